@@ -0,0 +1,143 @@
+#include "cpu.h"
+#include "stdinc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static constexpr long DEFAULT_INSTR_COUNT = 50000000;
+
+/*
+ * A tight loop of flag-setting instructions, where almost every flag gets
+ * overwritten before anything reads it
+ */
+static const u8 PROGRAM[] = {
+    0x80,       // loop: add a, b
+    0x89,       // adc a, c
+    0x92,       // sub d
+    0xAB,       // xor e
+    0x04,       // inc b
+    0x0D,       // dec c
+    0x07,       // rlca
+    0xBC,       // cp h
+    0xA5,       // and l
+    0xB7,       // or a
+    0xCB, 0x11, // rl c
+    0x15,       // dec d
+    0x20, 0xF1, // jr nz, loop
+    0x18, 0xEF, // jr loop
+};
+
+static u8 ram[0x10000];
+
+static u8 read_ram(const void *const ctx, const u16 addr)
+{
+    const u8 *const data = ctx;
+    return data[addr];
+}
+
+static void write_ram(void *const ctx, const u16 addr, const u8 value)
+{
+    u8 *const data = ctx;
+    data[addr] = value;
+}
+
+/**
+ * \brief Starts counting the host instructions retired by this thread.
+ *
+ * \return a file descriptor to read the count from, or -1 if unavailable.
+ */
+static int start_instr_counter()
+{
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    const int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+    if (fd != -1) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+static long long stop_instr_counter([[maybe_unused]] const int fd)
+{
+#if defined(__linux__)
+    long long count = 0;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+
+    close(fd);
+    return count;
+#else
+    return -1;
+#endif
+}
+
+static double now_seconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(const int argc, const char *const argv[])
+{
+    const long instr_count =
+        argc > 1 ? strtol(argv[1], nullptr, 10) : DEFAULT_INSTR_COUNT;
+
+    memcpy(&ram[0xC000], PROGRAM, sizeof(PROGRAM));
+
+    Memory mem = {
+        .ctx = ram,
+        .read = read_ram,
+        .write = write_ram,
+    };
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+
+    const int counter = start_instr_counter();
+    const double start = now_seconds();
+
+    for (long i = 0; i < instr_count; ++i)
+        Cpu_tick(&cpu, &mem);
+
+    const double elapsed = now_seconds() - start;
+    const long long host_instrs =
+        counter != -1 ? stop_instr_counter(counter) : -1;
+
+    // Keeps the whole run from being optimized away
+    printf("final a = $%02X, f = $%02X\n", cpu.a, Cpu_read_f(&cpu));
+    printf("%ld instructions in %.3f s (%.2f ns/instruction)\n", instr_count,
+           elapsed, elapsed * 1e9 / instr_count);
+
+    if (host_instrs >= 0)
+        printf("%.2f host instructions/instruction\n",
+               (double)host_instrs / instr_count);
+    else
+        printf("host instruction counter unavailable\n");
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "stdinc.h"
+#include "tile_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static constexpr long DEFAULT_PASSES = 20000;
+
+/**
+ * Tile data in VRAM, 384 tiles of 8 rows
+ */
+static constexpr size_t TILE_ROWS = 384 * 8;
+
+static const u8 COLOR_IDS[4] = {0, 1, 2, 3};
+
+static u8 data[TILE_ROWS * 2];
+static u8 pixels[TILE_ROWS * 8];
+
+static double now_seconds()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * \brief Decodes all of the tile data a number of times, both as is and
+ * flipped, and prints how long a row took.
+ */
+static void run(const char *const name, Decode2bppKernel *const kernel,
+                const long passes)
+{
+    const double start = now_seconds();
+
+    for (long i = 0; i < passes; ++i)
+        kernel(data, TILE_ROWS, COLOR_IDS, (i & 1) != 0, pixels);
+
+    const double elapsed = now_seconds() - start;
+
+    // Keeps the whole run from being optimized away
+    unsigned long sum = 0;
+    for (size_t i = 0; i < sizeof(pixels); ++i)
+        sum += pixels[i];
+
+    printf("%-7s %.3f s (%.2f ns/row, checksum %lu)\n", name, elapsed,
+           elapsed * 1e9 / ((double)passes * TILE_ROWS), sum);
+}
+
+int main(const int argc, const char *const argv[])
+{
+    const long passes =
+        argc > 1 ? strtol(argv[1], nullptr, 10) : DEFAULT_PASSES;
+
+    u32 seed = 1;
+
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        seed = (seed * 1103515245) + 12345;
+        data[i] = (u8)(seed >> 16);
+    }
+
+    printf("%ld passes over %zu rows\n", passes, TILE_ROWS);
+
+    run("scalar", decode_2bpp_scalar, passes);
+    run(decode_2bpp_kernel_name(), decode_2bpp, passes);
+
+    return 0;
+}
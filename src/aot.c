@@ -0,0 +1,272 @@
+#include "aot.h"
+#include "cpu.h"
+#include "data.h"
+#include "instructions.h"
+#include "macros.h"
+#include "mapper.h"
+#include "opcodes.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Entry points every ROM may start executing from: the RST vectors, the
+ * interrupt vectors and the cartridge entry point
+ */
+static constexpr u16 ROOTS[] = {
+    0x0000, 0x0008, 0x0010, 0x0018, 0x0020, 0x0028, 0x0030, 0x0038,
+    0x0040, 0x0048, 0x0050, 0x0058, 0x0060, 0x0100,
+};
+
+#define AOT_CALL(code, len, call) [0x##code] = #call,
+#define AOT_PREFIX_CALL(code, call) [0x##code] = #call,
+
+/**
+ * Source of the handler invocation of every opcode, as it appears in the
+ * opcode tables
+ */
+static const char *const OPCODE_CALLS[256] = {CPU_OPCODES(AOT_CALL)};
+
+static const char *const PREFIX_OPCODE_CALLS[256] = {
+    CPU_PREFIX_OPCODES(AOT_PREFIX_CALL)};
+
+u32 Aot_hash_rom(const u8 *const rom, const size_t rom_len)
+{
+    u32 hash = 0x811C9DC5;
+
+    for (size_t i = 0; i < rom_len; ++i) {
+        hash ^= rom[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/**
+ * \brief Gets the end of the address range code may be translated from.
+ */
+static size_t Aot_code_end(const u8 *const rom, const size_t rom_len)
+{
+    // Cartridges with a mapper may switch any bank into 4000-7FFF
+    if (rom_len > RomHeader_CartridgeType &&
+        CartridgeType_has_mapper(rom[RomHeader_CartridgeType]))
+        return MAPPER_ROM_BANK_LEN;
+
+    return rom_len < AOT_CODE_LEN ? rom_len : AOT_CODE_LEN;
+}
+
+static u16 Aot_read_imm(const u8 *const rom, const u16 addr, const u8 len)
+{
+    switch (len) {
+    case 2:
+        return rom[addr + 1];
+    case 3:
+        return rom[addr + 1] | (rom[addr + 2] << 8);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief Gets the static control flow successors of an instruction.
+ *
+ * \param succ where to write the successors to.
+ *
+ * \return the number of successors written to succ, at most 2.
+ */
+static size_t Aot_successors(const u8 *const rom, const u16 addr,
+                             u16 succ[2])
+{
+    const u8 opcode = rom[addr];
+    const u8 len = CPU_OPCODE_LENGTHS[opcode];
+    const u16 imm = Aot_read_imm(rom, addr, len);
+    const u16 next = addr + len;
+
+    switch (opcode) {
+    case 0x18: // jr e8
+        succ[0] = next + (i8)imm;
+        return 1;
+    case 0x20: // jr cc, e8
+    case 0x28:
+    case 0x30:
+    case 0x38:
+        succ[0] = next + (i8)imm;
+        succ[1] = next;
+        return 2;
+    case 0xC3: // jp a16
+        succ[0] = imm;
+        return 1;
+    case 0xC2: // jp cc, a16
+    case 0xCA:
+    case 0xD2:
+    case 0xDA:
+    case 0xC4: // call cc, a16
+    case 0xCC:
+    case 0xD4:
+    case 0xDC:
+    case 0xCD: // call a16
+        succ[0] = imm;
+        succ[1] = next;
+        return 2;
+    case 0xC7: // rst vec
+    case 0xCF:
+    case 0xD7:
+    case 0xDF:
+    case 0xE7:
+    case 0xEF:
+    case 0xF7:
+    case 0xFF:
+        succ[0] = opcode & 0x38;
+        succ[1] = next;
+        return 2;
+    case 0xC9: // ret
+    case 0xD9: // reti
+    case 0xE9: // jp hl
+        return 0;
+    default:
+        succ[0] = next;
+        return 1;
+    }
+}
+
+size_t Aot_find_code(const u8 *const rom, const size_t rom_len,
+                     bool is_code[AOT_CODE_LEN])
+{
+    const size_t end = Aot_code_end(rom, rom_len);
+
+    // Every address is pushed at most once, since it is marked right away
+    u16 *const stack = malloc(AOT_CODE_LEN * sizeof(*stack));
+    BAIL_IF_NULL(stack, "Could not allocate disassembly stack");
+
+    size_t stack_len = 0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < AOT_CODE_LEN; ++i)
+        is_code[i] = false;
+
+    for (size_t i = 0; i < sizeof(ROOTS) / sizeof(ROOTS[0]); ++i)
+        stack[stack_len++] = ROOTS[i];
+
+    while (stack_len != 0) {
+        const u16 addr = stack[--stack_len];
+
+        if (addr >= end || is_code[addr])
+            continue;
+
+        const u8 len = CPU_OPCODE_LENGTHS[rom[addr]];
+
+        // Removed opcodes and instructions cut off by the end of the range
+        // are left for the interpreter to deal with
+        if (len == 0 || addr + len > end)
+            continue;
+
+        is_code[addr] = true;
+        count++;
+
+        u16 succ[2];
+        const size_t succ_count = Aot_successors(rom, addr, succ);
+
+        for (size_t i = 0; i < succ_count; ++i) {
+            if (succ[i] < end && !is_code[succ[i]])
+                stack[stack_len++] = succ[i];
+        }
+    }
+
+    free(stack);
+    return count;
+}
+
+/**
+ * \brief Writes the translation of the instruction at an address, as a case of
+ * the dispatch switch.
+ */
+static void Aot_emit_instr(FILE *const out, const u8 *const rom,
+                           const u16 addr)
+{
+    const u8 opcode = rom[addr];
+    const u8 len = CPU_OPCODE_LENGTHS[opcode];
+    const u16 imm = Aot_read_imm(rom, addr, len);
+
+    fprintf(out, "    case 0x%04X: //", addr);
+    for (u8 i = 0; i < len; ++i)
+        fprintf(out, " %02X", rom[addr + i]);
+    fprintf(out, "\n");
+
+    // Fetching costs one cycle per byte, same as reading it from mem
+    fprintf(out, "        cpu->pc = 0x%04X;\n", (u16)(addr + len));
+    fprintf(out, "        cpu->cycle_count += %u;\n", len);
+
+    if (opcode == 0xCB)
+        fprintf(out, "        %s;\n", PREFIX_OPCODE_CALLS[imm]);
+    else if (len == 1)
+        fprintf(out, "        %s;\n", OPCODE_CALLS[opcode]);
+    else
+        fprintf(out, "        {\n"
+                     "            [[maybe_unused]] const u16 imm = 0x%04X;\n"
+                     "            %s;\n"
+                     "        }\n",
+                imm, OPCODE_CALLS[opcode]);
+
+    fprintf(out, "        return;\n");
+}
+
+void Aot_emit(FILE *const out, const u8 *const rom, const size_t rom_len,
+              const char *const rom_name)
+{
+    bool *const is_code = malloc(AOT_CODE_LEN * sizeof(*is_code));
+    BAIL_IF_NULL(is_code, "Could not allocate code map");
+
+    const size_t count = Aot_find_code(rom, rom_len, is_code);
+
+    fprintf(out,
+            "// Generated by gemu-aot from %s. Do not edit.\n"
+            "// %zu instructions translated.\n"
+            "\n"
+            "#include \"aot.h\"\n"
+            "#include \"cpu.h\"\n"
+            "#include \"instructions.h\"\n"
+            "#include \"instructions_inline.h\"\n"
+            "#include \"stdinc.h\"\n"
+            "\n"
+            "static void step(Cpu *const cpu, Memory *const mem)\n"
+            "{\n"
+            "    switch (cpu->pc) {\n",
+            rom_name, count);
+
+    for (size_t addr = 0; addr < AOT_CODE_LEN; ++addr) {
+        if (is_code[addr])
+            Aot_emit_instr(out, rom, addr);
+    }
+
+    fprintf(out,
+            "    default:\n"
+            "        Cpu_execute(cpu, mem, Cpu_read_pc(cpu, mem));\n"
+            "        return;\n"
+            "    }\n"
+            "}\n"
+            "\n"
+            "static const AotModule module = {\n"
+            "    .abi_version = %u,\n"
+            "    .cpu_size = sizeof(Cpu),\n"
+            "    .rom_hash = 0x%08X,\n"
+            "    .rom_len = %zu,\n"
+            "    .step = step,\n"
+            "};\n"
+            "\n"
+            "AOT_EXPORT const AotModule *gemu_aot_module()\n"
+            "{\n"
+            "    return &module;\n"
+            "}\n",
+            AOT_ABI_VERSION, Aot_hash_rom(rom, rom_len), rom_len);
+
+    free(is_code);
+}
+
+bool AotModule_matches(const AotModule *const module, const u8 *const rom,
+                       const size_t rom_len)
+{
+    return module->abi_version == AOT_ABI_VERSION &&
+           module->cpu_size == sizeof(Cpu) && module->rom_len == rom_len &&
+           module->rom_hash == Aot_hash_rom(rom, rom_len);
+}
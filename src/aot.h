@@ -0,0 +1,104 @@
+#ifndef GEMU_AOT_H
+#define GEMU_AOT_H
+
+#include "cpu.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Version of the interface between gemu and the modules generated by gemu-aot.
+ * Must be bumped whenever AotModule or the semantics of generated code change.
+ */
+constexpr u32 AOT_ABI_VERSION = 3;
+
+/**
+ * Length of the address range code is translated from (the unbanked ROM, or
+ * only its first bank on cartridges with a mapper)
+ */
+constexpr size_t AOT_CODE_LEN = 0x8000;
+
+/**
+ * Name of the AotModuleGetter every generated module exports
+ */
+#define AOT_MODULE_SYMBOL "gemu_aot_module"
+
+#if defined(_WIN32)
+#define AOT_EXPORT __declspec(dllexport)
+#else
+#define AOT_EXPORT __attribute__((visibility("default")))
+#endif
+
+/**
+ * A ROM translated ahead of time into native code.
+ *
+ * step executes exactly one instruction, just like Cpu_tick does after
+ * handling halting and queued interrupt enables. Instructions found by
+ * Aot_find_code run straight-line translated code, and anything else falls
+ * back to Cpu_execute.
+ */
+typedef struct AotModule {
+    u32 abi_version;
+    size_t cpu_size;
+    u32 rom_hash;
+    size_t rom_len;
+    void (*step)(Cpu *cpu, Memory *mem);
+} AotModule;
+
+/**
+ * The function exported as AOT_MODULE_SYMBOL by every generated module.
+ */
+typedef const AotModule *(*AotModuleGetter)();
+
+/**
+ * \brief Hashes a ROM, to tell whether a module was generated from it.
+ *
+ * \param rom the ROM data.
+ * \param rom_len the length of rom.
+ *
+ * \return the 32-bit FNV-1a hash of rom.
+ */
+[[nodiscard]] u32 Aot_hash_rom(const u8 *rom, size_t rom_len);
+
+/**
+ * \brief Finds every instruction statically reachable in a ROM.
+ *
+ * Disassembles recursively from the entry point at $0100, the RST vectors and
+ * the interrupt vectors, following every jump, call and branch with a static
+ * target. Targets outside of the ROM and jumps through hl are left for the
+ * interpreter.
+ *
+ * \param rom the ROM data.
+ * \param rom_len the length of rom.
+ * \param is_code where to mark the address of every instruction found.
+ *
+ * \return the number of instructions found.
+ */
+size_t Aot_find_code(const u8 *rom, size_t rom_len,
+                     bool is_code[AOT_CODE_LEN]);
+
+/**
+ * \brief Translates a ROM into a C translation unit defining an AotModule.
+ *
+ * \param out the stream to write the translation unit to.
+ * \param rom the ROM data.
+ * \param rom_len the length of rom.
+ * \param rom_name a name for the ROM, written into a comment.
+ *
+ * \sa Aot_find_code
+ */
+void Aot_emit(FILE *out, const u8 *rom, size_t rom_len, const char *rom_name);
+
+/**
+ * \brief Checks whether a module can run a given ROM on this build of gemu.
+ *
+ * \param module the module to check.
+ * \param rom the ROM data.
+ * \param rom_len the length of rom.
+ *
+ * \return whether module was generated from rom, against this AOT interface.
+ */
+[[nodiscard]] bool AotModule_matches(const AotModule *module, const u8 *rom,
+                                     size_t rom_len);
+
+#endif
@@ -0,0 +1,64 @@
+#include "aot.h"
+#include "log.h"
+#include "rom_image.h"
+#include "stdinc.h"
+#include <argparse.h>
+#include <stddef.h>
+#include <stdio.h>
+
+static const char *const usages[] = {
+    "gemu-aot [options] [--] <path-to-rom>",
+    nullptr,
+};
+
+int main(int argc, const char *argv[])
+{
+    const char *output_path = nullptr;
+
+    struct argparse_option options[] = {
+        OPT_HELP(),
+        OPT_STRING('o', "output", (void *)&output_path,
+                   "path to write the generated C file to (default: stdout)",
+                   nullptr, 0, 0),
+        OPT_END(),
+    };
+
+    struct argparse argparse;
+    argparse_init(&argparse, options, usages, 0);
+    argparse_describe(
+        &argparse,
+        "Translates a Game Boy ROM into C code that gemu can load with --aot.",
+        nullptr);
+
+    argc = argparse_parse(&argparse, argc, argv);
+
+    if (argc < 1) {
+        argparse_usage(&argparse);
+        return 1;
+    }
+
+    logger_init(LogLevel_Info);
+
+    RomImage *const rom = RomImage_open(argv[0]);
+
+    if (rom == nullptr) {
+        log_error("Could not read ROM file %s", argv[0]);
+        return 1;
+    }
+
+    FILE *const out = output_path != nullptr ? fopen(output_path, "w") : stdout;
+
+    if (out == nullptr) {
+        log_error("Could not open output file %s", output_path);
+        RomImage_release(rom);
+        return 1;
+    }
+
+    Aot_emit(out, rom->data, rom->len, argv[0]);
+
+    if (out != stdout)
+        fclose(out);
+
+    RomImage_release(rom);
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "cheats.h"
+#include "macros.h"
+#include "mapper.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Maximum number of hex digits in a cheat code
+ */
+static constexpr size_t CODE_MAX_DIGITS = 9;
+
+static int hex_digit(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+static bool freeze_addr_valid(const u16 addr)
+{
+    // 8000-DFFF (VRAM, external RAM and WRAM), FF80-FFFE (High RAM)
+    return (addr >= 0x8000 && addr <= 0xDFFF) ||
+           (addr >= 0xFF80 && addr <= 0xFFFE);
+}
+
+bool Cheat_parse(const char *const code, Cheat *const cheat)
+{
+    u8 digits[CODE_MAX_DIGITS];
+    size_t len = 0;
+
+    for (const char *c = code; *c != '\0'; ++c) {
+        if (*c == '-')
+            continue;
+
+        const int digit = hex_digit(*c);
+
+        if (digit < 0 || len == CODE_MAX_DIGITS)
+            return false;
+
+        digits[len++] = (u8)digit;
+    }
+
+    if (len == 8) {
+        // ttvvllhh
+        const u16 addr =
+            (u16)((digits[6] << 12) | (digits[7] << 8) | (digits[4] << 4) |
+                  digits[5]);
+
+        if (!freeze_addr_valid(addr))
+            return false;
+
+        *cheat = (Cheat){
+            .kind = CheatKind_RamFreeze,
+            .addr = addr,
+            .value = (u8)((digits[2] << 4) | digits[3]),
+            .has_compare = false,
+            .compare = 0,
+        };
+        return true;
+    }
+
+    if (len != 6 && len != 9)
+        return false;
+
+    // ABC-DEF-GHI
+    const u16 addr = (u16)(((digits[5] ^ 0xF) << 12) | (digits[2] << 8) |
+                           (digits[3] << 4) | digits[4]);
+
+    if (addr > 0x7FFF)
+        return false;
+
+    *cheat = (Cheat){
+        .kind = CheatKind_RomPatch,
+        .addr = addr,
+        .value = (u8)((digits[0] << 4) | digits[1]),
+        .has_compare = len == 9,
+        .compare = 0,
+    };
+
+    if (cheat->has_compare) {
+        // G and I hold the compare value rotated left by 2 and scrambled, and
+        // H is only a checksum
+        const u8 rotated = (u8)((digits[6] << 4) | digits[8]);
+        cheat->compare = (u8)(((rotated >> 2) | (rotated << 6)) ^ 0xBA);
+    }
+
+    return true;
+}
+
+Cheats *Cheats_new()
+{
+    Cheats *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate cheats");
+
+    *self = (Cheats){
+        .rom_pages = nullptr,
+        .rom_pages_len = 0,
+        .patched = {},
+        .freezes = nullptr,
+        .freezes_len = 0,
+    };
+
+    return self;
+}
+
+void Cheats_destroy(Cheats *const self)
+{
+    if (self == nullptr)
+        return;
+
+    Cheats_clear(self);
+    free(self);
+}
+
+void Cheats_clear(Cheats *const self)
+{
+    for (size_t i = 0; i < self->rom_pages_len; ++i)
+        free(self->rom_pages[i].data);
+
+    free(self->rom_pages);
+    free(self->freezes);
+
+    self->rom_pages = nullptr;
+    self->rom_pages_len = 0;
+    self->freezes = nullptr;
+    self->freezes_len = 0;
+    memset(self->patched, 0, sizeof(self->patched));
+}
+
+/**
+ * \brief Gets the patched copy of a page of a ROM bank, copying it from ROM
+ * if no patch has applied to it yet.
+ */
+static u8 *Cheats_shadow_page(Cheats *const self, const u8 page,
+                              const size_t bank, const u8 *const rom)
+{
+    for (size_t i = 0; i < self->rom_pages_len; ++i) {
+        CheatRomPage *const rom_page = &self->rom_pages[i];
+
+        if (rom_page->page == page && rom_page->bank == bank)
+            return rom_page->data;
+    }
+
+    u8 *const data = malloc(0x100);
+    BAIL_IF_NULL(data, "Could not allocate patched ROM page");
+
+    memcpy(data,
+           &rom[bank * MAPPER_ROM_BANK_LEN + (((size_t)page << 8) & 0x3FFF)],
+           0x100);
+
+    self->rom_pages =
+        realloc(self->rom_pages,
+                (self->rom_pages_len + 1) * sizeof(self->rom_pages[0]));
+    BAIL_IF_NULL(self->rom_pages, "Could not allocate patched ROM pages");
+
+    self->rom_pages[self->rom_pages_len++] = (CheatRomPage){
+        .page = page,
+        .bank = bank,
+        .data = data,
+    };
+    self->patched[page] = true;
+
+    return data;
+}
+
+void Cheats_add(Cheats *const self, const Cheat *const cheat,
+                const u8 *const rom, const size_t rom_len)
+{
+    if (cheat->kind == CheatKind_RamFreeze) {
+        BAIL_IF(!freeze_addr_valid(cheat->addr),
+                "Cannot freeze memory other than RAM (addr = $%04X)",
+                cheat->addr);
+
+        self->freezes = realloc(self->freezes, (self->freezes_len + 1) *
+                                                   sizeof(self->freezes[0]));
+        BAIL_IF_NULL(self->freezes, "Could not allocate RAM freezes");
+
+        self->freezes[self->freezes_len++] = *cheat;
+        return;
+    }
+
+    BAIL_IF(cheat->addr > 0x7FFF,
+            "Cannot patch memory other than ROM (addr = $%04X)", cheat->addr);
+
+    const u8 page = cheat->addr >> 8;
+    const size_t offset = cheat->addr & 0x3FFF;
+
+    // Compared against the original ROM, even where other patches apply
+    for (size_t bank = 0; bank < rom_len / MAPPER_ROM_BANK_LEN; ++bank) {
+        if (cheat->has_compare &&
+            rom[bank * MAPPER_ROM_BANK_LEN + offset] != cheat->compare)
+            continue;
+
+        u8 *const data = Cheats_shadow_page(self, page, bank, rom);
+        data[cheat->addr & 0xFF] = cheat->value;
+    }
+}
+
+const u8 *Cheats_rom_page(const Cheats *const self, const u8 page,
+                          const size_t bank)
+{
+    if (page >= sizeof(self->patched) || !self->patched[page])
+        return nullptr;
+
+    for (size_t i = 0; i < self->rom_pages_len; ++i) {
+        const CheatRomPage *const rom_page = &self->rom_pages[i];
+
+        if (rom_page->page == page && rom_page->bank == bank)
+            return rom_page->data;
+    }
+
+    return nullptr;
+}
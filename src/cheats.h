@@ -0,0 +1,123 @@
+#ifndef GEMU_CHEATS_H
+#define GEMU_CHEATS_H
+
+#include "stdinc.h"
+#include <stddef.h>
+
+typedef enum : u8 {
+    /** Substitutes a byte of ROM, like a Game Genie code */
+    CheatKind_RomPatch,
+    /** Keeps a byte of RAM at a value, like a GameShark code */
+    CheatKind_RamFreeze,
+} CheatKind;
+
+typedef struct {
+    CheatKind kind;
+    u16 addr;
+    u8 value;
+    /** Whether a ROM patch only applies where ROM holds compare */
+    bool has_compare;
+    u8 compare;
+} Cheat;
+
+/**
+ * \brief A 256-byte page of a ROM bank, as seen through the ROM patches
+ * covering it.
+ */
+typedef struct {
+    u8 page;
+    size_t bank;
+    u8 *data;
+} CheatRomPage;
+
+/**
+ * The cheats active on a loaded ROM.
+ *
+ * ROM patches are applied ahead of time to shadow copies of only the pages
+ * they cover, which the GameBoy maps in place of the originals. Every other
+ * page keeps pointing straight at ROM, so that cheats cost nothing where they
+ * do not apply.
+ *
+ * RAM freezes are re-applied by the owner of the Cheats, once per frame.
+ */
+typedef struct Cheats {
+    CheatRomPage *rom_pages;
+    size_t rom_pages_len;
+    bool patched[0x80];
+    Cheat *freezes;
+    size_t freezes_len;
+} Cheats;
+
+/**
+ * \brief Parses a cheat code.
+ *
+ * Codes with 8 hex digits (ttvvllhh) are GameShark codes, which freeze the
+ * byte at $hhll to $vv. Their type and bank byte tt is ignored.
+ *
+ * Codes with 6 or 9 hex digits (ABC-DEF or ABC-DEF-GHI, with optional dashes)
+ * are Game Genie codes, which patch the byte of ROM at $FCDE ^ $F000 to $AB,
+ * optionally only where it held the value encoded by GHI.
+ *
+ * \param code the cheat code.
+ * \param cheat where to write the parsed cheat.
+ *
+ * \return whether code is a valid cheat code, which only ever patches ROM or
+ * freezes RAM.
+ */
+[[nodiscard]] bool Cheat_parse(const char *code, Cheat *cheat);
+
+/**
+ * \brief Allocates an empty set of Cheats.
+ *
+ * The created Cheats must eventually be freed with Cheats_destroy.
+ *
+ * \return the allocated Cheats.
+ *
+ * \sa Cheats_destroy
+ */
+[[nodiscard]] Cheats *Cheats_new();
+
+/**
+ * \brief Frees previously-allocated Cheats.
+ *
+ * \param self the Cheats to free. May be NULL.
+ *
+ * \sa Cheats_new
+ */
+void Cheats_destroy(Cheats *self);
+
+/**
+ * \brief Removes every cheat, such as when another ROM is loaded.
+ *
+ * \param self the Cheats to clear.
+ */
+void Cheats_clear(Cheats *self);
+
+/**
+ * \brief Adds a cheat.
+ *
+ * ROM patches are applied to every bank that may be mapped at their address,
+ * unless they have a compare value the bank does not hold there.
+ *
+ * \param self the Cheats.
+ * \param cheat the cheat to add, as parsed by Cheat_parse.
+ * \param rom the ROM the cheat applies to.
+ * \param rom_len the length of rom, in whole banks.
+ */
+void Cheats_add(Cheats *self, const Cheat *cheat, const u8 *rom,
+                size_t rom_len);
+
+/**
+ * \brief Gets the patched copy of a page of a ROM bank.
+ *
+ * \param self the Cheats.
+ * \param page the page of the address space the bank is mapped at, from $00
+ * to $7F.
+ * \param bank the ROM bank.
+ *
+ * \return the patched page, or nullptr if no ROM patch applies to it.
+ */
+[[nodiscard]] const u8 *Cheats_rom_page(const Cheats *self, u8 page,
+                                        size_t bank);
+
+#endif
@@ -1,8 +1,15 @@
 #include "cpu.h"
+#include "aot.h"
+#include "cpu_bus.h"
+#include "decode_cache.h"
+#include "idiom.h"
 #include "instructions.h"
+#include "jit.h"
 #include "macros.h"
 #include "num.h"
 #include "stdinc.h"
+#include <limits.h>
+#include <stddef.h>
 
 Cpu Cpu_new()
 {
@@ -15,224 +22,199 @@ Cpu Cpu_new()
         .l = 0,
         .a = 0,
         .f = 0,
+        .flags_op = CpuFlagsOp_None,
+        .flags_lhs = 0,
+        .flags_rhs = 0,
+        .flags_res = 0,
         .pc = 0,
         .sp = 0,
         .mode = CpuMode_Running,
         .queued_ime = false,
         .ime = true,
         .cycle_count = 0,
+        .max_tick_cycles = INT_MAX,
+        .decode_cache = nullptr,
+        .jit = nullptr,
+        .aot = nullptr,
+        .idioms = nullptr,
+        .on_cycle = nullptr,
+        .on_cycle_ctx = nullptr,
     };
 }
 
+#if CPU_BIG_ENDIAN
+const u8 CPU_R8_INDEX[8] = {0, 1, 2, 3, 4, 5, 0, 8};
+#else
+const u8 CPU_R8_INDEX[8] = {1, 0, 3, 2, 5, 4, 0, 9};
+#endif
+
+static_assert(offsetof(Cpu, sp) == sizeof(u16) * CpuTableRp_SP);
+
+extern inline u16 Cpu_read_rp(const Cpu *self, CpuTableRp rp);
+extern inline void Cpu_write_rp(Cpu *self, CpuTableRp rp, u16 value);
+extern inline u8 Cpu_read_r(Cpu *self, const Memory *mem, CpuTableR r);
+extern inline void Cpu_write_r(Cpu *self, Memory *mem, CpuTableR r, u8 value);
+extern inline void Cpu_set_flags_op(Cpu *self, CpuFlagsOp op, u8 lhs, u8 rhs,
+                                    u16 res);
+extern inline bool Cpu_read_flag_z(const Cpu *self);
+extern inline bool Cpu_read_flag_c(const Cpu *self);
+
+u8 Cpu_read_f(const Cpu *const self)
+{
+    // Additions and subtractions (with or without carry) flip bit 4 of the
+    // result exactly when there is a carry or borrow out of the low nibble
+    const bool half_carry =
+        ((self->flags_lhs ^ self->flags_rhs ^ self->flags_res) & 0x10) != 0;
+
+    u8 f = 0;
+
+    switch (self->flags_op) {
+    case CpuFlagsOp_None:
+        return self->f;
+    case CpuFlagsOp_Add:
+        f = half_carry ? CpuFlag_H : 0;
+        break;
+    case CpuFlagsOp_Sub:
+        f = CpuFlag_N | (half_carry ? CpuFlag_H : 0);
+        break;
+    case CpuFlagsOp_And:
+        f = CpuFlag_H;
+        break;
+    case CpuFlagsOp_Result:
+    case CpuFlagsOp_Carry:
+        break;
+    default:
+        BAIL("invalid flags op: %i", self->flags_op);
+    }
+
+    if (Cpu_read_flag_z(self))
+        f |= CpuFlag_Z;
+
+    if (Cpu_read_flag_c(self))
+        f |= CpuFlag_C;
+
+    return f;
+}
+
+void Cpu_write_f(Cpu *const self, const u8 value)
+{
+    self->f = value & 0xF0;
+    self->flags_op = CpuFlagsOp_None;
+}
+
+void Cpu_materialize_flags(Cpu *const self)
+{
+    self->f = Cpu_read_f(self);
+    self->flags_op = CpuFlagsOp_None;
+}
+
 bool Cpu_read_cc(const Cpu *const self, const CpuTableCc cc)
 {
     switch (cc) {
     case CpuTableCc_NZ:
-        return (self->f & CpuFlag_Z) == 0;
+        return !Cpu_read_flag_z(self);
     case CpuTableCc_Z:
-        return (self->f & CpuFlag_Z) != 0;
+        return Cpu_read_flag_z(self);
     case CpuTableCc_NC:
-        return (self->f & CpuFlag_C) == 0;
+        return !Cpu_read_flag_c(self);
     case CpuTableCc_C:
-        return (self->f & CpuFlag_C) != 0;
+        return Cpu_read_flag_c(self);
     default:
         BAIL("invalid cc: %i", cc);
     }
 }
 
-u16 Cpu_read_rp(const Cpu *const self, const CpuTableRp rp)
+u16 Cpu_read_rp2(const Cpu *const self, const CpuTableRp2 rp)
 {
-    switch (rp) {
-    case CpuTableRp_BC:
-        return concat_u16(self->b, self->c);
-    case CpuTableRp_DE:
-        return concat_u16(self->d, self->e);
-    case CpuTableRp_HL:
-        return concat_u16(self->h, self->l);
-    case CpuTableRp_SP:
-        return self->sp;
-    default:
-        BAIL("invalid rp: %i", rp);
-    }
+    if (rp == CpuTableRp2_AF)
+        return concat_u16(self->a, Cpu_read_f(self));
+
+    return self->r16[rp];
 }
 
-void Cpu_write_rp(Cpu *const self, const CpuTableRp rp, const u16 value)
+void Cpu_write_rp2(Cpu *const self, const CpuTableRp2 rp, const u16 value)
 {
-    switch (rp) {
-    case CpuTableRp_BC:
-        self->b = value >> 8;
-        self->c = value & 0xFF;
-        break;
-    case CpuTableRp_DE:
-        self->d = value >> 8;
-        self->e = value & 0xFF;
-        break;
-    case CpuTableRp_HL:
-        self->h = value >> 8;
-        self->l = value & 0xFF;
-        break;
-    case CpuTableRp_SP:
-        self->sp = value;
-        break;
-    default:
-        BAIL("invalid rp: %i", rp);
+    if (rp == CpuTableRp2_AF) {
+        self->a = value >> 8;
+        Cpu_write_f(self, value & 0xFF);
+    } else {
+        self->r16[rp] = value;
     }
 }
 
-u16 Cpu_read_rp2(const Cpu *const self, const CpuTableRp rp)
+const u8 *Memory_get_span(const Memory *const self, const u16 addr,
+                          size_t *const len)
 {
-    switch (rp) {
-    case CpuTableRp2_BC:
-        return concat_u16(self->b, self->c);
-    case CpuTableRp2_DE:
-        return concat_u16(self->d, self->e);
-    case CpuTableRp2_HL:
-        return concat_u16(self->h, self->l);
-    case CpuTableRp2_AF:
-        return concat_u16(self->a, self->f);
-    default:
-        BAIL("invalid rp2: %i", rp);
+    if (self->get_span == nullptr)
+        return nullptr;
+
+    return self->get_span(self->ctx, addr, len);
+}
+
+void Memory_read_block(const Memory *const self, const u16 addr, u8 *const dst,
+                       const size_t len)
+{
+    if (self->read_block != nullptr) {
+        self->read_block(self->ctx, addr, dst, len);
+        return;
     }
+
+    for (size_t i = 0; i < len; ++i)
+        dst[i] = self->read(self->ctx, (u16)(addr + i));
 }
 
-void Cpu_write_rp2(Cpu *const self, const CpuTableRp rp, const u16 value)
+void Memory_write_block(Memory *const self, const u16 addr,
+                        const u8 *const src, const size_t len)
 {
-    switch (rp) {
-    case CpuTableRp2_BC:
-        self->b = value >> 8;
-        self->c = value & 0xFF;
-        break;
-    case CpuTableRp2_DE:
-        self->d = value >> 8;
-        self->e = value & 0xFF;
-        break;
-    case CpuTableRp2_HL:
-        self->h = value >> 8;
-        self->l = value & 0xFF;
-        break;
-    case CpuTableRp2_AF:
-        self->a = value >> 8;
-        self->f = value & 0xF0;
-        break;
-    default:
-        BAIL("invalid rp2: %i", rp);
+    if (self->write_block != nullptr) {
+        self->write_block(self->ctx, addr, src, len);
+        return;
     }
+
+    for (size_t i = 0; i < len; ++i)
+        self->write(self->ctx, (u16)(addr + i), src[i]);
 }
 
 u8 Cpu_read_mem(Cpu *const self, const Memory *const mem, const u16 addr)
 {
-    self->cycle_count++;
-    return mem->read(mem->ctx, addr);
+    return Cpu_bus_read(self, mem, addr);
 }
 
 u16 Cpu_read_mem_u16(Cpu *const self, const Memory *const mem, const u16 addr)
 {
-    const u8 lo = Cpu_read_mem(self, mem, addr);
-    const u8 hi = Cpu_read_mem(self, mem, addr + 1);
-    return concat_u16(hi, lo);
+    return Cpu_bus_read_u16(self, mem, addr);
 }
 
 void Cpu_write_mem(Cpu *const self, Memory *const mem, const u16 addr,
                    const u8 value)
 {
-    self->cycle_count++;
-    mem->write(mem->ctx, addr, value);
+    Cpu_bus_write(self, mem, addr, value);
 }
 
 void Cpu_write_mem_u16(Cpu *const self, Memory *const mem, const u16 addr,
                        const u16 value)
 {
-    Cpu_write_mem(self, mem, addr, value & 0xFF);
-    Cpu_write_mem(self, mem, addr + 1, value >> 8);
+    Cpu_bus_write_u16(self, mem, addr, value);
 }
 
 u8 Cpu_read_pc(Cpu *const self, const Memory *const mem)
 {
-    const u8 value = Cpu_read_mem(self, mem, self->pc);
-    self->pc++;
-    return value;
+    return Cpu_bus_read_pc(self, mem);
 }
 
 u16 Cpu_read_pc_u16(Cpu *const self, const Memory *const mem)
 {
-    const u16 value = Cpu_read_mem_u16(self, mem, self->pc);
-    self->pc += 2;
-    return value;
+    return Cpu_bus_read_pc_u16(self, mem);
 }
 
 void Cpu_stack_push_u16(Cpu *const self, Memory *const mem, const u16 value)
 {
-    self->sp -= 2;
-    Cpu_write_mem_u16(self, mem, self->sp, value);
-    self->cycle_count++;
+    Cpu_bus_push_u16(self, mem, value);
 }
 
 u16 Cpu_stack_pop_u16(Cpu *const self, const Memory *mem)
 {
-    const u16 value = Cpu_read_mem_u16(self, mem, self->sp);
-    self->sp += 2;
-    return value;
-}
-
-u8 Cpu_read_r(Cpu *const self, const Memory *const mem, const CpuTableR r)
-{
-    switch (r) {
-    case CpuTableR_B:
-        return self->b;
-    case CpuTableR_C:
-        return self->c;
-    case CpuTableR_D:
-        return self->d;
-    case CpuTableR_E:
-        return self->e;
-    case CpuTableR_H:
-        return self->h;
-    case CpuTableR_L:
-        return self->l;
-    case CpuTableR_HL: {
-        const u16 addr = Cpu_read_rp(self, CpuTableRp_HL);
-        return Cpu_read_mem(self, mem, addr);
-    }
-    case CpuTableR_A:
-        return self->a;
-    default:
-        BAIL("invalid cpu r: %i", r);
-    }
-}
-
-void Cpu_write_r(Cpu *const self, Memory *const mem, const CpuTableR r,
-                 const u8 value)
-{
-    switch (r) {
-    case CpuTableR_B:
-        self->b = value;
-        break;
-    case CpuTableR_C:
-        self->c = value;
-        break;
-    case CpuTableR_D:
-        self->d = value;
-        break;
-    case CpuTableR_E:
-        self->e = value;
-        break;
-    case CpuTableR_H:
-        self->h = value;
-        break;
-    case CpuTableR_L:
-        self->l = value;
-        break;
-    case CpuTableR_HL: {
-        const u16 addr = Cpu_read_rp(self, CpuTableRp_HL);
-        Cpu_write_mem(self, mem, addr, value);
-        break;
-    }
-    case CpuTableR_A:
-        self->a = value;
-        break;
-    default:
-        BAIL("[GameBoy_write_r] invalid CpuTableR r: %i", r);
-    }
+    return Cpu_bus_pop_u16(self, mem);
 }
 
 void Cpu_tick(Cpu *const self, Memory *const mem)
@@ -247,15 +229,78 @@ void Cpu_tick(Cpu *const self, Memory *const mem)
         self->queued_ime = false;
     }
 
+    if (self->aot != nullptr) {
+        self->aot->step(self, mem);
+        return;
+    }
+
+    if (self->jit != nullptr &&
+        Jit_run(self->jit, self, mem, self->max_tick_cycles))
+        return;
+
+    if (self->decode_cache != nullptr) {
+        const DecodedInstr *const instr =
+            DecodeCache_fetch(self->decode_cache, mem, self->pc);
+
+        if (instr != nullptr) {
+            // Fetching costs one cycle per byte, same as reading it from mem
+            self->pc += instr->len;
+            self->cycle_count += instr->len;
+            instr->handler(self, mem, instr->imm);
+            return;
+        }
+    }
+
     const u8 opcode = Cpu_read_pc(self, mem);
     Cpu_execute(self, mem, opcode);
 }
 
-void Cpu_interrupt(Cpu *const self, Memory *const mem,
-                   const u8 handler_location)
+void Cpu_invalidate_code(Cpu *const self, const u16 addr)
 {
-    Cpu_stack_push_u16(self, mem, self->pc);
-    self->ime = false;
-    self->pc = handler_location;
-    self->cycle_count += 2;
+    if (self->decode_cache != nullptr)
+        DecodeCache_invalidate(self->decode_cache, addr);
+
+    if (self->jit != nullptr)
+        Jit_invalidate(self->jit, addr);
+
+    if (self->idioms != nullptr)
+        IdiomCache_invalidate(self->idioms, addr);
+}
+
+void Cpu_invalidate_code_range(Cpu *const self, const u16 start,
+                               const u16 end)
+{
+    if (self->decode_cache != nullptr)
+        DecodeCache_invalidate_range(self->decode_cache, start, end);
+
+    if (self->jit != nullptr)
+        Jit_invalidate_range(self->jit, start, end);
+
+    if (self->idioms != nullptr)
+        IdiomCache_invalidate_range(self->idioms, start, end);
+}
+
+void Cpu_map_code(Cpu *const self, const u8 first_page, const u8 last_page,
+                  const size_t first_id)
+{
+    if (self->decode_cache != nullptr)
+        DecodeCache_map(self->decode_cache, first_page, last_page, first_id);
+
+    if (self->jit != nullptr)
+        Jit_map(self->jit, first_page, last_page, first_id);
+
+    if (self->idioms != nullptr)
+        IdiomCache_map(self->idioms, first_page, last_page, first_id);
+}
+
+void Cpu_flush_code(Cpu *const self)
+{
+    if (self->decode_cache != nullptr)
+        DecodeCache_flush(self->decode_cache);
+
+    if (self->jit != nullptr)
+        Jit_flush(self->jit);
+
+    if (self->idioms != nullptr)
+        IdiomCache_flush(self->idioms);
 }
@@ -2,6 +2,7 @@
 #define GEMU_CPU_H
 
 #include "stdinc.h"
+#include <stddef.h>
 
 typedef enum : u8 {
     CpuFlag_C = 1 << 4,
@@ -53,46 +54,268 @@ typedef enum : u8 {
     CpuTableAlu_Cp = 7,
 } CpuTableAlu;
 
+/**
+ * The address space a Cpu runs on.
+ *
+ * Only read and write are required. The rest may be left as NULL, and let bulk
+ * accesses skip calling read and write for every byte wherever memory is plain.
+ * Use Memory_get_span, Memory_read_block and Memory_write_block, which fall
+ * back to read and write when they are missing, rather than calling them
+ * directly.
+ *
+ * Block accesses wrap around from $FFFF to $0000, and must have the same
+ * effect as accessing each byte in turn.
+ */
 typedef struct {
     void *ctx;
     u8 (*read)(const void *ctx, u16 addr);
     void (*write)(void *ctx, u16 addr, u8 value);
+    const u8 *(*get_span)(const void *ctx, u16 addr, size_t *len);
+    void (*read_block)(const void *ctx, u16 addr, u8 *dst, size_t len);
+    void (*write_block)(void *ctx, u16 addr, const u8 *src, size_t len);
 } Memory;
 
+/**
+ * \brief Gets a pointer to the plain memory starting at an address, which can
+ * be read from directly.
+ *
+ * \param self the Memory.
+ * \param addr the address the span starts at.
+ * \param len where to store how many bytes the span is long, which is never 0.
+ *
+ * \return the span, or NULL if addr is not plain memory, in which case len is
+ * left alone.
+ */
+[[nodiscard]] const u8 *Memory_get_span(const Memory *self, u16 addr,
+                                        size_t *len);
+
+/**
+ * \brief Reads a block of memory.
+ *
+ * \param self the Memory.
+ * \param addr the address of the first byte to read.
+ * \param dst where to store the bytes read.
+ * \param len the number of bytes to read, up to $10000.
+ */
+void Memory_read_block(const Memory *self, u16 addr, u8 *dst, size_t len);
+
+/**
+ * \brief Writes a block of memory.
+ *
+ * \param self the Memory.
+ * \param addr the address of the first byte to write.
+ * \param src the bytes to write, which must not be written to by the block
+ * itself.
+ * \param len the number of bytes to write, up to $10000.
+ */
+void Memory_write_block(Memory *self, u16 addr, const u8 *src, size_t len);
+
+typedef struct DecodeCache DecodeCache;
+
+typedef struct Jit Jit;
+
+typedef struct AotModule AotModule;
+
+typedef struct IdiomCache IdiomCache;
+
+/**
+ * How the flags derive from the last operation that set them.
+ *
+ * Instead of updating every flag in f, flag-setting instructions record their
+ * operands and result, along with one of these, and the flags are only
+ * computed once something reads them. For every operation except
+ * CpuFlagsOp_None, C is bit 8 of flags_res, and Z (when derived) is set if the
+ * low byte of flags_res is zero.
+ *
+ * \sa Cpu_read_f, Cpu_materialize_flags
+ */
+typedef enum : u8 {
+    /** f holds every flag */
+    CpuFlagsOp_None,
+    /** Z and C from flags_res, N = 0, H from an addition */
+    CpuFlagsOp_Add,
+    /** Z and C from flags_res, N = 1, H from a subtraction */
+    CpuFlagsOp_Sub,
+    /** Z and C from flags_res, N = 0, H = 1 */
+    CpuFlagsOp_And,
+    /** Z and C from flags_res, N = H = 0 */
+    CpuFlagsOp_Result,
+    /** C from flags_res, Z = N = H = 0 */
+    CpuFlagsOp_Carry,
+} CpuFlagsOp;
+
 typedef enum : u8 {
     CpuMode_Running,
     CpuMode_Halted,
     CpuMode_Stopped,
 } CpuMode;
 
+/**
+ * How closely everything else follows the Cpu's timing.
+ *
+ * \sa Cpu_tick, Cpu_tick_accurate
+ */
+typedef enum : u8 {
+    /** Whole instructions run at once, and are caught up with afterwards */
+    CpuTier_Fast,
+    /** Everything else advances in step with every M-cycle */
+    CpuTier_Accurate,
+} CpuTier;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CPU_BIG_ENDIAN 1
+#else
+#define CPU_BIG_ENDIAN 0
+#endif
+
+/**
+ * Index of every CpuTableR register into Cpu.r8. CpuTableR_HL refers to
+ * memory, so its entry is meaningless.
+ */
+extern const u8 CPU_R8_INDEX[8];
+
 typedef struct {
-    u8 b;
-    u8 c;
-    u8 d;
-    u8 e;
-    u8 h;
-    u8 l;
-    u8 a;
-    u8 f;
-    u16 sp;
+    /*
+     * The register file, laid out so that BC, DE, HL and SP can be accessed
+     * as native u16s, indexed by CpuTableRp. AF is not meant to be accessed
+     * as a pair, since f may be out of date (see CpuFlagsOp).
+     */
+    union {
+        struct {
+#if CPU_BIG_ENDIAN
+            u8 b, c, d, e, h, l;
+            u16 sp;
+            u8 a, f;
+#else
+            u8 c, b, e, d, l, h;
+            u16 sp;
+            u8 f, a;
+#endif
+        };
+        u8 r8[10];
+        u16 r16[5];
+    };
+    CpuFlagsOp flags_op;
+    u8 flags_lhs;
+    u8 flags_rhs;
+    u16 flags_res;
     u16 pc;
     CpuMode mode;
     bool queued_ime;
     bool ime;
     int cycle_count;
+    /*
+     * The most M-cycles a single Cpu_tick may spend running compiled code,
+     * which can run many instructions at once. INT_MAX unless the caller has
+     * events to catch up on first.
+     */
+    int max_tick_cycles;
+    DecodeCache *decode_cache;
+    Jit *jit;
+    const AotModule *aot;
+    IdiomCache *idioms;
+    /*
+     * Called at the end of every M-cycle by the accurate tier, with
+     * on_cycle_ctx. Unused by the fast tier.
+     */
+    void (*on_cycle)(void *ctx);
+    void *on_cycle_ctx;
 } Cpu;
 
 [[nodiscard]] Cpu Cpu_new();
 
+/**
+ * \brief Records the operation that last set the flags, to compute them from
+ * later on.
+ *
+ * \param self the Cpu.
+ * \param op how the flags derive from the operation.
+ * \param lhs the left operand, used to compute H after additions and
+ * subtractions.
+ * \param rhs the right operand, used likewise.
+ * \param res the result in its low byte, and C in bit 8.
+ *
+ * \sa CpuFlagsOp
+ */
+inline void Cpu_set_flags_op(Cpu *const self, const CpuFlagsOp op,
+                             const u8 lhs, const u8 rhs, const u16 res)
+{
+    self->flags_op = op;
+    self->flags_lhs = lhs;
+    self->flags_rhs = rhs;
+    self->flags_res = res;
+}
+
+/**
+ * \brief Computes the Z flag alone, without materializing the others.
+ */
+[[nodiscard]] inline bool Cpu_read_flag_z(const Cpu *const self)
+{
+    switch (self->flags_op) {
+    case CpuFlagsOp_None:
+        return (self->f & CpuFlag_Z) != 0;
+    case CpuFlagsOp_Carry:
+        return false;
+    default:
+        return (self->flags_res & 0xFF) == 0;
+    }
+}
+
+/**
+ * \brief Computes the C flag alone, without materializing the others.
+ */
+[[nodiscard]] inline bool Cpu_read_flag_c(const Cpu *const self)
+{
+    if (self->flags_op == CpuFlagsOp_None)
+        return (self->f & CpuFlag_C) != 0;
+
+    return (self->flags_res & 0x100) != 0;
+}
+
+/**
+ * \brief Computes the value of the flags register.
+ *
+ * \param self the Cpu.
+ *
+ * \return the flags, as they would be stored in f.
+ *
+ * \sa Cpu_materialize_flags
+ */
+[[nodiscard]] u8 Cpu_read_f(const Cpu *self);
+
+/**
+ * \brief Sets every flag at once, discarding any recorded operation.
+ *
+ * \param self the Cpu.
+ * \param value the new flags. The low nibble is ignored.
+ */
+void Cpu_write_f(Cpu *self, u8 value);
+
+/**
+ * \brief Computes the flags of the last recorded operation into f, so that f
+ * can be read and modified directly.
+ *
+ * \param self the Cpu.
+ */
+void Cpu_materialize_flags(Cpu *self);
+
 [[nodiscard]] bool Cpu_read_cc(const Cpu *self, CpuTableCc cc);
 
-[[nodiscard]] u16 Cpu_read_rp(const Cpu *self, CpuTableRp rp);
+[[nodiscard]] inline u16 Cpu_read_rp(const Cpu *const self,
+                                     const CpuTableRp rp)
+{
+    return self->r16[rp];
+}
 
-void Cpu_write_rp(Cpu *self, CpuTableRp rp, u16 value);
+inline void Cpu_write_rp(Cpu *const self, const CpuTableRp rp,
+                         const u16 value)
+{
+    self->r16[rp] = value;
+}
 
-[[nodiscard]] u16 Cpu_read_rp2(const Cpu *self, CpuTableRp rp);
+[[nodiscard]] u16 Cpu_read_rp2(const Cpu *self, CpuTableRp2 rp);
 
-void Cpu_write_rp2(Cpu *self, CpuTableRp rp, u16 value);
+void Cpu_write_rp2(Cpu *self, CpuTableRp2 rp, u16 value);
 
 u8 Cpu_read_mem(Cpu *self, const Memory *mem, u16 addr);
 
@@ -106,16 +329,145 @@ u8 Cpu_read_pc(Cpu *self, const Memory *mem);
 
 u16 Cpu_read_pc_u16(Cpu *self, const Memory *mem);
 
-u8 Cpu_read_r(Cpu *self, const Memory *mem, CpuTableR r);
+inline u8 Cpu_read_r(Cpu *const self, const Memory *const mem,
+                     const CpuTableR r)
+{
+    if (r == CpuTableR_HL)
+        return Cpu_read_mem(self, mem, self->r16[CpuTableRp_HL]);
 
-void Cpu_write_r(Cpu *self, Memory *mem, CpuTableR r, u8 value);
+    return self->r8[CPU_R8_INDEX[r]];
+}
+
+inline void Cpu_write_r(Cpu *const self, Memory *const mem, const CpuTableR r,
+                        const u8 value)
+{
+    if (r == CpuTableR_HL)
+        Cpu_write_mem(self, mem, self->r16[CpuTableRp_HL], value);
+    else
+        self->r8[CPU_R8_INDEX[r]] = value;
+}
 
 void Cpu_stack_push_u16(Cpu *self, Memory *mem, u16 value);
 
 u16 Cpu_stack_pop_u16(Cpu *self, const Memory *mem);
 
+/**
+ * \brief Runs the Cpu for a single instruction, or a single cycle if it is not
+ * running, in the fast tier.
+ *
+ * Only adds the cycles spent to cycle_count, leaving it to the caller to catch
+ * everything else up afterwards. Runs compiled code instead of the interpreter
+ * when the Cpu has a JIT or an AOT module attached.
+ *
+ * \param self the Cpu.
+ * \param mem the memory the Cpu is attached to.
+ *
+ * \sa Cpu_tick_accurate
+ */
 void Cpu_tick(Cpu *self, Memory *mem);
 
+/**
+ * \brief Runs the Cpu for a single instruction, or a single cycle if it is not
+ * running, in the accurate tier.
+ *
+ * Calls on_cycle at the end of every M-cycle spent, besides adding it to
+ * cycle_count. Always runs the interpreter, ignoring every code cache
+ * attached to the Cpu.
+ *
+ * \param self the Cpu. Its on_cycle must not be NULL.
+ * \param mem the memory the Cpu is attached to.
+ *
+ * \sa Cpu_tick
+ */
+void Cpu_tick_accurate(Cpu *self, Memory *mem);
+
+/**
+ * Length of the address space Cpu_tick_flat runs on
+ */
+constexpr size_t CPU_FLAT_MEMORY_LEN = 0x10000;
+
+/**
+ * \brief Runs the Cpu for a single instruction, or a single cycle if it is not
+ * running, on a plain 64 KiB array instead of a Memory.
+ *
+ * Meant for hosting the Cpu outside of a GameBoy, where every address is plain
+ * memory. Every access is a load or store straight into ram, with no calls
+ * through function pointers. Otherwise, this behaves like Cpu_tick without
+ * any code caches attached.
+ *
+ * \param self the Cpu.
+ * \param ram the whole address space, CPU_FLAT_MEMORY_LEN bytes long.
+ *
+ * \sa Cpu_tick
+ */
+void Cpu_tick_flat(Cpu *self, u8 *ram);
+
+/**
+ * \brief Notifies every code cache attached to the Cpu that the byte at an
+ * address has been written to.
+ *
+ * \param self the Cpu.
+ * \param addr the address that was written to.
+ */
+void Cpu_invalidate_code(Cpu *self, u16 addr);
+
+/**
+ * \brief Notifies every code cache attached to the Cpu that a range of memory
+ * may have changed.
+ *
+ * \param self the Cpu.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void Cpu_invalidate_code_range(Cpu *self, u16 start, u16 end);
+
+/**
+ * \brief Tells every code cache attached to the Cpu which code pages are now
+ * mapped into a range of pages.
+ *
+ * A code page is a number standing for whatever 256 bytes of code may be
+ * mapped into a page, like a page of some ROM bank. first_page shows the code
+ * page first_id, the page after it first_id + 1, and so on. Code cached from
+ * the code pages mapped out is kept for when they get mapped back in.
+ *
+ * \param self the Cpu.
+ * \param first_page the first page of the range.
+ * \param last_page the last page of the range (inclusive).
+ * \param first_id the code page to show in first_page.
+ */
+void Cpu_map_code(Cpu *self, u8 first_page, u8 last_page, size_t first_id);
+
+/**
+ * \brief Empties every code cache attached to the Cpu.
+ *
+ * \param self the Cpu.
+ */
+void Cpu_flush_code(Cpu *self);
+
+/**
+ * \brief Dispatches an interrupt, pushing pc and jumping to its handler, in
+ * the fast tier.
+ *
+ * \param self the Cpu.
+ * \param mem the memory the Cpu is attached to.
+ * \param handler_location the address of the interrupt's handler.
+ *
+ * \sa Cpu_interrupt_accurate
+ */
 void Cpu_interrupt(Cpu *self, Memory *mem, u8 handler_location);
 
+/**
+ * \brief Dispatches an interrupt like Cpu_interrupt, in the accurate tier.
+ *
+ * Calls on_cycle at the end of every M-cycle spent, so that both pushes of pc
+ * happen at the right time.
+ *
+ * \param self the Cpu. Its on_cycle must not be NULL.
+ * \param mem the memory the Cpu is attached to.
+ * \param handler_location the address of the interrupt's handler.
+ *
+ * \sa Cpu_interrupt
+ */
+void Cpu_interrupt_accurate(Cpu *self, Memory *mem, u8 handler_location);
+
 #endif
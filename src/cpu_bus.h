@@ -0,0 +1,140 @@
+#ifndef GEMU_CPU_BUS_H
+#define GEMU_CPU_BUS_H
+
+/*
+ * Every M-cycle the Cpu spends, either accessing memory or internally, in the
+ * accuracy tier selected by CPU_ACCURATE.
+ *
+ * The fast tier (the default) only counts cycles, and leaves it to whoever
+ * ticks the Cpu to catch everything else up once the whole instruction has
+ * run. The accurate tier also calls Cpu.on_cycle at the end of every M-cycle,
+ * so that everything else advances in step with the instruction and sees each
+ * of its accesses at the right time.
+ *
+ * The interpreter is built once per tier from the same source (see
+ * instructions_accurate.c), so each translation unit including this header
+ * must stick to a single tier, and only expose its definitions under
+ * tier-specific names.
+ *
+ * It is also built once more with CPU_FLAT set (see instructions_flat.c), in
+ * the fast tier, where the ctx of the Memory is the whole address space as a
+ * plain array, and is read and written directly instead of through the
+ * callbacks.
+ */
+
+#include "cpu.h"
+#include "num.h"
+#include "stdinc.h"
+
+#ifndef CPU_ACCURATE
+#define CPU_ACCURATE 0
+#endif
+
+#ifndef CPU_FLAT
+#define CPU_FLAT 0
+#endif
+
+#if CPU_ACCURATE && CPU_FLAT
+#error "The flat build of the interpreter is fast tier only"
+#endif
+
+/**
+ * \brief Ends an M-cycle of the Cpu.
+ */
+static inline void Cpu_bus_cycle(Cpu *const cpu)
+{
+    cpu->cycle_count++;
+
+#if CPU_ACCURATE
+    cpu->on_cycle(cpu->on_cycle_ctx);
+#endif
+}
+
+static inline u8 Cpu_bus_read(Cpu *const cpu, const Memory *const mem,
+                              const u16 addr)
+{
+#if CPU_FLAT
+    const u8 value = ((const u8 *)mem->ctx)[addr];
+#else
+    const u8 value = mem->read(mem->ctx, addr);
+#endif
+
+    Cpu_bus_cycle(cpu);
+    return value;
+}
+
+static inline void Cpu_bus_write(Cpu *const cpu, Memory *const mem,
+                                 const u16 addr, const u8 value)
+{
+#if CPU_FLAT
+    ((u8 *)mem->ctx)[addr] = value;
+#else
+    mem->write(mem->ctx, addr, value);
+#endif
+
+    Cpu_bus_cycle(cpu);
+}
+
+static inline u16 Cpu_bus_read_u16(Cpu *const cpu, const Memory *const mem,
+                                   const u16 addr)
+{
+    const u8 lo = Cpu_bus_read(cpu, mem, addr);
+    const u8 hi = Cpu_bus_read(cpu, mem, addr + 1);
+    return concat_u16(hi, lo);
+}
+
+static inline void Cpu_bus_write_u16(Cpu *const cpu, Memory *const mem,
+                                     const u16 addr, const u16 value)
+{
+    Cpu_bus_write(cpu, mem, addr, value & 0xFF);
+    Cpu_bus_write(cpu, mem, addr + 1, value >> 8);
+}
+
+static inline u8 Cpu_bus_read_pc(Cpu *const cpu, const Memory *const mem)
+{
+    const u8 value = Cpu_bus_read(cpu, mem, cpu->pc);
+    cpu->pc++;
+    return value;
+}
+
+static inline u16 Cpu_bus_read_pc_u16(Cpu *const cpu, const Memory *const mem)
+{
+    const u16 value = Cpu_bus_read_u16(cpu, mem, cpu->pc);
+    cpu->pc += 2;
+    return value;
+}
+
+static inline u8 Cpu_bus_read_r(Cpu *const cpu, const Memory *const mem,
+                                const CpuTableR r)
+{
+    if (r == CpuTableR_HL)
+        return Cpu_bus_read(cpu, mem, cpu->r16[CpuTableRp_HL]);
+
+    return cpu->r8[CPU_R8_INDEX[r]];
+}
+
+static inline void Cpu_bus_write_r(Cpu *const cpu, Memory *const mem,
+                                   const CpuTableR r, const u8 value)
+{
+    if (r == CpuTableR_HL)
+        Cpu_bus_write(cpu, mem, cpu->r16[CpuTableRp_HL], value);
+    else
+        cpu->r8[CPU_R8_INDEX[r]] = value;
+}
+
+static inline void Cpu_bus_push_u16(Cpu *const cpu, Memory *const mem,
+                                    const u16 value)
+{
+    cpu->sp -= 2;
+    Cpu_bus_write_u16(cpu, mem, cpu->sp, value);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline u16 Cpu_bus_pop_u16(Cpu *const cpu, const Memory *const mem)
+{
+    const u16 value = Cpu_bus_read_u16(cpu, mem, cpu->sp);
+    cpu->sp += 2;
+    return value;
+}
+
+#endif
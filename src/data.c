@@ -18,3 +18,38 @@ bool CartridgeType_has_ram(const CartridgeType self)
            self == CartridgeType_Mbc7SensorRumbleRamBattery ||
            self == CartridgeType_Huc1RamBattery;
 }
+
+bool CartridgeType_has_mapper(const CartridgeType self)
+{
+    return self != CartridgeType_RomOnly && self != CartridgeType_RomRam &&
+           self != CartridgeType_RomRamBattery;
+}
+
+bool CartridgeType_has_battery(const CartridgeType self)
+{
+    return self == CartridgeType_Mbc1RamBattery ||
+           self == CartridgeType_Mbc2Battery ||
+           self == CartridgeType_RomRamBattery ||
+           self == CartridgeType_Mmm01RamBattery ||
+           self == CartridgeType_Mbc3TimerBattery ||
+           self == CartridgeType_Mbc3TimerRamBattery ||
+           self == CartridgeType_Mbc3RamBattery ||
+           self == CartridgeType_Mbc5RamBattery ||
+           self == CartridgeType_Mbc5RumbleRamBattery ||
+           self == CartridgeType_Mbc7SensorRumbleRamBattery ||
+           self == CartridgeType_Huc1RamBattery;
+}
+
+size_t RamSize_len(const RamSize self)
+{
+    // clang-format off
+    switch (self) {
+        case RamSize_Unused: return 0x800;
+        case RamSize_8KiB: return 0x2000;
+        case RamSize_32KiB: return 0x8000;
+        case RamSize_128KiB: return 0x20000;
+        case RamSize_64KiB: return 0x10000;
+        default: return 0;
+    }
+    // clang-format on
+}
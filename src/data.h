@@ -52,8 +52,30 @@ typedef enum : u8 {
     CartridgeType_Huc1RamBattery = 0xFF,
 } CartridgeType;
 
+typedef enum : u8 {
+    RamSize_None = 0x00,
+    RamSize_Unused = 0x01,
+    RamSize_8KiB = 0x02,
+    RamSize_32KiB = 0x03,
+    RamSize_128KiB = 0x04,
+    RamSize_64KiB = 0x05,
+} RamSize;
+
 void CartridgeType_log_info(CartridgeType self);
 
 bool CartridgeType_has_ram(CartridgeType self);
 
+bool CartridgeType_has_mapper(CartridgeType self);
+
+bool CartridgeType_has_battery(CartridgeType self);
+
+/**
+ * \brief Gets the length of the external RAM a header RAM size stands for.
+ *
+ * \param self the RAM size, as found in the ROM header.
+ *
+ * \return the length of the RAM, or 0 if self is not a known RAM size.
+ */
+size_t RamSize_len(RamSize self);
+
 #endif
@@ -0,0 +1,229 @@
+#include "decode_cache.h"
+#include "cpu.h"
+#include "instructions.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Value of an entry whose address has not been decoded yet. Slot 0 of the pool
+ * is never used, so that it can double as this marker.
+ */
+static constexpr u16 ENTRY_EMPTY = 0;
+
+/**
+ * Value of an entry whose address is known not to start a cacheable block
+ */
+static constexpr u16 ENTRY_UNCACHEABLE = 0xFFFF;
+
+static_assert(DECODE_CACHE_POOL_LEN < ENTRY_UNCACHEABLE);
+
+/**
+ * \brief Gets the blocks decoded from a code page, allocating them if the code
+ * page has never been mapped before.
+ */
+static DecodeCachePage *DecodeCache_code_page(DecodeCache *const self,
+                                              const size_t id)
+{
+    if (id >= self->code_pages_len) {
+        const size_t len = id + 1 > self->code_pages_len * 2
+                               ? id + 1
+                               : self->code_pages_len * 2;
+
+        self->code_pages =
+            realloc(self->code_pages, len * sizeof(self->code_pages[0]));
+        BAIL_IF_NULL(self->code_pages, "Could not allocate code pages");
+
+        for (size_t i = self->code_pages_len; i < len; ++i)
+            self->code_pages[i] = nullptr;
+
+        self->code_pages_len = len;
+    }
+
+    if (self->code_pages[id] == nullptr) {
+        // Zeroed entries are all ENTRY_EMPTY
+        self->code_pages[id] = calloc(1, sizeof(*self->code_pages[id]));
+        BAIL_IF_NULL(self->code_pages[id], "Could not allocate code page");
+    }
+
+    return self->code_pages[id];
+}
+
+DecodeCache *DecodeCache_new()
+{
+    DecodeCache *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate decode cache");
+
+    memset(self->cacheable, 0, sizeof(self->cacheable));
+    self->code_pages = nullptr;
+    self->code_pages_len = 0;
+
+    DecodeCache_map(self, 0x00, 0xFF, 0x00);
+    DecodeCache_flush(self);
+
+    return self;
+}
+
+void DecodeCache_destroy(DecodeCache *const self)
+{
+    if (self == nullptr)
+        return;
+
+    for (size_t i = 0; i < self->code_pages_len; ++i)
+        free(self->code_pages[i]);
+
+    free(self->code_pages);
+    free(self);
+}
+
+void DecodeCache_set_cacheable(DecodeCache *const self, const u16 start,
+                               const u16 end)
+{
+    for (size_t page = start >> 8; page <= (size_t)(end >> 8); ++page)
+        self->cacheable[page] = true;
+}
+
+void DecodeCache_map(DecodeCache *const self, const u8 first_page,
+                     const u8 last_page, const size_t first_id)
+{
+    for (size_t page = first_page; page <= last_page; ++page)
+        self->pages[page] =
+            DecodeCache_code_page(self, first_id + (page - first_page));
+
+    // The next instruction may have been mapped out
+    self->cursor = ENTRY_EMPTY;
+}
+
+void DecodeCache_flush(DecodeCache *const self)
+{
+    for (size_t i = 0; i < self->code_pages_len; ++i) {
+        DecodeCachePage *const code_page = self->code_pages[i];
+
+        if (code_page != nullptr && code_page->has_code) {
+            memset(code_page->entries, 0, sizeof(code_page->entries));
+            code_page->has_code = false;
+        }
+    }
+
+    self->pool_len = 1;
+    self->cursor = ENTRY_EMPTY;
+    self->cursor_pc = 0;
+}
+
+void DecodeCache_invalidate(DecodeCache *const self, const u16 addr)
+{
+    DecodeCachePage *const code_page = self->pages[addr >> 8];
+
+    if (!code_page->has_code)
+        return;
+
+    // Decoded instructions stay in the pool until the next flush, since the
+    // one being executed may be the one that triggered this invalidation.
+    memset(code_page->entries, 0, sizeof(code_page->entries));
+    code_page->has_code = false;
+    self->cursor = ENTRY_EMPTY;
+}
+
+void DecodeCache_invalidate_range(DecodeCache *const self, const u16 start,
+                                  const u16 end)
+{
+    for (size_t page = start >> 8; page <= (size_t)(end >> 8); ++page)
+        DecodeCache_invalidate(self, page << 8);
+}
+
+/**
+ * \brief Decodes a new block starting at pc.
+ *
+ * \return the pool index of the first instruction of the block, or
+ * ENTRY_UNCACHEABLE if not even one instruction could be decoded.
+ */
+static u16 DecodeCache_decode_block(DecodeCache *const self,
+                                    const Memory *const mem, const u16 pc)
+{
+    if (self->pool_len + DECODE_CACHE_MAX_BLOCK_LEN > DECODE_CACHE_POOL_LEN)
+        DecodeCache_flush(self);
+
+    DecodeCachePage *const code_page = self->pages[pc >> 8];
+    const size_t page_end = ((size_t)(pc >> 8) + 1) << 8;
+    const size_t start = self->pool_len;
+
+    size_t addr = pc;
+
+    for (size_t i = 0; i < DECODE_CACHE_MAX_BLOCK_LEN; ++i) {
+        const u8 opcode = mem->read(mem->ctx, addr);
+        const u8 len = CPU_OPCODE_LENGTHS[opcode];
+
+        // Removed instructions and instructions spilling into the next page
+        // are left to the interpreter
+        if (len == 0 || addr + len > page_end)
+            break;
+
+        u16 imm = 0;
+        if (len >= 2)
+            imm = mem->read(mem->ctx, addr + 1);
+        if (len == 3)
+            imm |= (u16)mem->read(mem->ctx, addr + 2) << 8;
+
+        const u16 index = self->pool_len++;
+        self->pool[index] = (DecodedInstr){
+            .handler = opcode == 0xCB ? CPU_PREFIX_OPCODE_HANDLERS[imm]
+                                      : CPU_OPCODE_HANDLERS[opcode],
+            .imm = imm,
+            .len = len,
+            .ends_block = Cpu_opcode_ends_block(opcode),
+        };
+        code_page->entries[addr & 0xFF] = index;
+
+        addr += len;
+
+        if (self->pool[index].ends_block)
+            break;
+    }
+
+    code_page->has_code = true;
+
+    if (self->pool_len == start) {
+        code_page->entries[pc & 0xFF] = ENTRY_UNCACHEABLE;
+        return ENTRY_UNCACHEABLE;
+    }
+
+    self->pool[self->pool_len - 1].ends_block = true;
+
+    return start;
+}
+
+const DecodedInstr *DecodeCache_fetch(DecodeCache *const self,
+                                      const Memory *const mem, const u16 pc)
+{
+    u16 index = ENTRY_EMPTY;
+
+    if (self->cursor != ENTRY_EMPTY && self->cursor_pc == pc) {
+        index = self->cursor;
+    } else {
+        if (!self->cacheable[pc >> 8])
+            return nullptr;
+
+        index = self->pages[pc >> 8]->entries[pc & 0xFF];
+
+        if (index == ENTRY_EMPTY)
+            index = DecodeCache_decode_block(self, mem, pc);
+
+        if (index == ENTRY_UNCACHEABLE) {
+            self->cursor = ENTRY_EMPTY;
+            return nullptr;
+        }
+    }
+
+    const DecodedInstr *const instr = &self->pool[index];
+
+    if (instr->ends_block) {
+        self->cursor = ENTRY_EMPTY;
+    } else {
+        self->cursor = index + 1;
+        self->cursor_pc = pc + instr->len;
+    }
+
+    return instr;
+}
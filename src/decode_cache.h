@@ -0,0 +1,159 @@
+#ifndef GEMU_DECODE_CACHE_H
+#define GEMU_DECODE_CACHE_H
+
+#include "cpu.h"
+#include "instructions.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Maximum number of instructions decoded into a single block
+ */
+constexpr size_t DECODE_CACHE_MAX_BLOCK_LEN = 32;
+
+/**
+ * Number of decoded instructions the cache can hold before being flushed
+ */
+constexpr size_t DECODE_CACHE_POOL_LEN = 0x4000;
+
+/**
+ * An instruction that has been fetched and decoded ahead of time.
+ */
+typedef struct {
+    CpuInstrHandler handler;
+    u16 imm;
+    u8 len;
+    bool ends_block;
+} DecodedInstr;
+
+/**
+ * The blocks decoded from a single code page, keyed by their offset into it.
+ */
+typedef struct {
+    u16 entries[0x100];
+    bool has_code;
+} DecodeCachePage;
+
+/**
+ * A cache of predecoded basic blocks, keyed by the code page and offset they
+ * start at.
+ *
+ * Blocks are stored as runs of consecutive entries in pool, the last of which
+ * has ends_block set. Blocks never cross a 256-byte page, so that writes only
+ * need to invalidate the page they land on.
+ *
+ * Each page of the address space shows a code page, which is whatever the
+ * owner of the cache says is mapped there (like a page of some ROM bank).
+ * Blocks stay with their code page when it gets mapped out, so switching back
+ * to a bank picks up what was decoded from it before.
+ *
+ * Only pages marked as cacheable are ever decoded. The owner of the cache is
+ * responsible for calling DecodeCache_invalidate whenever memory in one of
+ * those pages may have changed, and DecodeCache_map whenever a different code
+ * page gets mapped into one of them.
+ */
+typedef struct DecodeCache {
+    DecodeCachePage *pages[0x100];
+    DecodeCachePage **code_pages;
+    size_t code_pages_len;
+    DecodedInstr pool[DECODE_CACHE_POOL_LEN];
+    size_t pool_len;
+    bool cacheable[0x100];
+    u16 cursor;
+    u16 cursor_pc;
+} DecodeCache;
+
+/**
+ * \brief Allocates an empty DecodeCache with no cacheable pages.
+ *
+ * Every page of the address space starts out showing the code page with its
+ * own number.
+ *
+ * The created DecodeCache must eventually be freed with DecodeCache_destroy.
+ *
+ * \return the allocated DecodeCache.
+ *
+ * \sa DecodeCache_destroy
+ */
+[[nodiscard]] DecodeCache *DecodeCache_new();
+
+/**
+ * \brief Frees a previously-allocated DecodeCache.
+ *
+ * \param self the DecodeCache to free. May be NULL.
+ *
+ * \sa DecodeCache_new
+ */
+void DecodeCache_destroy(DecodeCache *self);
+
+/**
+ * \brief Marks the pages in the given address range as safe to decode ahead
+ * of time.
+ *
+ * \param self the DecodeCache to modify.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void DecodeCache_set_cacheable(DecodeCache *self, u16 start, u16 end);
+
+/**
+ * \brief Maps code pages into a range of pages of the address space.
+ *
+ * first_page shows the code page first_id, the page after it first_id + 1,
+ * and so on. Blocks decoded from the code pages mapped out are kept.
+ *
+ * \param self the DecodeCache to modify.
+ * \param first_page the first page of the range.
+ * \param last_page the last page of the range (inclusive).
+ * \param first_id the code page to show in first_page.
+ */
+void DecodeCache_map(DecodeCache *self, u8 first_page, u8 last_page,
+                     size_t first_id);
+
+/**
+ * \brief Drops every decoded block.
+ *
+ * \param self the DecodeCache to flush.
+ */
+void DecodeCache_flush(DecodeCache *self);
+
+/**
+ * \brief Drops every decoded block that may contain the given address, from
+ * the code page currently mapped there.
+ *
+ * This is cheap when the page of addr holds no decoded code, so it may be
+ * called on every write to memory that can be executed.
+ *
+ * \param self the DecodeCache to modify.
+ * \param addr the address that has been (or is about to be) modified.
+ */
+void DecodeCache_invalidate(DecodeCache *self, u16 addr);
+
+/**
+ * \brief Drops every decoded block that may contain an address in the given
+ * range.
+ *
+ * \param self the DecodeCache to modify.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void DecodeCache_invalidate_range(DecodeCache *self, u16 start, u16 end);
+
+/**
+ * \brief Looks up the decoded instruction at the given address, decoding a new
+ * block starting there if necessary.
+ *
+ * Decoding reads memory through mem without spending any cycles, so it must
+ * only be used on pages whose reads have no side effects.
+ *
+ * \param self the DecodeCache to look up.
+ * \param mem the memory to decode from.
+ * \param pc the address of the instruction.
+ *
+ * \return the decoded instruction, or NULL if the instruction at pc cannot be
+ * cached.
+ */
+[[nodiscard]] const DecodedInstr *DecodeCache_fetch(DecodeCache *self,
+                                                    const Memory *mem, u16 pc);
+
+#endif
@@ -1,8 +1,13 @@
 #include "frontend.h"
 #include "cpu.h"
+#include "data.h"
 #include "game_boy.h"
+#include "idiom.h"
+#include "idle_loop.h"
 #include "log.h"
 #include "macros.h"
+#include "ppu.h"
+#include "rom_image.h"
 #include "sdl.h"
 #include "stdinc.h"
 #include <SDL3/SDL.h>
@@ -113,6 +118,105 @@ static bool *map_joypad_btn(JoypadState *const joypad, const SDL_Keycode key,
     }
 }
 
+/**
+ * \brief Gets the path of the file the idle loops of the loaded ROM are cached
+ * in.
+ *
+ * Files are keyed by the header checksum of the ROM, along with its global
+ * checksum to tell apart ROMs that happen to share one.
+ *
+ * \param gb the GameBoy. Must have a ROM loaded.
+ *
+ * \return the path, which must be freed with SDL_free, or NULL if there is
+ * nowhere to cache idle loops.
+ */
+static char *idle_loop_cache_path(const GameBoy *const gb)
+{
+    char *const pref_path = SDL_GetPrefPath("gemu", "gemu");
+
+    if (pref_path == nullptr) {
+        log_warn("Cannot cache idle loops: %s", SDL_GetError());
+        return nullptr;
+    }
+
+    char *path = nullptr;
+    const int len = SDL_asprintf(&path, "%sidle-loops-%02X-%02X%02X.txt",
+                                 pref_path, gb->rom[RomHeader_HeaderChecksum],
+                                 gb->rom[RomHeader_GlobalChecksum],
+                                 gb->rom[RomHeader_GlobalChecksum + 1]);
+
+    SDL_free(pref_path);
+    return len < 0 ? nullptr : path;
+}
+
+void load_idle_loops(GameBoy *const gb)
+{
+    char *const path = idle_loop_cache_path(gb);
+
+    if (path == nullptr)
+        return;
+
+    if (IdleLoopDetector_load(gb->idle_loops, path))
+        log_info("Loaded idle loops from %s", path);
+
+    SDL_free(path);
+}
+
+void save_idle_loops(GameBoy *const gb)
+{
+    if (gb->rom == nullptr)
+        return;
+
+    char *const path = idle_loop_cache_path(gb);
+
+    if (path == nullptr)
+        return;
+
+    if (!IdleLoopDetector_save(gb->idle_loops, path))
+        log_warn("Could not save idle loops to %s", path);
+
+    SDL_free(path);
+}
+
+/**
+ * \brief Gets the path of the save file for a ROM file.
+ *
+ * \param rom_path the path to the ROM file.
+ *
+ * \return the path, which must be freed with SDL_free, or NULL if it could not
+ * be allocated.
+ */
+static char *save_path(const char *const rom_path)
+{
+    const char *const name = SDL_strrchr(rom_path, '/');
+    const char *const ext = SDL_strrchr(name != nullptr ? name : rom_path, '.');
+    const int stem_len =
+        ext != nullptr ? (int)(ext - rom_path) : (int)SDL_strlen(rom_path);
+
+    char *path = nullptr;
+    const int len = SDL_asprintf(&path, "%.*s.sav", stem_len, rom_path);
+
+    return len < 0 ? nullptr : path;
+}
+
+void load_save(State *const state, const char *const rom_path)
+{
+    char *const path = save_path(rom_path);
+
+    if (path == nullptr) {
+        log_warn("Cannot load save file: %s", SDL_GetError());
+        return;
+    }
+
+    if (!GameBoy_load_save(&state->gb, path, state->save_interval_ms))
+        log_warn("Could not open save file %s, progress will not be saved",
+                 path);
+    else if (state->gb.save != nullptr)
+        log_info("Loaded save file %s", path);
+
+    SDL_free(path);
+}
+
 static void rom_select_callback(void *const data,
                                 const char *const *const files,
                                 [[maybe_unused]] const int filter)
@@ -125,23 +229,26 @@ static void rom_select_callback(void *const data,
     if (files[0] == nullptr)
         return;
 
-    GameBoy *const gb = data;
+    State *const state = data;
+    GameBoy *const gb = &state->gb;
     const char *const rom_file = files[0];
 
     log_info("Loading ROM at %s", rom_file);
 
-    size_t rom_len = 0;
-    u8 *const rom = SDL_LoadFile(rom_file, &rom_len);
+    RomImage *const rom = RomImage_open(rom_file);
 
     if (rom == nullptr) {
-        log_error("Could not load ROM file: %s", SDL_GetError());
+        log_error("Could not load ROM file %s", rom_file);
         return;
     }
 
-    GameBoy_load_rom(gb, rom, rom_len);
+    save_idle_loops(gb);
+    GameBoy_load_rom(gb, rom);
+    load_save(state, rom_file);
+    load_idle_loops(gb);
     GameBoy_log_cartridge_info(gb);
 
-    SDL_free(rom);
+    RomImage_release(rom);
 }
 
 static inline SDL_Keymod mask_relevant_mod(const SDL_Keymod mod)
@@ -159,6 +266,12 @@ static void handle_event(State *const state, const SDL_Event *const event)
     case SDL_EVENT_WINDOW_RESIZED:
         state->window_width = event->window.data1;
         state->window_height = event->window.data2;
+        state->redraw_window = true;
+        break;
+    case SDL_EVENT_WINDOW_EXPOSED:
+    case SDL_EVENT_WINDOW_RESTORED:
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        state->redraw_window = true;
         break;
     case SDL_EVENT_KEY_DOWN: {
         const SDL_Keymod relevant_mod = mask_relevant_mod(event->key.mod);
@@ -172,7 +285,7 @@ static void handle_event(State *const state, const SDL_Event *const event)
 
         // <C-o> to select ROM
         if (relevant_mod & SDL_KMOD_CTRL && event->key.key == SDLK_O) {
-            SDL_ShowOpenFileDialog(rom_select_callback, &state->gb, nullptr,
+            SDL_ShowOpenFileDialog(rom_select_callback, state, nullptr,
                                    nullptr, 0, nullptr, false);
         }
         break;
@@ -191,86 +304,452 @@ static void handle_event(State *const state, const SDL_Event *const event)
     }
 }
 
-static void update(State *const state, const double delta)
+/**
+ * \brief Gets the number of cycles between TIMA increments.
+ */
+static int tima_period_cycles(const u8 tac)
 {
-    Memory memory = (Memory){
-        .ctx = &state->gb,
-        .read = GameBoy_read_mem,
-        .write = GameBoy_write_mem,
-    };
+    const u8 clock_select = tac & 0b11;
+    return clock_select == 0 ? 256 : 4 * clock_select;
+}
 
-    state->gb.cpu.cycle_count = 0;
+/**
+ * Number of cycles the LCD spends on each line
+ */
+static constexpr double LINE_CYCLES =
+    GB_CPU_FREQUENCY_HZ / GB_VBLANK_FREQ / GB_LCD_MAX_LY;
 
-    const double total_frame_cycles = GB_CPU_FREQUENCY_HZ * delta;
+/**
+ * \brief Computes how many cycles a halted or stopped Cpu can skip in one go
+ * without missing anything that could wake it up.
+ *
+ * Those are LY reaching 144 (VBlank) or LYC, the PPU changing modes if STAT
+ * interrupts are selected for them, TIMA overflowing, OAM DMA giving the bus
+ * back, and the end of the current frame, after which joypad input is polled.
+ *
+ * \param state the State the Cpu belongs to.
+ * \param progress how far into the current video frame the Game Boy is, from
+ * 0 to 1.
+ * \param frame_cycles_left cycles left until the end of the current frame.
+ *
+ * \return the number of cycles until the earliest of those, which may be
+ * fractional.
+ */
+static double cycles_until_next_event(const State *const state,
+                                      const double progress,
+                                      const double frame_cycles_left)
+{
+    const GameBoy *const gb = &state->gb;
+    const double line_pos = progress * GB_LCD_MAX_LY;
 
-    static constexpr double VFRAME_DURATION = 1.0 / GB_VBLANK_FREQ;
-    static constexpr int DIV_FREQUENCY_CYCLES =
-        GB_CPU_FREQUENCY_HZ / DIV_FREQUENCY_HZ;
+    double cycles = frame_cycles_left;
 
-    while (state->cycle_accumulator < total_frame_cycles) {
-        const double actual_vframe_time =
-            state->vframe_time +
-            (state->cycle_accumulator / GB_CPU_FREQUENCY_HZ);
-        double progress = actual_vframe_time / VFRAME_DURATION;
-        while (progress >= 1.0) {
-            progress -= 1.0;
+    // LY stays put while the LCD is off
+    if ((gb->lcdc & LcdControl_Enable) != 0) {
+        const u8 lines[] = {GB_LCD_HEIGHT, gb->lcy};
+
+        for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+            if (lines[i] >= GB_LCD_MAX_LY)
+                continue;
+
+            // The line that is current right now has already been handled
+            double lines_left = lines[i] - line_pos;
+            if (lines[i] <= gb->ly)
+                lines_left += GB_LCD_MAX_LY;
+
+            if (lines_left * LINE_CYCLES < cycles)
+                cycles = lines_left * LINE_CYCLES;
         }
 
-        const u8 prev_ly = state->gb.ly;
-        state->gb.ly = (u8)(progress * GB_LCD_MAX_LY);
+        // HBlank and OAM scan interrupts happen partway through lines
+        if ((gb->stat & (StatSelect_Mode0 | StatSelect_Mode2)) != 0) {
+            const double mode_cycles =
+                (Ppu_next_mode_change(line_pos) - line_pos) * LINE_CYCLES;
 
-        state->gb.stat |= (state->gb.ly == state->gb.lcy) << 2;
+            if (mode_cycles < cycles)
+                cycles = mode_cycles;
+        }
+    }
 
-        // Trigger some stuff then ly changes
-        if (prev_ly != state->gb.ly) {
-            // VBlank interrupt
-            if (state->gb.ly == 144) {
-                state->gb.if_ |= InterruptFlag_VBlank;
-            }
+    if (gb->tac & 0b100) {
+        const int period = tima_period_cycles(gb->tac);
+        const int overflow_cycles =
+            (0x100 - gb->tima) * period - state->tima_cycle_counter + 1;
+
+        if (overflow_cycles < cycles)
+            cycles = overflow_cycles;
+    }
+
+    if (gb->dma_cycles_left != 0 && gb->dma_cycles_left < cycles)
+        cycles = gb->dma_cycles_left;
+
+    return cycles;
+}
+
+/**
+ * \brief Computes how many cycles the Cpu can run for in one go, without
+ * missing the next event that could change what it reads.
+ *
+ * \param state the State the Cpu belongs to.
+ * \param progress how far into the current video frame the Game Boy was before
+ * the Cpu last ran, from 0 to 1.
+ * \param frame_cycles_left cycles that were left until the end of the current
+ * frame before the Cpu last ran.
+ * \param line_bound whether the Cpu reads something that changes on every
+ * line.
+ *
+ * \return the number of cycles, counting from the Cpu's current cycle_count,
+ * which may be 0.
+ */
+static int cycles_before_next_event(const State *const state,
+                                    const double progress,
+                                    const double frame_cycles_left,
+                                    const bool line_bound)
+{
+    double cycles =
+        cycles_until_next_event(state, progress, frame_cycles_left);
+
+    if (line_bound) {
+        const double line_pos = progress * GB_LCD_MAX_LY;
+        const double mode_cycles =
+            (Ppu_next_mode_change(line_pos) - line_pos) * LINE_CYCLES;
+
+        if (mode_cycles < cycles)
+            cycles = mode_cycles;
+    }
+
+    // Events are measured from before the Cpu last ran. Keep a whole cycle of
+    // margin so that rounding never lets the last cycle run see one.
+    cycles -= state->gb.cpu.cycle_count + 1;
+
+    return cycles < 0 ? 0 : (int)cycles;
+}
+
+/**
+ * \brief Computes how many cycles of an idle loop can be skipped in one go.
+ *
+ * The loop is skipped in whole iterations, and only for as long as every
+ * iteration skipped would have run before the next event that could change
+ * what the loop reads.
+ *
+ * \param state the State the Cpu belongs to.
+ * \param progress how far into the current video frame the Game Boy was before
+ * the Cpu last ran, from 0 to 1.
+ * \param frame_cycles_left cycles that were left until the end of the current
+ * frame before the Cpu last ran.
+ * \param iteration_cycles the length of an iteration of the loop.
+ * \param line_bound whether the loop reads something that changes on every
+ * line.
+ *
+ * \return the number of cycles to skip, which may be 0.
+ *
+ * \sa IdleLoopDetector_observe
+ */
+static int idle_loop_skip_cycles(const State *const state,
+                                 const double progress,
+                                 const double frame_cycles_left,
+                                 const int iteration_cycles,
+                                 const bool line_bound)
+{
+    const int cycles = cycles_before_next_event(state, progress,
+                                                frame_cycles_left, line_bound);
+
+    return cycles / iteration_cycles * iteration_cycles;
+}
+
+/**
+ * \brief Runs the idiom at the Cpu's pc in bulk, if there is one.
+ *
+ * Interrupts are only ever serviced between calls to Cpu_tick, so the idiom is
+ * only run up to right before the next event that could raise one.
+ *
+ * \param state the State the Cpu belongs to.
+ * \param memory the memory to look idioms up in.
+ * \param mem the memory to run the idiom on, which may be watched.
+ * \param progress how far into the current video frame the Game Boy is, from 0
+ * to 1.
+ * \param frame_cycles_left cycles left until the end of the current frame.
+ *
+ * \return whether the Cpu ran.
+ *
+ * \sa IdiomCache_run
+ */
+static bool run_idiom(State *const state, const Memory *const memory,
+                      Memory *const mem, const double progress,
+                      const double frame_cycles_left)
+{
+    Cpu *const cpu = &state->gb.cpu;
+    Idiom idiom;
+
+    if (cpu->idioms == nullptr ||
+        !IdiomCache_lookup(cpu->idioms, memory, cpu->pc, &idiom))
+        return false;
+
+    const int max_cycles =
+        cycles_before_next_event(state, progress, frame_cycles_left, false);
+
+    return IdiomCache_run(cpu->idioms, &idiom, cpu, mem, max_cycles);
+}
+
+/**
+ * Length in seconds of a video frame
+ */
+static constexpr double VFRAME_DURATION = 1.0 / GB_VBLANK_FREQ;
+
+/**
+ * Number of cycles between DIV increments
+ */
+static constexpr int DIV_FREQUENCY_CYCLES =
+    GB_CPU_FREQUENCY_HZ / DIV_FREQUENCY_HZ;
+
+/**
+ * \brief Brings the PPU up to date with how far into the current video frame
+ * the Game Boy is.
+ *
+ * \param state the State to update.
+ *
+ * \return how far into the current video frame the Game Boy is, from 0 to 1.
+ *
+ * \sa Ppu_update
+ */
+static double update_ly(State *const state)
+{
+    const double actual_vframe_time =
+        state->vframe_time + (state->cycle_accumulator / GB_CPU_FREQUENCY_HZ);
+    double progress = actual_vframe_time / VFRAME_DURATION;
+    while (progress >= 1.0) {
+        progress -= 1.0;
+    }
 
-            // STAT lcy == ly interrupt
-            if ((state->gb.stat & StatSelect_Lyc) != 0 &&
-                state->gb.ly == state->gb.lcy) {
-                state->gb.if_ |= InterruptFlag_Lcd;
+    Ppu_update(&state->gb, progress);
+
+    return progress;
+}
+
+/**
+ * \brief Advances DIV and TIMA by some cycles.
+ *
+ * \param state the State to update.
+ * \param cycles the number of cycles that have passed.
+ */
+static void update_timers(State *const state, const int cycles)
+{
+    // DIV counter
+    if (state->gb.cpu.mode != CpuMode_Stopped) {
+        state->div_cycle_counter += cycles;
+
+        while (state->div_cycle_counter >= DIV_FREQUENCY_CYCLES) {
+            ++state->gb.div;
+            state->div_cycle_counter -= DIV_FREQUENCY_CYCLES;
+        }
+    }
+
+    // TIMA is only incremented if TAC's bit 2 is set
+    if (state->gb.tac & 0b100) {
+        const int tac_delay_cycles = tima_period_cycles(state->gb.tac);
+
+        // TIMA counter
+        state->tima_cycle_counter += cycles;
+        // A single tick may span several TIMA increments when running
+        // compiled code
+        while (state->tima_cycle_counter > tac_delay_cycles) {
+            state->tima_cycle_counter -= tac_delay_cycles;
+            ++state->gb.tima;
+
+            // Trigger timer interrupt when tima overflows
+            if (state->gb.tima == 0) {
+                state->gb.tima = state->gb.tma;
+                state->gb.if_ |= InterruptFlag_Timer;
+                IdleLoopDetector_event(state->gb.idle_loops);
             }
         }
+    }
+}
+
+/**
+ * \brief Runs the Game Boy in the fast tier, an instruction at a time.
+ *
+ * \param state the State to update.
+ * \param total_frame_cycles the number of cycles to run for.
+ */
+static void update_fast(State *const state, const double total_frame_cycles)
+{
+    Memory memory = GameBoy_memory(&state->gb);
+
+    IdleLoopDetector *const idle_loops = state->gb.idle_loops;
+    Memory watched_memory = IdleLoopDetector_memory(idle_loops, &memory);
+
+    state->gb.cpu.cycle_count = 0;
+
+    while (state->cycle_accumulator < total_frame_cycles) {
+        const double progress = update_ly(state);
+        const double frame_cycles_left =
+            total_frame_cycles - state->cycle_accumulator;
 
+        const u16 interrupted_pc = state->gb.cpu.pc;
         GameBoy_service_interrupts(&state->gb, &memory);
-        Cpu_tick(&state->gb.cpu, &memory);
 
-        // DIV counter
-        if (state->gb.cpu.mode != CpuMode_Stopped) {
-            state->div_cycle_counter += state->gb.cpu.cycle_count;
+        if (state->gb.cpu.pc != interrupted_pc)
+            IdleLoopDetector_interrupt(idle_loops);
 
-            while (state->div_cycle_counter >= DIV_FREQUENCY_CYCLES) {
-                ++state->gb.div;
-                state->div_cycle_counter -= DIV_FREQUENCY_CYCLES;
-            }
-        }
+        if (state->gb.cpu.mode == CpuMode_Running) {
+            const u16 prev_pc = state->gb.cpu.pc;
+            Memory *const mem =
+                idle_loops->watching ? &watched_memory : &memory;
 
-        // TIMA is only incremented if TAC's bit 2 is set
-        if (state->gb.tac & 0b100) {
-            const u8 clock_select = state->gb.tac & 0b11;
-            const int tac_delay_cycles =
-                clock_select == 0 ? 256 : 4 * clock_select;
-
-            // TIMA counter
-            state->tima_cycle_counter += state->gb.cpu.cycle_count;
-            if (state->tima_cycle_counter > tac_delay_cycles) {
-                state->tima_cycle_counter -= tac_delay_cycles;
-                ++state->gb.tima;
-
-                // Trigger timer interrupt when tima overflows
-                if (state->gb.tima == 0) {
-                    state->gb.tima = state->gb.tma;
-                    state->gb.if_ |= InterruptFlag_Timer;
+            if (!run_idiom(state, &memory, mem, progress, frame_cycles_left)) {
+                // Compiled code may run many instructions at once too, so it
+                // gets bounded the same way
+                if (state->gb.cpu.jit != nullptr) {
+                    state->gb.cpu.max_tick_cycles = cycles_before_next_event(
+                        state, progress, frame_cycles_left, false);
                 }
+
+                Cpu_tick(&state->gb.cpu, mem);
             }
+
+            bool line_bound = false;
+            const int iteration_cycles = IdleLoopDetector_observe(
+                idle_loops, &state->gb.cpu, prev_pc, &line_bound);
+
+            // The loop would spin until the next event, so skip to right
+            // before it
+            if (iteration_cycles != 0) {
+                state->gb.cpu.cycle_count += idle_loop_skip_cycles(
+                    state, progress, frame_cycles_left, iteration_cycles,
+                    line_bound);
+            }
+        } else {
+            // Nothing happens until the next event, so skip straight to it
+            const int skip_cycles = (int)SDL_ceil(
+                cycles_until_next_event(state, progress, frame_cycles_left));
+            state->gb.cpu.cycle_count += skip_cycles < 1 ? 1 : skip_cycles;
         }
 
+        update_timers(state, state->gb.cpu.cycle_count);
+
+        if (GameBoy_step_dma(&state->gb, state->gb.cpu.cycle_count))
+            IdleLoopDetector_event(idle_loops);
+
         state->cycle_accumulator += state->gb.cpu.cycle_count;
         state->gb.cpu.cycle_count = 0;
     }
+}
+
+/**
+ * \brief Advances everything but the Cpu by a single cycle.
+ *
+ * \param ctx the State to update.
+ */
+static void step_cycle(void *const ctx)
+{
+    State *const state = ctx;
+
+    update_timers(state, 1);
+    GameBoy_step_dma(&state->gb, 1);
+    state->cycle_accumulator += 1;
+    update_ly(state);
+}
+
+/**
+ * \brief Runs the Game Boy in the accurate tier, a cycle at a time.
+ *
+ * \param state the State to update.
+ * \param total_frame_cycles the number of cycles to run for.
+ */
+static void update_accurate(State *const state,
+                            const double total_frame_cycles)
+{
+    Memory memory = GameBoy_memory(&state->gb);
+
+    Cpu *const cpu = &state->gb.cpu;
+    cpu->on_cycle = step_cycle;
+    cpu->on_cycle_ctx = state;
+
+    update_ly(state);
+
+    while (state->cycle_accumulator < total_frame_cycles) {
+        cpu->cycle_count = 0;
+
+        GameBoy_service_interrupts(&state->gb, &memory);
+        Cpu_tick_accurate(cpu, &memory);
+    }
+
+    cpu->cycle_count = 0;
+}
+
+/**
+ * \brief Runs the Game Boy an instruction at a time while GDB is attached,
+ * stopping on breakpoints and watchpoints.
+ *
+ * Always runs in the fast tier, with nothing skipped.
+ *
+ * \param state the State to update.
+ * \param total_frame_cycles the number of cycles to run for.
+ *
+ * \return whether the Game Boy ran for all of those cycles, instead of being
+ * halted before the end.
+ */
+static bool update_debug(State *const state, const double total_frame_cycles)
+{
+    GdbStub *const gdb = state->gdb;
+    Cpu *const cpu = &state->gb.cpu;
+
+    Memory memory = GameBoy_memory(&state->gb);
+    Memory watched_memory = GdbStub_memory(gdb, &memory);
+
+    // GDB may have changed anything a loop was waiting on
+    IdleLoopDetector_event(state->gb.idle_loops);
+
+    cpu->cycle_count = 0;
+
+    while (state->cycle_accumulator < total_frame_cycles) {
+        if (gdb->halted)
+            return false;
+
+        const double progress = update_ly(state);
+        const double frame_cycles_left =
+            total_frame_cycles - state->cycle_accumulator;
+
+        GameBoy_service_interrupts(&state->gb, &memory);
+
+        if (cpu->mode == CpuMode_Running) {
+            if (!GdbStub_check_break(gdb, cpu->pc)) {
+                Cpu_tick(cpu, &watched_memory);
+                GdbStub_instruction_done(gdb);
+            }
+        } else {
+            const int skip_cycles = (int)SDL_ceil(
+                cycles_until_next_event(state, progress, frame_cycles_left));
+            cpu->cycle_count += skip_cycles < 1 ? 1 : skip_cycles;
+        }
+
+        update_timers(state, cpu->cycle_count);
+        GameBoy_step_dma(&state->gb, cpu->cycle_count);
+
+        state->cycle_accumulator += cpu->cycle_count;
+        cpu->cycle_count = 0;
+    }
+
+    return true;
+}
+
+static void update(State *const state, const double delta)
+{
+    const double total_frame_cycles = GB_CPU_FREQUENCY_HZ * delta;
+
+    if (state->gdb != nullptr)
+        GdbStub_poll(state->gdb, &state->gb);
+
+    if (state->gdb != nullptr && state->gdb->armed) {
+        // Time stands still while GDB has the Game Boy halted
+        if (!update_debug(state, total_frame_cycles))
+            return;
+    } else if (state->gb.tier == CpuTier_Accurate) {
+        update_accurate(state, total_frame_cycles);
+    } else {
+        update_fast(state, total_frame_cycles);
+    }
 
     state->cycle_accumulator -= total_frame_cycles;
 
@@ -280,165 +759,116 @@ static void update(State *const state, const double delta)
     }
 }
 
-static void draw_tiles(const State *const state,
-                       const SDL_Surface *const surface,
-                       const SDL_PixelFormatDetails *const pixel_format)
+/**
+ * \brief Maps every shade of the LCD to its color, in the pixel format of the
+ * screen texture.
+ *
+ * \param state the State whose colors to set.
+ */
+static void init_colors(State *const state)
 {
-    static constexpr size_t TILES_HORIZONTAL = 32;
-    static constexpr size_t TILES_VERTICAL = 32;
-
-    u32 *const pixels = surface->pixels;
-
-    const size_t tile_data_start =
-        state->gb.lcdc & LcdControl_BgwTileArea ? 0 : 0x1000;
-    const size_t tile_map_start =
-        state->gb.lcdc & LcdControl_BgTileMap ? 0x1C00 : 0x1800;
-
-    const u8 *const tile_data = &state->gb.vram[tile_data_start];
-    const u8 *const tile_map = &state->gb.vram[tile_map_start];
-
-    for (size_t tile_y = 0; tile_y < TILES_VERTICAL; ++tile_y) {
-        for (size_t tile_x = 0; tile_x < TILES_HORIZONTAL; ++tile_x) {
-            const u8 tile_index =
-                tile_map[(tile_y * TILES_HORIZONTAL) + tile_x];
-            const long tile_index_signed =
-                state->gb.lcdc & LcdControl_BgwTileArea ? tile_index
-                                                        : (i8)tile_index;
-
-            for (size_t tile_row_index = 0; tile_row_index < 8;
-                 ++tile_row_index) {
-                const u8 byte_1 =
-                    tile_data[(tile_index_signed * 16) + (2 * tile_row_index)];
-                const u8 byte_2 = tile_data[(tile_index_signed * 16) +
-                                            (2 * tile_row_index) + 1];
-
-                for (size_t tile_col_index = 0; tile_col_index < 8;
-                     ++tile_col_index) {
-                    const u8 bit_lo = (byte_1 >> tile_col_index) & 1;
-                    const u8 bit_hi = (byte_2 >> tile_col_index) & 1;
-                    const u8 palette_index = bit_lo | (bit_hi << 1);
-
-                    const size_t color =
-                        (state->gb.bgp >> (2 * palette_index)) & 0b11;
-
-                    const size_t pixel_y = (8 * tile_y) + tile_row_index;
-                    const size_t pixel_x = (8 * tile_x) + 7 - tile_col_index;
-
-                    pixels[(pixel_y * surface->w) + pixel_x] =
-                        map_color_index(color, pixel_format);
-                }
-            }
-        }
-    }
+    const SDL_PixelFormatDetails *const pixel_format =
+        SDL_GetPixelFormatDetails(state->screen_texture->format);
+    BAIL_IF(pixel_format == nullptr, "Could not get pixel format: %s",
+            SDL_GetError());
+
+    for (size_t i = 0; i < PALETTE_RGB_LEN; ++i)
+        state->colors[i] = map_color_index(i, pixel_format);
 }
 
-static void draw_objects(const State *const state,
-                         const SDL_Surface *const surface,
-                         const SDL_PixelFormatDetails *const pixel_format)
+/**
+ * \brief Hashes the framebuffer, to tell whether it has changed since it was
+ * last shown.
+ */
+static u64 hash_framebuffer(const u8 *const framebuffer)
 {
-    u32 *const pixels = surface->pixels;
-
-    for (size_t obj = 0; obj < 40; ++obj) {
-        const u8 *const obj_data = &state->gb.oam[obj * 4];
-
-        const size_t y_pos = obj_data[0] - 16;
-        const size_t x_pos = obj_data[1] - 8;
-        const size_t tile_index = obj_data[2];
-        const u8 attrs = obj_data[3];
-
-        // TODO: implement priority (background over object)
-        // Will probably need two passes: low and normal priority objs
-
-        const bool flip_x = (attrs & ObjAttrs_FlipX) != 0;
-        const bool flip_y = (attrs & ObjAttrs_FlipY) != 0;
-        const u8 obp = (attrs & ObjAttrs_DmgPalette) != 0 ? state->gb.obp1
-                                                          : state->gb.obp0;
-
-        for (size_t sprite_row = 0; sprite_row < 8; ++sprite_row) {
-            // Objects always use the $8000 method
-            const u8 byte_1 =
-                state->gb.vram[(tile_index * 0x10) + (2 * sprite_row)];
-            const u8 byte_2 =
-                state->gb.vram[(tile_index * 0x10) + (2 * sprite_row) + 1];
-
-            for (size_t sprite_col = 0; sprite_col < 8; ++sprite_col) {
-                const u8 bit_lo = (byte_1 >> sprite_col) & 1;
-                const u8 bit_hi = (byte_2 >> sprite_col) & 1;
-                const size_t palette_index = bit_lo | (bit_hi << 1);
-                const size_t color = (obp >> (palette_index * 2)) & 0b11;
-
-                if (color != 0) {
-                    const size_t pixel_y =
-                        y_pos + (flip_y ? 7 - sprite_row : sprite_row);
-                    const size_t pixel_x =
-                        x_pos + (flip_x ? sprite_col : 7 - sprite_col);
-
-                    if (pixel_x < (size_t)surface->w &&
-                        pixel_y < (size_t)surface->h) {
-                        pixels[(pixel_y * surface->w) + pixel_x] =
-                            map_color_index(color, pixel_format);
-                    }
-                }
-            }
-        }
+    u64 hash = 0xCBF29CE484222325;
+
+    for (size_t i = 0; i < (size_t)GB_LCD_WIDTH * GB_LCD_HEIGHT; ++i) {
+        hash ^= framebuffer[i];
+        hash *= 0x100000001B3;
     }
+
+    return hash;
 }
 
 static void update_texture(const State *const state)
 {
-    SDL_Surface *surface = nullptr;
+    void *pixels = nullptr;
+    int pitch = 0;
 
     SDL_CHECKED(
-        SDL_LockTextureToSurface(state->screen_texture, nullptr, &surface),
+        SDL_LockTexture(state->screen_texture, nullptr, &pixels, &pitch),
         "Could not lock texture");
 
-    const SDL_PixelFormatDetails *const pixel_format =
-        SDL_GetPixelFormatDetails(surface->format);
-    BAIL_IF(pixel_format == nullptr, "Could not get pixel format: %s",
-            SDL_GetError());
+    const u8 *shades = state->gb.framebuffer;
 
-    SDL_FillSurfaceRect(surface, nullptr,
-                        SDL_MapRGB(pixel_format, nullptr, 0, 0, 0));
+    // Every pixel is overwritten, so there is no need to clear the texture
+    for (size_t y = 0; y < GB_LCD_HEIGHT; ++y) {
+        u32 *const row = (u32 *)((u8 *)pixels + (y * (size_t)pitch));
 
-    if ((state->gb.lcdc & LcdControl_Enable) != 0) {
-        draw_tiles(state, surface, pixel_format);
+        for (size_t x = 0; x < GB_LCD_WIDTH; ++x)
+            row[x] = state->colors[shades[x]];
 
-        if ((state->gb.lcdc & LcdControl_ObjEnable) != 0) {
-            draw_objects(state, surface, pixel_format);
-        }
+        shades += GB_LCD_WIDTH;
     }
 
     SDL_UnlockTexture(state->screen_texture);
 }
 
-static void render(const State *const state, SDL_Renderer *const renderer)
+static void render(State *const state, SDL_Renderer *const renderer)
 {
     const float ASPECT_RATIO = (float)GB_LCD_WIDTH / GB_LCD_HEIGHT;
 
-    update_texture(state);
+    // Nothing would be seen, so it is all left for when the window shows again
+    const SDL_WindowFlags window_flags =
+        SDL_GetWindowFlags(SDL_GetRenderWindow(renderer));
+
+    if ((window_flags & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED |
+                         SDL_WINDOW_OCCLUDED)) != 0) {
+        state->redraw_window = true;
+        return;
+    }
+
+    // Lines the PPU redraws often come out the same as before, as when games
+    // rewrite OAM every frame
+    if (state->gb.framebuffer_dirty) {
+        state->gb.framebuffer_dirty = false;
+
+        const u64 hash = hash_framebuffer(state->gb.framebuffer);
+
+        if (hash != state->texture_hash) {
+            update_texture(state);
+            state->texture_hash = hash;
+            state->redraw_window = true;
+        }
+    }
+
+    if (!state->redraw_window)
+        return;
+
+    state->redraw_window = false;
 
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(renderer);
 
-    // TODO: implement window wrapping
-    const SDL_FRect src_rect = {
-        .x = state->gb.scx,
-        .y = state->gb.scy,
-        .w = GB_LCD_WIDTH,
-        .h = GB_LCD_HEIGHT,
-    };
-
     const SDL_FRect dest_rect =
         fit_rect_to_aspect_ratio(&(SDL_FRect){0, 0, (float)state->window_width,
                                               (float)state->window_height},
                                  ASPECT_RATIO);
 
-    SDL_RenderTexture(renderer, state->screen_texture, &src_rect, &dest_rect);
+    SDL_RenderTexture(renderer, state->screen_texture, nullptr, &dest_rect);
     SDL_RenderPresent(renderer);
 }
 
 void run_until_quit(State *const state, SDL_Renderer *const renderer)
 {
+    init_colors(state);
+
+    update_texture(state);
+    state->texture_hash = hash_framebuffer(state->gb.framebuffer);
+    state->redraw_window = true;
+
     double last_time = sdl_get_performance_time();
     double time_accumulator = 0.0;
 
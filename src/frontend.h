@@ -2,6 +2,7 @@
 #define GEMU_FRONTEND_H
 
 #include "game_boy.h"
+#include "gdb_stub.h"
 #include <SDL3/SDL.h>
 
 typedef struct {
@@ -14,8 +15,48 @@ typedef struct {
     int tima_cycle_counter;
     bool quit;
     SDL_Texture *screen_texture;
+    /** The color of each shade, in the pixel format of screen_texture */
+    u32 colors[4];
+    /** Hash of the framebuffer last uploaded to screen_texture */
+    u64 texture_hash;
+    /** Whether the window has to be presented, even if the LCD is unchanged */
+    bool redraw_window;
+    u32 save_interval_ms;
+    GdbStub *gdb;
 } State;
 
 void run_until_quit(State *state, SDL_Renderer *renderer);
 
+/**
+ * \brief Marks the idle loops cached for the loaded ROM by previous runs as
+ * known, so that they can be skipped right away.
+ *
+ * \param gb the GameBoy. Must have a ROM loaded.
+ *
+ * \sa IdleLoopDetector_load
+ */
+void load_idle_loops(GameBoy *gb);
+
+/**
+ * \brief Caches the idle loops found in the loaded ROM for later runs.
+ *
+ * \param gb the GameBoy. Does nothing if it has no ROM loaded.
+ *
+ * \sa IdleLoopDetector_save
+ */
+void save_idle_loops(GameBoy *gb);
+
+/**
+ * \brief Backs the external RAM of the loaded ROM with its save file.
+ *
+ * The save file sits next to the ROM file, with its extension replaced by
+ * .sav, as is common among emulators.
+ *
+ * \param state the State. Its GameBoy must have a ROM loaded.
+ * \param rom_path the path the loaded ROM was read from.
+ *
+ * \sa GameBoy_load_save
+ */
+void load_save(State *state, const char *rom_path);
+
 #endif
@@ -1,9 +1,19 @@
 #include "game_boy.h"
+#include "aot.h"
+#include "cheats.h"
 #include "cpu.h"
 #include "data.h"
+#include "decode_cache.h"
+#include "idiom.h"
+#include "idle_loop.h"
+#include "jit.h"
 #include "log.h"
 #include "macros.h"
+#include "mapper.h"
 #include "num.h"
+#include "ppu.h"
+#include "rom_image.h"
+#include "save_ram.h"
 #include "stdinc.h"
 #include "string.h"
 #include <stddef.h>
@@ -57,6 +67,18 @@ static void verify_rom_checksum(const u8 *const rom)
         rom[RomHeader_HeaderChecksum], checksum_lo);
 }
 
+/**
+ * \brief Rebuilds the shade lookup tables of BGP, OBP0 and OBP1.
+ */
+static void GameBoy_update_palettes(GameBoy *const self)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        self->bg_shades[i] = (self->bgp >> (i * 2)) & 0b11;
+        self->obj_shades[0][i] = (self->obp0 >> (i * 2)) & 0b11;
+        self->obj_shades[1][i] = (self->obp1 >> (i * 2)) & 0b11;
+    }
+}
+
 static void GameBoy_simulate_boot(GameBoy *const self)
 {
     verify_rom_checksum(self->rom);
@@ -71,6 +93,12 @@ static void GameBoy_simulate_boot(GameBoy *const self)
     self->cpu.sp = 0xFFFE;
     self->cpu.pc = 0x0100;
 
+    // The boot ROM leaves the LCD on, showing the background
+    self->lcdc = LcdControl_Enable | LcdControl_BgwTileArea |
+                 LcdControl_ObjBgwEnable;
+    self->bgp = 0xFC;
+    GameBoy_update_palettes(self);
+
     self->boot_rom_enable = false;
 }
 
@@ -78,11 +106,12 @@ static void GameBoy_reset(GameBoy *const self)
 {
     self->cpu.pc = 0;
     self->boot_rom_enable = true;
+    self->dma_cycles_left = 0;
 }
 
 static void GameBoy_validate_rom(const GameBoy *const self)
 {
-    BAIL_IF(self->rom[RomHeader_CartridgeType] != 0x00,
+    BAIL_IF(!Mapper_is_supported(self->rom[RomHeader_CartridgeType]),
             "Unsupported cartridge type (ctype: $%02X)",
             self->rom[RomHeader_CartridgeType]);
 
@@ -98,14 +127,241 @@ static void GameBoy_validate_rom(const GameBoy *const self)
         self->rom[RomHeader_RomSize], self->rom_len);
 }
 
+static u8 *alloc_memory(const size_t len)
+{
+    u8 *const memory = calloc(len, sizeof(u8));
+    BAIL_IF_NULL(memory, "Could not allocate GameBoy memory");
+    return memory;
+}
+
+/**
+ * \brief Maps the pages from first_page to last_page to contiguous memory
+ * starting at read and write, either of which may be NULL.
+ */
+static void GameBoy_map_region(GameBoy *const self, const u8 first_page,
+                               const u8 last_page, const PageKind kind,
+                               const u8 *const read, u8 *const write)
+{
+    for (size_t page = first_page; page <= last_page; ++page) {
+        const size_t offset = (page - first_page) << 8;
+
+        self->pages[page] = (GameBoyPage){
+            .read = read != nullptr ? &read[offset] : nullptr,
+            .write = write != nullptr ? &write[offset] : nullptr,
+            .kind = kind,
+        };
+    }
+}
+
+/**
+ * First code page of the pages blocked by OAM DMA, which only ever read as $FF.
+ * Code pages below are those of memory that is never banked, numbered after
+ * the page they are mapped into.
+ */
+static constexpr size_t CODE_PAGE_BLOCKED = 0x100;
+
+/**
+ * First code page of ROM. Each bank gets its own code page for every page of
+ * the 32 KiB it may be mapped into, since compiled code depends on the address
+ * it runs at.
+ */
+static constexpr size_t CODE_PAGE_ROM = 0x200;
+
+/**
+ * \brief Tells the code caches which code pages are mapped into a range of
+ * pages, remembering them for caches attached later on.
+ */
+static void GameBoy_map_code(GameBoy *const self, const u8 first_page,
+                             const u8 last_page, const size_t first_id)
+{
+    for (size_t page = first_page; page <= last_page; ++page)
+        self->code_pages[page] = first_id + (page - first_page);
+
+    Cpu_map_code(&self->cpu, first_page, last_page, first_id);
+}
+
+/**
+ * \brief Runs translated code only while what it was translated from is
+ * mapped.
+ */
+static void GameBoy_update_aot(GameBoy *const self)
+{
+    // Translated code assumes the first ROM bank is mapped at $0000, and that
+    // ROM is not patched. It also runs whole blocks, which a debugger cannot
+    // stop halfway through. OAM DMA hides ROM from the CPU until it ends
+    const bool mapped = !self->boot_rom_enable && !self->debugging &&
+                        self->dma_cycles_left == 0 &&
+                        Mapper_rom_bank_lo(&self->mapper) == 0 &&
+                        self->cheats->rom_pages_len == 0;
+
+    self->cpu.aot = mapped ? self->aot_module : nullptr;
+}
+
+/**
+ * \brief Takes everything below the I/O registers out of reach of the CPU, as
+ * OAM DMA does until it ends.
+ *
+ * Code caches see different code pages there in the meantime, so that nothing
+ * they cached from either side is run on the other.
+ */
+static void GameBoy_block_pages(GameBoy *const self)
+{
+    GameBoy_map_region(self, 0x00, 0xFE, PageKind_Blocked, nullptr, nullptr);
+    GameBoy_map_code(self, 0x00, 0xFE, CODE_PAGE_BLOCKED);
+    GameBoy_update_aot(self);
+}
+
+static const u8 *GameBoy_rom_bank(const GameBoy *const self, const size_t bank)
+{
+    if (self->rom == nullptr)
+        return nullptr;
+
+    return &self->rom[bank * MAPPER_ROM_BANK_LEN];
+}
+
+static u8 *GameBoy_ext_ram_bank(const GameBoy *const self)
+{
+    size_t bank;
+
+    if (!Mapper_ram_bank(&self->mapper, &bank))
+        return nullptr;
+
+    return &self->ext_ram[bank * MAPPER_RAM_BANK_LEN];
+}
+
+/**
+ * \brief Maps a ROM bank into the 16 KiB window starting at first_page, with
+ * the pages patched by cheats mapped to their patched copies instead.
+ */
+static void GameBoy_map_rom_bank(GameBoy *const self, const u8 first_page,
+                                 const size_t bank)
+{
+    const u8 last_page = first_page + 0x3F;
+
+    // Writes to ROM go to the cartridge's mapper instead
+    GameBoy_map_region(self, first_page, last_page, PageKind_Rom,
+                       GameBoy_rom_bank(self, bank), nullptr);
+    GameBoy_map_code(self, first_page, last_page,
+                     CODE_PAGE_ROM + (bank * 0x80) + first_page);
+
+    for (size_t page = first_page; page <= last_page; ++page) {
+        const u8 *const patched = Cheats_rom_page(self->cheats, page, bank);
+
+        if (patched != nullptr)
+            self->pages[page].read = patched;
+    }
+}
+
+static void GameBoy_map_rom_lo(GameBoy *const self, const size_t bank)
+{
+    self->rom_bank_lo = bank;
+    GameBoy_map_rom_bank(self, 0x00, bank);
+
+    if (self->boot_rom_enable) {
+        self->pages[0x00].read =
+            self->boot_rom_exists ? self->boot_rom : nullptr;
+        GameBoy_map_code(self, 0x00, 0x00, 0x00);
+    }
+
+    GameBoy_update_aot(self);
+}
+
+static void GameBoy_map_rom_hi(GameBoy *const self, const size_t bank)
+{
+    self->rom_bank_hi = bank;
+    GameBoy_map_rom_bank(self, 0x40, bank);
+}
+
+/**
+ * \brief Rebuilds the page table of a GameBoy.
+ *
+ * Must be called whenever what is mapped into the address space changes, like
+ * when loading a ROM or unmapping the boot ROM. Switching banks is handled by
+ * GameBoy_switch_banks instead.
+ */
+static void GameBoy_map_pages(GameBoy *const self)
+{
+    const Mapper *const mapper = &self->mapper;
+    u8 *const ext_ram = GameBoy_ext_ram_bank(self);
+
+    GameBoy_map_rom_lo(self, Mapper_rom_bank_lo(mapper));
+    GameBoy_map_rom_hi(self, Mapper_rom_bank_hi(mapper));
+
+    GameBoy_map_region(self, 0x80, 0x9F, PageKind_Vram, self->vram, self->vram);
+    GameBoy_map_region(self, 0xA0, 0xBF, PageKind_ExtRam, ext_ram, ext_ram);
+    GameBoy_map_region(self, 0xC0, 0xDF, PageKind_Wram, self->ram, self->ram);
+
+    // Writes to echo RAM must invalidate code at the address they mirror
+    GameBoy_map_region(self, 0xE0, 0xFD, PageKind_EchoRam, self->ram, nullptr);
+
+    // OAM shares its page with unusable memory, and HRAM with I/O registers
+    GameBoy_map_region(self, 0xFE, 0xFE, PageKind_Oam, nullptr, nullptr);
+    GameBoy_map_region(self, 0xFF, 0xFF, PageKind_High, nullptr, nullptr);
+    GameBoy_map_code(self, 0x80, 0xFF, 0x80);
+
+    // OAM DMA keeps everything below the I/O registers to itself until it ends
+    if (self->dma_cycles_left != 0)
+        GameBoy_block_pages(self);
+}
+
+/**
+ * \brief Points the banked windows of the page table at the banks currently
+ * selected by the Mapper.
+ *
+ * Only windows whose bank actually changed are touched. Code cached from the
+ * banks switched out is kept for when they get switched back in.
+ */
+static void GameBoy_switch_banks(GameBoy *const self)
+{
+    const Mapper *const mapper = &self->mapper;
+    const size_t rom_lo = Mapper_rom_bank_lo(mapper);
+    const size_t rom_hi = Mapper_rom_bank_hi(mapper);
+    u8 *const ext_ram = GameBoy_ext_ram_bank(self);
+
+    // Compared by bank, since pages may be covered by the boot ROM or cheats
+    if (self->rom_bank_lo != rom_lo)
+        GameBoy_map_rom_lo(self, rom_lo);
+
+    if (self->rom_bank_hi != rom_hi)
+        GameBoy_map_rom_hi(self, rom_hi);
+
+    if (self->pages[0xA0].write != ext_ram)
+        GameBoy_map_region(self, 0xA0, 0xBF, PageKind_ExtRam, ext_ram, ext_ram);
+}
+
+/**
+ * \brief Frees external RAM, closing its save file if it has one.
+ */
+static void GameBoy_free_ext_ram(GameBoy *const self)
+{
+    if (self->save != nullptr)
+        SaveRam_close(self->save);
+    else
+        free(self->ext_ram);
+
+    self->save = nullptr;
+    self->ext_ram = nullptr;
+}
+
 GameBoy GameBoy_new(const u8 *const boot_rom)
 {
     GameBoy gb = {
         .cpu = Cpu_new(),
+        .tier = CpuTier_Fast,
+        .rom_image = nullptr,
         .rom = nullptr,
         .rom_len = 0,
+        .mapper = Mapper_new(CartridgeType_RomOnly, 2, 0),
+        .ext_ram = nullptr,
+        .ext_ram_len = 0,
+        .save = nullptr,
+        .cheats = Cheats_new(),
         .boot_rom_exists = boot_rom != nullptr,
         .boot_rom_enable = true,
+        .debugging = false,
+        .paused_jit = nullptr,
+        .paused_decode_cache = nullptr,
+        .aot_module = nullptr,
         .lcdc = 0,
         .stat = 0,
         .ly = 0,
@@ -117,6 +373,12 @@ GameBoy GameBoy_new(const u8 *const boot_rom)
         .bgp = 0,
         .obp0 = 0,
         .obp1 = 0,
+        .bg_shades = {},
+        .obj_shades = {},
+        .lines_drawn = 0,
+        .window_line = 0,
+        .lines = {},
+        .framebuffer_dirty = true,
         .ie = 0,
         .if_ = 0,
         .sb = 0,
@@ -126,20 +388,170 @@ GameBoy GameBoy_new(const u8 *const boot_rom)
         .tma = 0,
         .tac = 0,
         .joyp = 0x0F,
+        .dma = 0,
+        .dma_cycles_left = 0,
+        .code_pages = {},
     };
 
+    // Kept out of line so that the page table stays valid when gb is moved
+    gb.ram = alloc_memory(0x2000);
+    gb.vram = alloc_memory(0x2000);
+    gb.hram = alloc_memory(0x7F);
+    gb.oam = alloc_memory(0xA0);
+    gb.boot_rom = alloc_memory(GB_BOOT_ROM_LEN);
+    gb.framebuffer = alloc_memory((size_t)GB_LCD_WIDTH * GB_LCD_HEIGHT);
+    gb.tiles = TileCache_new(gb.vram);
+
     if (boot_rom != nullptr)
-        memcpy(gb.boot_rom, boot_rom, sizeof(gb.boot_rom));
+        memcpy(gb.boot_rom, boot_rom, GB_BOOT_ROM_LEN);
+
+    // Code is only ever predecoded from ROM, WRAM and HRAM
+    gb.cpu.decode_cache = DecodeCache_new();
+    DecodeCache_set_cacheable(gb.cpu.decode_cache, 0x0000, 0x7FFF);
+    DecodeCache_set_cacheable(gb.cpu.decode_cache, 0xC000, 0xDFFF);
+    DecodeCache_set_cacheable(gb.cpu.decode_cache, 0xFF80, 0xFFFF);
+
+    // Idioms may only touch memory that reads and writes without side effects
+    gb.cpu.idioms = IdiomCache_new();
+    IdiomCache_set_readable(gb.cpu.idioms, 0x0000, 0x7FFF);
+    IdiomCache_set_readable(gb.cpu.idioms, 0x8000, 0x9FFF);
+    IdiomCache_set_readable(gb.cpu.idioms, 0xC000, 0xDFFF);
+    IdiomCache_set_readable(gb.cpu.idioms, 0xFE00, 0xFE9F);
+    IdiomCache_set_readable(gb.cpu.idioms, 0xFF80, 0xFFFE);
+    IdiomCache_set_writable(gb.cpu.idioms, 0x8000, 0x9FFF);
+    IdiomCache_set_writable(gb.cpu.idioms, 0xC000, 0xDFFF);
+    IdiomCache_set_writable(gb.cpu.idioms, 0xFE00, 0xFE9F);
+    IdiomCache_set_writable(gb.cpu.idioms, 0xFF80, 0xFFFE);
+
+    gb.idle_loops = IdleLoopDetector_new();
+
+    // Once the code caches exist, so that they learn what is mapped
+    GameBoy_map_pages(&gb);
 
     return gb;
 }
 
 void GameBoy_destroy(GameBoy *const self)
 {
-    free(self->rom);
+    RomImage_release(self->rom_image);
 
+    self->rom_image = nullptr;
     self->rom = nullptr;
     self->rom_len = 0;
+
+    GameBoy_free_ext_ram(self);
+    self->ext_ram_len = 0;
+
+    Cheats_destroy(self->cheats);
+    self->cheats = nullptr;
+
+    free(self->ram);
+    free(self->vram);
+    free(self->hram);
+    free(self->oam);
+    free(self->boot_rom);
+    free(self->framebuffer);
+
+    self->ram = nullptr;
+    self->vram = nullptr;
+    self->hram = nullptr;
+    self->oam = nullptr;
+    self->boot_rom = nullptr;
+    self->framebuffer = nullptr;
+
+    TileCache_destroy(self->tiles);
+    self->tiles = nullptr;
+
+    DecodeCache_destroy(self->cpu.decode_cache);
+    DecodeCache_destroy(self->paused_decode_cache);
+    self->cpu.decode_cache = nullptr;
+    self->paused_decode_cache = nullptr;
+
+    Jit_destroy(self->cpu.jit);
+    Jit_destroy(self->paused_jit);
+    self->cpu.jit = nullptr;
+    self->paused_jit = nullptr;
+
+    IdiomCache_destroy(self->cpu.idioms);
+    self->cpu.idioms = nullptr;
+
+    IdleLoopDetector_destroy(self->idle_loops);
+    self->idle_loops = nullptr;
+}
+
+/**
+ * \brief Tells the code caches which code pages are mapped, for those that
+ * were not attached to the Cpu while they got mapped.
+ */
+static void GameBoy_remap_code(GameBoy *const self)
+{
+    for (size_t page = 0; page < 0x100; ++page)
+        Cpu_map_code(&self->cpu, page, page, self->code_pages[page]);
+}
+
+bool GameBoy_enable_jit(GameBoy *const self)
+{
+    if (self->cpu.jit != nullptr || self->paused_jit != nullptr)
+        return true;
+
+    self->cpu.jit = Jit_new();
+
+    if (self->cpu.jit == nullptr)
+        return false;
+
+    GameBoy_remap_code(self);
+
+    // Same regions as the decode cache
+    Jit_set_cacheable(self->cpu.jit, 0x0000, 0x7FFF);
+    Jit_set_cacheable(self->cpu.jit, 0xC000, 0xDFFF);
+    Jit_set_cacheable(self->cpu.jit, 0xFF80, 0xFFFF);
+
+    return true;
+}
+
+void GameBoy_set_debugging(GameBoy *const self, const bool debugging)
+{
+    if (self->debugging == debugging)
+        return;
+
+    self->debugging = debugging;
+
+    if (debugging) {
+        self->paused_jit = self->cpu.jit;
+        self->paused_decode_cache = self->cpu.decode_cache;
+        self->cpu.jit = nullptr;
+        self->cpu.decode_cache = nullptr;
+    } else {
+        self->cpu.jit = self->paused_jit;
+        self->cpu.decode_cache = self->paused_decode_cache;
+        self->paused_jit = nullptr;
+        self->paused_decode_cache = nullptr;
+
+        // Nothing invalidated or mapped their code while they were set aside
+        if (self->cpu.jit != nullptr)
+            Jit_flush(self->cpu.jit);
+
+        if (self->cpu.decode_cache != nullptr)
+            DecodeCache_flush(self->cpu.decode_cache);
+
+        GameBoy_remap_code(self);
+    }
+
+    GameBoy_update_aot(self);
+}
+
+bool GameBoy_set_aot_module(GameBoy *const self,
+                            const AotModule *const module)
+{
+    BAIL_IF_NULL(self->rom, "Cannot set an AOT module without a ROM loaded");
+
+    if (!AotModule_matches(module, self->rom, self->rom_len))
+        return false;
+
+    self->aot_module = module;
+    GameBoy_update_aot(self);
+
+    return true;
 }
 
 void GameBoy_log_cartridge_info(const GameBoy *const self)
@@ -157,150 +569,425 @@ void GameBoy_log_cartridge_info(const GameBoy *const self)
     log_info("Game title: %s", game_title);
 }
 
-void GameBoy_load_rom(GameBoy *const self, const u8 *const rom,
-                      const size_t rom_len)
+void GameBoy_load_rom(GameBoy *const self, RomImage *const rom)
 {
-    BAIL_IF(rom_len < 0x8000,
-            "ROM data cannot be less than 32768 bytes long (was %zu)", rom_len);
+    BAIL_IF(rom->len < 0x8000,
+            "ROM data cannot be less than 32768 bytes long (was %zu)",
+            rom->len);
 
-    free(self->rom);
+    // Retained first, in case rom is the image already loaded
+    RomImage_retain(rom);
+    RomImage_release(self->rom_image);
 
-    self->rom = malloc(rom_len * sizeof(self->rom[0]));
-    BAIL_IF(self->rom == nullptr, "Could not allocate memory for new ROM");
-
-    memcpy(self->rom, rom, rom_len * sizeof(self->rom[0]));
-    self->rom_len = rom_len;
+    self->rom_image = rom;
+    self->rom = rom->data;
+    self->rom_len = rom->len;
+    self->aot_module = nullptr;
 
     GameBoy_validate_rom(self);
+
+    // Smaller RAM still takes up a whole bank
+    const size_t ram_len = RamSize_len(self->rom[RomHeader_RamSize]);
+    const size_t ram_banks =
+        (ram_len + MAPPER_RAM_BANK_LEN - 1) / MAPPER_RAM_BANK_LEN;
+
+    GameBoy_free_ext_ram(self);
+    self->ext_ram_len = ram_banks * MAPPER_RAM_BANK_LEN;
+
+    if (self->ext_ram_len != 0) {
+        self->ext_ram = calloc(self->ext_ram_len, sizeof(self->ext_ram[0]));
+        BAIL_IF_NULL(self->ext_ram, "Could not allocate external RAM");
+    }
+
+    self->mapper = Mapper_new(self->rom[RomHeader_CartridgeType],
+                              self->rom_len / MAPPER_ROM_BANK_LEN, ram_banks);
+
     GameBoy_reset(self);
+    Cheats_clear(self->cheats);
+    Cpu_flush_code(&self->cpu);
+    IdleLoopDetector_clear(self->idle_loops);
 
     if (!self->boot_rom_exists)
         GameBoy_simulate_boot(self);
+
+    GameBoy_map_pages(self);
 }
 
-// NOLINTNEXTLINE
-u8 GameBoy_read_io(const GameBoy *const self, const u16 addr)
+bool GameBoy_load_save(GameBoy *const self, const char *const path,
+                       const u32 flush_interval_ms)
 {
-    if (addr == 0xFF00) // FF00 (joypad input)
-        return self->joyp;
+    BAIL_IF_NULL(self->rom, "Cannot load a save file without a ROM loaded");
 
-    // TODO: implement serial transfer
-    if (addr == 0xFF01) // FF01 (serial transfer data)
-        return 0xFF;
+    if (!CartridgeType_has_battery(self->rom[RomHeader_CartridgeType]) ||
+        self->ext_ram_len == 0)
+        return true;
 
-    if (addr == 0xFF02) // FF02 (serial transfer control)
-        return self->sc;
+    SaveRam *const save =
+        SaveRam_open(path, self->ext_ram_len, flush_interval_ms);
 
-    if (addr >= 0xFF04 && addr <= 0xFF07) {
-        // FF04-FF07 (timer and divider)
+    if (save == nullptr)
+        return false;
 
-        // clang-format off
-        switch (addr) {
-            case 0xFF04: return self->div;
-            case 0xFF05: return self->tima;
-            case 0xFF06: return self->tma;
-            case 0xFF07: return self->tac;
-            default: BAIL("Unexpected I/O timer and divider read ($%04X)", addr);
-        }
-        // clang-format on
+    GameBoy_free_ext_ram(self);
+    self->save = save;
+    self->ext_ram = save->data;
+
+    GameBoy_map_pages(self);
+    return true;
+}
+
+void GameBoy_add_cheat(GameBoy *const self, const Cheat *const cheat)
+{
+    BAIL_IF_NULL(self->rom, "Cannot add a cheat without a ROM loaded");
+
+    Cheats_add(self->cheats, cheat, self->rom, self->rom_len);
+
+    if (cheat->kind == CheatKind_RomPatch) {
+        // The patch may apply to banks that are not mapped right now
+        GameBoy_map_pages(self);
+        Cpu_flush_code(&self->cpu);
     }
+}
 
-    if (addr == 0xFF0F) // FF0F (interrupts)
-        return self->if_;
-
-    if (addr >= 0xFF10 && addr <= 0xFF26) // FF10-FF26 (audio)
-        BAIL("I/O audio read ($%04X)", addr);
-
-    if (addr >= 0xFF30 && addr <= 0xFF3F) // FF30-FF3F (wave pattern)
-        BAIL("I/O wave pattern read ($%04X)", addr);
-
-    if (addr >= 0xFF40 && addr <= 0xFF4B) {
-        // FF40-FF4B (LCD)
-        // clang-format off
-        switch (addr) {
-            case 0xFF40: return self->lcdc;
-            case 0xFF44: return self->ly;
-            case 0xFF45: return self->lcy;
-            case 0xFF41: return self->stat;
-            case 0xFF42: return self->scy;
-            case 0xFF43: return self->scx;
-            case 0xFF4A: return self->wy;
-            case 0xFF4B: return self->wx;
-            case 0xFF47: return self->bgp;
-            case 0xFF48: return self->obp0;
-            case 0xFF49: return self->obp1;
-            default: BAIL("Unexpected I/O LCD read (addr = $%04X)", addr);
-        }
-        // clang-format on
+void GameBoy_apply_freezes(GameBoy *const self)
+{
+    const Cheats *const cheats = self->cheats;
+
+    for (size_t i = 0; i < cheats->freezes_len; ++i) {
+        const Cheat *const freeze = &cheats->freezes[i];
+        const GameBoyPage *const page = &self->pages[freeze->addr >> 8];
+
+        // Only HRAM shares its page with anything else
+        if (page->write == nullptr && page->kind != PageKind_High)
+            continue;
+
+        // Rewriting the same value would still invalidate code cached there
+        if (GameBoy_read_mem(self, freeze->addr) != freeze->value)
+            GameBoy_write_mem(self, freeze->addr, freeze->value);
     }
+}
 
-    if (addr == 0xFF4D) // FF4D (CGB registers, CGB-only)
-        return 0xFF;
+/**
+ * \brief Reads a byte of the page an OAM DMA transfer copies from.
+ */
+static u8 GameBoy_read_dma_source(const GameBoy *const self, const u8 index)
+{
+    const GameBoyPage *const src = &self->dma_source;
 
-    if (addr == 0xFF4F) // FF4F (VRAM bank select, CGB-only)
-        return 0xFF;
+    if (src->read != nullptr)
+        return src->read[index];
 
-    if (addr == 0xFF50) // FF50 (boot ROM disable)
-        return 0xFF;
+    // External RAM while disabled or while an RTC register is mapped in
+    if (src->kind == PageKind_ExtRam)
+        return Mapper_read_register(&self->mapper);
 
-    if (addr >= 0xFF51 && addr <= 0xFF55) // FF51-FF55 (VRAM DMA, CGB-only)
-        return 0xFF;
+    return 0xFF;
+}
 
-    if (addr >= 0xFF68 && addr <= 0xFF6B) // FF68-FF6B (LCD palettes, CGB-only)
-        return 0xFF;
+typedef struct IoRegister IoRegister;
+
+/**
+ * \brief An I/O register, as seen from the CPU.
+ *
+ * Registers that are plain storage point their handlers at io_read_field and
+ * io_write_field, and set field to where in GameBoy they live. Only the bits
+ * set in write_mask are changed by writes to those.
+ */
+struct IoRegister {
+    u8 (*read)(const GameBoy *self, const IoRegister *reg);
+    void (*write)(GameBoy *self, const IoRegister *reg, u8 value);
+    size_t field;
+    u8 write_mask;
+};
+
+static u8 io_read_field(const GameBoy *const self, const IoRegister *const reg)
+{
+    return ((const u8 *)self)[reg->field];
+}
 
-    if (addr == 0xFF70) // FF70 (WRAM bank select, CGB-only)
-        return 0xFF;
+static void io_write_field(GameBoy *const self, const IoRegister *const reg,
+                           const u8 value)
+{
+    u8 *const field = &((u8 *)self)[reg->field];
+    *field = (*field & ~reg->write_mask) | (value & reg->write_mask);
+}
 
-    BAIL("Unexpected I/O read (addr = $%04X)", addr);
+static u8 io_read_open_bus([[maybe_unused]] const GameBoy *const self,
+                           [[maybe_unused]] const IoRegister *const reg)
+{
+    return 0xFF;
 }
 
-u8 GameBoy_read_mem(const void *const ctx, const u16 addr)
+static void io_write_joyp(GameBoy *const self,
+                          [[maybe_unused]] const IoRegister *const reg,
+                          const u8 value)
 {
-    const GameBoy *const self = ctx;
+    GameBoy_write_joyp(self, value);
+}
+
+static void io_write_div(GameBoy *const self,
+                         [[maybe_unused]] const IoRegister *const reg,
+                         [[maybe_unused]] const u8 value)
+{
+    self->div = 0;
+}
+
+static void io_write_lcdc(GameBoy *const self,
+                          [[maybe_unused]] const IoRegister *const reg,
+                          const u8 value)
+{
+    // The LCD goes blank as soon as it is turned off
+    if ((self->lcdc & LcdControl_Enable) != 0 &&
+        (value & LcdControl_Enable) == 0) {
+        memset(self->framebuffer, 0, (size_t)GB_LCD_WIDTH * GB_LCD_HEIGHT);
+        self->framebuffer_dirty = true;
+        Ppu_invalidate_lines(self);
+    }
+
+    self->lcdc = value;
+}
 
-    if (addr <= 0x7FFF) {
-        if (self->boot_rom_enable && addr <= 0x100) {
-            // 0000-0100 (Boot ROM)
-            if (!self->boot_rom_exists)
-                BAIL("Tried to read non-existing boot ROM");
+static void io_write_palette(GameBoy *const self, const IoRegister *const reg,
+                             const u8 value)
+{
+    io_write_field(self, reg, value);
+    GameBoy_update_palettes(self);
+}
 
-            return self->boot_rom[addr];
+/**
+ * \brief Writes a byte of OAM, having the lines its object affects drawn again
+ * if that changes it.
+ */
+static void GameBoy_write_oam(GameBoy *const self, const u8 offset,
+                              const u8 value)
+{
+    if (self->oam[offset] == value)
+        return;
+
+    self->oam[offset] = value;
+    Ppu_invalidate_object(self, offset / 4);
+}
+
+/**
+ * \brief Copies a whole OAM DMA transfer into OAM, having the lines of the
+ * objects it changes drawn again.
+ */
+static void GameBoy_copy_oam(GameBoy *const self, const u8 *const src)
+{
+    // Most games copy the same objects over and over, frame after frame
+    if (memcmp(self->oam, src, GB_OAM_DMA_CYCLES) == 0)
+        return;
+
+    for (u8 obj = 0; obj < GB_OAM_DMA_CYCLES / 4; ++obj) {
+        u8 *const dst = &self->oam[obj * 4];
+
+        if (memcmp(dst, &src[obj * 4], 4) != 0) {
+            memcpy(dst, &src[obj * 4], 4);
+            Ppu_invalidate_object(self, obj);
         }
+    }
+}
 
-        if (self->rom == nullptr)
-            BAIL("Tried to read non-existing ROM");
+static void io_write_dma(GameBoy *const self,
+                         [[maybe_unused]] const IoRegister *const reg,
+                         const u8 value)
+{
+    self->dma = value;
 
-        // 0000-7FFF (ROM bank)
-        return self->rom[addr];
+    // Restarting a transfer, so the source must be looked up unblocked
+    if (self->dma_cycles_left != 0) {
+        self->dma_cycles_left = 0;
+        GameBoy_map_pages(self);
     }
 
-    if (addr <= 0x9FFF) // 8000-9FFF (VRAM)
-        return self->vram[addr - 0x8000];
+    // Sources past WRAM read from its echo, as E000-FDFF do
+    const u8 src_page = value >= 0xE0 ? value - 0x20 : value;
 
-    if (addr <= 0xBFFF) // A000-BFFF (External RAM)
-        BAIL("TODO: GameBoy_read_mem (addr = $%04X)", addr);
+    // Resolved once, since the CPU cannot switch banks until the end
+    self->dma_source = self->pages[src_page];
+    self->dma_cycles_left = GB_OAM_DMA_CYCLES;
 
-    if (addr <= 0xDFFF) // C000-DFFF (WRAM)
-        return self->ram[addr - 0xC000];
+    if (self->tier != CpuTier_Accurate) {
+        if (self->dma_source.read != nullptr) {
+            GameBoy_copy_oam(self, self->dma_source.read);
+        } else {
+            u8 data[GB_OAM_DMA_CYCLES];
+            for (u8 i = 0; i < GB_OAM_DMA_CYCLES; ++i)
+                data[i] = GameBoy_read_dma_source(self, i);
 
-    if (addr <= 0xFDFF) // E000-FDFF (Echo RAM, mirror of C000-DDFF)
-        return self->ram[addr - 0xE000];
+            GameBoy_copy_oam(self, data);
+        }
+    }
 
-    if (addr <= 0xFE9F) // FE00-FE9F (OAM)
-        return self->oam[addr - 0xFE00];
+    GameBoy_block_pages(self);
+}
+
+static void io_write_boot_rom(GameBoy *const self,
+                              [[maybe_unused]] const IoRegister *const reg,
+                              const u8 value)
+{
+    if (value != 0 && self->boot_rom_enable) {
+        self->boot_rom_enable = false;
+        GameBoy_map_pages(self);
+    }
+}
+
+#define IO_FIELD(name, mask)              \
+    {                                     \
+        .read = io_read_field,            \
+        .write = io_write_field,          \
+        .field = offsetof(GameBoy, name), \
+        .write_mask = (mask),             \
+    }
+
+/**
+ * \brief The I/O registers from FF00 to FF7F, indexed by their address.
+ *
+ * Registers left out (audio and CGB-only ones included, for now) read as open
+ * bus and ignore writes.
+ */
+static const IoRegister IO_REGISTERS[0x80] = {
+    // FF00 (joypad input)
+    [0x00] = {.read = io_read_field,
+              .write = io_write_joyp,
+              .field = offsetof(GameBoy, joyp)},
+
+    // FF01-FF02 (serial transfer)
+    // TODO: implement serial transfer
+    [0x01] = {.read = io_read_open_bus,
+              .write = io_write_field,
+              .field = offsetof(GameBoy, sb),
+              .write_mask = 0xFF},
+    [0x02] = IO_FIELD(sc, 0xFF),
+
+    // FF04-FF07 (timer and divider)
+    [0x04] = {.read = io_read_field,
+              .write = io_write_div,
+              .field = offsetof(GameBoy, div)},
+    [0x05] = IO_FIELD(tima, 0xFF),
+    [0x06] = IO_FIELD(tma, 0xFF),
+    [0x07] = IO_FIELD(tac, 0xFF),
+
+    // FF0F (interrupts)
+    [0x0F] = IO_FIELD(if_, 0xFF),
+
+    // FF40-FF4B (LCD)
+    [0x40] = {.read = io_read_field,
+              .write = io_write_lcdc,
+              .field = offsetof(GameBoy, lcdc)},
+    [0x41] = IO_FIELD(stat, 0b11111000),
+    [0x42] = IO_FIELD(scy, 0xFF),
+    [0x43] = IO_FIELD(scx, 0xFF),
+    [0x44] = IO_FIELD(ly, 0x00),
+    [0x45] = IO_FIELD(lcy, 0xFF),
+    [0x46] = {.read = io_read_field,
+              .write = io_write_dma,
+              .field = offsetof(GameBoy, dma)},
+    [0x47] = {.read = io_read_field,
+              .write = io_write_palette,
+              .field = offsetof(GameBoy, bgp),
+              .write_mask = 0xFF},
+    [0x48] = {.read = io_read_field,
+              .write = io_write_palette,
+              .field = offsetof(GameBoy, obp0),
+              .write_mask = 0xFF},
+    [0x49] = {.read = io_read_field,
+              .write = io_write_palette,
+              .field = offsetof(GameBoy, obp1),
+              .write_mask = 0xFF},
+    [0x4A] = IO_FIELD(wy, 0xFF),
+    [0x4B] = IO_FIELD(wx, 0xFF),
+
+    // FF50 (boot ROM disable)
+    [0x50] = {.read = io_read_open_bus, .write = io_write_boot_rom},
+};
+
+#undef IO_FIELD
+
+static u8 GameBoy_read_io(const GameBoy *const self, const u16 addr)
+{
+    const IoRegister *const reg = &IO_REGISTERS[addr & 0x7F];
+
+    if (reg->read == nullptr)
+        return io_read_open_bus(self, reg);
+
+    return reg->read(self, reg);
+}
+
+static void GameBoy_write_io(GameBoy *const self, const u16 addr,
+                             const u8 value)
+{
+    const IoRegister *const reg = &IO_REGISTERS[addr & 0x7F];
+
+    if (reg->write != nullptr)
+        reg->write(self, reg, value);
+}
 
-    if (addr <= 0xFEFF) // FEA0-FEFF (Not usable)
+/**
+ * \brief Hands control back from compiled code to the frontend right after an
+ * access to I/O registers or IE, so that it gets to catch up on whatever the
+ * access may have started or be waiting on.
+ */
+static void GameBoy_end_jit_run(const GameBoy *const self)
+{
+    if (self->cpu.jit != nullptr)
+        Jit_end_run(self->cpu.jit);
+}
+
+/**
+ * \brief Reads from a page that is not plain memory.
+ */
+static u8 GameBoy_read_page(const GameBoy *const self, const PageKind kind,
+                            const u16 addr)
+{
+    switch (kind) {
+    case PageKind_Rom:
+        // 0000-00FF (Boot ROM), 0000-7FFF (ROM bank)
+        if (self->boot_rom_enable && addr < GB_BOOT_ROM_LEN)
+            BAIL("Tried to read non-existing boot ROM");
+
+        BAIL("Tried to read non-existing ROM");
+
+    case PageKind_ExtRam: // A000-BFFF (External RAM, while not mapped)
+        return Mapper_read_register(&self->mapper);
+
+    case PageKind_Oam:
+        if (addr <= 0xFE9F) // FE00-FE9F (OAM)
+            return self->oam[addr - 0xFE00];
+
+        // FEA0-FEFF (Not usable)
         BAIL("Tried to read unusable memory (addr = $%04X)", addr);
 
-    if (addr <= 0xFF7F) // FF00-FF7F (I/O registers)
-        return GameBoy_read_io(self, addr);
+    case PageKind_High:
+        if (addr <= 0xFF7F) { // FF00-FF7F (I/O registers)
+            GameBoy_end_jit_run(self);
+            return GameBoy_read_io(self, addr);
+        }
+
+        if (addr <= 0xFFFE) // FF80-FFFE (High RAM)
+            return self->hram[addr - 0xFF80];
+
+        // FFFF (Interrupt Enable Register)
+        GameBoy_end_jit_run(self);
+        return self->ie;
+
+    case PageKind_Blocked: // 0000-FEFF (while OAM DMA is running)
+        return 0xFF;
+
+    default:
+        BAIL("Unexpected read from unmapped page (addr = $%04X)", addr);
+    }
+}
 
-    if (addr <= 0xFFFE) // FF80-FFFE (High RAM)
-        return self->hram[addr - 0xFF80];
+u8 GameBoy_read_mem(const void *const ctx, const u16 addr)
+{
+    const GameBoy *const self = ctx;
+    const GameBoyPage *const page = &self->pages[addr >> 8];
 
-    // FFFF (Interrupt Enable Register)
-    return self->ie;
+    if (page->read != nullptr)
+        return page->read[addr & 0xFF];
+
+    return GameBoy_read_page(self, page->kind, addr);
 }
 
 u16 GameBoy_read_mem_u16(GameBoy *const self, u16 addr)
@@ -310,129 +997,233 @@ u16 GameBoy_read_mem_u16(GameBoy *const self, u16 addr)
     return concat_u16(hi, lo);
 }
 
-// NOLINTNEXTLINE
-void GameBoy_write_io(GameBoy *const self, const u16 addr, const u8 value)
-{
-    if (addr == 0xFF00) {
-        // FF00 (joypad input)
-        GameBoy_write_joyp(self, value);
-    } else if (addr == 0xFF01) {
-        // FF01 (serial transfer data)
-        self->sb = value;
-    } else if (addr == 0xFF02) {
-        // FF02 (serial transfer control)
-        // TODO: implement properly
-        self->sc = value;
-    } else if (addr >= 0xFF04 && addr <= 0xFF07) {
-        // FF04-FF07 (timer and divider)
-        // clang-format off
-        switch (addr) {
-            case 0xFF04: self->div = 0; break;
-            case 0xFF05: self->tima = value; break;
-            case 0xFF06: self->tma = value; break;
-            case 0xFF07: self->tac = value; break;
-            default: BAIL("Unexpected I/O timer and divider write ($%04X, $%02X)", addr, value);
-        }
-        // clang-format on
-    } else if (addr == 0xFF0F) {
-        // FF0F (interrupts)
-        self->if_ = value;
-    } else if (addr >= 0xFF10 && addr <= 0xFF26) {
-        // FF10-FF26 (audio)
-        // TODO: I/O audio write
-    } else if (addr >= 0xFF30 && addr <= 0xFF3F) {
-        // FF30-FF3F (wave pattern)
-        // TODO: I/O wave pattern write
-    } else if (addr == 0xFF46) {
-        // FF46 (OAM DMA source address and start)
-        const u16 src = (u16)value << 8;
-
-        // TODO: implement proper timing
-        for (size_t i = 0; i < 0xA0; ++i) {
-            self->oam[i] = GameBoy_read_mem(self, src + i);
+/**
+ * \brief Writes to a page that is not plain memory.
+ */
+static void GameBoy_write_page(GameBoy *const self, const PageKind kind,
+                               const u16 addr, const u8 value)
+{
+    switch (kind) {
+    case PageKind_Rom: // 0000-7FFF (mapper registers)
+        if (Mapper_write(&self->mapper, addr, value))
+            GameBoy_switch_banks(self);
+        break;
+
+    case PageKind_ExtRam: // A000-BFFF (External RAM, while not mapped)
+        Mapper_write_register(&self->mapper, value);
+        break;
+
+    case PageKind_EchoRam: // E000-FDFF (Echo RAM, mirror of C000-DDFF)
+        self->ram[addr - 0xE000] = value;
+        Cpu_invalidate_code(&self->cpu, addr - 0x2000);
+        break;
+
+    case PageKind_Oam:
+        if (addr <= 0xFE9F) {
+            // FE00-FE9F (OAM)
+            // TODO: should only be writable during HBlank or VBlank
+            GameBoy_write_oam(self, addr - 0xFE00, value);
+        } else {
+            // FEA0-FEFF (Not usable)
+            log_debug(
+                "Tried to write into unusable memory (addr = $%04X, $%02X)",
+                addr, value);
         }
-    } else if (addr >= 0xFF40 && addr <= 0xFF4B) {
-        // FF40-FF4B (LCD)
-        // clang-format off
-        switch (addr) {
-            case 0xFF40: self->lcdc = value; break;
-            case 0xFF45: self->lcy = value; break;
-            case 0xFF41:
-                // Modifies only bits 3-7
-                self->stat = (self->stat & 0b111) | (value & ~0b111);
-                break;
-            case 0xFF42: self->scy = value; break;
-            case 0xFF43: self->scx = value; break;
-            case 0xFF4A: self->wy = value; break;
-            case 0xFF4B: self->wx = value; break;
-            case 0xFF47: self->bgp = value; break;
-            case 0xFF48: self->obp0 = value; break;
-            case 0xFF49: self->obp1 = value; break;
-            default: BAIL("Unexpected I/O LCD write (addr = $%04X, value = $%02X)", addr, value);
+        break;
+
+    case PageKind_High:
+        if (addr <= 0xFF7F) {
+            // FF00-FF7F I/O registers
+            GameBoy_write_io(self, addr, value);
+            GameBoy_end_jit_run(self);
+        } else if (addr <= 0xFFFE) {
+            // FF80-FFFE (High RAM)
+            self->hram[addr - 0xFF80] = value;
+            Cpu_invalidate_code(&self->cpu, addr);
+        } else {
+            // FFFF (Interrupt Enable Register)
+            // Shares its page with HRAM, and may be an operand of code there
+            self->ie = value;
+            Cpu_invalidate_code(&self->cpu, addr);
+            GameBoy_end_jit_run(self);
         }
-        // clang-format on
-    } else if (addr == 0xFF4F) {
-        // FF4F
-        BAIL("I/O VRAM bank select write ($%04X, $%02X)", addr, value);
-    } else if (addr == 0xFF50) {
-        // FF50 (boot ROM disable)
-        if (value != 0)
-            self->boot_rom_enable = false;
-    } else if (addr >= 0xFF51 && addr <= 0xFF55) {
-        // FF51-FF55 (VRAM DMA, CGB-only)
-    } else if (addr >= 0xFF68 && addr <= 0xFF6B) {
-        // FF68-FF6B (LCD color palettes, CGB-only)
-    } else if (addr == 0xFF70) {
-        // FF70 (WRAM bank select, CGB-only)
-    } else if (addr == 0xFF7F) {
-        // Tetris tries to write here. Probably a no-op.
-    } else {
-        BAIL("Unexpected I/O write (addr = $%04X, value = $%02X)", addr, value);
+        break;
+
+    case PageKind_Blocked: // 0000-FEFF (while OAM DMA is running)
+        break;
+
+    default:
+        BAIL("Unexpected write to unmapped page (addr = $%04X, $%02X)", addr,
+             value);
     }
 }
 
 void GameBoy_write_mem(void *const ctx, const u16 addr, const u8 value)
 {
     GameBoy *const self = ctx;
+    const GameBoyPage *const page = &self->pages[addr >> 8];
 
     log_trace("write mem (addr = $%04X, value = $%02X)", addr, value);
 
-    if (addr <= 0x7FFF) {
-        // 0000-7FFF (ROM bank)
-        log_debug("TODO: GameBoy_write_mem ROM (addr = $%04X, $%02X)", addr,
-                  value);
-    } else if (addr <= 0x9FFF) {
-        // 8000-9FFF (VRAM)
-        self->vram[addr - 0x8000] = value;
-    } else if (addr <= 0xBFFF) {
-        // A000-BFFF (External RAM)
-        BAIL("TODO: GameBoy_write_mem ERAM (addr = $%04X, $%02X)", addr, value);
-    } else if (addr <= 0xDFFF) {
-        // C000-DFFF (WRAM)
-        self->ram[addr - 0xC000] = value;
-    } else if (addr <= 0xFDFF) {
-        // E000-FDFF (Echo RAM, mirror of C000-DDFF)
-        self->ram[addr - 0xE000] = value;
-    } else if (addr <= 0xFE9F) {
-        // FE00-FE9F (OAM)
-        // TODO: should only be writable during HBlank or VBlank
-        self->oam[addr - 0xFE00] = value;
-    } else if (addr <= 0xFEFF) {
-        // FEA0-FEFF (Not usable)
-        log_debug("Tried to write into unusable memory (addr = $%04X, $%02X)",
-                  addr, value);
-    } else if (addr <= 0xFF7F) {
-        // FF00-FF7F I/O registers
-        GameBoy_write_io(self, addr, value);
-    } else if (addr <= 0xFFFE) {
-        // FF80-FFFE (High RAM)
-        self->hram[addr - 0xFF80] = value;
-    } else {
-        // FFFF (Interrupt Enable Register)
-        self->ie = value;
+    if (page->write == nullptr) {
+        GameBoy_write_page(self, page->kind, addr, value);
+        return;
+    }
+
+    u8 *const dst = &page->write[addr & 0xFF];
+
+    // Rewriting VRAM with what it already holds leaves the LCD as it is
+    if (page->kind == PageKind_Vram && *dst == value)
+        return;
+
+    *dst = value;
+
+    // Of the directly writable memory, code only ever runs from WRAM
+    if (page->kind == PageKind_Wram) {
+        Cpu_invalidate_code(&self->cpu, addr);
+    } else if (page->kind == PageKind_Vram) {
+        TileCache_invalidate(self->tiles, addr - 0x8000);
+        Ppu_invalidate_vram(self, addr - 0x8000, addr - 0x8000);
+    } else if (page->kind == PageKind_ExtRam && self->save != nullptr) {
+        SaveRam_mark_dirty(self->save, dst - self->ext_ram);
     }
 }
 
+const u8 *GameBoy_get_span(const void *const ctx, const u16 addr,
+                           size_t *const len)
+{
+    const GameBoy *const self = ctx;
+    const size_t first_page = addr >> 8;
+    const GameBoyPage *const page = &self->pages[first_page];
+
+    if (page->read == nullptr)
+        return nullptr;
+
+    size_t span_len = 0x100 - (addr & 0xFF);
+
+    for (size_t i = first_page + 1; i < 0x100; ++i) {
+        if (self->pages[i].read != self->pages[i - 1].read + 0x100)
+            break;
+
+        span_len += 0x100;
+    }
+
+    *len = span_len;
+    return &page->read[addr & 0xFF];
+}
+
+void GameBoy_read_block(const void *const ctx, const u16 addr, u8 *const dst,
+                        const size_t len)
+{
+    const GameBoy *const self = ctx;
+    size_t done = 0;
+
+    while (done < len) {
+        const u16 chunk_addr = (u16)(addr + done);
+        const GameBoyPage *const page = &self->pages[chunk_addr >> 8];
+
+        size_t chunk_len = 0x100 - (chunk_addr & 0xFF);
+        if (chunk_len > len - done)
+            chunk_len = len - done;
+
+        if (page->read != nullptr) {
+            memcpy(&dst[done], &page->read[chunk_addr & 0xFF], chunk_len);
+        } else {
+            for (size_t i = 0; i < chunk_len; ++i)
+                dst[done + i] =
+                    GameBoy_read_page(self, page->kind, chunk_addr + i);
+        }
+
+        done += chunk_len;
+    }
+}
+
+void GameBoy_write_block(void *const ctx, const u16 addr, const u8 *const src,
+                         const size_t len)
+{
+    GameBoy *const self = ctx;
+    size_t done = 0;
+
+    while (done < len) {
+        const u16 chunk_addr = (u16)(addr + done);
+        const GameBoyPage *const page = &self->pages[chunk_addr >> 8];
+
+        size_t chunk_len = 0x100 - (chunk_addr & 0xFF);
+        if (chunk_len > len - done)
+            chunk_len = len - done;
+
+        if (page->write == nullptr) {
+            // Any of these may remap pages, which is why they are looked up
+            // one at a time
+            for (size_t i = 0; i < chunk_len; ++i)
+                GameBoy_write_page(self, page->kind, chunk_addr + i,
+                                   src[done + i]);
+        } else {
+            u8 *const dst = &page->write[chunk_addr & 0xFF];
+            const u16 chunk_end = chunk_addr + (chunk_len - 1);
+            const bool unchanged = page->kind == PageKind_Vram &&
+                                   memcmp(dst, &src[done], chunk_len) == 0;
+
+            memcpy(dst, &src[done], chunk_len);
+
+            // Same as GameBoy_write_mem, for the whole chunk at once
+            if (page->kind == PageKind_Wram) {
+                Cpu_invalidate_code_range(&self->cpu, chunk_addr, chunk_end);
+            } else if (page->kind == PageKind_Vram && !unchanged) {
+                // Tiles are 16 bytes long, so this touches every one of them
+                for (size_t i = 0; i < chunk_len; i += 16)
+                    TileCache_invalidate(self->tiles, chunk_addr + i - 0x8000);
+
+                TileCache_invalidate(self->tiles, chunk_end - 0x8000);
+                Ppu_invalidate_vram(self, chunk_addr - 0x8000,
+                                    chunk_end - 0x8000);
+            } else if (page->kind == PageKind_ExtRam && self->save != nullptr) {
+                SaveRam_mark_dirty(self->save, dst - self->ext_ram);
+                SaveRam_mark_dirty(self->save,
+                                   dst + (chunk_len - 1) - self->ext_ram);
+            }
+        }
+
+        done += chunk_len;
+    }
+}
+
+Memory GameBoy_memory(GameBoy *const self)
+{
+    return (Memory){
+        .ctx = self,
+        .read = GameBoy_read_mem,
+        .write = GameBoy_write_mem,
+        .get_span = GameBoy_get_span,
+        .read_block = GameBoy_read_block,
+        .write_block = GameBoy_write_block,
+    };
+}
+
+bool GameBoy_step_dma(GameBoy *const self, const int cycles)
+{
+    if (self->dma_cycles_left == 0)
+        return false;
+
+    const u8 steps =
+        cycles < self->dma_cycles_left ? (u8)cycles : self->dma_cycles_left;
+
+    if (self->tier == CpuTier_Accurate) {
+        const u8 start = GB_OAM_DMA_CYCLES - self->dma_cycles_left;
+
+        for (u8 i = start; i < start + steps; ++i)
+            GameBoy_write_oam(self, i, GameBoy_read_dma_source(self, i));
+    }
+
+    self->dma_cycles_left -= steps;
+
+    if (self->dma_cycles_left != 0)
+        return false;
+
+    GameBoy_map_pages(self);
+    return true;
+}
+
 void GameBoy_service_interrupts(GameBoy *const self, Memory *const mem)
 {
     const u8 int_mask = self->if_ & self->ie;
@@ -448,7 +1239,15 @@ void GameBoy_service_interrupts(GameBoy *const self, Memory *const mem)
         if (int_mask & (1 << i)) {
             log_debug("Servicing interrupt #%zu", i);
             self->if_ &= ~(1 << i);
-            Cpu_interrupt(&self->cpu, mem, 0x40 | (i << 3));
+
+            const u8 handler_location = 0x40 | (i << 3);
+
+            // The Game Boy only runs in the fast tier while being debugged
+            if (self->tier == CpuTier_Accurate && !self->debugging)
+                Cpu_interrupt_accurate(&self->cpu, mem, handler_location);
+            else
+                Cpu_interrupt(&self->cpu, mem, handler_location);
+
             break;
         }
     }
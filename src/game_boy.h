@@ -1,7 +1,13 @@
 #ifndef GEMU_GAME_BOY_H
 #define GEMU_GAME_BOY_H
 
+#include "cheats.h"
 #include "cpu.h"
+#include "idle_loop.h"
+#include "mapper.h"
+#include "rom_image.h"
+#include "save_ram.h"
+#include "tile_cache.h"
 #include <stddef.h>
 
 constexpr int GB_LCD_WIDTH = 160;
@@ -12,6 +18,7 @@ constexpr int GB_LCD_MAX_LY = 154;
 constexpr int GB_CPU_FREQUENCY_HZ = 4194304 / 4;
 constexpr double GB_VBLANK_FREQ = 59.7;
 constexpr size_t GB_BOOT_ROM_LEN = 0x100;
+constexpr u8 GB_OAM_DMA_CYCLES = 0xA0;
 
 typedef enum : u8 {
     LcdControl_Enable = 1 << 7,
@@ -68,18 +75,84 @@ typedef struct {
     bool select;
 } JoypadState;
 
+/**
+ * \brief What backs a page of the GameBoy's address space.
+ */
+typedef enum : u8 {
+    PageKind_Rom,
+    PageKind_Vram,
+    PageKind_ExtRam,
+    PageKind_Wram,
+    PageKind_EchoRam,
+    PageKind_Oam,
+    PageKind_High,
+    /** Out of reach of the CPU while OAM DMA is running */
+    PageKind_Blocked,
+} PageKind;
+
+/**
+ * \brief A 256-byte page of the GameBoy's address space.
+ *
+ * Pages that are plain memory point straight at it, so that accessing them is
+ * a single load or store. Pages that are not, either because accessing them has
+ * side effects or because they mix several kinds of memory, leave the pointer
+ * as NULL and are handled according to their kind instead.
+ */
+typedef struct {
+    const u8 *read;
+    u8 *write;
+    PageKind kind;
+} GameBoyPage;
+
+/**
+ * \brief What a line of the framebuffer was last drawn from.
+ *
+ * A line is only drawn again once the registers it was drawn with differ, or
+ * a write to VRAM or OAM changes any of the tile map rows, tiles or objects it
+ * read.
+ */
+typedef struct {
+    /** Whether the line is drawn, and nothing it read has changed since */
+    bool drawn;
+    /** LCDC, SCY, SCX, WY, WX, BGP, OBP0, OBP1 and the window line counter */
+    u8 regs[9];
+    /** Tile map rows read, a bit for each row of the maps at $9800 and $9C00 */
+    u64 map_rows;
+    /** Tiles read, a bit for each */
+    u64 tiles[TILE_CACHE_TILES / 64];
+    /** Objects drawn, a bit for each slot of OAM */
+    u64 objects;
+} PpuLine;
+
 typedef struct {
     JoypadState joypad;
     Cpu cpu;
+    CpuTier tier;
     bool boot_rom_exists;
     bool boot_rom_enable;
-    u8 ram[0x2000];
-    u8 vram[0x2000];
-    u8 hram[0x7F];
-    u8 oam[0xA0];
-    u8 boot_rom[GB_BOOT_ROM_LEN];
-    u8 *rom;
+    bool debugging;
+    Jit *paused_jit;
+    DecodeCache *paused_decode_cache;
+    const AotModule *aot_module;
+    IdleLoopDetector *idle_loops;
+    u8 *ram;
+    u8 *vram;
+    u8 *hram;
+    u8 *oam;
+    u8 *boot_rom;
+    /** The LCD, as GB_LCD_WIDTH * GB_LCD_HEIGHT shades from 0 to 3 */
+    u8 *framebuffer;
+    TileCache *tiles;
+    RomImage *rom_image;
+    const u8 *rom;
     size_t rom_len;
+    size_t rom_bank_lo;
+    size_t rom_bank_hi;
+    Mapper mapper;
+    u8 *ext_ram;
+    size_t ext_ram_len;
+    SaveRam *save;
+    Cheats *cheats;
     u8 lcdc;
     u8 stat;
     u8 ly;
@@ -91,6 +164,14 @@ typedef struct {
     u8 bgp;
     u8 obp0;
     u8 obp1;
+    /** Shade of each color index in BGP, OBP0 and OBP1 */
+    u8 bg_shades[4];
+    u8 obj_shades[2][4];
+    u8 lines_drawn;
+    u8 window_line;
+    PpuLine lines[GB_LCD_HEIGHT];
+    /** Whether framebuffer has changed since the frontend last showed it */
+    bool framebuffer_dirty;
     u8 ie;
     u8 if_;
     u8 sb;
@@ -100,6 +181,12 @@ typedef struct {
     u8 tma;
     u8 tac;
     u8 joyp;
+    u8 dma;
+    u8 dma_cycles_left;
+    GameBoyPage dma_source;
+    GameBoyPage pages[0x100];
+    /** Code page mapped into each page, as told to the Cpu's code caches */
+    size_t code_pages[0x100];
 } GameBoy;
 
 /**
@@ -128,6 +215,51 @@ typedef struct {
  */
 void GameBoy_destroy(GameBoy *self);
 
+/**
+ * \brief Makes a GameBoy run hot code through the x86-64 JIT from now on.
+ *
+ * Code that has not been compiled yet keeps running on the interpreter.
+ *
+ * \param self the GameBoy to enable the JIT on.
+ *
+ * \return whether the JIT could be enabled, which requires an x86-64 host.
+ */
+[[nodiscard]] bool GameBoy_enable_jit(GameBoy *self);
+
+/**
+ * \brief Makes a GameBoy run a single instruction per Cpu_tick, for as long as
+ * it is being debugged.
+ *
+ * The JIT and code translated ahead of time both run whole blocks at once, so
+ * they are set aside while debugging. So is the decode cache, which reads code
+ * ahead of time and would trip read watchpoints before the CPU gets there.
+ * The JIT and the decode cache start over once debugging ends, since code may
+ * have been changed behind their backs.
+ *
+ * \param self the GameBoy.
+ * \param debugging whether the GameBoy is being debugged.
+ */
+void GameBoy_set_debugging(GameBoy *self, bool debugging);
+
+/**
+ * \brief Makes a GameBoy run the currently loaded ROM through code translated
+ * ahead of time by gemu-aot.
+ *
+ * The module only takes over once the boot ROM has been unmapped, and is
+ * dropped as soon as another ROM is loaded. module must outlive its use by the
+ * GameBoy.
+ *
+ * \param self the GameBoy to set the module on. Must have a ROM loaded.
+ * \param module the module to run.
+ *
+ * \return whether module was generated from the loaded ROM by a compatible
+ * version of gemu-aot.
+ *
+ * \sa AotModule_matches
+ */
+[[nodiscard]] bool GameBoy_set_aot_module(GameBoy *self,
+                                          const AotModule *module);
+
 /**
  * \brief Logs information about the currently loaded ROM.
  *
@@ -140,20 +272,123 @@ void GameBoy_destroy(GameBoy *self);
 void GameBoy_log_cartridge_info(const GameBoy *self);
 
 /**
- * \brief Loads ROM data into a GameBoy.
+ * \brief Loads a ROM into a GameBoy.
  *
- * This method copies rom, so it does not take ownership of it.
+ * The GameBoy takes its own reference to rom, which it releases once another
+ * ROM is loaded or it is destroyed. The ROM data itself is never copied, so
+ * any number of GameBoys may share the same RomImage.
  *
  * \param self the GameBoy to load the ROM to.
- * \param rom the ROM data to load.
- * \param rom_len the length of rom.
+ * \param rom the ROM to load.
+ *
+ * \sa RomImage_open
  */
-void GameBoy_load_rom(GameBoy *self, const u8 *rom, size_t rom_len);
+void GameBoy_load_rom(GameBoy *self, RomImage *rom);
+
+/**
+ * \brief Backs the external RAM of a GameBoy with a save file.
+ *
+ * The save file is loaded into external RAM, and every write to external RAM
+ * from then on is persisted to it in the background. It is closed once
+ * another ROM is loaded or the GameBoy is destroyed.
+ *
+ * If the loaded cartridge has no battery-backed RAM, this will be a no-op.
+ *
+ * \param self the GameBoy. Must have a ROM loaded.
+ * \param path the path to the save file, which is created if it does not
+ * exist yet.
+ * \param flush_interval_ms how often writes are flushed to disk, or 0 to only
+ * flush them once the save file is closed.
+ *
+ * \return whether the save file could be opened.
+ *
+ * \sa SaveRam_open
+ */
+[[nodiscard]] bool GameBoy_load_save(GameBoy *self, const char *path,
+                                     u32 flush_interval_ms);
+
+/**
+ * \brief Adds a cheat to the currently loaded ROM.
+ *
+ * ROM patches take effect right away, by mapping patched copies of the pages
+ * they cover. RAM freezes take effect on the next call to
+ * GameBoy_apply_freezes. Cheats are dropped once another ROM is loaded.
+ *
+ * Patching ROM stops code translated ahead of time from running, since it was
+ * translated from the unpatched ROM.
+ *
+ * \param self the GameBoy. Must have a ROM loaded.
+ * \param cheat the cheat to add, as parsed by Cheat_parse.
+ *
+ * \sa Cheat_parse
+ */
+void GameBoy_add_cheat(GameBoy *self, const Cheat *cheat);
+
+/**
+ * \brief Writes the values of every RAM freeze back into RAM.
+ *
+ * Meant to be called once per frame, like a GameShark does on VBlank. RAM
+ * that is not mapped at the time, like disabled external RAM, is left alone.
+ *
+ * \param self the GameBoy.
+ */
+void GameBoy_apply_freezes(GameBoy *self);
+
+/**
+ * \brief Advances a running OAM DMA transfer by some cycles.
+ *
+ * A transfer takes GB_OAM_DMA_CYCLES cycles, one per byte, during which the
+ * CPU can only reach HRAM and the I/O registers. In the accurate tier, the
+ * bytes are copied into OAM as the transfer goes. Otherwise, they are all
+ * copied as soon as it starts.
+ *
+ * \param self the GameBoy.
+ * \param cycles the number of cycles that have passed.
+ *
+ * \return whether a transfer ended, giving the CPU the whole bus back.
+ */
+bool GameBoy_step_dma(GameBoy *self, int cycles);
 
 [[nodiscard]] u8 GameBoy_read_mem(const void *ctx, u16 addr);
 
 void GameBoy_write_mem(void *ctx, u16 addr, u8 value);
 
+/**
+ * \brief Gets the span of plain memory a GameBoy has mapped at an address.
+ *
+ * The span runs across as many pages as are mapped back to back, like
+ * consecutive ROM banks or the whole of WRAM.
+ *
+ * \sa Memory_get_span
+ */
+[[nodiscard]] const u8 *GameBoy_get_span(const void *ctx, u16 addr,
+                                         size_t *len);
+
+/**
+ * \brief Reads a block of memory of a GameBoy, copying straight from plain
+ * memory and reading the rest a byte at a time.
+ *
+ * \sa Memory_read_block
+ */
+void GameBoy_read_block(const void *ctx, u16 addr, u8 *dst, size_t len);
+
+/**
+ * \brief Writes a block of memory of a GameBoy, copying straight into plain
+ * memory and writing the rest a byte at a time.
+ *
+ * \sa Memory_write_block
+ */
+void GameBoy_write_block(void *ctx, u16 addr, const u8 *src, size_t len);
+
+/**
+ * \brief Gets the address space of a GameBoy, as seen from its Cpu.
+ *
+ * \param self the GameBoy.
+ *
+ * \return a Memory that stays valid for as long as self does.
+ */
+[[nodiscard]] Memory GameBoy_memory(GameBoy *self);
+
 void GameBoy_service_interrupts(GameBoy *self, Memory *mem);
 
 #endif
@@ -0,0 +1,666 @@
+// Sockets are only declared for POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include "gdb_stub.h"
+#include "cpu.h"
+#include "game_boy.h"
+#include "log.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GDB_STUB_SOCKETS 1
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#else
+#define GDB_STUB_SOCKETS 0
+#endif
+
+#if GDB_STUB_SOCKETS
+#ifdef MSG_NOSIGNAL
+// GDB going away must not kill the process
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+#endif
+
+/**
+ * Number of registers exposed to GDB
+ */
+static constexpr size_t REGISTER_COUNT = 6;
+
+static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+extern inline bool GdbStub_bitmap_test(const u64 *bitmap, u16 addr);
+
+static void bitmap_set(u64 *const bitmap, const u16 addr, const bool value)
+{
+    const u64 mask = (u64)1 << (addr & 63);
+
+    if (value)
+        bitmap[addr >> 6] |= mask;
+    else
+        bitmap[addr >> 6] &= ~mask;
+}
+
+static int hex_digit(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+/**
+ * \brief Parses a hex number of at most max_digits digits, advancing cursor
+ * past it.
+ *
+ * \return whether there was at least one digit.
+ */
+static bool parse_hex(const char **const cursor, const size_t max_digits,
+                      u32 *const value)
+{
+    size_t len = 0;
+    *value = 0;
+
+    while (len < max_digits && hex_digit((*cursor)[len]) >= 0) {
+        *value = (*value << 4) | (u32)hex_digit((*cursor)[len]);
+        ++len;
+    }
+
+    *cursor += len;
+    return len != 0;
+}
+
+static void write_hex_u8(char *const dst, const u8 value)
+{
+    dst[0] = HEX_DIGITS[value >> 4];
+    dst[1] = HEX_DIGITS[value & 0xF];
+}
+
+static u16 read_register(const Cpu *const cpu, const size_t index)
+{
+    switch (index) {
+    case 0:
+        return Cpu_read_rp2(cpu, CpuTableRp2_AF);
+    case 1:
+        return Cpu_read_rp(cpu, CpuTableRp_BC);
+    case 2:
+        return Cpu_read_rp(cpu, CpuTableRp_DE);
+    case 3:
+        return Cpu_read_rp(cpu, CpuTableRp_HL);
+    case 4:
+        return cpu->sp;
+    default:
+        return cpu->pc;
+    }
+}
+
+static void write_register(Cpu *const cpu, const size_t index,
+                           const u16 value)
+{
+    switch (index) {
+    case 0:
+        Cpu_write_rp2(cpu, CpuTableRp2_AF, value);
+        break;
+    case 1:
+        Cpu_write_rp(cpu, CpuTableRp_BC, value);
+        break;
+    case 2:
+        Cpu_write_rp(cpu, CpuTableRp_DE, value);
+        break;
+    case 3:
+        Cpu_write_rp(cpu, CpuTableRp_HL, value);
+        break;
+    case 4:
+        cpu->sp = value;
+        break;
+    default:
+        cpu->pc = value;
+        break;
+    }
+}
+
+/**
+ * \brief Parses a register value, which GDB sends in target byte order.
+ */
+static bool parse_register(const char **const cursor, u16 *const value)
+{
+    u32 lo;
+    u32 hi;
+
+    if (!parse_hex(cursor, 2, &lo) || !parse_hex(cursor, 2, &hi))
+        return false;
+
+    *value = (u16)((hi << 8) | lo);
+    return true;
+}
+
+static u8 peek(const GameBoy *const gb, const u16 addr)
+{
+    // The only memory that cannot be read at all
+    if (addr >= 0xFEA0 && addr <= 0xFEFF)
+        return 0xFF;
+
+    return GameBoy_read_mem(gb, addr);
+}
+
+GdbStub *GdbStub_new()
+{
+    GdbStub *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate GDB stub");
+
+    *self = (GdbStub){
+        .listen_fd = -1,
+        .client_fd = -1,
+        .armed = false,
+        .halted = false,
+        .stepping = false,
+        .skip_break = false,
+        .watch_hit = GdbWatch_None,
+        .watch_addr = 0,
+        .input_len = 0,
+    };
+
+    return self;
+}
+
+static void GdbStub_send([[maybe_unused]] const GdbStub *const self,
+                         [[maybe_unused]] const char *const data)
+{
+#if GDB_STUB_SOCKETS
+    if (self->client_fd < 0)
+        return;
+
+    const size_t len = strlen(data);
+    u8 checksum = 0;
+
+    for (size_t i = 0; i < len; ++i)
+        checksum += (u8)data[i];
+
+    char trailer[3] = {'#'};
+    write_hex_u8(&trailer[1], checksum);
+
+    // Failures show up as the connection closing on the next poll
+    if (send(self->client_fd, "$", 1, SEND_FLAGS) < 0 ||
+        send(self->client_fd, data, len, SEND_FLAGS) < 0 ||
+        send(self->client_fd, trailer, sizeof(trailer), SEND_FLAGS) < 0)
+        log_debug("Could not send packet to GDB");
+#endif
+}
+
+/**
+ * \brief Halts the GameBoy, telling GDB why.
+ */
+static void GdbStub_stop(GdbStub *const self, const char *const reason)
+{
+    self->halted = true;
+    self->stepping = false;
+    GdbStub_send(self, reason);
+}
+
+/**
+ * \brief Disarms the stub, dropping every breakpoint and watchpoint.
+ */
+static void GdbStub_disarm(GdbStub *const self, GameBoy *const gb)
+{
+    self->armed = false;
+    self->halted = false;
+    self->stepping = false;
+    self->skip_break = false;
+    self->watch_hit = GdbWatch_None;
+
+    memset(self->breakpoints, 0, sizeof(self->breakpoints));
+    memset(self->read_watchpoints, 0, sizeof(self->read_watchpoints));
+    memset(self->write_watchpoints, 0, sizeof(self->write_watchpoints));
+
+    GameBoy_set_debugging(gb, false);
+}
+
+static void GdbStub_disconnect(GdbStub *const self, GameBoy *const gb)
+{
+#if GDB_STUB_SOCKETS
+    if (self->client_fd >= 0)
+        close(self->client_fd);
+#endif
+
+    self->client_fd = -1;
+    self->input_len = 0;
+    GdbStub_disarm(self, gb);
+
+    log_info("GDB disconnected");
+}
+
+void GdbStub_destroy(GdbStub *const self)
+{
+    if (self == nullptr)
+        return;
+
+#if GDB_STUB_SOCKETS
+    if (self->client_fd >= 0)
+        close(self->client_fd);
+
+    if (self->listen_fd >= 0)
+        close(self->listen_fd);
+#endif
+
+    free(self);
+}
+
+bool GdbStub_listen([[maybe_unused]] GdbStub *const self,
+                    [[maybe_unused]] const u16 port)
+{
+#if GDB_STUB_SOCKETS
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return false;
+
+    const int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Only ever reachable from the same machine
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr = {.s_addr = htonl(INADDR_LOOPBACK)},
+    };
+
+    if (bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 1) != 0) {
+        close(fd);
+        return false;
+    }
+
+    self->listen_fd = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void GdbStub_set_point(GdbStub *const self, const u32 type,
+                              const u16 addr, const u32 len, const bool value)
+{
+    for (u32 i = 0; i < (len != 0 ? len : 1); ++i) {
+        const u16 point_addr = (u16)(addr + i);
+
+        switch (type) {
+        case 0: // Software breakpoint
+        case 1: // Hardware breakpoint
+            bitmap_set(self->breakpoints, point_addr, value);
+            // Breakpoints only ever cover the first byte of an instruction
+            return;
+        case 2: // Write watchpoint
+            bitmap_set(self->write_watchpoints, point_addr, value);
+            break;
+        case 3: // Read watchpoint
+            bitmap_set(self->read_watchpoints, point_addr, value);
+            break;
+        default: // Access watchpoint
+            bitmap_set(self->write_watchpoints, point_addr, value);
+            bitmap_set(self->read_watchpoints, point_addr, value);
+            break;
+        }
+    }
+}
+
+static bool GdbStub_handle_query(const char *const packet, char *const reply)
+{
+    if (strncmp(packet, "qSupported", 10) == 0) {
+        snprintf(reply, GDB_STUB_PACKET_MAX + 1, "PacketSize=%zx",
+                 GDB_STUB_PACKET_MAX);
+    } else if (strcmp(packet, "qAttached") == 0) {
+        // Detaching leaves the GameBoy running, instead of killing it
+        strcpy(reply, "1");
+    }
+
+    return true;
+}
+
+bool GdbStub_handle_packet(GdbStub *const self, GameBoy *const gb,
+                           const char *const packet, char *const reply)
+{
+    Cpu *const cpu = &gb->cpu;
+    const char *cursor = &packet[1];
+    u32 addr;
+    u32 len;
+    u32 value;
+
+    reply[0] = '\0';
+
+    switch (packet[0]) {
+    case '?':
+        strcpy(reply, "S05");
+        return true;
+
+    case 'g':
+        for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+            const u16 reg = read_register(cpu, i);
+            write_hex_u8(&reply[i * 4], reg & 0xFF);
+            write_hex_u8(&reply[i * 4 + 2], reg >> 8);
+        }
+
+        reply[REGISTER_COUNT * 4] = '\0';
+        return true;
+
+    case 'G':
+        for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+            u16 reg;
+
+            if (!parse_register(&cursor, &reg)) {
+                strcpy(reply, "E01");
+                return true;
+            }
+
+            write_register(cpu, i, reg);
+        }
+
+        strcpy(reply, "OK");
+        return true;
+
+    case 'p':
+        if (!parse_hex(&cursor, 8, &value) || value >= REGISTER_COUNT) {
+            strcpy(reply, "E01");
+            return true;
+        }
+
+        write_hex_u8(&reply[0], read_register(cpu, value) & 0xFF);
+        write_hex_u8(&reply[2], read_register(cpu, value) >> 8);
+        reply[4] = '\0';
+        return true;
+
+    case 'P': {
+        u16 reg;
+
+        if (!parse_hex(&cursor, 8, &value) || value >= REGISTER_COUNT ||
+            *cursor++ != '=' || !parse_register(&cursor, &reg)) {
+            strcpy(reply, "E01");
+            return true;
+        }
+
+        write_register(cpu, value, reg);
+        strcpy(reply, "OK");
+        return true;
+    }
+
+    case 'm':
+        if (!parse_hex(&cursor, 8, &addr) || *cursor++ != ',' ||
+            !parse_hex(&cursor, 8, &len) || addr > 0xFFFF) {
+            strcpy(reply, "E01");
+            return true;
+        }
+
+        // Whatever does not fit is asked for again
+        if (len > GDB_STUB_PACKET_MAX / 2)
+            len = GDB_STUB_PACKET_MAX / 2;
+
+        for (u32 i = 0; i < len; ++i)
+            write_hex_u8(&reply[i * 2], peek(gb, (u16)(addr + i)));
+
+        reply[len * 2] = '\0';
+        return true;
+
+    case 'M':
+        if (!parse_hex(&cursor, 8, &addr) || *cursor++ != ',' ||
+            !parse_hex(&cursor, 8, &len) || *cursor++ != ':' ||
+            addr > 0xFFFF || strlen(cursor) / 2 < len) {
+            strcpy(reply, "E01");
+            return true;
+        }
+
+        for (u32 i = 0; i < len; ++i) {
+            u32 byte;
+            parse_hex(&cursor, 2, &byte);
+            GameBoy_write_mem(gb, (u16)(addr + i), (u8)byte);
+        }
+
+        strcpy(reply, "OK");
+        return true;
+
+    case 'c':
+    case 's':
+        if (parse_hex(&cursor, 8, &addr))
+            cpu->pc = (u16)addr;
+
+        self->halted = false;
+        self->stepping = packet[0] == 's';
+        self->skip_break = true;
+        return false;
+
+    case 'Z':
+    case 'z': {
+        u32 type;
+
+        if (!parse_hex(&cursor, 1, &type) || type > 4 || *cursor++ != ',' ||
+            !parse_hex(&cursor, 8, &addr) || *cursor++ != ',' ||
+            !parse_hex(&cursor, 8, &len) || addr > 0xFFFF) {
+            strcpy(reply, "E01");
+            return true;
+        }
+
+        GdbStub_set_point(self, type, (u16)addr, len, packet[0] == 'Z');
+        strcpy(reply, "OK");
+        return true;
+    }
+
+    case 'D':
+        strcpy(reply, "OK");
+        return true;
+
+    case 'k':
+        return false;
+
+    case 'H':
+        strcpy(reply, "OK");
+        return true;
+
+    case 'q':
+        return GdbStub_handle_query(packet, reply);
+
+    default:
+        // An empty reply tells GDB the packet is not supported
+        return true;
+    }
+}
+
+#if GDB_STUB_SOCKETS
+static void GdbStub_accept(GdbStub *const self, GameBoy *const gb)
+{
+    struct pollfd pfd = {.fd = self->listen_fd, .events = POLLIN};
+
+    if (poll(&pfd, 1, 0) <= 0)
+        return;
+
+    self->client_fd = accept(self->listen_fd, nullptr, nullptr);
+
+    if (self->client_fd < 0)
+        return;
+
+    log_info("GDB connected");
+
+    self->armed = true;
+    self->halted = true;
+    GameBoy_set_debugging(gb, true);
+}
+
+/**
+ * \brief Handles every complete packet in the input buffer, keeping whatever
+ * is left of an incomplete one.
+ */
+static void GdbStub_process_input(GdbStub *const self, GameBoy *const gb)
+{
+    static char reply[GDB_STUB_PACKET_MAX + 1];
+    size_t start = 0;
+
+    while (start < self->input_len) {
+        char *const input = &self->input[start];
+        const size_t input_len = self->input_len - start;
+
+        // Ctrl-C, sent out of band
+        if (input[0] == 0x03) {
+            if (!self->halted)
+                GdbStub_stop(self, "S02");
+
+            ++start;
+            continue;
+        }
+
+        // Acknowledgements, and anything else out of place
+        if (input[0] != '$') {
+            ++start;
+            continue;
+        }
+
+        char *const end = memchr(input, '#', input_len);
+
+        // The checksum is not verified, since TCP already is reliable
+        if (end == nullptr || (size_t)(end - input) + 3 > input_len)
+            break;
+
+        *end = '\0';
+        send(self->client_fd, "+", 1, SEND_FLAGS);
+
+        if (GdbStub_handle_packet(self, gb, &input[1], reply))
+            GdbStub_send(self, reply);
+
+        start += (size_t)(end - input) + 3;
+
+        if (input[1] == 'D' || input[1] == 'k') {
+            GdbStub_disconnect(self, gb);
+            return;
+        }
+    }
+
+    memmove(self->input, &self->input[start], self->input_len - start);
+    self->input_len -= start;
+
+    // A packet longer than advertised can never complete
+    if (self->input_len == sizeof(self->input))
+        self->input_len = 0;
+}
+#endif
+
+void GdbStub_poll([[maybe_unused]] GdbStub *const self,
+                  [[maybe_unused]] GameBoy *const gb)
+{
+#if GDB_STUB_SOCKETS
+    if (self->client_fd < 0)
+        GdbStub_accept(self, gb);
+
+    if (self->client_fd < 0)
+        return;
+
+    struct pollfd pfd = {.fd = self->client_fd, .events = POLLIN};
+
+    while (poll(&pfd, 1, 0) > 0) {
+        const ssize_t received =
+            recv(self->client_fd, &self->input[self->input_len],
+                 sizeof(self->input) - self->input_len, 0);
+
+        if (received <= 0) {
+            GdbStub_disconnect(self, gb);
+            return;
+        }
+
+        self->input_len += (size_t)received;
+        GdbStub_process_input(self, gb);
+
+        if (self->client_fd < 0)
+            return;
+    }
+#endif
+}
+
+bool GdbStub_check_break(GdbStub *const self, const u16 pc)
+{
+    if (self->skip_break) {
+        self->skip_break = false;
+        return false;
+    }
+
+    if (!GdbStub_bitmap_test(self->breakpoints, pc))
+        return false;
+
+    GdbStub_stop(self, "S05");
+    return true;
+}
+
+void GdbStub_instruction_done(GdbStub *const self)
+{
+    self->skip_break = false;
+
+    if (self->watch_hit != GdbWatch_None) {
+        // GDB matches access watchpoints by address alone
+        const char *const kind =
+            self->watch_hit == GdbWatch_Read ? "rwatch" : "watch";
+
+        char reason[32];
+        snprintf(reason, sizeof(reason), "T05%s:%04x;", kind, self->watch_addr);
+
+        self->watch_hit = GdbWatch_None;
+        GdbStub_stop(self, reason);
+    } else if (self->stepping) {
+        GdbStub_stop(self, "S05");
+    }
+}
+
+/**
+ * \brief Records a watchpoint being hit, unless another one already was
+ * during the same instruction.
+ */
+static void GdbStub_watch(GdbStub *const self, const u16 addr,
+                          const GdbWatch kind)
+{
+    if (self->watch_hit != GdbWatch_None)
+        return;
+
+    self->watch_hit = kind;
+    self->watch_addr = addr;
+}
+
+static u8 GdbStub_read(const void *const ctx, const u16 addr)
+{
+    // Reads are only const from the point of view of the memory being read
+    GdbStub *const self = (GdbStub *)ctx;
+
+    if (GdbStub_bitmap_test(self->read_watchpoints, addr))
+        GdbStub_watch(self, addr, GdbWatch_Read);
+
+    return self->inner.read(self->inner.ctx, addr);
+}
+
+static void GdbStub_write(void *const ctx, const u16 addr, const u8 value)
+{
+    GdbStub *const self = ctx;
+
+    if (GdbStub_bitmap_test(self->write_watchpoints, addr))
+        GdbStub_watch(self, addr, GdbWatch_Write);
+
+    self->inner.write(self->inner.ctx, addr, value);
+}
+
+Memory GdbStub_memory(GdbStub *const self, const Memory *const mem)
+{
+    self->inner = *mem;
+
+    return (Memory){
+        .ctx = self,
+        .read = GdbStub_read,
+        .write = GdbStub_write,
+    };
+}
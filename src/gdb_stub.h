@@ -0,0 +1,153 @@
+#ifndef GEMU_GDB_STUB_H
+#define GEMU_GDB_STUB_H
+
+#include "cpu.h"
+#include "game_boy.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Maximum length of a packet exchanged with GDB, not counting its framing
+ */
+constexpr size_t GDB_STUB_PACKET_MAX = 0x1000;
+
+/**
+ * Number of u64 words in a bitmap with a bit for every address
+ */
+constexpr size_t GDB_STUB_BITMAP_LEN = 0x10000 / 64;
+
+typedef enum : u8 {
+    GdbWatch_None,
+    GdbWatch_Write,
+    GdbWatch_Read,
+} GdbWatch;
+
+/**
+ * A GDB remote serial protocol server, debugging the GameBoy of the frontend
+ * over a local TCP socket.
+ *
+ * Registers are exposed in the order of GDB's z80 target (af, bc, de, hl, sp
+ * and pc, all 16 bits wide), which works with gdb-multiarch.
+ *
+ * Breakpoints and watchpoints are kept as bitmaps with a bit for every
+ * address. They are only ever checked while armed is set, which only happens
+ * while GDB is connected. Until then, the frontend runs the GameBoy as usual,
+ * and only polls the socket once per frame.
+ */
+typedef struct {
+    int listen_fd;
+    int client_fd;
+    bool armed;
+    bool halted;
+    bool stepping;
+    bool skip_break;
+    u64 breakpoints[GDB_STUB_BITMAP_LEN];
+    u64 read_watchpoints[GDB_STUB_BITMAP_LEN];
+    u64 write_watchpoints[GDB_STUB_BITMAP_LEN];
+    GdbWatch watch_hit;
+    u16 watch_addr;
+    char input[GDB_STUB_PACKET_MAX + 4];
+    size_t input_len;
+    Memory inner;
+} GdbStub;
+
+/**
+ * \brief Allocates a GdbStub that is not listening on any socket.
+ *
+ * The created GdbStub must eventually be freed with GdbStub_destroy.
+ *
+ * \return the allocated GdbStub.
+ *
+ * \sa GdbStub_listen, GdbStub_destroy
+ */
+[[nodiscard]] GdbStub *GdbStub_new();
+
+/**
+ * \brief Frees a previously-allocated GdbStub, closing its sockets.
+ *
+ * \param self the GdbStub to free. May be NULL.
+ *
+ * \sa GdbStub_new
+ */
+void GdbStub_destroy(GdbStub *self);
+
+/**
+ * \brief Starts listening for GDB on a TCP port of the loopback interface.
+ *
+ * \param self the GdbStub.
+ * \param port the port to listen on.
+ *
+ * \return whether the socket could be opened, which requires a POSIX host.
+ */
+[[nodiscard]] bool GdbStub_listen(GdbStub *self, u16 port);
+
+/**
+ * \brief Accepts GDB if it is trying to connect, and handles every packet it
+ * has sent since the last poll, without waiting for anything.
+ *
+ * GDB connecting arms the stub and halts the GameBoy, and GDB leaving disarms
+ * it, removing every breakpoint and watchpoint.
+ *
+ * \param self the GdbStub.
+ * \param gb the GameBoy being debugged.
+ */
+void GdbStub_poll(GdbStub *self, GameBoy *gb);
+
+/**
+ * \brief Handles a single packet from GDB.
+ *
+ * \param self the GdbStub.
+ * \param gb the GameBoy being debugged.
+ * \param packet the contents of the packet, without its framing.
+ * \param reply where to write the reply, at least GDB_STUB_PACKET_MAX + 1
+ * bytes long.
+ *
+ * \return whether there is a reply to send right away, which is not the case
+ * when resuming the GameBoy.
+ */
+[[nodiscard]] bool GdbStub_handle_packet(GdbStub *self, GameBoy *gb,
+                                         const char *packet, char *reply);
+
+/**
+ * \brief Checks whether the Cpu must stop before running the instruction at
+ * an address, and halts if so.
+ *
+ * Resuming from a breakpoint runs the instruction it is on before the check
+ * applies again.
+ *
+ * \param self the GdbStub.
+ * \param pc the address of the next instruction.
+ *
+ * \return whether the Cpu must stop.
+ */
+[[nodiscard]] bool GdbStub_check_break(GdbStub *self, u16 pc);
+
+/**
+ * \brief Lets the stub know that the Cpu has run an instruction, halting if
+ * it was single-stepping or hit a watchpoint.
+ *
+ * \param self the GdbStub.
+ */
+void GdbStub_instruction_done(GdbStub *self);
+
+/**
+ * \brief Wraps memory so that the accesses made through it are checked
+ * against watchpoints.
+ *
+ * \param self the GdbStub.
+ * \param mem the memory to wrap. Its contents are copied.
+ *
+ * \return the wrapped memory, which is only valid for as long as self is.
+ */
+[[nodiscard]] Memory GdbStub_memory(GdbStub *self, const Memory *mem);
+
+/**
+ * \brief Checks whether the bit for an address is set in a bitmap.
+ */
+[[nodiscard]] inline bool GdbStub_bitmap_test(const u64 *const bitmap,
+                                              const u16 addr)
+{
+    return (bitmap[addr >> 6] >> (addr & 63)) & 1;
+}
+
+#endif
@@ -0,0 +1,527 @@
+#include "idiom.h"
+#include "cpu.h"
+#include "log.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum : u8 {
+    IdiomEntry_Unknown,
+    IdiomEntry_None,
+    IdiomEntry_Found,
+} IdiomEntry;
+
+/**
+ * \brief Gets what is known about the idioms in a code page, allocating it if
+ * the code page has never been mapped before.
+ */
+static IdiomCachePage *IdiomCache_code_page(IdiomCache *const self,
+                                            const size_t id)
+{
+    if (id >= self->code_pages_len) {
+        const size_t len = id + 1 > self->code_pages_len * 2
+                               ? id + 1
+                               : self->code_pages_len * 2;
+
+        self->code_pages =
+            realloc(self->code_pages, len * sizeof(self->code_pages[0]));
+        BAIL_IF_NULL(self->code_pages, "Could not allocate code pages");
+
+        for (size_t i = self->code_pages_len; i < len; ++i)
+            self->code_pages[i] = nullptr;
+
+        self->code_pages_len = len;
+    }
+
+    if (self->code_pages[id] == nullptr) {
+        // Zeroed entries are all IdiomEntry_Unknown
+        self->code_pages[id] = calloc(1, sizeof(*self->code_pages[id]));
+        BAIL_IF_NULL(self->code_pages[id], "Could not allocate code page");
+    }
+
+    return self->code_pages[id];
+}
+
+IdiomCache *IdiomCache_new()
+{
+    IdiomCache *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate idiom cache");
+
+    self->code_pages = nullptr;
+    self->code_pages_len = 0;
+    self->readable_len = 0;
+    self->writable_len = 0;
+
+    IdiomCache_map(self, 0x00, 0xFF, 0x00);
+
+    return self;
+}
+
+void IdiomCache_destroy(IdiomCache *const self)
+{
+    if (self == nullptr)
+        return;
+
+    for (size_t i = 0; i < self->code_pages_len; ++i)
+        free(self->code_pages[i]);
+
+    free(self->code_pages);
+    free(self);
+}
+
+void IdiomCache_set_readable(IdiomCache *const self, const u16 start,
+                             const u16 end)
+{
+    BAIL_IF(self->readable_len == IDIOM_MAX_RANGES,
+            "Too many readable idiom ranges");
+
+    self->readable[self->readable_len++] = (IdiomRange){
+        .start = start,
+        .end = end,
+    };
+}
+
+void IdiomCache_set_writable(IdiomCache *const self, const u16 start,
+                             const u16 end)
+{
+    BAIL_IF(self->writable_len == IDIOM_MAX_RANGES,
+            "Too many writable idiom ranges");
+
+    self->writable[self->writable_len++] = (IdiomRange){
+        .start = start,
+        .end = end,
+    };
+}
+
+static void IdiomCache_invalidate_page(IdiomCache *const self,
+                                       const size_t page)
+{
+    IdiomCachePage *const code_page = self->pages[page];
+
+    if (!code_page->has_entries)
+        return;
+
+    memset(code_page->entries, IdiomEntry_Unknown, sizeof(code_page->entries));
+    code_page->has_entries = false;
+}
+
+void IdiomCache_map(IdiomCache *const self, const u8 first_page,
+                    const u8 last_page, const size_t first_id)
+{
+    for (size_t page = first_page; page <= last_page; ++page)
+        self->pages[page] =
+            IdiomCache_code_page(self, first_id + (page - first_page));
+
+    // Idioms starting on the page right before may run into the new pages
+    if (first_page != 0x00)
+        IdiomCache_invalidate_page(self, first_page - 1);
+}
+
+void IdiomCache_flush(IdiomCache *const self)
+{
+    for (size_t i = 0; i < self->code_pages_len; ++i) {
+        IdiomCachePage *const code_page = self->code_pages[i];
+
+        if (code_page != nullptr && code_page->has_entries) {
+            memset(code_page->entries, IdiomEntry_Unknown,
+                   sizeof(code_page->entries));
+            code_page->has_entries = false;
+        }
+    }
+}
+
+void IdiomCache_invalidate(IdiomCache *const self, const u16 addr)
+{
+    // An idiom containing addr may start up to IDIOM_MAX_LEN - 1 bytes before
+    // it, which may be on the previous page
+    IdiomCache_invalidate_page(self, addr >> 8);
+    IdiomCache_invalidate_page(self, (u16)(addr - (IDIOM_MAX_LEN - 1)) >> 8);
+}
+
+void IdiomCache_invalidate_range(IdiomCache *const self, const u16 start,
+                                 const u16 end)
+{
+    for (size_t page = start >> 8; page <= (size_t)(end >> 8); ++page)
+        IdiomCache_invalidate(self, page << 8);
+
+    IdiomCache_invalidate(self, end);
+}
+
+/**
+ * \brief Checks whether a range of addresses lies within a single range of a
+ * list.
+ */
+static bool ranges_contain(const IdiomRange *const ranges, const size_t len,
+                           const u16 start, const u16 end)
+{
+    for (size_t i = 0; i < len; ++i) {
+        if (ranges[i].start <= start && end <= ranges[i].end)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * \brief Recognizes the body of an idiom, which must define a before the
+ * counter is decremented.
+ *
+ * \return the length in bytes of the body, or 0 if there is none.
+ */
+static u8 parse_body(const u8 *const code, Idiom *const idiom)
+{
+    switch (code[0]) {
+    case 0x22: // ld [hl+], a
+    case 0x32: // ld [hl-], a
+        idiom->body = IdiomBody_FillA;
+        idiom->step = code[0] == 0x22 ? 1 : -1;
+        idiom->iteration_cycles = 2;
+        return 1;
+    case 0x78: // ld a, b
+    case 0x79: // ld a, c
+    case 0x7A: // ld a, d
+    case 0x7B: // ld a, e
+        if (code[1] != 0x22 && code[1] != 0x32)
+            return 0;
+
+        idiom->body = IdiomBody_FillR;
+        idiom->fill_r = code[0] & 0x07;
+        idiom->step = code[1] == 0x22 ? 1 : -1;
+        idiom->iteration_cycles = 1 + 2;
+        return 2;
+    case 0x2A: // ld a, [hl+]
+        if (code[1] != 0x12 || code[2] != 0x13) // ld [de], a; inc de
+            return 0;
+
+        idiom->body = IdiomBody_CopyHlToDe;
+        idiom->step = 1;
+        idiom->iteration_cycles = 2 + 2 + 2;
+        return 3;
+    case 0x1A: // ld a, [de]
+        // ld [hl+], a; inc de, or the other way around
+        if (!(code[1] == 0x22 && code[2] == 0x13) &&
+            !(code[1] == 0x13 && code[2] == 0x22))
+            return 0;
+
+        idiom->body = IdiomBody_CopyDeToHl;
+        idiom->step = 1;
+        idiom->iteration_cycles = 2 + 2 + 2;
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief Recognizes the counter of an idiom, right after its body.
+ *
+ * \return the length in bytes of the counter, or 0 if there is none.
+ */
+static u8 parse_counter(const u8 *const code, Idiom *const idiom)
+{
+    switch (code[0]) {
+    case 0x05: // dec b
+    case 0x0D: // dec c
+    case 0x15: // dec d
+    case 0x1D: // dec e
+        idiom->wide_counter = false;
+        idiom->counter_r = code[0] >> 3;
+        idiom->iteration_cycles += 1;
+        return 1;
+    case 0x0B: // dec bc
+    case 0x1B: // dec de
+        idiom->wide_counter = true;
+        idiom->counter_rp = code[0] >> 4;
+
+        // ld a, b; or c, or ld a, d; or e
+        if (code[1] != (idiom->counter_rp == CpuTableRp_BC ? 0x78 : 0x7A) ||
+            code[2] != (idiom->counter_rp == CpuTableRp_BC ? 0xB1 : 0xB3))
+            return 0;
+
+        idiom->iteration_cycles += 2 + 1 + 1;
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief Checks whether the counter of an idiom is left alone by its body.
+ */
+static bool counter_is_free(const Idiom *const idiom)
+{
+    // Every body uses hl, which no counter can be
+    const bool uses_de = idiom->body == IdiomBody_CopyHlToDe ||
+                         idiom->body == IdiomBody_CopyDeToHl;
+
+    if (idiom->wide_counter) {
+        // The counter is tested through a, which fill_a needs to keep
+        if (idiom->body == IdiomBody_FillA)
+            return false;
+
+        const CpuTableR high = idiom->counter_rp == CpuTableRp_BC
+                                   ? CpuTableR_B
+                                   : CpuTableR_D;
+
+        if (idiom->counter_rp == CpuTableRp_DE && uses_de)
+            return false;
+
+        return idiom->body != IdiomBody_FillR ||
+               (idiom->fill_r != high && idiom->fill_r != high + 1);
+    }
+
+    if (uses_de && (idiom->counter_r == CpuTableR_D ||
+                    idiom->counter_r == CpuTableR_E))
+        return false;
+
+    return idiom->body != IdiomBody_FillR ||
+           idiom->fill_r != idiom->counter_r;
+}
+
+/**
+ * \brief Recognizes the idiom starting at pc, if any.
+ */
+static bool IdiomCache_parse(const IdiomCache *const self,
+                             const Memory *const mem, const u16 pc,
+                             Idiom *const idiom)
+{
+    if (pc > 0xFFFF - (IDIOM_MAX_LEN - 1) ||
+        !ranges_contain(self->readable, self->readable_len, pc,
+                        pc + (IDIOM_MAX_LEN - 1)))
+        return false;
+
+    u8 code[IDIOM_MAX_LEN];
+
+    for (size_t i = 0; i < IDIOM_MAX_LEN; ++i)
+        code[i] = mem->read(mem->ctx, pc + i);
+
+    const u8 body_len = parse_body(code, idiom);
+
+    if (body_len == 0)
+        return false;
+
+    const u8 counter_len = parse_counter(&code[body_len], idiom);
+
+    if (counter_len == 0 || !counter_is_free(idiom))
+        return false;
+
+    // jr nz back to the start of the body
+    const u8 len = body_len + counter_len + 2;
+
+    if (code[len - 2] != 0x20 || (i8)code[len - 1] != -len)
+        return false;
+
+    idiom->len = len;
+    idiom->iteration_cycles += 3;
+    return true;
+}
+
+bool IdiomCache_lookup(IdiomCache *const self, const Memory *const mem,
+                       const u16 pc, Idiom *const idiom)
+{
+    IdiomCachePage *const code_page = self->pages[pc >> 8];
+    u8 *const entry = &code_page->entries[pc & 0xFF];
+
+    switch (*entry) {
+    case IdiomEntry_None:
+        return false;
+    case IdiomEntry_Found:
+        // Cheaper to recognize again than to store every idiom found
+        if (IdiomCache_parse(self, mem, pc, idiom))
+            return true;
+
+        break;
+    case IdiomEntry_Unknown:
+        if (IdiomCache_parse(self, mem, pc, idiom)) {
+            log_debug("Found idiom at $%04X", pc);
+
+            *entry = IdiomEntry_Found;
+            code_page->has_entries = true;
+            return true;
+        }
+
+        break;
+    }
+
+    *entry = IdiomEntry_None;
+    code_page->has_entries = true;
+    return false;
+}
+
+/**
+ * \brief Computes the range of addresses touched by n steps starting at addr.
+ *
+ * \return whether the range does not wrap around.
+ */
+static bool step_range(const u16 addr, const i8 step, const int n,
+                       u16 *const start, u16 *const end)
+{
+    const int last = addr + step * (n - 1);
+
+    if (last < 0 || last > 0xFFFF)
+        return false;
+
+    *start = step > 0 ? addr : (u16)last;
+    *end = step > 0 ? (u16)last : addr;
+    return true;
+}
+
+/**
+ * \brief Copies a block of memory to another one that does not overlap it,
+ * straight from plain memory wherever possible.
+ *
+ * \return the last byte copied.
+ */
+static u8 copy_block(Memory *const mem, const u16 dst, const u16 src,
+                     const int len)
+{
+    u8 buffer[0x100];
+    u8 last = 0;
+    int done = 0;
+
+    while (done < len) {
+        size_t chunk_len = 0;
+        const u8 *chunk = Memory_get_span(mem, src + done, &chunk_len);
+
+        if (chunk == nullptr)
+            chunk_len = sizeof(buffer);
+
+        if (chunk_len > (size_t)(len - done))
+            chunk_len = len - done;
+
+        if (chunk == nullptr) {
+            Memory_read_block(mem, src + done, buffer, chunk_len);
+            chunk = buffer;
+        }
+
+        last = chunk[chunk_len - 1];
+        Memory_write_block(mem, dst + done, chunk, chunk_len);
+        done += (int)chunk_len;
+    }
+
+    return last;
+}
+
+static void fill_block(Memory *const mem, const u16 dst, const u8 value,
+                       const int len)
+{
+    u8 buffer[0x100];
+    memset(buffer, value, sizeof(buffer));
+
+    for (int done = 0; done < len; done += (int)sizeof(buffer)) {
+        const int chunk_len =
+            len - done < (int)sizeof(buffer) ? len - done : (int)sizeof(buffer);
+
+        Memory_write_block(mem, dst + done, buffer, chunk_len);
+    }
+}
+
+bool IdiomCache_run(const IdiomCache *const self, const Idiom *const idiom,
+                    Cpu *const cpu, Memory *const mem, const int max_cycles)
+{
+    if (cpu->mode != CpuMode_Running || cpu->queued_ime)
+        return false;
+
+    int count = 0;
+
+    if (idiom->wide_counter) {
+        count = Cpu_read_rp(cpu, idiom->counter_rp);
+
+        if (count == 0)
+            count = 0x10000;
+    } else {
+        count = Cpu_read_r(cpu, mem, idiom->counter_r);
+
+        if (count == 0)
+            count = 0x100;
+    }
+
+    // The last iteration falls through the branch, which costs one cycle less
+    // than taking it, so it is left to the interpreter
+    int n = count - 1;
+
+    if (n > max_cycles / idiom->iteration_cycles)
+        n = max_cycles / idiom->iteration_cycles;
+
+    if (n < 1)
+        return false;
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    const u16 de = Cpu_read_rp(cpu, CpuTableRp_DE);
+
+    const bool copy_to_de = idiom->body == IdiomBody_CopyHlToDe;
+    const bool copy_from_de = idiom->body == IdiomBody_CopyDeToHl;
+    const bool copy = copy_to_de || copy_from_de;
+    const u16 dst = copy_to_de ? de : hl;
+    const u16 src = copy_from_de ? de : hl;
+
+    u16 dst_start = 0;
+    u16 dst_end = 0;
+    u16 src_start = 0;
+    u16 src_end = 0;
+
+    if (!step_range(dst, idiom->step, n, &dst_start, &dst_end) ||
+        !ranges_contain(self->writable, self->writable_len, dst_start,
+                        dst_end))
+        return false;
+
+    // Overwriting the idiom itself would change what the next iteration runs
+    const u16 pc_end = cpu->pc + (idiom->len - 1);
+
+    if (dst_start <= pc_end && cpu->pc <= dst_end)
+        return false;
+
+    if (copy) {
+        if (!step_range(src, idiom->step, n, &src_start, &src_end) ||
+            !ranges_contain(self->readable, self->readable_len, src_start,
+                            src_end))
+            return false;
+    }
+
+    u8 a = cpu->a;
+
+    if (idiom->body == IdiomBody_FillR)
+        a = Cpu_read_r(cpu, mem, idiom->fill_r);
+
+    // Writable memory is plain, so the order bytes are written in only
+    // matters when a copy reads back what it wrote
+    if (!copy) {
+        fill_block(mem, dst_start, a, n);
+    } else if (dst_end < src_start || src_end < dst_start) {
+        a = copy_block(mem, dst_start, src_start, n);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            a = mem->read(mem->ctx, src + i);
+            mem->write(mem->ctx, dst + idiom->step * i, a);
+        }
+    }
+
+    const u16 distance = idiom->step * n;
+
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl + distance);
+
+    if (copy)
+        Cpu_write_rp(cpu, CpuTableRp_DE, de + distance);
+
+    if (idiom->wide_counter) {
+        const u16 counter = count - n;
+        Cpu_write_rp(cpu, idiom->counter_rp, counter);
+
+        // ld a, rh; or rl
+        cpu->a = (counter >> 8) | (counter & 0xFF);
+        Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, cpu->a);
+    } else {
+        const u8 counter = count - n;
+        Cpu_write_r(cpu, mem, idiom->counter_r, counter);
+
+        // dec r leaves C alone
+        cpu->a = a;
+        Cpu_set_flags_op(cpu, CpuFlagsOp_Sub, counter + 1, 1,
+                         counter | (Cpu_read_flag_c(cpu) << 8));
+    }
+
+    cpu->cycle_count += n * idiom->iteration_cycles;
+    return true;
+}
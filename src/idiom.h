@@ -0,0 +1,203 @@
+#ifndef GEMU_IDIOM_H
+#define GEMU_IDIOM_H
+
+#include "cpu.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Length in bytes of the longest idiom
+ */
+constexpr u16 IDIOM_MAX_LEN = 8;
+
+/**
+ * Maximum number of address ranges an IdiomCache may be given of each kind
+ */
+constexpr size_t IDIOM_MAX_RANGES = 8;
+
+/**
+ * What each iteration of an idiom does with memory.
+ */
+typedef enum : u8 {
+    /** ld [hl±], a */
+    IdiomBody_FillA,
+    /** ld a, r; ld [hl±], a */
+    IdiomBody_FillR,
+    /** ld a, [hl+]; ld [de], a; inc de */
+    IdiomBody_CopyHlToDe,
+    /** ld a, [de]; ld [hl+], a; inc de (in either order) */
+    IdiomBody_CopyDeToHl,
+} IdiomBody;
+
+/**
+ * A loop that fills or copies a range of memory, counting down a register.
+ *
+ * The loop either ends in dec r; jr nz (with an 8-bit counter), or in
+ * dec rr; ld a, rh; or rl; jr nz (with a 16-bit counter), jumping back to its
+ * first instruction.
+ */
+typedef struct {
+    IdiomBody body;
+    i8 step;
+    CpuTableR fill_r;
+    bool wide_counter;
+    CpuTableR counter_r;
+    CpuTableRp counter_rp;
+    u8 len;
+    u8 iteration_cycles;
+} Idiom;
+
+typedef struct {
+    u16 start;
+    u16 end;
+} IdiomRange;
+
+/**
+ * What is known about the idioms starting in a single code page, keyed by
+ * their offset into it.
+ */
+typedef struct {
+    u8 entries[0x100];
+    bool has_entries;
+} IdiomCachePage;
+
+/**
+ * A cache of the idioms found in memory, keyed by the code page and offset
+ * they start at.
+ *
+ * Idioms are only looked for in memory marked as readable, and only run over
+ * memory marked as readable (when copied from) or writable (when written to).
+ * The owner of the cache is responsible for marking only memory whose
+ * accesses have no side effects, and for calling IdiomCache_invalidate
+ * whenever memory may have changed and IdiomCache_map whenever a different
+ * code page gets mapped, just like with DecodeCache.
+ */
+typedef struct IdiomCache {
+    IdiomCachePage *pages[0x100];
+    IdiomCachePage **code_pages;
+    size_t code_pages_len;
+    IdiomRange readable[IDIOM_MAX_RANGES];
+    size_t readable_len;
+    IdiomRange writable[IDIOM_MAX_RANGES];
+    size_t writable_len;
+} IdiomCache;
+
+/**
+ * \brief Allocates an empty IdiomCache with no readable or writable memory.
+ *
+ * Every page of the address space starts out showing the code page with its
+ * own number.
+ *
+ * The created IdiomCache must eventually be freed with IdiomCache_destroy.
+ *
+ * \return the allocated IdiomCache.
+ *
+ * \sa IdiomCache_destroy
+ */
+[[nodiscard]] IdiomCache *IdiomCache_new();
+
+/**
+ * \brief Frees a previously-allocated IdiomCache.
+ *
+ * \param self the IdiomCache to free. May be NULL.
+ *
+ * \sa IdiomCache_new
+ */
+void IdiomCache_destroy(IdiomCache *self);
+
+/**
+ * \brief Marks an address range as safe to read from in bulk, and to look for
+ * idioms in.
+ *
+ * \param self the IdiomCache to modify.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void IdiomCache_set_readable(IdiomCache *self, u16 start, u16 end);
+
+/**
+ * \brief Marks an address range as safe to write to in bulk.
+ *
+ * \param self the IdiomCache to modify.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void IdiomCache_set_writable(IdiomCache *self, u16 start, u16 end);
+
+/**
+ * \brief Maps code pages into a range of pages of the address space, just
+ * like DecodeCache_map.
+ *
+ * \param self the IdiomCache to modify.
+ * \param first_page the first page of the range.
+ * \param last_page the last page of the range (inclusive).
+ * \param first_id the code page to show in first_page.
+ */
+void IdiomCache_map(IdiomCache *self, u8 first_page, u8 last_page,
+                    size_t first_id);
+
+/**
+ * \brief Forgets every idiom found so far.
+ *
+ * \param self the IdiomCache to flush.
+ */
+void IdiomCache_flush(IdiomCache *self);
+
+/**
+ * \brief Forgets every idiom that may contain the given address.
+ *
+ * \param self the IdiomCache to modify.
+ * \param addr the address that has been (or is about to be) modified.
+ */
+void IdiomCache_invalidate(IdiomCache *self, u16 addr);
+
+/**
+ * \brief Forgets every idiom that may contain an address in the given range.
+ *
+ * \param self the IdiomCache to modify.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void IdiomCache_invalidate_range(IdiomCache *self, u16 start, u16 end);
+
+/**
+ * \brief Looks up the idiom starting at the given address, recognizing it if
+ * necessary.
+ *
+ * Recognizing reads memory through mem without spending any cycles.
+ *
+ * \param self the IdiomCache to look up.
+ * \param mem the memory to recognize idioms in.
+ * \param pc the address to look up.
+ * \param idiom where to write the idiom found.
+ *
+ * \return whether an idiom starts at pc.
+ */
+[[nodiscard]] bool IdiomCache_lookup(IdiomCache *self, const Memory *mem,
+                                     u16 pc, Idiom *idiom);
+
+/**
+ * \brief Runs as many iterations of an idiom as possible in one go.
+ *
+ * Leaves the Cpu (cycle_count included) and memory exactly as running those
+ * iterations one instruction at a time would. The last iteration of the loop
+ * is never run, so that execution always leaves the loop normally.
+ *
+ * Nothing is run if the Cpu is not at the start of a fresh instruction, if the
+ * memory the iterations would access is not safe to access in bulk, or if not
+ * even a single iteration fits in max_cycles.
+ *
+ * \param self the IdiomCache the idiom was looked up in.
+ * \param idiom the idiom starting at the Cpu's pc.
+ * \param cpu the Cpu to run the idiom on.
+ * \param mem the memory the Cpu is attached to.
+ * \param max_cycles the maximum number of cycles to run for.
+ *
+ * \return whether any iterations were run.
+ *
+ * \sa IdiomCache_lookup
+ */
+[[nodiscard]] bool IdiomCache_run(const IdiomCache *self, const Idiom *idiom,
+                                  Cpu *cpu, Memory *mem, int max_cycles);
+
+#endif
@@ -0,0 +1,342 @@
+#include "idle_loop.h"
+#include "cpu.h"
+#include "log.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * How the value at an address may change while the Cpu is not writing to
+ * memory.
+ */
+typedef enum : u8 {
+    /** Only interrupt handlers can change it */
+    ReadKind_Stable,
+    /** Changes on every scanline */
+    ReadKind_Line,
+    /** Changes on its own at any time */
+    ReadKind_Volatile,
+} ReadKind;
+
+static ReadKind classify_read(const u16 addr)
+{
+    if (addr >= 0xA000 && addr <= 0xBFFF) // A000-BFFF (External RAM)
+        return ReadKind_Volatile;
+
+    if (addr < 0xFF00 || addr >= 0xFF80) // Everything but I/O registers
+        return ReadKind_Stable;
+
+    switch (addr) {
+    case 0xFF41: // STAT
+    case 0xFF44: // LY
+        return ReadKind_Line;
+    case 0xFF00: // JOYP (latched on write)
+    case 0xFF01: // SB
+    case 0xFF02: // SC
+    case 0xFF06: // TMA
+    case 0xFF07: // TAC
+    case 0xFF0F: // IF
+    case 0xFF40: // LCDC
+    case 0xFF42: // SCY
+    case 0xFF43: // SCX
+    case 0xFF45: // LYC
+    case 0xFF47: // BGP
+    case 0xFF48: // OBP0
+    case 0xFF49: // OBP1
+    case 0xFF4A: // WY
+    case 0xFF4B: // WX
+        return ReadKind_Stable;
+    default:
+        return ReadKind_Volatile;
+    }
+}
+
+static IdleLoopSnapshot IdleLoopSnapshot_take(const Cpu *const cpu)
+{
+    return (IdleLoopSnapshot){
+        .bc = Cpu_read_rp(cpu, CpuTableRp_BC),
+        .de = Cpu_read_rp(cpu, CpuTableRp_DE),
+        .hl = Cpu_read_rp(cpu, CpuTableRp_HL),
+        .sp = Cpu_read_rp(cpu, CpuTableRp_SP),
+        .a = cpu->a,
+        .f = Cpu_read_f(cpu),
+        .ime = cpu->ime,
+        .queued_ime = cpu->queued_ime,
+        .mode = cpu->mode,
+    };
+}
+
+static bool IdleLoopSnapshot_equals(const IdleLoopSnapshot *const self,
+                                    const IdleLoopSnapshot *const other)
+{
+    return self->bc == other->bc && self->de == other->de &&
+           self->hl == other->hl && self->sp == other->sp &&
+           self->a == other->a && self->f == other->f &&
+           self->ime == other->ime && self->queued_ime == other->queued_ime &&
+           self->mode == other->mode;
+}
+
+IdleLoopDetector *IdleLoopDetector_new()
+{
+    IdleLoopDetector *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate idle loop detector");
+
+    self->inner = (Memory){
+        .ctx = nullptr,
+        .read = nullptr,
+        .write = nullptr,
+    };
+
+    IdleLoopDetector_clear(self);
+    return self;
+}
+
+void IdleLoopDetector_destroy(IdleLoopDetector *const self)
+{
+    free(self);
+}
+
+void IdleLoopDetector_clear(IdleLoopDetector *const self)
+{
+    memset(self->states, IdleLoopState_Unknown, sizeof(self->states));
+    self->modified = false;
+    self->watching = false;
+}
+
+static u8 IdleLoopDetector_read(const void *const ctx, const u16 addr)
+{
+    // Reads are only const from the point of view of the memory being read
+    IdleLoopDetector *const self = (IdleLoopDetector *)ctx;
+    const u8 value = self->inner.read(self->inner.ctx, addr);
+
+    // ROM cannot change without being written to first
+    if (!self->watching || addr <= 0x7FFF)
+        return value;
+
+    switch (classify_read(addr)) {
+    case ReadKind_Stable:
+        break;
+    case ReadKind_Line:
+        self->line_bound = true;
+        break;
+    case ReadKind_Volatile:
+        self->dirty = true;
+        return value;
+    }
+
+    for (size_t i = 0; i < self->reads_len; ++i) {
+        if (self->reads[i].addr == addr) {
+            if (self->reads[i].value != value)
+                self->changed = true;
+
+            return value;
+        }
+    }
+
+    // Too much to keep track of, which is most likely a block of code being
+    // decoded for the first time. Later iterations will tell.
+    if (self->reads_len == IDLE_LOOP_MAX_READS) {
+        self->changed = true;
+        return value;
+    }
+
+    self->reads[self->reads_len++] = (IdleLoopRead){
+        .addr = addr,
+        .value = value,
+    };
+
+    return value;
+}
+
+static void IdleLoopDetector_write(void *const ctx, const u16 addr,
+                                   const u8 value)
+{
+    IdleLoopDetector *const self = ctx;
+
+    if (self->watching)
+        self->dirty = true;
+
+    self->inner.write(self->inner.ctx, addr, value);
+}
+
+Memory IdleLoopDetector_memory(IdleLoopDetector *const self,
+                               const Memory *const mem)
+{
+    self->inner = *mem;
+
+    return (Memory){
+        .ctx = self,
+        .read = IdleLoopDetector_read,
+        .write = IdleLoopDetector_write,
+    };
+}
+
+/**
+ * \brief Starts a new iteration of the loop being watched.
+ */
+static void IdleLoopDetector_begin_iteration(IdleLoopDetector *const self,
+                                             const Cpu *const cpu)
+{
+    self->snapshot = IdleLoopSnapshot_take(cpu);
+    self->cycles = 0;
+    self->dirty = false;
+    self->changed = false;
+    self->line_bound = false;
+    self->reads_len = 0;
+}
+
+static void IdleLoopDetector_reject(IdleLoopDetector *const self)
+{
+    log_debug("Rejected loop at $%04X", self->start);
+
+    self->states[self->start] = IdleLoopState_Rejected;
+    self->watching = false;
+}
+
+/**
+ * \brief Checks whether the current iteration read exactly the same values as
+ * the previous one.
+ */
+static bool IdleLoopDetector_reads_repeat(const IdleLoopDetector *const self)
+{
+    if (self->changed || self->reads_len != self->prev_reads_len)
+        return false;
+
+    for (size_t i = 0; i < self->reads_len; ++i) {
+        bool found = false;
+
+        for (size_t j = 0; j < self->prev_reads_len && !found; ++j) {
+            found = self->reads[i].addr == self->prev_reads[j].addr &&
+                    self->reads[i].value == self->prev_reads[j].value;
+        }
+
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+int IdleLoopDetector_observe(IdleLoopDetector *const self,
+                             const Cpu *const cpu, const u16 prev_pc,
+                             bool *const line_bound)
+{
+    const u16 pc = cpu->pc;
+
+    if (!self->watching) {
+        if (pc < prev_pc && prev_pc - pc <= IDLE_LOOP_MAX_LEN &&
+            self->states[pc] != IdleLoopState_Rejected) {
+            self->watching = true;
+            self->start = pc;
+            self->end = prev_pc;
+            self->confirmations = 0;
+            self->prev_reads_len = 0;
+            IdleLoopDetector_begin_iteration(self, cpu);
+        }
+
+        return 0;
+    }
+
+    self->cycles += cpu->cycle_count;
+
+    // Leaving the loop ends the watch, but does not say anything about it
+    if (pc < self->start || pc > self->end) {
+        self->watching = false;
+        return 0;
+    }
+
+    if (self->dirty) {
+        IdleLoopDetector_reject(self);
+        return 0;
+    }
+
+    if (pc != self->start)
+        return 0;
+
+    const IdleLoopSnapshot snapshot = IdleLoopSnapshot_take(cpu);
+    int skippable_cycles = 0;
+
+    if (!self->changed && IdleLoopSnapshot_equals(&snapshot, &self->snapshot)) {
+        if (self->states[self->start] != IdleLoopState_Idle &&
+            ++self->confirmations >= IDLE_LOOP_CONFIRMATIONS) {
+            log_debug("Found idle loop at $%04X", self->start);
+
+            self->states[self->start] = IdleLoopState_Idle;
+            self->modified = true;
+        }
+
+        if (self->states[self->start] == IdleLoopState_Idle) {
+            skippable_cycles = self->cycles;
+            *line_bound = self->line_bound;
+        }
+    } else if (IdleLoopDetector_reads_repeat(self)) {
+        IdleLoopDetector_reject(self);
+        return 0;
+    } else {
+        self->confirmations = 0;
+    }
+
+    memcpy(self->prev_reads, self->reads, sizeof(self->reads));
+    self->prev_reads_len = self->reads_len;
+
+    IdleLoopDetector_begin_iteration(self, cpu);
+    return skippable_cycles;
+}
+
+void IdleLoopDetector_interrupt(IdleLoopDetector *const self)
+{
+    self->watching = false;
+}
+
+void IdleLoopDetector_event(IdleLoopDetector *const self)
+{
+    self->changed = true;
+}
+
+bool IdleLoopDetector_load(IdleLoopDetector *const self,
+                           const char *const path)
+{
+    FILE *const file = fopen(path, "r");
+
+    if (file == nullptr)
+        return false;
+
+    unsigned int addr = 0;
+
+    while (fscanf(file, "%x", &addr) == 1) {
+        if (addr <= 0xFFFF)
+            self->states[addr] = IdleLoopState_Idle;
+    }
+
+    fclose(file);
+
+    self->modified = false;
+    return true;
+}
+
+bool IdleLoopDetector_save(IdleLoopDetector *const self,
+                           const char *const path)
+{
+    if (!self->modified)
+        return true;
+
+    FILE *const file = fopen(path, "w");
+
+    if (file == nullptr)
+        return false;
+
+    for (size_t addr = 0; addr < 0x10000; ++addr) {
+        if (self->states[addr] == IdleLoopState_Idle)
+            fprintf(file, "%04zX\n", addr);
+    }
+
+    const bool ok = fclose(file) == 0;
+
+    if (ok)
+        self->modified = false;
+
+    return ok;
+}
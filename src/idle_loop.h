@@ -0,0 +1,189 @@
+#ifndef GEMU_IDLE_LOOP_H
+#define GEMU_IDLE_LOOP_H
+
+#include "cpu.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Maximum distance in bytes from the start of a loop to its backward branch
+ */
+constexpr u16 IDLE_LOOP_MAX_LEN = 16;
+
+/**
+ * Maximum number of distinct addresses outside of ROM a loop may read from
+ */
+constexpr size_t IDLE_LOOP_MAX_READS = 16;
+
+/**
+ * Number of identical iterations a loop must go through before it is trusted
+ * to be idle for the first time
+ */
+constexpr int IDLE_LOOP_CONFIRMATIONS = 8;
+
+typedef enum : u8 {
+    IdleLoopState_Unknown,
+    IdleLoopState_Rejected,
+    IdleLoopState_Idle,
+} IdleLoopState;
+
+typedef struct {
+    u16 addr;
+    u8 value;
+} IdleLoopRead;
+
+/**
+ * The registers a loop iteration must leave exactly as it found them.
+ */
+typedef struct {
+    u16 bc;
+    u16 de;
+    u16 hl;
+    u16 sp;
+    u8 a;
+    u8 f;
+    bool ime;
+    bool queued_ime;
+    CpuMode mode;
+} IdleLoopSnapshot;
+
+/**
+ * Finds busy-waiting loops, which spin until an interrupt or a new scanline
+ * changes something they read.
+ *
+ * A loop is watched from the first time the Cpu jumps a short distance
+ * backwards, for as long as it stays between the target and the jump, with
+ * every memory access of the Cpu going through IdleLoopDetector_memory. Each
+ * time the Cpu comes back to the start of the loop, an iteration has
+ * completed. An iteration that writes memory or reads
+ * something that changes on its own (like DIV) rejects the loop for good, and
+ * so does one that changes the registers despite reading the same values as
+ * the previous one, like a delay loop counting down. An iteration that leaves
+ * the registers exactly as it found them proves that the loop will keep doing
+ * so for as long as the values it reads stay the same, so it can be skipped
+ * ahead in whole iterations.
+ *
+ * Nothing but interrupts and scanline changes can change what an idle loop
+ * reads, so the owner of the detector is responsible for bounding every skip
+ * by the next of those.
+ */
+typedef struct IdleLoopDetector {
+    IdleLoopState states[0x10000];
+    bool modified;
+    bool watching;
+    u16 start;
+    u16 end;
+    IdleLoopSnapshot snapshot;
+    int cycles;
+    int confirmations;
+    bool dirty;
+    bool changed;
+    bool line_bound;
+    IdleLoopRead reads[IDLE_LOOP_MAX_READS];
+    size_t reads_len;
+    IdleLoopRead prev_reads[IDLE_LOOP_MAX_READS];
+    size_t prev_reads_len;
+    Memory inner;
+} IdleLoopDetector;
+
+/**
+ * \brief Allocates an IdleLoopDetector that knows no loops yet.
+ *
+ * The created IdleLoopDetector must eventually be freed with
+ * IdleLoopDetector_destroy.
+ *
+ * \return the allocated IdleLoopDetector.
+ *
+ * \sa IdleLoopDetector_destroy
+ */
+[[nodiscard]] IdleLoopDetector *IdleLoopDetector_new();
+
+/**
+ * \brief Frees a previously-allocated IdleLoopDetector.
+ *
+ * \param self the IdleLoopDetector to free. May be NULL.
+ *
+ * \sa IdleLoopDetector_new
+ */
+void IdleLoopDetector_destroy(IdleLoopDetector *self);
+
+/**
+ * \brief Forgets every loop found so far, such as when another ROM is loaded.
+ *
+ * \param self the IdleLoopDetector to clear.
+ */
+void IdleLoopDetector_clear(IdleLoopDetector *self);
+
+/**
+ * \brief Wraps memory so that the accesses made through it are watched by the
+ * detector.
+ *
+ * \param self the IdleLoopDetector.
+ * \param mem the memory to wrap. Its contents are copied.
+ *
+ * \return the wrapped memory, which is only valid for as long as self is.
+ */
+[[nodiscard]] Memory IdleLoopDetector_memory(IdleLoopDetector *self,
+                                             const Memory *mem);
+
+/**
+ * \brief Lets the detector know that the Cpu has just run from prev_pc to its
+ * current pc.
+ *
+ * \param self the IdleLoopDetector.
+ * \param cpu the Cpu, whose cycle_count holds the cycles it has just spent.
+ * \param prev_pc the value of pc before the Cpu ran.
+ * \param line_bound where to write whether the loop waits on something that
+ * changes on every scanline, like LY, if it may be skipped.
+ *
+ * \return the length in cycles of an iteration of the loop starting at the
+ * current pc if it may be skipped right now, or 0 if it may not.
+ */
+[[nodiscard]] int IdleLoopDetector_observe(IdleLoopDetector *self,
+                                           const Cpu *cpu, u16 prev_pc,
+                                           bool *line_bound);
+
+/**
+ * \brief Lets the detector know that the Cpu has been interrupted, which ends
+ * the loop iteration in progress without it counting either way.
+ *
+ * \param self the IdleLoopDetector.
+ */
+void IdleLoopDetector_interrupt(IdleLoopDetector *self);
+
+/**
+ * \brief Lets the detector know that something loops may be waiting on, like
+ * LY or IF, has just changed.
+ *
+ * The loop iteration in progress does not count either way, since it may have
+ * read the old value.
+ *
+ * \param self the IdleLoopDetector.
+ */
+void IdleLoopDetector_event(IdleLoopDetector *self);
+
+/**
+ * \brief Marks the loops listed in a file as known to be idle, so that they do
+ * not have to be confirmed again.
+ *
+ * \param self the IdleLoopDetector.
+ * \param path the path of a file written by IdleLoopDetector_save.
+ *
+ * \return whether the file could be read.
+ */
+bool IdleLoopDetector_load(IdleLoopDetector *self, const char *path);
+
+/**
+ * \brief Writes the start address of every loop known to be idle to a file.
+ *
+ * Does nothing if no new loop has been found since self was created, cleared
+ * or loaded.
+ *
+ * \param self the IdleLoopDetector.
+ * \param path the path of the file to write.
+ *
+ * \return whether the file could be written.
+ */
+bool IdleLoopDetector_save(IdleLoopDetector *self, const char *path);
+
+#endif
@@ -1,1022 +1,267 @@
 #include "instructions.h"
 #include "cpu.h"
+#include "cpu_bus.h"
+#include "instructions_inline.h"
 #include "log.h"
 #include "macros.h"
-#include "num.h"
+#include "opcodes.h"
 #include "stdinc.h"
 
-static inline void Cpu_instr_add_u8(Cpu *const cpu, const u8 rhs)
-{
-    const u8 prev_a = cpu->a;
-    cpu->a += rhs;
-
-    set_bits(&cpu->f, CpuFlag_C, rhs > (0xFF - prev_a));
-    set_bits(&cpu->f, CpuFlag_H, (prev_a & 0xF) + (rhs & 0xF) > 0xF);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-}
-
-static inline void Cpu_instr_adc_u8(Cpu *const cpu, const u8 rhs)
-{
-    const u8 prev_a = cpu->a;
-    const u8 carry = (cpu->f & CpuFlag_C) != 0;
-    const u16 result = (u16)prev_a + rhs + carry;
-    cpu->a = (u8)result;
-
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, (prev_a & 0xF) + (rhs & 0xF) + carry > 0xF);
-    set_bits(&cpu->f, CpuFlag_C, result > 0xFF);
-}
-
-static inline void Cpu_instr_sub_u8(Cpu *const cpu, const u8 rhs)
-{
-    const u8 prev_a = cpu->a;
-    cpu->a -= rhs;
-
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, true);
-    set_bits(&cpu->f, CpuFlag_H, (prev_a & 0xF) < (rhs & 0xF));
-    set_bits(&cpu->f, CpuFlag_C, rhs > prev_a);
-}
-
-static inline void Cpu_instr_sbc_u8(Cpu *const cpu, const u8 rhs)
-{
-    const u8 prev_a = cpu->a;
-    const u8 borrow = (cpu->f & CpuFlag_C) != 0;
-    cpu->a = prev_a - rhs - borrow;
-
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, true);
-    set_bits(&cpu->f, CpuFlag_H, (prev_a & 0xF) < (rhs & 0xF) + borrow);
-    set_bits(&cpu->f, CpuFlag_C, prev_a < (u16)rhs + borrow);
-}
-
-static inline void Cpu_instr_and_u8(Cpu *const cpu, const u8 rhs)
-{
-    cpu->a &= rhs;
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, true);
-    set_bits(&cpu->f, CpuFlag_C, false);
-}
-
-static inline void Cpu_instr_xor_u8(Cpu *const cpu, const u8 rhs)
-{
-    cpu->a ^= rhs;
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, false);
-}
-
-static inline void Cpu_instr_or_u8(Cpu *const cpu, const u8 rhs)
-{
-    cpu->a |= rhs;
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, false);
-}
-
-static inline void Cpu_instr_cp_u8(Cpu *const cpu, const u8 rhs)
-{
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == rhs);
-    set_bits(&cpu->f, CpuFlag_N, true);
-    set_bits(&cpu->f, CpuFlag_H, (cpu->a & 0xF) < (rhs & 0xF));
-    set_bits(&cpu->f, CpuFlag_C, cpu->a < rhs);
-}
-
-static inline void Cpu_instr_alu(Cpu *const cpu, const CpuTableAlu alu,
-                                 const u8 rhs)
-{
-    // clang-format off
-    switch (alu) {
-        case CpuTableAlu_Add: Cpu_instr_add_u8(cpu, rhs); break;
-        case CpuTableAlu_Adc: Cpu_instr_adc_u8(cpu, rhs); break;
-        case CpuTableAlu_Sub: Cpu_instr_sub_u8(cpu, rhs); break;
-        case CpuTableAlu_Sbc: Cpu_instr_sbc_u8(cpu, rhs); break;
-        case CpuTableAlu_And: Cpu_instr_and_u8(cpu, rhs); break;
-        case CpuTableAlu_Xor: Cpu_instr_xor_u8(cpu, rhs); break;
-        case CpuTableAlu_Or: Cpu_instr_or_u8(cpu, rhs); break;
-        case CpuTableAlu_Cp: Cpu_instr_cp_u8(cpu, rhs); break;
-        default: BAIL("invalid alu: %i", alu);
+/*
+ * Opcode dispatch.
+ *
+ * On GCC and Clang, each opcode gets its own label and dispatch is a single
+ * indirect jump through a label table, with the decoded operands baked into
+ * the call at that label. Other compilers fall back to a flat switch over the
+ * same tables.
+ */
+
+#if !defined(GEMU_NO_COMPUTED_GOTO) &&        \
+    (defined(__GNUC__) || defined(__clang__))
+#define CPU_COMPUTED_GOTO 1
+#else
+#define CPU_COMPUTED_GOTO 0
+#endif
+
+/*
+ * This file is built once per accuracy tier, and once more for flat memory
+ * (see cpu_bus.h). Only the fast tier defines the handler tables, which code
+ * caches rely on.
+ */
+
+#if CPU_ACCURATE
+#define CPU_EXECUTE Cpu_execute_accurate
+#define CPU_INTERRUPT Cpu_interrupt_accurate
+#elif CPU_FLAT
+#define CPU_EXECUTE Cpu_execute_flat
+#else
+#define CPU_EXECUTE Cpu_execute
+#define CPU_INTERRUPT Cpu_interrupt
+#endif
+
+#define CPU_DISPATCH_LABEL(code, len, call) [0x##code] = &&op_##code,
+
+#define CPU_DISPATCH_TARGET(code, len, call)                          \
+    op_##code : {                                                     \
+        [[maybe_unused]] const u16 imm = Cpu_read_imm(cpu, mem, len); \
+        call;                                                         \
+    }                                                                 \
+    return;
+
+#define CPU_DISPATCH_CASE(code, len, call)                            \
+    case 0x##code: {                                                  \
+        [[maybe_unused]] const u16 imm = Cpu_read_imm(cpu, mem, len); \
+        call;                                                         \
+        break;                                                        \
     }
-    // clang-format on
-}
 
-static inline void Cpu_instr_nop()
-{
-    log_trace("nop");
-}
-
-static inline void Cpu_instr_ld_n16_sp(Cpu *const cpu, Memory *const mem)
-{
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("ld [$%04X], SP", addr);
-
-    Cpu_write_mem_u16(cpu, mem, addr, cpu->sp);
-}
-
-static inline void Cpu_instr_stop(Cpu *const cpu)
-{
-    log_trace("stop");
-    cpu->mode = CpuMode_Stopped;
-
-    log_debug("TODO: implement STOP instruction properly");
-}
-
-static inline void Cpu_instr_jr_e8(Cpu *const cpu, const Memory *const mem)
-{
-    const i8 offset = (i8)Cpu_read_pc(cpu, mem);
-    log_trace("jr %i", offset);
-
-    cpu->pc += offset;
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_jr_cc_e8(Cpu *const cpu, const Memory *const mem,
-                                      const u8 y)
-{
-    const u8 cc = y - 4;
-    const i8 offset = (i8)Cpu_read_pc(cpu, mem);
-    log_trace("jr cc(%i), %i", cc, offset);
-
-    if (Cpu_read_cc(cpu, cc)) {
-        cpu->pc += offset;
-        cpu->cycle_count++;
+#define CPU_HANDLER(name, call)                          \
+    static void name([[maybe_unused]] Cpu *const cpu,    \
+                     [[maybe_unused]] Memory *const mem, \
+                     [[maybe_unused]] const u16 imm)     \
+    {                                                    \
+        call;                                            \
     }
-}
-
-static inline void Cpu_instr_ld_r16_n16(Cpu *const cpu, const Memory *const mem,
-                                        const u8 p)
-{
-    const u16 value = Cpu_read_pc_u16(cpu, mem);
-    log_trace("ld rp(%d), $%04X", p, value);
-
-    Cpu_write_rp(cpu, p, value);
-}
-
-static inline void Cpu_instr_add_hl_r16(Cpu *const cpu, const u8 p)
-{
-    log_trace("add hl, rp(%d)", p);
-
-    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
-    const u16 rhs = Cpu_read_rp(cpu, p);
-
-    Cpu_write_rp(cpu, CpuTableRp_HL, hl + rhs);
-
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, (hl & 0xFFF) + (rhs & 0xFFF) > 0xFFF);
-    set_bits(&cpu->f, CpuFlag_C, rhs > 0xFFFF - hl);
-
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_ld_bc_a(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ld [bc], a");
-
-    const u16 bc = Cpu_read_rp(cpu, CpuTableRp_BC);
-    Cpu_write_mem(cpu, mem, bc, cpu->a);
-}
-
-static inline void Cpu_instr_ld_de_a(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ld [de], a");
-
-    const u16 de = Cpu_read_rp(cpu, CpuTableRp_DE);
-    Cpu_write_mem(cpu, mem, de, cpu->a);
-}
-
-static inline void Cpu_instr_ld_hli_a(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ld [hl+], a");
-
-    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
-    Cpu_write_mem(cpu, mem, hl, cpu->a);
-    Cpu_write_rp(cpu, CpuTableRp_HL, hl + 1);
-}
-
-static inline void Cpu_instr_ld_hld_a(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ld [hl-], a");
-
-    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
-    Cpu_write_mem(cpu, mem, hl, cpu->a);
-    Cpu_write_rp(cpu, CpuTableRp_HL, hl - 1);
-}
-
-static inline void Cpu_instr_ld_a_bc(Cpu *const cpu, const Memory *const mem)
-{
-    log_trace("ld a, [bc]");
-    const u16 bc = Cpu_read_rp(cpu, CpuTableRp_BC);
-    cpu->a = Cpu_read_mem(cpu, mem, bc);
-}
-
-static inline void Cpu_instr_ld_a_de(Cpu *const cpu, const Memory *const mem)
-{
-    log_trace("ld a, [de]");
-
-    const u16 de = Cpu_read_rp(cpu, CpuTableRp_DE);
-    cpu->a = Cpu_read_mem(cpu, mem, de);
-}
-
-static inline void Cpu_instr_ld_a_hli(Cpu *const cpu, const Memory *const mem)
-{
-    log_trace("ld a, [hl+]");
-
-    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
-    cpu->a = Cpu_read_mem(cpu, mem, hl);
-    Cpu_write_rp(cpu, CpuTableRp_HL, hl + 1);
-}
-
-static inline void Cpu_instr_ld_a_hld(Cpu *const cpu, const Memory *const mem)
-{
-    log_trace("ld a, [hl-]");
-
-    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
-    cpu->a = Cpu_read_mem(cpu, mem, hl);
-    Cpu_write_rp(cpu, CpuTableRp_HL, hl - 1);
-}
-
-static inline void Cpu_instr_inc_r16(Cpu *const cpu, const u8 p)
-{
-    log_trace("inc rp(%d)", p);
-
-    const u16 value = Cpu_read_rp(cpu, p);
-    Cpu_write_rp(cpu, p, value + 1);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_dec_r16(Cpu *const cpu, const u8 p)
-{
-    log_trace("dec rp(%d)", p);
 
-    const u16 value = Cpu_read_rp(cpu, p);
-    Cpu_write_rp(cpu, p, value - 1);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_inc_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 y)
-{
-    log_trace("inc r(%d)", y);
-
-    const u8 value = Cpu_read_r(cpu, mem, y);
-    const u8 new_value = value + 1;
-    Cpu_write_r(cpu, mem, y, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, (new_value & 0xF) == 0);
-}
+#define CPU_OPCODE_HANDLER(code, len, call) CPU_HANDLER(Cpu_op_##code, call)
+#define CPU_OPCODE_ENTRY(code, len, call) [0x##code] = Cpu_op_##code,
+#define CPU_OPCODE_LENGTH(code, len, call) [0x##code] = len,
 
-static inline void Cpu_instr_dec_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 y)
-{
-    log_trace("dec r(%d)", y);
+#define CPU_PREFIX_DISPATCH_LABEL(code, call) [0x##code] = &&op_##code,
 
-    const u8 value = Cpu_read_r(cpu, mem, y);
-    const u8 new_value = value - 1;
-    Cpu_write_r(cpu, mem, y, new_value);
+#define CPU_PREFIX_DISPATCH_TARGET(code, call) \
+    op_##code:                                 \
+    call;                                      \
+    return;
 
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, true);
-    set_bits(&cpu->f, CpuFlag_H, (new_value & 0xF) == 0xF);
-}
-
-static inline void Cpu_instr_ld_r8_n(Cpu *const cpu, Memory *const mem,
-                                     const u8 y)
-{
-    const u8 value = Cpu_read_pc(cpu, mem);
-    log_trace("ld r(%d), $%02X", y, value);
-
-    Cpu_write_r(cpu, mem, y, value);
-}
-
-static inline void Cpu_instr_rlca(Cpu *const cpu)
-{
-    log_trace("rlca");
-
-    const u8 bit_7 = (cpu->a & 0x80) != 0;
-    cpu->a = (cpu->a << 1) | bit_7;
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_7);
-}
-
-static inline void Cpu_instr_rrca(Cpu *const cpu)
-{
-    log_trace("rrca");
-
-    const u8 bit_0 = cpu->a & 1;
-    cpu->a = (cpu->a >> 1) | (bit_0 << 7);
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_0);
-}
-
-static inline void Cpu_instr_rla(Cpu *const cpu)
-{
-    log_trace("rla");
-
-    const u8 prev_carry = (cpu->f & CpuFlag_C) != 0;
-    const u8 new_carry = (cpu->a & 0x80) != 0;
-    cpu->a = (cpu->a << 1) | prev_carry;
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, new_carry);
-}
-
-static inline void Cpu_instr_rra(Cpu *const cpu)
-{
-    log_trace("rra");
-
-    const u8 prev_carry = (cpu->f & CpuFlag_C) != 0;
-    const u8 new_carry = cpu->a & 1;
-    cpu->a = (cpu->a >> 1) | (prev_carry << 7);
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, new_carry);
-}
-
-static inline void Cpu_instr_daa(Cpu *const cpu)
-{
-    log_trace("daa");
-
-    u8 adj = 0;
-
-    if (cpu->f & CpuFlag_N) {
-        if (cpu->f & CpuFlag_H) {
-            adj += 0x06;
-        }
-
-        if (cpu->f & CpuFlag_C) {
-            adj += 0x60;
-        }
-
-        cpu->a -= adj;
-    } else {
-        if (cpu->f & CpuFlag_H || (cpu->a & 0xF) > 0x9) {
-            adj += 0x06;
-        }
-
-        if (cpu->f & CpuFlag_C || cpu->a > 0x99) {
-            adj += 0x60;
-            set_bits(&cpu->f, CpuFlag_C, true);
-        }
+#define CPU_PREFIX_DISPATCH_CASE(code, call) \
+    case 0x##code:                           \
+        call;                                \
+        break;
 
-        cpu->a += adj;
+#define CPU_PREFIX_OPCODE_HANDLER(code, call) \
+    CPU_HANDLER(Cpu_op_cb_##code, call)
+#define CPU_PREFIX_OPCODE_ENTRY(code, call) [0x##code] = Cpu_op_cb_##code,
+
+/**
+ * \brief Fetches the immediate operand of an instruction whose opcode has
+ * already been read.
+ *
+ * \param len the full length of the instruction, including its opcode.
+ *
+ * \return the immediate operand, or 0 if the instruction has none.
+ */
+static inline u16 Cpu_read_imm(Cpu *const cpu, const Memory *const mem,
+                               const u8 len)
+{
+    switch (len) {
+    case 2:
+        return Cpu_bus_read_pc(cpu, mem);
+    case 3:
+        return Cpu_bus_read_pc_u16(cpu, mem);
+    default:
+        return 0;
     }
-
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
-}
-
-static inline void Cpu_instr_cpl(Cpu *const cpu)
-{
-    log_trace("cpl");
-
-    cpu->a = ~cpu->a;
-    set_bits(&cpu->f, CpuFlag_N, true);
-    set_bits(&cpu->f, CpuFlag_H, true);
 }
 
-static inline void Cpu_instr_scf(Cpu *const cpu)
-{
-    log_trace("scf");
+#if CPU_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
 
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, true);
-}
-
-static inline void Cpu_instr_ccf(Cpu *const cpu)
+static void Cpu_execute_prefix(Cpu *const cpu, Memory *const mem,
+                               const u8 opcode)
 {
-    log_trace("ccf");
-
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, !(cpu->f & CpuFlag_C));
-}
-
-static inline void Cpu_instr_halt(Cpu *const cpu)
-{
-    log_trace("halt");
-    cpu->mode = CpuMode_Halted;
-}
+#if CPU_COMPUTED_GOTO
+    static const void *const labels[256] = {
+        CPU_PREFIX_OPCODES(CPU_PREFIX_DISPATCH_LABEL)};
 
-static inline void Cpu_instr_ld_r8_r8(Cpu *const cpu, Memory *const mem,
-                                      const u8 y, const u8 z)
-{
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    log_trace("ld r(%d), r(%d)", y, z);
-
-    Cpu_write_r(cpu, mem, y, value);
-}
-
-static inline void Cpu_instr_alu_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 y, const u8 z)
-{
-
-    log_trace("{alu} a, r(%d)", z);
-
-    const u8 rhs = Cpu_read_r(cpu, mem, z);
-    Cpu_instr_alu(cpu, y, rhs);
-}
-
-static inline void Cpu_instr_ldh_n16_a(Cpu *const cpu, Memory *const mem)
-{
-    const u8 offset = Cpu_read_pc(cpu, mem);
-    log_trace("ldh [$%02X], a", offset);
-
-    const u16 addr = 0xFF00 + offset;
-    Cpu_write_mem(cpu, mem, addr, cpu->a);
-}
-
-static inline void Cpu_instr_add_sp_e8(Cpu *const cpu, Memory *const mem)
-{
-    const u8 offset_u8 = (i8)Cpu_read_pc(cpu, mem);
-    const i8 offset = (i8)offset_u8;
-    log_trace("add sp, %d", offset);
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, (cpu->sp & 0xF) + (offset_u8 & 0xF) > 0xF);
-    set_bits(&cpu->f, CpuFlag_C, (cpu->sp & 0xFF) + offset_u8 > 0xFF);
-
-    cpu->sp += offset;
-    cpu->cycle_count += 2;
-}
-
-static inline void Cpu_instr_ldh_a_n16(Cpu *const cpu, const Memory *const mem)
-{
-    const u8 offset = Cpu_read_pc(cpu, mem);
-    log_trace("ldh a, [$%02X]", offset);
-
-    const u16 addr = 0xFF00 + offset;
-    cpu->a = Cpu_read_mem(cpu, mem, addr);
-}
-
-static inline void Cpu_instr_ld_hl_sp_plus_e8(Cpu *const cpu,
-                                              const Memory *const mem)
-{
-    const u8 offset_u8 = (i8)Cpu_read_pc(cpu, mem);
-    const i8 offset = (i8)offset_u8;
-    log_trace("ld hl, sp%+d", offset);
-
-    set_bits(&cpu->f, CpuFlag_Z, false);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, (cpu->sp & 0xF) + (offset_u8 & 0xF) > 0xF);
-    set_bits(&cpu->f, CpuFlag_C, (cpu->sp & 0xFF) + offset_u8 > 0xFF);
-
-    Cpu_write_rp(cpu, CpuTableRp_HL, cpu->sp + offset);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_ret_cc(Cpu *const cpu, Memory *const mem,
-                                    const u8 y)
-{
-    log_trace("ret cc(%d)", y);
-
-    cpu->cycle_count++;
-    if (Cpu_read_cc(cpu, y)) {
-        cpu->pc = Cpu_stack_pop_u16(cpu, mem);
-        cpu->cycle_count++;
+    goto *labels[opcode];
+    CPU_PREFIX_OPCODES(CPU_PREFIX_DISPATCH_TARGET)
+#else
+    switch (opcode) {
+        CPU_PREFIX_OPCODES(CPU_PREFIX_DISPATCH_CASE)
+    default:
+        BAIL("unreachable");
     }
+#endif
 }
 
-static inline void Cpu_instr_pop_r16(Cpu *const cpu, Memory *const mem,
-                                     const u8 p)
+static inline void Cpu_instr_prefix(Cpu *const cpu, Memory *const mem,
+                                    const u8 opcode)
 {
-    log_trace("pop rp2(%d)", p);
-
-    const u16 value = Cpu_stack_pop_u16(cpu, mem);
-    Cpu_write_rp2(cpu, p, value);
-}
-
-static inline void Cpu_instr_ret(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ret");
-
-    cpu->pc = Cpu_stack_pop_u16(cpu, mem);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_reti(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("reti");
-
-    cpu->ime = true;
-    cpu->pc = Cpu_stack_pop_u16(cpu, mem);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_jp_hl(Cpu *const cpu)
-{
-    log_trace("jp hl");
-
-    cpu->pc = Cpu_read_rp(cpu, CpuTableRp_HL);
-}
-
-static inline void Cpu_instr_ld_sp_hl(Cpu *const cpu)
-{
-    log_trace("ld sp, hl");
-
-    cpu->sp = Cpu_read_rp(cpu, CpuTableRp_HL);
-    cpu->cycle_count++;
-}
-
-static inline void Cpu_instr_ldh_c_a(Cpu *const cpu, Memory *const mem)
-{
-    log_trace("ldh [c], a");
-
-    const u16 addr = 0xFF00 + cpu->c;
-    Cpu_write_mem(cpu, mem, addr, cpu->a);
-}
-
-static inline void Cpu_instr_ld_a16_a(Cpu *const cpu, Memory *const mem)
-{
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("ld [$%04X], a", addr);
-
-    Cpu_write_mem(cpu, mem, addr, cpu->a);
-}
-
-static inline void Cpu_instr_ldh_a_c(Cpu *const cpu, const Memory *const mem)
-{
-    const u16 addr = 0xFF00 + cpu->c;
-    log_trace("ld a, [c]");
-
-    cpu->a = Cpu_read_mem(cpu, mem, addr);
-}
-
-static inline void Cpu_instr_ld_a_a16(Cpu *const cpu, const Memory *const mem)
-{
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("ld a, [$%04X]", addr);
+    log_trace("{prefix} $%02X", opcode);
+    log_trace("    prefixed (opcode = $%02X)", opcode);
 
-    cpu->a = Cpu_read_mem(cpu, mem, addr);
+    Cpu_execute_prefix(cpu, mem, opcode);
 }
 
-static inline void Cpu_instr_jp_cc_a16(Cpu *const cpu, const Memory *const mem,
-                                       const u8 y)
+void CPU_EXECUTE(Cpu *const cpu, Memory *const mem, const u8 opcode)
 {
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("jp cc(%d), $%04X", y, addr);
+#if CPU_COMPUTED_GOTO
+    static const void *const labels[256] = {CPU_OPCODES(CPU_DISPATCH_LABEL)};
 
-    if (Cpu_read_cc(cpu, y)) {
-        cpu->pc = addr;
-        cpu->cycle_count++;
+    goto *labels[opcode];
+    CPU_OPCODES(CPU_DISPATCH_TARGET)
+#else
+    switch (opcode) {
+        CPU_OPCODES(CPU_DISPATCH_CASE)
+    default:
+        BAIL("unreachable");
     }
+#endif
 }
 
-static inline void Cpu_instr_jp_a16(Cpu *const cpu, const Memory *const mem)
-{
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("jp $%04X", addr);
+#if CPU_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
 
-    cpu->pc = addr;
-    cpu->cycle_count++;
-}
+#if !CPU_FLAT
 
-static inline void Cpu_instr_di(Cpu *const cpu)
+void CPU_INTERRUPT(Cpu *const cpu, Memory *const mem,
+                   const u8 handler_location)
 {
-    log_trace("di");
+    // Two wait states, then pc gets pushed like by call
+    Cpu_bus_cycle(cpu);
+    Cpu_bus_cycle(cpu);
+    Cpu_bus_push_u16(cpu, mem, cpu->pc);
 
     cpu->ime = false;
-    cpu->queued_ime = false;
+    cpu->pc = handler_location;
 }
 
-static inline void Cpu_instr_ei(Cpu *const cpu)
-{
-    log_trace("ei");
+#endif
 
-    cpu->queued_ime = true;
-}
+#if CPU_ACCURATE
 
-static inline void Cpu_instr_call_cc_n16(Cpu *const cpu, Memory *const mem,
-                                         const u8 y)
+void Cpu_tick_accurate(Cpu *const self, Memory *const mem)
 {
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("call cc(%d), $%04X", y, addr);
-
-    if (Cpu_read_cc(cpu, y)) {
-        Cpu_stack_push_u16(cpu, mem, cpu->pc);
-        cpu->pc = addr;
+    if (self->mode != CpuMode_Running) {
+        Cpu_bus_cycle(self);
+        return;
     }
-}
-
-static inline void Cpu_instr_push_r16(Cpu *const cpu, Memory *const mem,
-                                      const u8 p)
-{
-    log_trace("push rp2(%d)", p);
 
-    const u16 value = Cpu_read_rp2(cpu, p);
-    Cpu_stack_push_u16(cpu, mem, value);
-}
-
-static inline void Cpu_instr_call_n16(Cpu *const cpu, Memory *const mem)
-{
-    const u16 addr = Cpu_read_pc_u16(cpu, mem);
-    log_trace("call $%04X", addr);
-
-    Cpu_stack_push_u16(cpu, mem, cpu->pc);
-    cpu->pc = addr;
-}
-
-static inline void Cpu_instr_alu_a_a8(Cpu *const cpu, Memory *const mem,
-                                      const u8 y)
-{
-    const u8 rhs = Cpu_read_pc(cpu, mem);
-    log_trace("{alu} a, $%02X", rhs);
-
-    Cpu_instr_alu(cpu, y, rhs);
-}
-
-static inline void Cpu_instr_rst_vec(Cpu *const cpu, Memory *const mem,
-                                     const u8 y)
-{
-    log_trace("rst $%02X", y * 8);
-
-    Cpu_stack_push_u16(cpu, mem, cpu->pc);
-    cpu->pc = y * 8;
-}
-
-static inline void Cpu_instr_rlc_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 z)
-{
-    log_trace("rlc r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 bit_7 = (value & 0x80) != 0;
-    const u8 new_value = (value << 1) | bit_7;
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_7);
-}
-
-static inline void Cpu_instr_rrc_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 z)
-{
-    log_trace("rrc r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 bit_0 = value & 1;
-    const u8 new_value = (value >> 1) | (bit_0 << 7);
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_0);
-}
-
-static inline void Cpu_instr_rl_r8(Cpu *const cpu, Memory *const mem,
-                                   const u8 z)
-{
-    log_trace("rl r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 prev_carry = (cpu->f & CpuFlag_C) != 0;
-    const u8 new_carry = (value & 0x80) != 0;
-
-    const u8 new_value = (value << 1) | prev_carry;
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, new_carry);
-}
-
-static inline void Cpu_instr_rr_r8(Cpu *const cpu, Memory *const mem,
-                                   const u8 z)
-{
-    log_trace("rr r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 prev_carry = (cpu->f & CpuFlag_C) != 0;
-    const u8 new_carry = value & 1;
-
-    const u8 new_value = (value >> 1) | (prev_carry << 7);
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, new_carry);
-}
-
-static inline void Cpu_instr_sla_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 z)
-{
-    log_trace("sla r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 bit_7 = (value & 0x80) != 0;
-    const u8 new_value = value << 1;
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_7);
-}
-
-static inline void Cpu_instr_sra_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 z)
-{
-    log_trace("sra r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 bit_0 = value & 1;
-    const u8 bit_7 = (value & 0x80) != 0;
-    const u8 new_value = (value >> 1) | (bit_7 << 7);
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_0);
-}
-
-static inline void Cpu_instr_swap_r8(Cpu *const cpu, Memory *const mem,
-                                     const u8 z)
-{
-    log_trace("swap r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 prev_hi = value >> 4;
-    const u8 prev_lo = value & 0xF;
-    const u8 new_value = (prev_lo << 4) | prev_hi;
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, false);
-}
-
-static inline void Cpu_instr_srl_r8(Cpu *const cpu, Memory *const mem,
-                                    const u8 z)
-{
-    log_trace("srl r(%d)", z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    const u8 bit_0 = value & 1;
-    const u8 new_value = value >> 1;
-    Cpu_write_r(cpu, mem, z, new_value);
-
-    set_bits(&cpu->f, CpuFlag_Z, new_value == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, false);
-    set_bits(&cpu->f, CpuFlag_C, bit_0);
-}
-
-static inline void Cpu_instr_bit_u3_r8(Cpu *const cpu, Memory *const mem,
-                                       const u8 y, const u8 z)
-{
-    log_trace("bit %d,r(%d)", y, z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    set_bits(&cpu->f, CpuFlag_Z, (value & (1 << y)) == 0);
-    set_bits(&cpu->f, CpuFlag_N, false);
-    set_bits(&cpu->f, CpuFlag_H, true);
-}
-
-static inline void Cpu_instr_res_u3_r8(Cpu *const cpu, Memory *const mem,
-                                       const u8 y, const u8 z)
-{
-    log_trace("res %d,r(%d)", y, z);
+    if (self->queued_ime) {
+        self->ime = true;
+        self->queued_ime = false;
+    }
 
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    Cpu_write_r(cpu, mem, z, value & ~(1 << y));
+    const u8 opcode = Cpu_bus_read_pc(self, mem);
+    Cpu_execute_accurate(self, mem, opcode);
 }
 
-static inline void Cpu_instr_set_u3_r8(Cpu *const cpu, Memory *const mem,
-                                       const u8 y, const u8 z)
-{
-    log_trace("set %d,r(%d)", y, z);
-
-    const u8 value = Cpu_read_r(cpu, mem, z);
-    Cpu_write_r(cpu, mem, z, value | (1 << y));
-}
+#elif CPU_FLAT
 
-static inline void Cpu_instr_prefix(Cpu *const cpu, Memory *const mem)
+void Cpu_tick_flat(Cpu *const self, u8 *const ram)
 {
-    const u8 opcode = Cpu_read_pc(cpu, mem);
-    log_trace("{prefix} $%02X", opcode);
-    log_trace("    prefixed (opcode = $%02X)", opcode);
+    if (self->mode != CpuMode_Running) {
+        Cpu_bus_cycle(self);
+        return;
+    }
 
-    const u8 x = opcode >> 6;
-    const u8 y = (opcode >> 3) & 0b111;
-    const u8 z = opcode & 0b111;
-
-    // clang-format off
-    switch (x) {
-        case 0:
-            switch (y) {
-                case 0: Cpu_instr_rlc_r8(cpu, mem, z); break;
-                case 1: Cpu_instr_rrc_r8(cpu, mem, z); break;
-                case 2: Cpu_instr_rl_r8(cpu, mem, z); break;
-                case 3: Cpu_instr_rr_r8(cpu, mem, z); break;
-                case 4: Cpu_instr_sla_r8(cpu, mem, z); break;
-                case 5: Cpu_instr_sra_r8(cpu, mem, z); break;
-                case 6: Cpu_instr_swap_r8(cpu, mem, z); break;
-                case 7: Cpu_instr_srl_r8(cpu, mem, z); break;
-                default: BAIL("unreachable");
-            }
-            break;
-        case 1: Cpu_instr_bit_u3_r8(cpu, mem, y, z); break;
-        case 2: Cpu_instr_res_u3_r8(cpu, mem, y, z); break;
-        case 3: Cpu_instr_set_u3_r8(cpu, mem, y, z); break;
-        default: BAIL("unreachable");
+    if (self->queued_ime) {
+        self->ime = true;
+        self->queued_ime = false;
     }
-    // clang-format on
-}
 
-// NOLINTNEXTLINE
-void Cpu_execute(Cpu *const cpu, Memory *const mem, const u8 opcode)
-{
-    // Credit:
-    // https://archive.gbdev.io/salvage/decoding_gbz80_opcodes/Decoding%20Gamboy%20Z80%20Opcodes.html
-
-    const u8 x = opcode >> 6;
-    const u8 y = (opcode >> 3) & 0b111;
-    const u8 z = opcode & 0b111;
-    const u8 p = y >> 1;
-    const u8 q = y & 1;
-
-    switch (x) {
-    case 0:
-        switch (z) {
-        case 0:
-            // clang-format off
-                    switch (y) {
-                        case 0: Cpu_instr_nop(); break;
-                        case 1: Cpu_instr_ld_n16_sp(cpu, mem); break;
-                        case 2: Cpu_instr_stop(cpu); break;
-                        case 3: Cpu_instr_jr_e8(cpu, mem); break;
-                        default: Cpu_instr_jr_cc_e8(cpu, mem, y);
-                    }
-            // clang-format on
-            break;
-        case 1:
-            if (q == 0)
-                Cpu_instr_ld_r16_n16(cpu, mem, p);
-            else
-                Cpu_instr_add_hl_r16(cpu, p);
-            break;
-        case 2:
-            if (q == 0) {
-                // clang-format off
-                        switch (p) {
-                            case 0: Cpu_instr_ld_bc_a(cpu, mem); break;
-                            case 1: Cpu_instr_ld_de_a(cpu, mem); break;
-                            case 2: Cpu_instr_ld_hli_a(cpu, mem); break;
-                            case 3: Cpu_instr_ld_hld_a(cpu, mem); break;
-                            default: BAIL("unreachable");
-                        }
-                // clang-format on
-            } else {
-                // clang-format off
-                        switch (p) {
-                            case 0: Cpu_instr_ld_a_bc(cpu, mem); break;
-                            case 1: Cpu_instr_ld_a_de(cpu, mem); break;
-                            case 2: Cpu_instr_ld_a_hli(cpu, mem); break;
-                            case 3: Cpu_instr_ld_a_hld(cpu, mem); break;
-                            default: BAIL("unreachable");
-                        }
-                // clang-format on
-            }
-            break;
-        case 3:
-            if (q == 0)
-                Cpu_instr_inc_r16(cpu, p);
-            else
-                Cpu_instr_dec_r16(cpu, p);
-            break;
-            // clang-format off
-                case 4: Cpu_instr_inc_r8(cpu, mem, y); break;
-                case 5: Cpu_instr_dec_r8(cpu, mem, y); break;
-                case 6: Cpu_instr_ld_r8_n(cpu, mem, y); break;
-            // clang-format on
-        case 7:
-            // clang-format off
-                    switch (y) {
-                        case 0: Cpu_instr_rlca(cpu); break;
-                        case 1: Cpu_instr_rrca(cpu); break;
-                        case 2: Cpu_instr_rla(cpu); break;
-                        case 3: Cpu_instr_rra(cpu); break;
-                        case 4: Cpu_instr_daa(cpu); break;
-                        case 5: Cpu_instr_cpl(cpu); break;
-                        case 6: Cpu_instr_scf(cpu); break;
-                        case 7: Cpu_instr_ccf(cpu); break;
-                        default: BAIL("unreachable");
-                    }
-            // clang-format on
-            break;
-        default:
-            BAIL("unreachable");
-        }
-        break;
-    case 1:
-        if (z == 6 && y == 6)
-            Cpu_instr_halt(cpu);
-        else
-            Cpu_instr_ld_r8_r8(cpu, mem, y, z);
-        break;
-    case 2:
-        Cpu_instr_alu_r8(cpu, mem, y, z);
-        break;
-    case 3:
-        switch (z) {
-        case 0:
-            // clang-format off
-                    switch (y) {
-                        case 4: Cpu_instr_ldh_n16_a(cpu, mem); break;
-                        case 5: Cpu_instr_add_sp_e8(cpu, mem); break;
-                        case 6: Cpu_instr_ldh_a_n16(cpu, mem); break;
-                        case 7: Cpu_instr_ld_hl_sp_plus_e8(cpu, mem); break;
-                        default: Cpu_instr_ret_cc(cpu, mem, y);
-                    }
-            // clang-format on
-            break;
-        case 1:
-            if (q == 0)
-                Cpu_instr_pop_r16(cpu, mem, p);
-            else {
-                // clang-format off
-                        switch (p) {
-                            case 0: Cpu_instr_ret(cpu, mem); break;
-                            case 1: Cpu_instr_reti(cpu, mem); break;
-                            case 2: Cpu_instr_jp_hl(cpu); break;
-                            case 3: Cpu_instr_ld_sp_hl(cpu); break;
-                            default: BAIL("unreachable");
-                        }
-                // clang-format on
-            }
-            break;
-        case 2:
-            // clang-format off
-                    switch (y) {
-                        case 4: Cpu_instr_ldh_c_a(cpu, mem); break;
-                        case 5: Cpu_instr_ld_a16_a(cpu, mem); break;
-                        case 6: Cpu_instr_ldh_a_c(cpu, mem); break;
-                        case 7: Cpu_instr_ld_a_a16(cpu, mem); break;
-                        default: Cpu_instr_jp_cc_a16(cpu, mem, y);
-                    }
-            // clang-format on
-            break;
-        case 3:
-            // clang-format off
-                    switch (y) {
-                        case 0: Cpu_instr_jp_a16(cpu, mem); break;
-                        case 1: Cpu_instr_prefix(cpu, mem); break;
-                        case 6: Cpu_instr_di(cpu); break;
-                        case 7: Cpu_instr_ei(cpu); break;
-                        default: BAIL("removed instruction");
-                    }
-            // clang-format on
-            break;
-        case 4:
-            if (y < 4)
-                Cpu_instr_call_cc_n16(cpu, mem, y);
-            else
-                BAIL("removed instruction");
-            break;
-        case 5:
-            if (q == 0)
-                Cpu_instr_push_r16(cpu, mem, p);
-            else if (p == 0)
-                Cpu_instr_call_n16(cpu, mem);
-            else
-                BAIL("removed instruction");
-            break;
-        case 6:
-            Cpu_instr_alu_a_a8(cpu, mem, y);
-            break;
-        case 7:
-            Cpu_instr_rst_vec(cpu, mem, y);
-            break;
-        default:
-            BAIL("unreachable");
-        }
-        break;
+    Memory mem = {.ctx = ram};
+
+    const u8 opcode = Cpu_bus_read_pc(self, &mem);
+    Cpu_execute_flat(self, &mem, opcode);
+}
+
+#else
+
+CPU_OPCODES(CPU_OPCODE_HANDLER)
+CPU_PREFIX_OPCODES(CPU_PREFIX_OPCODE_HANDLER)
+
+const CpuInstrHandler CPU_OPCODE_HANDLERS[256] = {
+    CPU_OPCODES(CPU_OPCODE_ENTRY)};
+
+const CpuInstrHandler CPU_PREFIX_OPCODE_HANDLERS[256] = {
+    CPU_PREFIX_OPCODES(CPU_PREFIX_OPCODE_ENTRY)};
+
+const u8 CPU_OPCODE_LENGTHS[256] = {CPU_OPCODES(CPU_OPCODE_LENGTH)};
+
+bool Cpu_opcode_ends_block(const u8 opcode)
+{
+    switch (opcode) {
+    case 0x10: // stop
+    case 0x18: // jr e8
+    case 0x20: // jr cc, e8
+    case 0x28:
+    case 0x30:
+    case 0x38:
+    case 0x76: // halt
+    case 0xC0: // ret cc
+    case 0xC8:
+    case 0xD0:
+    case 0xD8:
+    case 0xC2: // jp cc, a16
+    case 0xCA:
+    case 0xD2:
+    case 0xDA:
+    case 0xC3: // jp a16
+    case 0xC4: // call cc, a16
+    case 0xCC:
+    case 0xD4:
+    case 0xDC:
+    case 0xC9: // ret
+    case 0xD9: // reti
+    case 0xCD: // call a16
+    case 0xE9: // jp hl
+    case 0xC7: // rst vec
+    case 0xCF:
+    case 0xD7:
+    case 0xDF:
+    case 0xE7:
+    case 0xEF:
+    case 0xF7:
+    case 0xFF:
+        return true;
     default:
-        BAIL("unreachable");
+        return false;
     }
 }
+
+#endif
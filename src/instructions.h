@@ -4,6 +4,74 @@
 #include "cpu.h"
 #include "stdinc.h"
 
+/**
+ * A single opcode's instruction, with its operands already decoded.
+ *
+ * Handlers run after the whole instruction has been fetched: pc must already
+ * point past it, and imm holds its immediate operand (if any).
+ */
+typedef void (*CpuInstrHandler)(Cpu *cpu, Memory *mem, u16 imm);
+
+/**
+ * Handlers for every unprefixed opcode, indexed by opcode.
+ */
+extern const CpuInstrHandler CPU_OPCODE_HANDLERS[256];
+
+/**
+ * Handlers for every $CB-prefixed opcode, indexed by the byte following $CB.
+ */
+extern const CpuInstrHandler CPU_PREFIX_OPCODE_HANDLERS[256];
+
+/**
+ * Full length in bytes of every unprefixed instruction, indexed by opcode. The
+ * $CB entry covers the whole prefixed instruction, and removed opcodes have a
+ * length of 0.
+ */
+extern const u8 CPU_OPCODE_LENGTHS[256];
+
+/**
+ * \brief Executes a single instruction whose opcode has already been fetched.
+ *
+ * \param cpu the Cpu to execute the instruction on.
+ * \param mem the memory the Cpu is attached to.
+ * \param opcode the fetched opcode.
+ */
 void Cpu_execute(Cpu *cpu, Memory *mem, u8 opcode);
 
+/**
+ * \brief Executes a single instruction whose opcode has already been fetched,
+ * in the accurate tier.
+ *
+ * \param cpu the Cpu to execute the instruction on. Its on_cycle must not be
+ * NULL.
+ * \param mem the memory the Cpu is attached to.
+ * \param opcode the fetched opcode.
+ *
+ * \sa Cpu_execute, Cpu_tick_accurate
+ */
+void Cpu_execute_accurate(Cpu *cpu, Memory *mem, u8 opcode);
+
+/**
+ * \brief Executes a single instruction whose opcode has already been fetched,
+ * on a flat address space.
+ *
+ * \param cpu the Cpu to execute the instruction on.
+ * \param mem a Memory whose ctx is the whole address space, as a u8 array of
+ * CPU_FLAT_MEMORY_LEN bytes. Its callbacks are never called.
+ * \param opcode the fetched opcode.
+ *
+ * \sa Cpu_execute, Cpu_tick_flat
+ */
+void Cpu_execute_flat(Cpu *cpu, Memory *mem, u8 opcode);
+
+/**
+ * \brief Checks whether an instruction may transfer control somewhere other
+ * than the next instruction, or otherwise stop execution.
+ *
+ * \param opcode the opcode of the instruction.
+ *
+ * \return whether the instruction should end a basic block.
+ */
+[[nodiscard]] bool Cpu_opcode_ends_block(u8 opcode);
+
 #endif
@@ -0,0 +1,8 @@
+/*
+ * The accurate tier of the interpreter, built from the same source as the fast
+ * tier (see cpu_bus.h).
+ */
+
+#define CPU_ACCURATE 1
+
+#include "instructions.c"
@@ -0,0 +1,8 @@
+/*
+ * The interpreter on a flat address space, built from the same source as the
+ * fast tier (see cpu_bus.h).
+ */
+
+#define CPU_FLAT 1
+
+#include "instructions.c"
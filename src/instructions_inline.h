@@ -0,0 +1,770 @@
+#ifndef GEMU_INSTRUCTIONS_INLINE_H
+#define GEMU_INSTRUCTIONS_INLINE_H
+
+/*
+ * Definitions of every instruction, shared by the interpreter's dispatch in
+ * instructions.c and by C code generated by gemu-aot, so that both execute
+ * exactly the same operations.
+ *
+ * Every definition expects pc to already point past the instruction, and its
+ * immediate operand (if any) to have been fetched. Every cycle is spent
+ * through cpu_bus.h, so the same definitions serve both accuracy tiers.
+ */
+
+#include "cpu.h"
+#include "cpu_bus.h"
+#include "log.h"
+#include "macros.h"
+#include "num.h"
+#include "stdinc.h"
+
+static inline void Cpu_instr_add_u8(Cpu *const cpu, const u8 rhs)
+{
+    const u16 result = (u16)cpu->a + rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Add, cpu->a, rhs, result);
+    cpu->a = (u8)result;
+}
+
+static inline void Cpu_instr_adc_u8(Cpu *const cpu, const u8 rhs)
+{
+    const u8 carry = Cpu_read_flag_c(cpu);
+    const u16 result = (u16)cpu->a + rhs + carry;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Add, cpu->a, rhs, result);
+    cpu->a = (u8)result;
+}
+
+static inline void Cpu_instr_sub_u8(Cpu *const cpu, const u8 rhs)
+{
+    // Borrowing wraps the result around, which sets bit 8 just like a carry
+    const u16 result = (u16)cpu->a - rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Sub, cpu->a, rhs, result);
+    cpu->a = (u8)result;
+}
+
+static inline void Cpu_instr_sbc_u8(Cpu *const cpu, const u8 rhs)
+{
+    const u8 borrow = Cpu_read_flag_c(cpu);
+    const u16 result = (u16)cpu->a - rhs - borrow;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Sub, cpu->a, rhs, result);
+    cpu->a = (u8)result;
+}
+
+static inline void Cpu_instr_and_u8(Cpu *const cpu, const u8 rhs)
+{
+    cpu->a &= rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_And, 0, 0, cpu->a);
+}
+
+static inline void Cpu_instr_xor_u8(Cpu *const cpu, const u8 rhs)
+{
+    cpu->a ^= rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, cpu->a);
+}
+
+static inline void Cpu_instr_or_u8(Cpu *const cpu, const u8 rhs)
+{
+    cpu->a |= rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, cpu->a);
+}
+
+static inline void Cpu_instr_cp_u8(Cpu *const cpu, const u8 rhs)
+{
+    const u16 result = (u16)cpu->a - rhs;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Sub, cpu->a, rhs, result);
+}
+
+static inline void Cpu_instr_alu(Cpu *const cpu, const CpuTableAlu alu,
+                                 const u8 rhs)
+{
+    // clang-format off
+    switch (alu) {
+        case CpuTableAlu_Add: Cpu_instr_add_u8(cpu, rhs); break;
+        case CpuTableAlu_Adc: Cpu_instr_adc_u8(cpu, rhs); break;
+        case CpuTableAlu_Sub: Cpu_instr_sub_u8(cpu, rhs); break;
+        case CpuTableAlu_Sbc: Cpu_instr_sbc_u8(cpu, rhs); break;
+        case CpuTableAlu_And: Cpu_instr_and_u8(cpu, rhs); break;
+        case CpuTableAlu_Xor: Cpu_instr_xor_u8(cpu, rhs); break;
+        case CpuTableAlu_Or: Cpu_instr_or_u8(cpu, rhs); break;
+        case CpuTableAlu_Cp: Cpu_instr_cp_u8(cpu, rhs); break;
+        default: BAIL("invalid alu: %i", alu);
+    }
+    // clang-format on
+}
+
+static inline void Cpu_instr_nop()
+{
+    log_trace("nop");
+}
+
+static inline void Cpu_instr_ld_n16_sp(Cpu *const cpu, Memory *const mem,
+                                       const u16 addr)
+{
+    log_trace("ld [$%04X], SP", addr);
+
+    Cpu_bus_write_u16(cpu, mem, addr, cpu->sp);
+}
+
+static inline void Cpu_instr_stop(Cpu *const cpu)
+{
+    log_trace("stop");
+    cpu->mode = CpuMode_Stopped;
+
+    log_debug("TODO: implement STOP instruction properly");
+}
+
+static inline void Cpu_instr_jr_e8(Cpu *const cpu, const u8 offset_u8)
+{
+    const i8 offset = (i8)offset_u8;
+    log_trace("jr %i", offset);
+
+    cpu->pc += offset;
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_jr_cc_e8(Cpu *const cpu, const CpuTableCc cc,
+                                      const u8 offset_u8)
+{
+    const i8 offset = (i8)offset_u8;
+    log_trace("jr cc(%i), %i", cc, offset);
+
+    if (Cpu_read_cc(cpu, cc)) {
+        cpu->pc += offset;
+        Cpu_bus_cycle(cpu);
+    }
+}
+
+static inline void Cpu_instr_ld_r16_n16(Cpu *const cpu, const u8 p,
+                                        const u16 value)
+{
+    log_trace("ld rp(%d), $%04X", p, value);
+
+    Cpu_write_rp(cpu, p, value);
+}
+
+static inline void Cpu_instr_add_hl_r16(Cpu *const cpu, const u8 p)
+{
+    log_trace("add hl, rp(%d)", p);
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    const u16 rhs = Cpu_read_rp(cpu, p);
+
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl + rhs);
+
+    // Z is kept, so f must be up to date
+    Cpu_materialize_flags(cpu);
+    set_bits(&cpu->f, CpuFlag_N, false);
+    set_bits(&cpu->f, CpuFlag_H, (hl & 0xFFF) + (rhs & 0xFFF) > 0xFFF);
+    set_bits(&cpu->f, CpuFlag_C, rhs > 0xFFFF - hl);
+
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_ld_bc_a(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ld [bc], a");
+
+    const u16 bc = Cpu_read_rp(cpu, CpuTableRp_BC);
+    Cpu_bus_write(cpu, mem, bc, cpu->a);
+}
+
+static inline void Cpu_instr_ld_de_a(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ld [de], a");
+
+    const u16 de = Cpu_read_rp(cpu, CpuTableRp_DE);
+    Cpu_bus_write(cpu, mem, de, cpu->a);
+}
+
+static inline void Cpu_instr_ld_hli_a(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ld [hl+], a");
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    Cpu_bus_write(cpu, mem, hl, cpu->a);
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl + 1);
+}
+
+static inline void Cpu_instr_ld_hld_a(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ld [hl-], a");
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    Cpu_bus_write(cpu, mem, hl, cpu->a);
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl - 1);
+}
+
+static inline void Cpu_instr_ld_a_bc(Cpu *const cpu, const Memory *const mem)
+{
+    log_trace("ld a, [bc]");
+    const u16 bc = Cpu_read_rp(cpu, CpuTableRp_BC);
+    cpu->a = Cpu_bus_read(cpu, mem, bc);
+}
+
+static inline void Cpu_instr_ld_a_de(Cpu *const cpu, const Memory *const mem)
+{
+    log_trace("ld a, [de]");
+
+    const u16 de = Cpu_read_rp(cpu, CpuTableRp_DE);
+    cpu->a = Cpu_bus_read(cpu, mem, de);
+}
+
+static inline void Cpu_instr_ld_a_hli(Cpu *const cpu, const Memory *const mem)
+{
+    log_trace("ld a, [hl+]");
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    cpu->a = Cpu_bus_read(cpu, mem, hl);
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl + 1);
+}
+
+static inline void Cpu_instr_ld_a_hld(Cpu *const cpu, const Memory *const mem)
+{
+    log_trace("ld a, [hl-]");
+
+    const u16 hl = Cpu_read_rp(cpu, CpuTableRp_HL);
+    cpu->a = Cpu_bus_read(cpu, mem, hl);
+    Cpu_write_rp(cpu, CpuTableRp_HL, hl - 1);
+}
+
+static inline void Cpu_instr_inc_r16(Cpu *const cpu, const u8 p)
+{
+    log_trace("inc rp(%d)", p);
+
+    const u16 value = Cpu_read_rp(cpu, p);
+    Cpu_write_rp(cpu, p, value + 1);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_dec_r16(Cpu *const cpu, const u8 p)
+{
+    log_trace("dec rp(%d)", p);
+
+    const u16 value = Cpu_read_rp(cpu, p);
+    Cpu_write_rp(cpu, p, value - 1);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_inc_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 y)
+{
+    log_trace("inc r(%d)", y);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, y);
+    const u8 new_value = value + 1;
+    Cpu_bus_write_r(cpu, mem, y, new_value);
+
+    const u16 carry = Cpu_read_flag_c(cpu) << 8;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Add, value, 1, new_value | carry);
+}
+
+static inline void Cpu_instr_dec_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 y)
+{
+    log_trace("dec r(%d)", y);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, y);
+    const u8 new_value = value - 1;
+    Cpu_bus_write_r(cpu, mem, y, new_value);
+
+    const u16 carry = Cpu_read_flag_c(cpu) << 8;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Sub, value, 1, new_value | carry);
+}
+
+static inline void Cpu_instr_ld_r8_n(Cpu *const cpu, Memory *const mem,
+                                     const u8 y, const u8 value)
+{
+    log_trace("ld r(%d), $%02X", y, value);
+
+    Cpu_bus_write_r(cpu, mem, y, value);
+}
+
+static inline void Cpu_instr_rlca(Cpu *const cpu)
+{
+    log_trace("rlca");
+
+    const u8 bit_7 = (cpu->a & 0x80) != 0;
+    cpu->a = (cpu->a << 1) | bit_7;
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Carry, 0, 0, bit_7 << 8);
+}
+
+static inline void Cpu_instr_rrca(Cpu *const cpu)
+{
+    log_trace("rrca");
+
+    const u8 bit_0 = cpu->a & 1;
+    cpu->a = (cpu->a >> 1) | (bit_0 << 7);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Carry, 0, 0, bit_0 << 8);
+}
+
+static inline void Cpu_instr_rla(Cpu *const cpu)
+{
+    log_trace("rla");
+
+    const u8 prev_carry = Cpu_read_flag_c(cpu);
+    const u8 new_carry = (cpu->a & 0x80) != 0;
+    cpu->a = (cpu->a << 1) | prev_carry;
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Carry, 0, 0, new_carry << 8);
+}
+
+static inline void Cpu_instr_rra(Cpu *const cpu)
+{
+    log_trace("rra");
+
+    const u8 prev_carry = Cpu_read_flag_c(cpu);
+    const u8 new_carry = cpu->a & 1;
+    cpu->a = (cpu->a >> 1) | (prev_carry << 7);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Carry, 0, 0, new_carry << 8);
+}
+
+static inline void Cpu_instr_daa(Cpu *const cpu)
+{
+    log_trace("daa");
+
+    Cpu_materialize_flags(cpu);
+
+    u8 adj = 0;
+
+    if (cpu->f & CpuFlag_N) {
+        if (cpu->f & CpuFlag_H) {
+            adj += 0x06;
+        }
+
+        if (cpu->f & CpuFlag_C) {
+            adj += 0x60;
+        }
+
+        cpu->a -= adj;
+    } else {
+        if (cpu->f & CpuFlag_H || (cpu->a & 0xF) > 0x9) {
+            adj += 0x06;
+        }
+
+        if (cpu->f & CpuFlag_C || cpu->a > 0x99) {
+            adj += 0x60;
+            set_bits(&cpu->f, CpuFlag_C, true);
+        }
+
+        cpu->a += adj;
+    }
+
+    set_bits(&cpu->f, CpuFlag_H, false);
+    set_bits(&cpu->f, CpuFlag_Z, cpu->a == 0);
+}
+
+static inline void Cpu_instr_cpl(Cpu *const cpu)
+{
+    log_trace("cpl");
+
+    cpu->a = ~cpu->a;
+
+    Cpu_materialize_flags(cpu);
+    set_bits(&cpu->f, CpuFlag_N, true);
+    set_bits(&cpu->f, CpuFlag_H, true);
+}
+
+static inline void Cpu_instr_scf(Cpu *const cpu)
+{
+    log_trace("scf");
+
+    Cpu_materialize_flags(cpu);
+    set_bits(&cpu->f, CpuFlag_N, false);
+    set_bits(&cpu->f, CpuFlag_H, false);
+    set_bits(&cpu->f, CpuFlag_C, true);
+}
+
+static inline void Cpu_instr_ccf(Cpu *const cpu)
+{
+    log_trace("ccf");
+
+    Cpu_materialize_flags(cpu);
+    set_bits(&cpu->f, CpuFlag_N, false);
+    set_bits(&cpu->f, CpuFlag_H, false);
+    set_bits(&cpu->f, CpuFlag_C, !(cpu->f & CpuFlag_C));
+}
+
+static inline void Cpu_instr_halt(Cpu *const cpu)
+{
+    log_trace("halt");
+    cpu->mode = CpuMode_Halted;
+}
+
+static inline void Cpu_instr_ld_r8_r8(Cpu *const cpu, Memory *const mem,
+                                      const u8 y, const u8 z)
+{
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    log_trace("ld r(%d), r(%d)", y, z);
+
+    Cpu_bus_write_r(cpu, mem, y, value);
+}
+
+static inline void Cpu_instr_alu_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 y, const u8 z)
+{
+
+    log_trace("{alu} a, r(%d)", z);
+
+    const u8 rhs = Cpu_bus_read_r(cpu, mem, z);
+    Cpu_instr_alu(cpu, y, rhs);
+}
+
+static inline void Cpu_instr_ldh_n16_a(Cpu *const cpu, Memory *const mem,
+                                       const u8 offset)
+{
+    log_trace("ldh [$%02X], a", offset);
+
+    const u16 addr = 0xFF00 + offset;
+    Cpu_bus_write(cpu, mem, addr, cpu->a);
+}
+
+static inline void Cpu_instr_add_sp_e8(Cpu *const cpu, const u8 offset_u8)
+{
+    const i8 offset = (i8)offset_u8;
+    log_trace("add sp, %d", offset);
+
+    const bool half_carry = (cpu->sp & 0xF) + (offset_u8 & 0xF) > 0xF;
+    const bool carry = (cpu->sp & 0xFF) + offset_u8 > 0xFF;
+    Cpu_write_f(cpu, (half_carry ? CpuFlag_H : 0) | (carry ? CpuFlag_C : 0));
+
+    cpu->sp += offset;
+    Cpu_bus_cycle(cpu);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_ldh_a_n16(Cpu *const cpu, const Memory *const mem,
+                                       const u8 offset)
+{
+    log_trace("ldh a, [$%02X]", offset);
+
+    const u16 addr = 0xFF00 + offset;
+    cpu->a = Cpu_bus_read(cpu, mem, addr);
+}
+
+static inline void Cpu_instr_ld_hl_sp_plus_e8(Cpu *const cpu,
+                                              const u8 offset_u8)
+{
+    const i8 offset = (i8)offset_u8;
+    log_trace("ld hl, sp%+d", offset);
+
+    const bool half_carry = (cpu->sp & 0xF) + (offset_u8 & 0xF) > 0xF;
+    const bool carry = (cpu->sp & 0xFF) + offset_u8 > 0xFF;
+    Cpu_write_f(cpu, (half_carry ? CpuFlag_H : 0) | (carry ? CpuFlag_C : 0));
+
+    Cpu_write_rp(cpu, CpuTableRp_HL, cpu->sp + offset);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_ret_cc(Cpu *const cpu, Memory *const mem,
+                                    const u8 y)
+{
+    log_trace("ret cc(%d)", y);
+
+    Cpu_bus_cycle(cpu);
+    if (Cpu_read_cc(cpu, y)) {
+        cpu->pc = Cpu_bus_pop_u16(cpu, mem);
+        Cpu_bus_cycle(cpu);
+    }
+}
+
+static inline void Cpu_instr_pop_r16(Cpu *const cpu, Memory *const mem,
+                                     const u8 p)
+{
+    log_trace("pop rp2(%d)", p);
+
+    const u16 value = Cpu_bus_pop_u16(cpu, mem);
+    Cpu_write_rp2(cpu, p, value);
+}
+
+static inline void Cpu_instr_ret(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ret");
+
+    cpu->pc = Cpu_bus_pop_u16(cpu, mem);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_reti(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("reti");
+
+    cpu->ime = true;
+    cpu->pc = Cpu_bus_pop_u16(cpu, mem);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_jp_hl(Cpu *const cpu)
+{
+    log_trace("jp hl");
+
+    cpu->pc = Cpu_read_rp(cpu, CpuTableRp_HL);
+}
+
+static inline void Cpu_instr_ld_sp_hl(Cpu *const cpu)
+{
+    log_trace("ld sp, hl");
+
+    cpu->sp = Cpu_read_rp(cpu, CpuTableRp_HL);
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_ldh_c_a(Cpu *const cpu, Memory *const mem)
+{
+    log_trace("ldh [c], a");
+
+    const u16 addr = 0xFF00 + cpu->c;
+    Cpu_bus_write(cpu, mem, addr, cpu->a);
+}
+
+static inline void Cpu_instr_ld_a16_a(Cpu *const cpu, Memory *const mem,
+                                      const u16 addr)
+{
+    log_trace("ld [$%04X], a", addr);
+
+    Cpu_bus_write(cpu, mem, addr, cpu->a);
+}
+
+static inline void Cpu_instr_ldh_a_c(Cpu *const cpu, const Memory *const mem)
+{
+    const u16 addr = 0xFF00 + cpu->c;
+    log_trace("ld a, [c]");
+
+    cpu->a = Cpu_bus_read(cpu, mem, addr);
+}
+
+static inline void Cpu_instr_ld_a_a16(Cpu *const cpu, const Memory *const mem,
+                                      const u16 addr)
+{
+    log_trace("ld a, [$%04X]", addr);
+
+    cpu->a = Cpu_bus_read(cpu, mem, addr);
+}
+
+static inline void Cpu_instr_jp_cc_a16(Cpu *const cpu, const u8 y,
+                                       const u16 addr)
+{
+    log_trace("jp cc(%d), $%04X", y, addr);
+
+    if (Cpu_read_cc(cpu, y)) {
+        cpu->pc = addr;
+        Cpu_bus_cycle(cpu);
+    }
+}
+
+static inline void Cpu_instr_jp_a16(Cpu *const cpu, const u16 addr)
+{
+    log_trace("jp $%04X", addr);
+
+    cpu->pc = addr;
+    Cpu_bus_cycle(cpu);
+}
+
+static inline void Cpu_instr_di(Cpu *const cpu)
+{
+    log_trace("di");
+
+    cpu->ime = false;
+    cpu->queued_ime = false;
+}
+
+static inline void Cpu_instr_ei(Cpu *const cpu)
+{
+    log_trace("ei");
+
+    cpu->queued_ime = true;
+}
+
+static inline void Cpu_instr_call_cc_n16(Cpu *const cpu, Memory *const mem,
+                                         const u8 y, const u16 addr)
+{
+    log_trace("call cc(%d), $%04X", y, addr);
+
+    if (Cpu_read_cc(cpu, y)) {
+        Cpu_bus_push_u16(cpu, mem, cpu->pc);
+        cpu->pc = addr;
+    }
+}
+
+static inline void Cpu_instr_push_r16(Cpu *const cpu, Memory *const mem,
+                                      const u8 p)
+{
+    log_trace("push rp2(%d)", p);
+
+    const u16 value = Cpu_read_rp2(cpu, p);
+    Cpu_bus_push_u16(cpu, mem, value);
+}
+
+static inline void Cpu_instr_call_n16(Cpu *const cpu, Memory *const mem,
+                                      const u16 addr)
+{
+    log_trace("call $%04X", addr);
+
+    Cpu_bus_push_u16(cpu, mem, cpu->pc);
+    cpu->pc = addr;
+}
+
+static inline void Cpu_instr_alu_a_a8(Cpu *const cpu, const u8 y,
+                                      const u8 rhs)
+{
+    log_trace("{alu} a, $%02X", rhs);
+
+    Cpu_instr_alu(cpu, y, rhs);
+}
+
+static inline void Cpu_instr_rst_vec(Cpu *const cpu, Memory *const mem,
+                                     const u8 vec)
+{
+    log_trace("rst $%02X", vec);
+
+    Cpu_bus_push_u16(cpu, mem, cpu->pc);
+    cpu->pc = vec;
+}
+
+static inline void Cpu_instr_removed(const u8 opcode)
+{
+    BAIL("removed instruction ($%02X)", opcode);
+}
+
+static inline void Cpu_instr_rlc_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 z)
+{
+    log_trace("rlc r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 bit_7 = (value & 0x80) != 0;
+    const u8 new_value = (value << 1) | bit_7;
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value | (bit_7 << 8));
+}
+
+static inline void Cpu_instr_rrc_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 z)
+{
+    log_trace("rrc r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 bit_0 = value & 1;
+    const u8 new_value = (value >> 1) | (bit_0 << 7);
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value | (bit_0 << 8));
+}
+
+static inline void Cpu_instr_rl_r8(Cpu *const cpu, Memory *const mem,
+                                   const u8 z)
+{
+    log_trace("rl r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 prev_carry = Cpu_read_flag_c(cpu);
+    const u8 new_carry = (value & 0x80) != 0;
+
+    const u8 new_value = (value << 1) | prev_carry;
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0,
+                     new_value | (new_carry << 8));
+}
+
+static inline void Cpu_instr_rr_r8(Cpu *const cpu, Memory *const mem,
+                                   const u8 z)
+{
+    log_trace("rr r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 prev_carry = Cpu_read_flag_c(cpu);
+    const u8 new_carry = value & 1;
+
+    const u8 new_value = (value >> 1) | (prev_carry << 7);
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0,
+                     new_value | (new_carry << 8));
+}
+
+static inline void Cpu_instr_sla_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 z)
+{
+    log_trace("sla r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 bit_7 = (value & 0x80) != 0;
+    const u8 new_value = value << 1;
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value | (bit_7 << 8));
+}
+
+static inline void Cpu_instr_sra_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 z)
+{
+    log_trace("sra r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 bit_0 = value & 1;
+    const u8 bit_7 = (value & 0x80) != 0;
+    const u8 new_value = (value >> 1) | (bit_7 << 7);
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value | (bit_0 << 8));
+}
+
+static inline void Cpu_instr_swap_r8(Cpu *const cpu, Memory *const mem,
+                                     const u8 z)
+{
+    log_trace("swap r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 prev_hi = value >> 4;
+    const u8 prev_lo = value & 0xF;
+    const u8 new_value = (prev_lo << 4) | prev_hi;
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value);
+}
+
+static inline void Cpu_instr_srl_r8(Cpu *const cpu, Memory *const mem,
+                                    const u8 z)
+{
+    log_trace("srl r(%d)", z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u8 bit_0 = value & 1;
+    const u8 new_value = value >> 1;
+    Cpu_bus_write_r(cpu, mem, z, new_value);
+
+    Cpu_set_flags_op(cpu, CpuFlagsOp_Result, 0, 0, new_value | (bit_0 << 8));
+}
+
+static inline void Cpu_instr_bit_u3_r8(Cpu *const cpu, Memory *const mem,
+                                       const u8 y, const u8 z)
+{
+    log_trace("bit %d,r(%d)", y, z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    const u16 carry = Cpu_read_flag_c(cpu) << 8;
+    Cpu_set_flags_op(cpu, CpuFlagsOp_And, 0, 0, (value & (1 << y)) | carry);
+}
+
+static inline void Cpu_instr_res_u3_r8(Cpu *const cpu, Memory *const mem,
+                                       const u8 y, const u8 z)
+{
+    log_trace("res %d,r(%d)", y, z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    Cpu_bus_write_r(cpu, mem, z, value & ~(1 << y));
+}
+
+static inline void Cpu_instr_set_u3_r8(Cpu *const cpu, Memory *const mem,
+                                       const u8 y, const u8 z)
+{
+    log_trace("set %d,r(%d)", y, z);
+
+    const u8 value = Cpu_bus_read_r(cpu, mem, z);
+    Cpu_bus_write_r(cpu, mem, z, value | (1 << y));
+}
+
+#endif
@@ -0,0 +1,1022 @@
+#include "jit.h"
+#include "cpu.h"
+#include "instructions.h"
+#include "log.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+/**
+ * Value of a block entry whose address has not been compiled yet. Offset 0 of
+ * the code buffer holds the entry trampoline, so no block can ever start there.
+ */
+static constexpr u32 BLOCK_NONE = 0;
+
+/**
+ * Value of a block entry whose address is known not to be compilable
+ */
+static constexpr u32 BLOCK_UNCOMPILABLE = 0xFFFFFFFF;
+
+bool Jit_is_supported()
+{
+    return JIT_SUPPORTED;
+}
+
+void Jit_set_cacheable(Jit *const self, const u16 start, const u16 end)
+{
+    for (size_t page = start >> 8; page <= (size_t)(end >> 8); ++page)
+        self->cacheable[page] = true;
+}
+
+/**
+ * \brief Gets the blocks compiled from a code page, allocating them if the
+ * code page has never been mapped before.
+ */
+static JitPage *Jit_code_page(Jit *const self, const size_t id)
+{
+    if (id >= self->code_pages_len) {
+        const size_t len = id + 1 > self->code_pages_len * 2
+                               ? id + 1
+                               : self->code_pages_len * 2;
+
+        self->code_pages =
+            realloc(self->code_pages, len * sizeof(self->code_pages[0]));
+        BAIL_IF_NULL(self->code_pages, "Could not allocate code pages");
+
+        for (size_t i = self->code_pages_len; i < len; ++i)
+            self->code_pages[i] = nullptr;
+
+        self->code_pages_len = len;
+    }
+
+    if (self->code_pages[id] == nullptr) {
+        // Zeroed blocks are all BLOCK_NONE
+        self->code_pages[id] = calloc(1, sizeof(*self->code_pages[id]));
+        BAIL_IF_NULL(self->code_pages[id], "Could not allocate code page");
+
+        self->code_pages[id]->stamp = ++self->next_stamp;
+    }
+
+    return self->code_pages[id];
+}
+
+void Jit_map(Jit *const self, const u8 first_page, const u8 last_page,
+             const size_t first_id)
+{
+    for (size_t page = first_page; page <= last_page; ++page) {
+        JitPage *const code_page =
+            Jit_code_page(self, first_id + (page - first_page));
+        const JitPage *const mapped_out = self->pages[page];
+
+        if (mapped_out == code_page)
+            continue;
+
+        // The handler doing this may have been called from the very block
+        // being mapped out, which must not run any further
+        if (mapped_out != nullptr && mapped_out->has_code)
+            self->exit_pending = true;
+
+        self->pages[page] = code_page;
+        self->page_stamps[page] = code_page->stamp;
+    }
+}
+
+void Jit_flush(Jit *const self)
+{
+    for (size_t i = 0; i < self->code_pages_len; ++i) {
+        JitPage *const code_page = self->code_pages[i];
+
+        if (code_page != nullptr && code_page->has_code) {
+            memset(code_page->blocks, 0, sizeof(code_page->blocks));
+            memset(code_page->heat, 0, sizeof(code_page->heat));
+            code_page->has_code = false;
+        }
+    }
+
+    self->code_len = self->code_start;
+}
+
+void Jit_invalidate(Jit *const self, const u16 addr)
+{
+    const size_t page = addr >> 8;
+    JitPage *const code_page = self->pages[page];
+
+    if (!code_page->has_code)
+        return;
+
+    memset(code_page->blocks, 0, sizeof(code_page->blocks));
+    memset(code_page->heat, 0, sizeof(code_page->heat));
+    code_page->has_code = false;
+
+    // Blocks chained into the ones dropped bail out once they see this
+    code_page->stamp = ++self->next_stamp;
+    self->page_stamps[page] = code_page->stamp;
+
+    // The write may come from a handler called by compiled code, which must
+    // not run any further if it was compiled from this page
+    self->exit_pending = true;
+}
+
+void Jit_invalidate_range(Jit *const self, const u16 start, const u16 end)
+{
+    for (size_t page = start >> 8; page <= (size_t)(end >> 8); ++page)
+        Jit_invalidate(self, page << 8);
+}
+
+#if JIT_SUPPORTED
+
+/**
+ * Upper bound for the machine code emitted for a single instruction, including
+ * its share of the block's exits
+ */
+static constexpr size_t MAX_INSTR_CODE_LEN = 256;
+
+/**
+ * M-cycles taken by the slowest instruction (call a16), which every fallback
+ * to an instruction handler is assumed to take when bounding a block
+ */
+static constexpr u32 MAX_INSTR_CYCLES = 6;
+
+/*
+ * Guest registers are pinned to r8-r15 for as long as compiled code runs, so
+ * that every instruction on them is a single REX-prefixed byte operation:
+ *
+ *     b: r8    c: r9    d: r10   e: r11
+ *     a: r12   f: r13   h: r14   l: r15
+ *
+ * rbx holds the Cpu, rbp holds the Memory and [rsp] holds the cycle limit.
+ * Those are all callee-saved (or stack), so only the guest registers need to
+ * be spilled around calls into instruction handlers. rax, rcx and rdx are
+ * scratch. sp, pc and cycle_count always live in the Cpu itself.
+ *
+ * Only the low byte of a guest register is meaningful.
+ */
+
+typedef enum : u8 {
+    HostReg_Rax = 0,
+    HostReg_Rcx = 1,
+    HostReg_Rdx = 2,
+    HostReg_Rbx = 3,
+    HostReg_Rsp = 4,
+    HostReg_Rbp = 5,
+    HostReg_Rsi = 6,
+    HostReg_Rdi = 7,
+    HostReg_R8 = 8,
+    HostReg_R9 = 9,
+    HostReg_R10 = 10,
+    HostReg_R11 = 11,
+    HostReg_R12 = 12,
+    HostReg_R13 = 13,
+    HostReg_R14 = 14,
+    HostReg_R15 = 15,
+} HostReg;
+
+typedef enum : u8 {
+    HostCc_E = 0x4,
+    HostCc_Ne = 0x5,
+    HostCc_Ge = 0xD,
+    HostCc_G = 0xF,
+} HostCc;
+
+/**
+ * Host register of every CpuTableR, except for CpuTableR_HL
+ */
+static const HostReg GUEST_R[8] = {
+    HostReg_R8,  HostReg_R9,  HostReg_R10, HostReg_R11,
+    HostReg_R14, HostReg_R15, HostReg_Rax, HostReg_R12,
+};
+
+static constexpr HostReg GUEST_F = HostReg_R13;
+
+static const struct {
+    HostReg reg;
+    size_t offset;
+} GUEST_REGS[8] = {
+    {HostReg_R8, offsetof(Cpu, b)},  {HostReg_R9, offsetof(Cpu, c)},
+    {HostReg_R10, offsetof(Cpu, d)}, {HostReg_R11, offsetof(Cpu, e)},
+    {HostReg_R14, offsetof(Cpu, h)}, {HostReg_R15, offsetof(Cpu, l)},
+    {HostReg_R12, offsetof(Cpu, a)}, {HostReg_R13, offsetof(Cpu, f)},
+};
+
+#define JIT_EMIT(self, ...)                           \
+    Jit_emit_bytes(self, (const u8[]){__VA_ARGS__},   \
+                   sizeof((const u8[]){__VA_ARGS__}))
+
+static void Jit_emit_bytes(Jit *const self, const u8 *const bytes,
+                           const size_t len)
+{
+    memcpy(&self->code[self->code_len], bytes, len);
+    self->code_len += len;
+}
+
+static void Jit_emit_u16(Jit *const self, const u16 value)
+{
+    memcpy(&self->code[self->code_len], &value, sizeof(value));
+    self->code_len += sizeof(value);
+}
+
+static void Jit_emit_u32(Jit *const self, const u32 value)
+{
+    memcpy(&self->code[self->code_len], &value, sizeof(value));
+    self->code_len += sizeof(value);
+}
+
+static void Jit_emit_u64(Jit *const self, const u64 value)
+{
+    memcpy(&self->code[self->code_len], &value, sizeof(value));
+    self->code_len += sizeof(value);
+}
+
+static inline u8 modrm(const u8 mod, const u8 reg, const u8 rm)
+{
+    return (u8)((mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+static inline u8 rex(const u8 reg, const u8 rm)
+{
+    return (u8)(0x40 | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+/**
+ * \brief Emits `op dst8, src8` for one of the `op r/m8, r8` opcodes.
+ */
+static void Jit_emit_op_rr8(Jit *const self, const u8 opcode,
+                            const HostReg dst, const HostReg src)
+{
+    JIT_EMIT(self, rex(src, dst), opcode, modrm(3, src, dst));
+}
+
+/**
+ * \brief Emits `op dst8, imm8` for one of the group 1 (0x80 /digit) opcodes.
+ */
+static void Jit_emit_op_ri8(Jit *const self, const u8 digit, const HostReg dst,
+                            const u8 imm)
+{
+    JIT_EMIT(self, rex(0, dst), 0x80, modrm(3, digit, dst), imm);
+}
+
+/**
+ * \brief Emits a single-operand byte instruction, such as `inc dst8`.
+ */
+static void Jit_emit_op_r8(Jit *const self, const u8 opcode, const u8 digit,
+                           const HostReg dst)
+{
+    JIT_EMIT(self, rex(0, dst), opcode, modrm(3, digit, dst));
+}
+
+static void Jit_emit_mov_ri8(Jit *const self, const HostReg dst, const u8 imm)
+{
+    JIT_EMIT(self, rex(0, dst), 0xB0 + (dst & 7), imm);
+}
+
+/**
+ * \brief Emits an instruction whose memory operand is the Cpu field at offset.
+ */
+static void Jit_emit_op_cpu(Jit *const self, const u8 prefix, const u8 opcode,
+                            const u8 reg, const size_t offset)
+{
+    if (prefix != 0)
+        JIT_EMIT(self, prefix);
+
+    JIT_EMIT(self, opcode, modrm(2, reg, HostReg_Rbx));
+    Jit_emit_u32(self, offset);
+}
+
+static void Jit_emit_store_r8(Jit *const self, const size_t offset,
+                              const HostReg src)
+{
+    Jit_emit_op_cpu(self, rex(src, HostReg_Rbx), 0x88, src, offset);
+}
+
+static void Jit_emit_load_r8(Jit *const self, const HostReg dst,
+                             const size_t offset)
+{
+    Jit_emit_op_cpu(self, rex(dst, HostReg_Rbx), 0x8A, dst, offset);
+}
+
+static void Jit_emit_store_imm16(Jit *const self, const size_t offset,
+                                 const u16 value)
+{
+    Jit_emit_op_cpu(self, 0x66, 0xC7, 0, offset);
+    Jit_emit_u16(self, value);
+}
+
+static void Jit_emit_add_cycles(Jit *const self, const u32 cycles)
+{
+    if (cycles == 0)
+        return;
+
+    Jit_emit_op_cpu(self, 0, 0x81, 0, offsetof(Cpu, cycle_count));
+    Jit_emit_u32(self, cycles);
+}
+
+/**
+ * \brief Emits a jmp whose target is filled in later with Jit_patch.
+ *
+ * \return the offset of the jump's displacement.
+ */
+static size_t Jit_emit_jmp(Jit *const self)
+{
+    JIT_EMIT(self, 0xE9);
+    Jit_emit_u32(self, 0);
+    return self->code_len - 4;
+}
+
+/**
+ * \brief Emits a conditional jump whose target is filled in later with
+ * Jit_patch.
+ *
+ * \return the offset of the jump's displacement.
+ */
+static size_t Jit_emit_jcc(Jit *const self, const HostCc cc)
+{
+    JIT_EMIT(self, 0x0F, 0x80 | cc);
+    Jit_emit_u32(self, 0);
+    return self->code_len - 4;
+}
+
+static void Jit_patch(Jit *const self, const size_t at, const size_t target)
+{
+    const i32 rel = (i32)((i64)target - (i64)(at + 4));
+    memcpy(&self->code[at], &rel, sizeof(rel));
+}
+
+static void Jit_emit_spill(Jit *const self)
+{
+    for (size_t i = 0; i < 8; ++i)
+        Jit_emit_store_r8(self, GUEST_REGS[i].offset, GUEST_REGS[i].reg);
+}
+
+static void Jit_emit_reload(Jit *const self)
+{
+    for (size_t i = 0; i < 8; ++i)
+        Jit_emit_load_r8(self, GUEST_REGS[i].reg, GUEST_REGS[i].offset);
+}
+
+/**
+ * \brief Emits code that converts the host flags left by the last
+ * instruction into the guest's f.
+ *
+ * \param self the Jit.
+ * \param mask which of Z, H and C to take from the host flags.
+ * \param set flags to set unconditionally.
+ * \param keep_c whether to keep the guest's C flag instead of the host's.
+ */
+static void Jit_emit_flags(Jit *const self, const u8 mask, const u8 set,
+                           const bool keep_c)
+{
+    JIT_EMIT(self, 0x9C,             // pushfq
+             0x58,                   // pop rax
+             0x0F, 0xB6, 0xC0,       // movzx eax, al
+             0x48, 0xB9);            // mov rcx, imm64
+    Jit_emit_u64(self, (u64)(uintptr_t)self->eflags_to_flags);
+    JIT_EMIT(self, 0x8A, 0x04, 0x01); // mov al, [rcx + rax]
+
+    const u8 all = CpuFlag_Z | CpuFlag_H | CpuFlag_C;
+
+    if ((mask & all) != all)
+        JIT_EMIT(self, 0x24, mask); // and al, mask
+    if (set != 0)
+        JIT_EMIT(self, 0x0C, set); // or al, set
+
+    if (keep_c) {
+        Jit_emit_op_ri8(self, 4, GUEST_F, CpuFlag_C);
+        Jit_emit_op_rr8(self, 0x08, GUEST_F, HostReg_Rax);
+    } else {
+        Jit_emit_op_rr8(self, 0x88, GUEST_F, HostReg_Rax);
+    }
+}
+
+/**
+ * \brief Emits code that loads the guest's C flag into the host's carry.
+ */
+static void Jit_emit_load_carry(Jit *const self)
+{
+    // bt r13d, 4
+    JIT_EMIT(self, rex(0, GUEST_F), 0x0F, 0xBA, modrm(3, 4, GUEST_F), 4);
+}
+
+static void Jit_emit_alu(Jit *const self, const CpuTableAlu alu,
+                         const bool is_imm, const HostReg src, const u8 imm)
+{
+    // `op r/m8, r8` opcodes and `op r/m8, imm8` digits, indexed by alu
+    static const u8 RR_OPCODES[8] = {0x00, 0x10, 0x28, 0x18,
+                                     0x20, 0x30, 0x08, 0x38};
+    static const u8 RI_DIGITS[8] = {0, 2, 5, 3, 4, 6, 1, 7};
+
+    const HostReg a = GUEST_R[CpuTableR_A];
+
+    if (alu == CpuTableAlu_Adc || alu == CpuTableAlu_Sbc)
+        Jit_emit_load_carry(self);
+
+    if (is_imm)
+        Jit_emit_op_ri8(self, RI_DIGITS[alu], a, imm);
+    else
+        Jit_emit_op_rr8(self, RR_OPCODES[alu], a, src);
+
+    // x86 computes AF exactly like the SM83 computes H for every arithmetic
+    // operation, but leaves it undefined for logical ones
+    switch (alu) {
+    case CpuTableAlu_Add:
+    case CpuTableAlu_Adc:
+        Jit_emit_flags(self, CpuFlag_Z | CpuFlag_H | CpuFlag_C, 0, false);
+        break;
+    case CpuTableAlu_Sub:
+    case CpuTableAlu_Sbc:
+    case CpuTableAlu_Cp:
+        Jit_emit_flags(self, CpuFlag_Z | CpuFlag_H | CpuFlag_C, CpuFlag_N,
+                       false);
+        break;
+    case CpuTableAlu_And:
+        Jit_emit_flags(self, CpuFlag_Z, CpuFlag_H, false);
+        break;
+    case CpuTableAlu_Xor:
+    case CpuTableAlu_Or:
+        Jit_emit_flags(self, CpuFlag_Z, 0, false);
+        break;
+    default:
+        BAIL("invalid alu: %i", alu);
+    }
+}
+
+/**
+ * \brief Emits rlca, rrca, rla or rra, given the digit of the matching x86
+ * rotate.
+ */
+static void Jit_emit_rotate_a(Jit *const self, const u8 digit)
+{
+    if (digit >= 2)
+        Jit_emit_load_carry(self);
+
+    Jit_emit_op_r8(self, 0xD0, digit, GUEST_R[CpuTableR_A]);
+
+    JIT_EMIT(self, 0x0F, 0x92, 0xC0, // setc al
+             0xC0, 0xE0, 4);         // shl al, 4
+    Jit_emit_op_rr8(self, 0x88, GUEST_F, HostReg_Rax);
+}
+
+/**
+ * \brief Emits an exit to a known guest address, which can later be patched
+ * into a direct jump to the block compiled for it.
+ */
+static void Jit_emit_exit(Jit *const self, const u16 target)
+{
+    const size_t site = self->code_len;
+    JIT_EMIT(self, 0xE9, 0, 0, 0, 0); // jmp to the next instruction
+
+    Jit_emit_store_imm16(self, offsetof(Cpu, pc), target);
+
+    // lea rax, [rip - site]
+    JIT_EMIT(self, 0x48, 0x8D, 0x05);
+    Jit_emit_u32(self, (u32)(i32)((i64)site - (i64)(self->code_len + 4)));
+
+    Jit_patch(self, Jit_emit_jmp(self), self->exit_offset + 2);
+}
+
+/**
+ * \brief Emits an exit to wherever the Cpu's pc already points.
+ */
+static void Jit_emit_exit_dynamic(Jit *const self)
+{
+    Jit_patch(self, Jit_emit_jmp(self), self->exit_offset);
+}
+
+static bool opcode_ends_jit_block(const u8 opcode)
+{
+    // di, ei and reti change interrupt state, which Jit_run must look at
+    return Cpu_opcode_ends_block(opcode) || opcode == 0xF3 || opcode == 0xFB;
+}
+
+/**
+ * \brief Emits a call into the interpreter's handler for an instruction.
+ *
+ * Unless the instruction ends the block, also emits a check for writes that
+ * invalidated compiled code (or for code being mapped out), whose jump gets
+ * appended to exits so that it can be patched into an exit later.
+ */
+static void Jit_emit_fallback(Jit *const self, const CpuInstrHandler handler,
+                              const u16 next_pc, const u16 imm,
+                              const bool ends_block, size_t *const exits,
+                              size_t *const exit_count)
+{
+    Jit_emit_store_imm16(self, offsetof(Cpu, pc), next_pc);
+    Jit_emit_spill(self);
+
+    JIT_EMIT(self, 0x48, 0x89, 0xDF, // mov rdi, rbx
+             0x48, 0x89, 0xEE,       // mov rsi, rbp
+             0xBA);                  // mov edx, imm32
+    Jit_emit_u32(self, imm);
+    JIT_EMIT(self, 0x48, 0xB8); // mov rax, imm64
+    Jit_emit_u64(self, (u64)(uintptr_t)handler);
+    JIT_EMIT(self, 0xFF, 0xD0); // call rax
+
+    // Compiled code keeps every flag in f
+    JIT_EMIT(self, 0x48, 0x89, 0xDF, // mov rdi, rbx
+             0x48, 0xB8);            // mov rax, imm64
+    Jit_emit_u64(self, (u64)(uintptr_t)Cpu_materialize_flags);
+    JIT_EMIT(self, 0xFF, 0xD0); // call rax
+
+    Jit_emit_reload(self);
+
+    if (ends_block) {
+        Jit_emit_exit_dynamic(self);
+        return;
+    }
+
+    // The handler may have written to this very block, or mapped it out
+    JIT_EMIT(self, 0x48, 0xB8); // mov rax, imm64
+    Jit_emit_u64(self, (u64)(uintptr_t)&self->exit_pending);
+    JIT_EMIT(self, 0x80, 0x38, 0x00); // cmp byte [rax], 0
+    exits[(*exit_count)++] = Jit_emit_jcc(self, HostCc_Ne);
+}
+
+/**
+ * \brief Emits a conditional jump to a known address, ending the block.
+ */
+static void Jit_emit_branch_cc(Jit *const self, const CpuTableCc cc,
+                               const u16 taken, const u16 not_taken)
+{
+    static const u8 CC_FLAGS[4] = {CpuFlag_Z, CpuFlag_Z, CpuFlag_C, CpuFlag_C};
+
+    // test r13b, flag
+    JIT_EMIT(self, rex(0, GUEST_F), 0xF6, modrm(3, 0, GUEST_F), CC_FLAGS[cc]);
+
+    const bool needs_set = cc == CpuTableCc_Z || cc == CpuTableCc_C;
+    const size_t skip = Jit_emit_jcc(self, needs_set ? HostCc_E : HostCc_Ne);
+
+    Jit_emit_add_cycles(self, 1);
+    Jit_emit_exit(self, taken);
+
+    Jit_patch(self, skip, self->code_len);
+    Jit_emit_exit(self, not_taken);
+}
+
+/**
+ * \brief Emits native code for an instruction, if it has a translation.
+ *
+ * \return the cycles the instruction takes, or 0 if it must fall back to its
+ * handler. Branches are not included.
+ */
+static u32 Jit_emit_native(Jit *const self, const u8 opcode, const u16 imm)
+{
+    const u8 x = opcode >> 6;
+    const u8 y = (opcode >> 3) & 7;
+    const u8 z = opcode & 7;
+    const u8 p = y >> 1;
+
+    const HostReg a = GUEST_R[CpuTableR_A];
+
+    if (x == 0) {
+        switch (z) {
+        case 0:
+            return opcode == 0x00 ? 1 : 0;
+        case 1:
+            // ld rp, n16
+            if (y & 1)
+                return 0;
+            if (p == CpuTableRp_SP) {
+                Jit_emit_store_imm16(self, offsetof(Cpu, sp), imm);
+            } else {
+                Jit_emit_mov_ri8(self, GUEST_R[p * 2], imm >> 8);
+                Jit_emit_mov_ri8(self, GUEST_R[p * 2 + 1], imm & 0xFF);
+            }
+            return 3;
+        case 3:
+            // inc rp / dec rp
+            if (p == CpuTableRp_SP) {
+                Jit_emit_op_cpu(self, 0x66, 0xFF, y & 1, offsetof(Cpu, sp));
+            } else if ((y & 1) == 0) {
+                Jit_emit_op_ri8(self, 0, GUEST_R[p * 2 + 1], 1); // add
+                Jit_emit_op_ri8(self, 2, GUEST_R[p * 2], 0);     // adc
+            } else {
+                Jit_emit_op_ri8(self, 5, GUEST_R[p * 2 + 1], 1); // sub
+                Jit_emit_op_ri8(self, 3, GUEST_R[p * 2], 0);     // sbb
+            }
+            return 2;
+        case 4:
+        case 5:
+            // inc r / dec r
+            if (y == CpuTableR_HL)
+                return 0;
+            Jit_emit_op_r8(self, 0xFE, z - 4, GUEST_R[y]);
+            Jit_emit_flags(self, CpuFlag_Z | CpuFlag_H,
+                           z == 5 ? CpuFlag_N : 0, true);
+            return 1;
+        case 6:
+            // ld r, n8
+            if (y == CpuTableR_HL)
+                return 0;
+            Jit_emit_mov_ri8(self, GUEST_R[y], imm);
+            return 2;
+        case 7:
+            switch (y) {
+            case 0: // rlca
+                Jit_emit_rotate_a(self, 0);
+                return 1;
+            case 1: // rrca
+                Jit_emit_rotate_a(self, 1);
+                return 1;
+            case 2: // rla
+                Jit_emit_rotate_a(self, 2);
+                return 1;
+            case 3: // rra
+                Jit_emit_rotate_a(self, 3);
+                return 1;
+            case 5: // cpl
+                Jit_emit_op_r8(self, 0xF6, 2, a);
+                Jit_emit_op_ri8(self, 1, GUEST_F, CpuFlag_N | CpuFlag_H);
+                return 1;
+            case 6: // scf
+                Jit_emit_op_ri8(self, 4, GUEST_F, CpuFlag_Z);
+                Jit_emit_op_ri8(self, 1, GUEST_F, CpuFlag_C);
+                return 1;
+            case 7: // ccf
+                Jit_emit_op_ri8(self, 4, GUEST_F, CpuFlag_Z | CpuFlag_C);
+                Jit_emit_op_ri8(self, 6, GUEST_F, CpuFlag_C);
+                return 1;
+            default:
+                return 0;
+            }
+        default:
+            return 0;
+        }
+    }
+
+    if (x == 1) {
+        // ld r, r
+        if (y == CpuTableR_HL || z == CpuTableR_HL)
+            return 0;
+        Jit_emit_op_rr8(self, 0x88, GUEST_R[y], GUEST_R[z]);
+        return 1;
+    }
+
+    if (x == 2) {
+        // alu a, r
+        if (z == CpuTableR_HL)
+            return 0;
+        Jit_emit_alu(self, y, false, GUEST_R[z], 0);
+        return 1;
+    }
+
+    if (z == 6) {
+        // alu a, n8
+        Jit_emit_alu(self, y, true, HostReg_Rax, imm);
+        return 2;
+    }
+
+    return 0;
+}
+
+/**
+ * \brief Compiles the block starting at pc.
+ *
+ * \return the offset of the compiled block, or BLOCK_UNCOMPILABLE if not even
+ * one instruction could be compiled.
+ */
+static u32 Jit_compile(Jit *const self, const Memory *const mem, const u16 pc)
+{
+    const size_t max_len = (self->max_block_len + 1) * MAX_INSTR_CODE_LEN;
+
+    if (self->code_len + max_len > JIT_CODE_LEN)
+        Jit_flush(self);
+
+    const size_t page = pc >> 8;
+    const size_t page_end = (page + 1) << 8;
+    const size_t block = self->code_len;
+
+    // Bail out to the caller if this block has gone stale, which blocks
+    // chained into it cannot know about
+    JIT_EMIT(self, 0x48, 0xB8); // mov rax, imm64
+    Jit_emit_u64(self, (u64)(uintptr_t)&self->page_stamps[page]);
+    JIT_EMIT(self, 0x81, 0x38); // cmp dword [rax], imm32
+    Jit_emit_u32(self, self->pages[page]->stamp);
+    const size_t stale = Jit_emit_jcc(self, HostCc_Ne);
+
+    // Bail out to the caller unless the whole block fits in the cycles left.
+    // Its worst case is only known once it has been compiled.
+    JIT_EMIT(self, 0x8B, 0x04, 0x24, // mov eax, [rsp]
+             0x2D);                  // sub eax, imm32
+    const size_t max_cycles_at = self->code_len;
+    Jit_emit_u32(self, 0);
+    Jit_emit_op_cpu(self, 0, 0x39, HostReg_Rax, offsetof(Cpu, cycle_count));
+    const size_t over_budget = Jit_emit_jcc(self, HostCc_G);
+
+    size_t flush_exits[UINT8_MAX];
+    size_t flush_exit_count = 0;
+
+    size_t addr = pc;
+    u32 cycles = 0;
+    u32 max_cycles = 0;
+    bool ended = false;
+
+    for (size_t i = 0; i < self->max_block_len && !ended; ++i) {
+        const u8 opcode = mem->read(mem->ctx, addr);
+        const u8 len = CPU_OPCODE_LENGTHS[opcode];
+
+        if (len == 0 || addr + len > page_end)
+            break;
+
+        u16 imm = 0;
+        if (len >= 2)
+            imm = mem->read(mem->ctx, addr + 1);
+        if (len == 3)
+            imm |= (u16)mem->read(mem->ctx, addr + 2) << 8;
+
+        const u16 next_pc = addr + len;
+        const u8 cc = (opcode >> 3) & 3;
+
+        switch (opcode) {
+        case 0x18: // jr e8
+            Jit_emit_add_cycles(self, cycles + 3);
+            Jit_emit_exit(self, next_pc + (i8)imm);
+            max_cycles += 3;
+            ended = true;
+            break;
+        case 0x20: // jr cc, e8
+        case 0x28:
+        case 0x30:
+        case 0x38:
+            Jit_emit_add_cycles(self, cycles + 2);
+            Jit_emit_branch_cc(self, cc, next_pc + (i8)imm, next_pc);
+            max_cycles += 3;
+            ended = true;
+            break;
+        case 0xC3: // jp a16
+            Jit_emit_add_cycles(self, cycles + 4);
+            Jit_emit_exit(self, imm);
+            max_cycles += 4;
+            ended = true;
+            break;
+        case 0xC2: // jp cc, a16
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+            Jit_emit_add_cycles(self, cycles + 3);
+            Jit_emit_branch_cc(self, cc, imm, next_pc);
+            max_cycles += 4;
+            ended = true;
+            break;
+        default: {
+            const u32 native_cycles = Jit_emit_native(self, opcode, imm);
+
+            if (native_cycles != 0) {
+                cycles += native_cycles;
+                max_cycles += native_cycles;
+                break;
+            }
+
+            max_cycles += MAX_INSTR_CYCLES;
+
+            // Fetching costs one cycle per byte, same as in Cpu_tick
+            Jit_emit_add_cycles(self, cycles + len);
+            cycles = 0;
+
+            ended = opcode_ends_jit_block(opcode);
+            Jit_emit_fallback(self,
+                              opcode == 0xCB ? CPU_PREFIX_OPCODE_HANDLERS[imm]
+                                             : CPU_OPCODE_HANDLERS[opcode],
+                              next_pc, imm, ended, flush_exits,
+                              &flush_exit_count);
+            break;
+        }
+        }
+
+        addr = next_pc;
+    }
+
+    if (addr == pc) {
+        self->code_len = block;
+        return BLOCK_UNCOMPILABLE;
+    }
+
+    if (!ended) {
+        Jit_emit_add_cycles(self, cycles);
+        Jit_emit_exit(self, addr);
+    }
+
+    memcpy(&self->code[max_cycles_at], &max_cycles, sizeof(max_cycles));
+
+    Jit_patch(self, stale, self->code_len);
+    Jit_patch(self, over_budget, self->code_len);
+    Jit_emit_store_imm16(self, offsetof(Cpu, pc), pc);
+    Jit_emit_exit_dynamic(self);
+
+    for (size_t i = 0; i < flush_exit_count; ++i)
+        Jit_patch(self, flush_exits[i], self->exit_offset);
+
+    return block;
+}
+
+/**
+ * \brief Emits the entry trampoline and the shared exit path.
+ */
+static void Jit_emit_trampolines(Jit *const self)
+{
+    // Entry: save callee-saved registers, keeping the stack 16-byte aligned
+    JIT_EMIT(self, 0x53, 0x55,        // push rbx; push rbp
+             0x41, 0x54, 0x41, 0x55,  // push r12; push r13
+             0x41, 0x56, 0x41, 0x57,  // push r14; push r15
+             0x48, 0x83, 0xEC, 0x08,  // sub rsp, 8
+             0x48, 0x89, 0xFB,        // mov rbx, rdi
+             0x48, 0x89, 0xF5,        // mov rbp, rsi
+             0x89, 0x0C, 0x24);       // mov [rsp], ecx
+    Jit_emit_reload(self);
+    JIT_EMIT(self, 0xFF, 0xE2); // jmp rdx
+
+    // Exit: a dynamic exit enters at exit_offset, with no site to chain, and a
+    // static one right after, with the site in rax
+    self->exit_offset = self->code_len;
+    JIT_EMIT(self, 0x31, 0xC0); // xor eax, eax
+    Jit_emit_spill(self);
+    JIT_EMIT(self, 0x48, 0x83, 0xC4, 0x08, // add rsp, 8
+             0x41, 0x5F, 0x41, 0x5E,       // pop r15; pop r14
+             0x41, 0x5D, 0x41, 0x5C,       // pop r13; pop r12
+             0x5D, 0x5B,                   // pop rbp; pop rbx
+             0xC3);                        // ret
+
+    self->code_start = self->code_len;
+}
+
+static void Jit_build_flag_table(Jit *const self)
+{
+    static constexpr u8 EFLAGS_CF = 1 << 0;
+    static constexpr u8 EFLAGS_AF = 1 << 4;
+    static constexpr u8 EFLAGS_ZF = 1 << 6;
+
+    for (size_t i = 0; i < 0x100; ++i) {
+        self->eflags_to_flags[i] = ((i & EFLAGS_ZF) ? CpuFlag_Z : 0) |
+                                   ((i & EFLAGS_AF) ? CpuFlag_H : 0) |
+                                   ((i & EFLAGS_CF) ? CpuFlag_C : 0);
+    }
+}
+
+Jit *Jit_new()
+{
+    void *const code = mmap(nullptr, JIT_CODE_LEN,
+                            PROT_READ | PROT_WRITE | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (code == MAP_FAILED) {
+        log_warn("Could not map executable memory for the JIT");
+        return nullptr;
+    }
+
+    Jit *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate JIT");
+
+    memset(self->cacheable, 0, sizeof(self->cacheable));
+
+    for (size_t page = 0; page < 0x100; ++page)
+        self->pages[page] = nullptr;
+
+    self->code = code;
+    self->code_len = 0;
+    self->code_pages = nullptr;
+    self->code_pages_len = 0;
+    self->next_stamp = 0;
+    self->exit_pending = false;
+    self->end_pending = false;
+    self->hot_threshold = JIT_DEFAULT_HOT_THRESHOLD;
+    self->max_block_len = JIT_DEFAULT_MAX_BLOCK_LEN;
+    self->cycle_budget = JIT_DEFAULT_CYCLE_BUDGET;
+
+    Jit_build_flag_table(self);
+    Jit_emit_trampolines(self);
+    Jit_map(self, 0x00, 0xFF, 0x00);
+
+    // Object to function pointer conversions are not ISO C
+    static_assert(sizeof(self->enter) == sizeof(self->code));
+    memcpy(&self->enter, &self->code, sizeof(self->enter));
+
+    return self;
+}
+
+void Jit_destroy(Jit *const self)
+{
+    if (self == nullptr)
+        return;
+
+    munmap(self->code, JIT_CODE_LEN);
+
+    for (size_t i = 0; i < self->code_pages_len; ++i)
+        free(self->code_pages[i]);
+
+    free(self->code_pages);
+    free(self);
+}
+
+#else
+
+static u32 Jit_compile([[maybe_unused]] Jit *const self,
+                       [[maybe_unused]] const Memory *const mem,
+                       [[maybe_unused]] const u16 pc)
+{
+    return BLOCK_UNCOMPILABLE;
+}
+
+Jit *Jit_new()
+{
+    log_warn("The JIT is not supported on this platform");
+    return nullptr;
+}
+
+void Jit_destroy([[maybe_unused]] Jit *const self) {}
+
+#endif
+
+/**
+ * \brief Looks up the compiled block starting at pc, compiling it if it has
+ * become hot.
+ *
+ * \return the block's code, or nullptr if pc must be interpreted.
+ */
+static const u8 *Jit_lookup(Jit *const self, const Memory *const mem,
+                            const u16 pc)
+{
+    if (!self->cacheable[pc >> 8])
+        return nullptr;
+
+    JitPage *const code_page = self->pages[pc >> 8];
+    const u8 offset = pc & 0xFF;
+    u32 block = code_page->blocks[offset];
+
+    if (block == BLOCK_NONE) {
+        if (code_page->heat[offset] < self->hot_threshold) {
+            ++code_page->heat[offset];
+            return nullptr;
+        }
+
+        block = Jit_compile(self, mem, pc);
+        code_page->blocks[offset] = block;
+        code_page->has_code = true;
+    }
+
+    if (block == BLOCK_UNCOMPILABLE)
+        return nullptr;
+
+    return &self->code[block];
+}
+
+void Jit_end_run(Jit *const self)
+{
+    self->exit_pending = true;
+    self->end_pending = true;
+}
+
+bool Jit_run(Jit *const self, Cpu *const cpu, Memory *const mem,
+             const int max_cycles)
+{
+    const bool ime = cpu->ime;
+    const int cycle_limit =
+        cpu->cycle_count +
+        (max_cycles < self->cycle_budget ? max_cycles : self->cycle_budget);
+
+    bool ran = false;
+    self->end_pending = false;
+
+    while (true) {
+        self->exit_pending = false;
+
+        const u8 *const code = Jit_lookup(self, mem, cpu->pc);
+
+        if (code == nullptr)
+            return ran;
+
+        const int prev_cycle_count = cpu->cycle_count;
+
+        Cpu_materialize_flags(cpu);
+        u8 *const site = self->enter(cpu, mem, code, cycle_limit);
+
+        // The block did not fit in the cycles left, so the caller has to
+        // interpret its first instruction instead
+        if (cpu->cycle_count == prev_cycle_count)
+            return ran;
+
+        ran = true;
+
+        // Chain the exit that was just taken straight into its target
+        if (site != nullptr && !self->exit_pending) {
+            const u32 target =
+                self->pages[cpu->pc >> 8]->blocks[cpu->pc & 0xFF];
+
+            if (target != BLOCK_NONE && target != BLOCK_UNCOMPILABLE) {
+                const size_t at = site - self->code;
+                const i32 rel = (i32)((i64)target - (i64)(at + 5));
+                memcpy(site + 1, &rel, sizeof(rel));
+            }
+        }
+
+        if (cpu->cycle_count >= cycle_limit || cpu->mode != CpuMode_Running ||
+            cpu->queued_ime || cpu->ime != ime || self->end_pending)
+            return true;
+    }
+}
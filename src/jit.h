@@ -0,0 +1,203 @@
+#ifndef GEMU_JIT_H
+#define GEMU_JIT_H
+
+#include "cpu.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Size in bytes of the executable buffer compiled blocks are emitted into
+ */
+constexpr size_t JIT_CODE_LEN = 4 * 1024 * 1024;
+
+/**
+ * Times execution must reach a block start before it gets compiled
+ */
+constexpr u8 JIT_DEFAULT_HOT_THRESHOLD = 16;
+
+/**
+ * Maximum number of instructions compiled into a single block
+ */
+constexpr u8 JIT_DEFAULT_MAX_BLOCK_LEN = 32;
+
+/**
+ * M-cycles Jit_run may execute before handing control back to its caller
+ */
+constexpr int JIT_DEFAULT_CYCLE_BUDGET = 64;
+
+/**
+ * Native entry point into compiled code. Loads the guest registers from cpu,
+ * jumps into code and runs until some block exits.
+ *
+ * Returns the exit site taken if it can be chained into its target block, or
+ * nullptr otherwise.
+ */
+typedef u8 *(*JitEntry)(Cpu *cpu, Memory *mem, const u8 *code,
+                        int cycle_limit);
+
+/**
+ * The blocks compiled from a single code page, keyed by their offset into it.
+ */
+typedef struct {
+    u32 blocks[0x100];
+    u8 heat[0x100];
+    u32 stamp;
+    bool has_code;
+} JitPage;
+
+/**
+ * A dynamic recompiler that translates hot basic blocks of SM83 code into
+ * x86-64 machine code.
+ *
+ * Guest registers live in host registers for as long as execution stays in
+ * compiled code, including across blocks, which jump straight into each other
+ * once both have been compiled. Register-only instructions and jumps with
+ * static targets are translated natively, and everything else (anything that
+ * touches memory, and thus possibly I/O) calls into the interpreter's
+ * instruction handlers.
+ *
+ * Just like DecodeCache, blocks never cross a 256-byte page, and are kept per
+ * code page. Since chained blocks may jump into any page, every block starts
+ * by comparing the stamp of its code page against the one in page_stamps for
+ * the page it was compiled at, which changes whenever that page gets
+ * invalidated or a different code page gets mapped there. That way, only the
+ * blocks of the page involved are dropped, and the ones chained into them
+ * bail out to Jit_run instead.
+ *
+ * \sa Jit_new, Jit_run
+ */
+typedef struct Jit {
+    u8 *code;
+    size_t code_len;
+    size_t code_start;
+    size_t exit_offset;
+    JitEntry enter;
+    JitPage *pages[0x100];
+    u32 page_stamps[0x100];
+    JitPage **code_pages;
+    size_t code_pages_len;
+    u32 next_stamp;
+    bool cacheable[0x100];
+    bool exit_pending;
+    bool end_pending;
+    u8 eflags_to_flags[0x100];
+    u8 hot_threshold;
+    u8 max_block_len;
+    int cycle_budget;
+} Jit;
+
+/**
+ * \brief Checks whether this host can run compiled code at all.
+ *
+ * \return whether Jit_new may succeed.
+ */
+[[nodiscard]] bool Jit_is_supported();
+
+/**
+ * \brief Creates a new, empty Jit, with no cacheable pages.
+ *
+ * Every page of the address space starts out showing the code page with its
+ * own number.
+ *
+ * hot_threshold, max_block_len and cycle_budget may be tuned before the Jit
+ * is first run.
+ *
+ * \return the new Jit, or nullptr if this host cannot run compiled code.
+ *
+ * \sa Jit_destroy, Jit_is_supported
+ */
+[[nodiscard]] Jit *Jit_new();
+
+/**
+ * \brief Destroys a Jit, along with all of its compiled code.
+ *
+ * \param self the Jit to destroy, which may be nullptr.
+ *
+ * \sa Jit_new
+ */
+void Jit_destroy(Jit *self);
+
+/**
+ * \brief Allows code in an address range to be compiled.
+ *
+ * \param self the Jit.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void Jit_set_cacheable(Jit *self, u16 start, u16 end);
+
+/**
+ * \brief Maps code pages into a range of pages of the address space, just
+ * like DecodeCache_map.
+ *
+ * Blocks compiled from the code pages mapped out are kept for when they get
+ * mapped back in. May be called from within instruction handlers.
+ *
+ * \param self the Jit.
+ * \param first_page the first page of the range.
+ * \param last_page the last page of the range (inclusive).
+ * \param first_id the code page to show in first_page.
+ */
+void Jit_map(Jit *self, u8 first_page, u8 last_page, size_t first_id);
+
+/**
+ * \brief Discards every compiled block.
+ *
+ * Must not be called while compiled code is running. Use Jit_invalidate from
+ * within instruction handlers instead.
+ *
+ * \param self the Jit to flush.
+ */
+void Jit_flush(Jit *self);
+
+/**
+ * \brief Notifies the Jit that the byte at an address has been written to.
+ *
+ * Only the blocks compiled from the code page mapped there are discarded.
+ *
+ * \param self the Jit.
+ * \param addr the address that was written to.
+ */
+void Jit_invalidate(Jit *self, u16 addr);
+
+/**
+ * \brief Notifies the Jit that every byte in a range may have changed.
+ *
+ * \param self the Jit.
+ * \param start the first address of the range.
+ * \param end the last address of the range (inclusive).
+ */
+void Jit_invalidate_range(Jit *self, u16 start, u16 end);
+
+/**
+ * \brief Makes Jit_run hand control back to its caller as soon as the
+ * instruction handler currently running returns.
+ *
+ * Meant for accesses whose side effects the caller has to catch up on, like
+ * those to I/O registers. May be called from within instruction handlers, and
+ * does nothing outside of Jit_run.
+ *
+ * \param self the Jit.
+ */
+void Jit_end_run(Jit *self);
+
+/**
+ * \brief Runs compiled code starting at cpu's pc, compiling it first if it
+ * has become hot.
+ *
+ * Keeps going from block to block until cycle_budget M-cycles (or max_cycles,
+ * if fewer) have elapsed, execution reaches code that has not been compiled,
+ * the Cpu halts, stops or changes its interrupt master enable, or Jit_end_run
+ * gets called. Blocks that could take longer than the cycles left are not
+ * entered at all, so max_cycles is never exceeded.
+ *
+ * \param self the Jit.
+ * \param cpu the Cpu to run.
+ * \param mem the memory the Cpu is attached to.
+ * \param max_cycles the most M-cycles to run for.
+ *
+ * \return whether any instruction was executed.
+ */
+[[nodiscard]] bool Jit_run(Jit *self, Cpu *cpu, Memory *mem, int max_cycles);
+
+#endif
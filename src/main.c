@@ -1,6 +1,11 @@
+#include "aot.h"
+#include "cheats.h"
 #include "frontend.h"
 #include "game_boy.h"
+#include "gdb_stub.h"
 #include "log.h"
+#include "rom_image.h"
+#include "save_ram.h"
 #include "sdl.h"
 #include "stdinc.h"
 #include "string.h"
@@ -21,6 +26,7 @@ static const char *const usages[] = {
 static SDL_Window *window = nullptr;
 static SDL_Renderer *renderer = nullptr;
 static State state;
+static SDL_SharedObject *aot_object = nullptr;
 
 static void cleanup()
 {
@@ -28,7 +34,65 @@ static void cleanup()
     SDL_DestroyWindow(window);
     SDL_DestroyTexture(state.screen_texture);
 
+    save_idle_loops(&state.gb);
     GameBoy_destroy(&state.gb);
+    GdbStub_destroy(state.gdb);
+    SDL_UnloadObject(aot_object);
+}
+
+/**
+ * \brief Loads a module generated by gemu-aot and sets it on the GameBoy.
+ *
+ * Failing to load the module is not fatal, since the interpreter can always
+ * run the ROM by itself.
+ */
+static void load_aot_module(const char *const path)
+{
+    aot_object = SDL_LoadObject(path);
+
+    if (aot_object == nullptr) {
+        log_warn("Could not load AOT module: %s", SDL_GetError());
+        return;
+    }
+
+    const AotModuleGetter get_module =
+        (AotModuleGetter)SDL_LoadFunction(aot_object, AOT_MODULE_SYMBOL);
+
+    if (get_module == nullptr) {
+        log_warn("Could not load AOT module: %s", SDL_GetError());
+        return;
+    }
+
+    if (!GameBoy_set_aot_module(&state.gb, get_module()))
+        log_warn("AOT module was not generated from this ROM, ignoring it");
+}
+
+/**
+ * \brief Adds the cheats in a comma-separated list of cheat codes to the
+ * GameBoy.
+ *
+ * Invalid codes are skipped with a warning, so that the others still apply.
+ */
+static void load_cheats(const char *const codes)
+{
+    char *const list = SDL_strdup(codes);
+    SDL_CHECKED(list != nullptr, "Could not copy cheat codes");
+
+    char *saveptr = nullptr;
+
+    for (char *code = SDL_strtok_r(list, ",", &saveptr); code != nullptr;
+         code = SDL_strtok_r(nullptr, ",", &saveptr)) {
+        Cheat cheat;
+
+        if (!Cheat_parse(code, &cheat)) {
+            log_warn("Ignoring invalid cheat code %s", code);
+            continue;
+        }
+
+        GameBoy_add_cheat(&state.gb, &cheat);
+    }
+
+    SDL_free(list);
 }
 
 int main(int argc, const char *argv[])
@@ -37,6 +101,12 @@ int main(int argc, const char *argv[])
 
     const char *boot_rom_path = nullptr;
     const char *log_level_str = nullptr;
+    const char *aot_path = nullptr;
+    const char *cheat_codes = nullptr;
+    int use_jit = 0;
+    int use_accurate = 0;
+    int save_interval_ms = SAVE_RAM_DEFAULT_FLUSH_INTERVAL_MS;
+    int gdb_port = 0;
 
     struct argparse_option options[] = {
         OPT_HELP(),
@@ -45,6 +115,24 @@ int main(int argc, const char *argv[])
         OPT_STRING('l', "log-level", (void *)&log_level_str,
                    "log level (one of trace, debug, info, warn, error)",
                    nullptr, 0, 0),
+        OPT_BOOLEAN('j', "jit", &use_jit,
+                    "compile hot code to native x86-64 code", nullptr, 0, 0),
+        OPT_BOOLEAN(0, "accurate", &use_accurate,
+                    "step everything along with every CPU cycle, for ROMs "
+                    "that need exact timing (ignores --jit and --aot)",
+                    nullptr, 0, 0),
+        OPT_STRING('a', "aot", (void *)&aot_path,
+                   "path to a module generated by gemu-aot for this ROM",
+                   nullptr, 0, 0),
+        OPT_INTEGER(0, "save-interval", &save_interval_ms,
+                    "how often to write battery-backed RAM to the save file, "
+                    "in milliseconds (0 to only write it on exit)",
+                    nullptr, 0, 0),
+        OPT_STRING('c', "cheats", (void *)&cheat_codes,
+                   "comma-separated GameShark or Game Genie codes to apply",
+                   nullptr, 0, 0),
+        OPT_INTEGER(0, "gdb", &gdb_port,
+                    "listen for GDB on a local TCP port", nullptr, 0, 0),
         OPT_END(),
     };
 
@@ -67,11 +155,19 @@ int main(int argc, const char *argv[])
         return 1;
     }
 
+    if (save_interval_ms < 0 || gdb_port < 0 || gdb_port > 0xFFFF) {
+        argparse_usage(&argparse);
+        return 1;
+    }
+
     logger_init(log_level);
 
-    size_t rom_len = 0;
-    u8 *const rom = SDL_LoadFile(argv[0], &rom_len);
-    SDL_CHECKED(rom != nullptr, "Could not read ROM file");
+    RomImage *const rom = RomImage_open(argv[0]);
+
+    if (rom == nullptr) {
+        log_error("Could not read ROM file %s", argv[0]);
+        return 1;
+    }
 
     SDL_CHECKED(SDL_Init(SDL_INIT_VIDEO), "Could not initialize video");
 
@@ -82,7 +178,7 @@ int main(int argc, const char *argv[])
 
     SDL_Texture *const texture = SDL_CreateTexture(
         renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
-        GB_BG_WIDTH, GB_BG_HEIGHT);
+        GB_LCD_WIDTH, GB_LCD_HEIGHT);
     SDL_CHECKED(texture != nullptr, "Could not create texture");
 
     SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
@@ -112,12 +208,39 @@ int main(int argc, const char *argv[])
         .tima_cycle_counter = 0,
         .quit = false,
         .screen_texture = texture,
+        .save_interval_ms = (u32)save_interval_ms,
+        .gdb = nullptr,
     };
 
-    GameBoy_load_rom(&state.gb, rom, rom_len);
+    if (gdb_port != 0) {
+        state.gdb = GdbStub_new();
+
+        if (!GdbStub_listen(state.gdb, (u16)gdb_port)) {
+            log_error("Could not listen for GDB on port %d", gdb_port);
+            return 1;
+        }
+
+        log_info("Listening for GDB on localhost:%d", gdb_port);
+    }
+
+    if (use_accurate)
+        state.gb.tier = CpuTier_Accurate;
+
+    if (use_jit && !GameBoy_enable_jit(&state.gb))
+        log_warn("Could not enable the JIT, falling back to the interpreter");
+
+    GameBoy_load_rom(&state.gb, rom);
+    load_save(&state, argv[0]);
+    load_idle_loops(&state.gb);
+
+    if (cheat_codes != nullptr)
+        load_cheats(cheat_codes);
+
+    if (aot_path != nullptr)
+        load_aot_module(aot_path);
 
     SDL_free(boot_rom);
-    SDL_free(rom);
+    RomImage_release(rom);
 
     GameBoy_log_cartridge_info(&state.gb);
 
@@ -0,0 +1,224 @@
+#include "mapper.h"
+#include "data.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * \brief Gets the kind of Mapper a cartridge type needs.
+ *
+ * \return whether cartridges of that type are supported at all.
+ */
+static bool MapperKind_of(const CartridgeType type, MapperKind *const kind)
+{
+    switch (type) {
+    case CartridgeType_RomOnly:
+    case CartridgeType_RomRam:
+    case CartridgeType_RomRamBattery:
+        *kind = MapperKind_None;
+        return true;
+    case CartridgeType_Mbc1:
+    case CartridgeType_Mbc1Ram:
+    case CartridgeType_Mbc1RamBattery:
+        *kind = MapperKind_Mbc1;
+        return true;
+    case CartridgeType_Mbc3TimerBattery:
+    case CartridgeType_Mbc3TimerRamBattery:
+    case CartridgeType_Mbc3:
+    case CartridgeType_Mbc3Ram:
+    case CartridgeType_Mbc3RamBattery:
+        *kind = MapperKind_Mbc3;
+        return true;
+    case CartridgeType_Mbc5:
+    case CartridgeType_Mbc5Ram:
+    case CartridgeType_Mbc5RamBattery:
+    case CartridgeType_Mbc5Rumble:
+    case CartridgeType_Mbc5RumbleRam:
+    case CartridgeType_Mbc5RumbleRamBattery:
+        *kind = MapperKind_Mbc5;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Mapper_is_supported(const CartridgeType type)
+{
+    MapperKind kind;
+    return MapperKind_of(type, &kind);
+}
+
+Mapper Mapper_new(const CartridgeType type, const size_t rom_banks,
+                  const size_t ram_banks)
+{
+    MapperKind kind;
+    BAIL_IF(!MapperKind_of(type, &kind),
+            "Unsupported cartridge type (ctype: $%02X)", type);
+
+    return (Mapper){
+        .kind = kind,
+        .rumble = type == CartridgeType_Mbc5Rumble ||
+                  type == CartridgeType_Mbc5RumbleRam ||
+                  type == CartridgeType_Mbc5RumbleRamBattery,
+        .rom_banks = rom_banks,
+        .ram_banks = ram_banks,
+        // Without a mapper, there is nothing to enable RAM through
+        .ram_enable = kind == MapperKind_None,
+        .mode = false,
+        .rom_bank = 1,
+        .ram_bank = 0,
+        .latch = 0xFF,
+        .rtc = {0},
+        .rtc_latched = {0},
+    };
+}
+
+static bool Mapper_write_mbc1(Mapper *const self, const u16 addr,
+                              const u8 value)
+{
+    if (addr <= 0x1FFF) {
+        // 0000-1FFF (RAM enable)
+        self->ram_enable = (value & 0x0F) == 0x0A;
+    } else if (addr <= 0x3FFF) {
+        // 2000-3FFF (ROM bank number, where bank 0 selects bank 1)
+        self->rom_bank = value & 0x1F;
+
+        if (self->rom_bank == 0)
+            self->rom_bank = 1;
+    } else if (addr <= 0x5FFF) {
+        // 4000-5FFF (RAM bank number, or upper bits of the ROM bank number)
+        self->ram_bank = value & 0x03;
+    } else {
+        // 6000-7FFF (banking mode select)
+        self->mode = (value & 0x01) != 0;
+    }
+
+    return true;
+}
+
+static bool Mapper_write_mbc3(Mapper *const self, const u16 addr,
+                              const u8 value)
+{
+    if (addr <= 0x1FFF) {
+        // 0000-1FFF (RAM and timer enable)
+        self->ram_enable = (value & 0x0F) == 0x0A;
+    } else if (addr <= 0x3FFF) {
+        // 2000-3FFF (ROM bank number, where bank 0 selects bank 1)
+        self->rom_bank = value & 0x7F;
+
+        if (self->rom_bank == 0)
+            self->rom_bank = 1;
+    } else if (addr <= 0x5FFF) {
+        // 4000-5FFF (RAM bank number, or RTC register select)
+        self->ram_bank = value & 0x0F;
+    } else {
+        // 6000-7FFF (latch clock data, on writing $00 then $01)
+        if (self->latch == 0x00 && value == 0x01)
+            memcpy(self->rtc_latched, self->rtc, sizeof(self->rtc));
+
+        self->latch = value;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Mapper_write_mbc5(Mapper *const self, const u16 addr,
+                              const u8 value)
+{
+    if (addr <= 0x1FFF) {
+        // 0000-1FFF (RAM enable)
+        self->ram_enable = (value & 0x0F) == 0x0A;
+    } else if (addr <= 0x2FFF) {
+        // 2000-2FFF (lower 8 bits of the ROM bank number)
+        self->rom_bank = (self->rom_bank & 0x100) | value;
+    } else if (addr <= 0x3FFF) {
+        // 3000-3FFF (9th bit of the ROM bank number)
+        self->rom_bank = (self->rom_bank & 0xFF) | ((value & 0x01) << 8);
+    } else if (addr <= 0x5FFF) {
+        // 4000-5FFF (RAM bank number, whose bit 3 drives the rumble motor on
+        // carts that have one)
+        self->ram_bank = value & (self->rumble ? 0x07 : 0x0F);
+    } else {
+        // 6000-7FFF (unused)
+        return false;
+    }
+
+    return true;
+}
+
+bool Mapper_write(Mapper *const self, const u16 addr, const u8 value)
+{
+    // clang-format off
+    switch (self->kind) {
+        case MapperKind_Mbc1: return Mapper_write_mbc1(self, addr, value);
+        case MapperKind_Mbc3: return Mapper_write_mbc3(self, addr, value);
+        case MapperKind_Mbc5: return Mapper_write_mbc5(self, addr, value);
+        default: return false;
+    }
+    // clang-format on
+}
+
+size_t Mapper_rom_bank_lo(const Mapper *const self)
+{
+    // In mode 1, MBC1 also applies the upper bits to the first bank
+    if (self->kind == MapperKind_Mbc1 && self->mode)
+        return ((size_t)self->ram_bank << 5) & (self->rom_banks - 1);
+
+    return 0;
+}
+
+size_t Mapper_rom_bank_hi(const Mapper *const self)
+{
+    size_t bank = self->rom_bank;
+
+    if (self->kind == MapperKind_Mbc1)
+        bank |= (size_t)self->ram_bank << 5;
+
+    return bank & (self->rom_banks - 1);
+}
+
+bool Mapper_ram_bank(const Mapper *const self, size_t *const bank)
+{
+    if (self->ram_banks == 0 || !self->ram_enable)
+        return false;
+
+    switch (self->kind) {
+    case MapperKind_Mbc1:
+        *bank = self->mode ? self->ram_bank : 0;
+        break;
+    case MapperKind_Mbc3:
+        // $08-$0C select an RTC register instead
+        if (self->ram_bank > 0x07)
+            return false;
+
+        *bank = self->ram_bank;
+        break;
+    case MapperKind_Mbc5:
+        *bank = self->ram_bank;
+        break;
+    default:
+        *bank = 0;
+        break;
+    }
+
+    *bank &= self->ram_banks - 1;
+    return true;
+}
+
+u8 Mapper_read_register(const Mapper *const self)
+{
+    if (self->kind == MapperKind_Mbc3 && self->ram_enable &&
+        self->ram_bank >= 0x08 && self->ram_bank <= 0x0C)
+        return self->rtc_latched[self->ram_bank - 0x08];
+
+    return 0xFF;
+}
+
+void Mapper_write_register(Mapper *const self, const u8 value)
+{
+    if (self->kind == MapperKind_Mbc3 && self->ram_enable &&
+        self->ram_bank >= 0x08 && self->ram_bank <= 0x0C)
+        self->rtc[self->ram_bank - 0x08] = value;
+}
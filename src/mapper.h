@@ -0,0 +1,116 @@
+#ifndef GEMU_MAPPER_H
+#define GEMU_MAPPER_H
+
+#include "data.h"
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Length of a ROM bank, as switched by mappers
+ */
+constexpr size_t MAPPER_ROM_BANK_LEN = 0x4000;
+
+/**
+ * Length of an external RAM bank, as switched by mappers
+ */
+constexpr size_t MAPPER_RAM_BANK_LEN = 0x2000;
+
+typedef enum : u8 {
+    MapperKind_None,
+    MapperKind_Mbc1,
+    MapperKind_Mbc3,
+    MapperKind_Mbc5,
+} MapperKind;
+
+/**
+ * The memory bank controller of a cartridge.
+ *
+ * A Mapper only keeps track of which banks are selected. Actually pointing
+ * the address space at them is left to its owner, which must query the banks
+ * again whenever Mapper_write reports that they have changed.
+ *
+ * The MBC3 real-time clock registers can be selected, written and latched, but
+ * the clock itself does not tick yet.
+ */
+typedef struct {
+    MapperKind kind;
+    bool rumble;
+    size_t rom_banks;
+    size_t ram_banks;
+    bool ram_enable;
+    bool mode;
+    u16 rom_bank;
+    u8 ram_bank;
+    u8 latch;
+    u8 rtc[5];
+    u8 rtc_latched[5];
+} Mapper;
+
+/**
+ * \brief Checks whether a cartridge type has a Mapper implementation.
+ *
+ * \param type the cartridge type, as found in the ROM header.
+ *
+ * \return whether Mapper_new supports type.
+ */
+[[nodiscard]] bool Mapper_is_supported(CartridgeType type);
+
+/**
+ * \brief Constructs the Mapper of a cartridge, in its power-on state.
+ *
+ * \param type the cartridge type. Must be supported.
+ * \param rom_banks the number of ROM banks. Must be a power of two.
+ * \param ram_banks the number of external RAM banks, which may be 0.
+ *
+ * \return the constructed Mapper.
+ *
+ * \sa Mapper_is_supported
+ */
+[[nodiscard]] Mapper Mapper_new(CartridgeType type, size_t rom_banks,
+                                size_t ram_banks);
+
+/**
+ * \brief Writes to the registers of a Mapper, mapped at 0000-7FFF.
+ *
+ * \param self the Mapper.
+ * \param addr the address written to.
+ * \param value the value written.
+ *
+ * \return whether the mapped banks may have changed.
+ */
+bool Mapper_write(Mapper *self, u16 addr, u8 value);
+
+/**
+ * \brief Gets the ROM bank mapped at 0000-3FFF.
+ */
+[[nodiscard]] size_t Mapper_rom_bank_lo(const Mapper *self);
+
+/**
+ * \brief Gets the ROM bank mapped at 4000-7FFF.
+ */
+[[nodiscard]] size_t Mapper_rom_bank_hi(const Mapper *self);
+
+/**
+ * \brief Gets the external RAM bank mapped at A000-BFFF.
+ *
+ * \param self the Mapper.
+ * \param bank where to store the bank.
+ *
+ * \return whether a RAM bank is mapped at all. If not, accesses to A000-BFFF
+ * must go through Mapper_read_register and Mapper_write_register instead.
+ */
+[[nodiscard]] bool Mapper_ram_bank(const Mapper *self, size_t *bank);
+
+/**
+ * \brief Reads from A000-BFFF while no RAM bank is mapped there.
+ *
+ * \return the selected real-time clock register, or open bus.
+ */
+[[nodiscard]] u8 Mapper_read_register(const Mapper *self);
+
+/**
+ * \brief Writes to A000-BFFF while no RAM bank is mapped there.
+ */
+void Mapper_write_register(Mapper *self, u8 value);
+
+#endif
@@ -0,0 +1,540 @@
+#ifndef GEMU_OPCODES_H
+#define GEMU_OPCODES_H
+
+/*
+ * Opcode tables for the SM83, as X-macros.
+ *
+ * Entries of CPU_OPCODES expand X(code, len, call), where code is the opcode
+ * in hex (without the 0x prefix), len is the full length of the instruction in
+ * bytes (opcode included, 0 for removed opcodes) and call is the instruction
+ * handler invocation with its operands already decoded. Expansions have `cpu`,
+ * `mem` and the fetched immediate `imm` in scope.
+ *
+ * Entries of CPU_PREFIX_OPCODES expand X(code, call), with code being the byte
+ * following $CB.
+ *
+ * Credit:
+ * https://archive.gbdev.io/salvage/decoding_gbz80_opcodes/Decoding%20Gamboy%20Z80%20Opcodes.html
+ */
+
+// clang-format off
+
+#define CPU_OPCODES(X)                                                  \
+    X(00, 1, Cpu_instr_nop())                                           \
+    X(01, 3, Cpu_instr_ld_r16_n16(cpu, CpuTableRp_BC, imm))             \
+    X(02, 1, Cpu_instr_ld_bc_a(cpu, mem))                               \
+    X(03, 1, Cpu_instr_inc_r16(cpu, CpuTableRp_BC))                     \
+    X(04, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_B))                   \
+    X(05, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_B))                   \
+    X(06, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_B, imm))             \
+    X(07, 1, Cpu_instr_rlca(cpu))                                       \
+    X(08, 3, Cpu_instr_ld_n16_sp(cpu, mem, imm))                        \
+    X(09, 1, Cpu_instr_add_hl_r16(cpu, CpuTableRp_BC))                  \
+    X(0A, 1, Cpu_instr_ld_a_bc(cpu, mem))                               \
+    X(0B, 1, Cpu_instr_dec_r16(cpu, CpuTableRp_BC))                     \
+    X(0C, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_C))                   \
+    X(0D, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_C))                   \
+    X(0E, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_C, imm))             \
+    X(0F, 1, Cpu_instr_rrca(cpu))                                       \
+    X(10, 1, Cpu_instr_stop(cpu))                                       \
+    X(11, 3, Cpu_instr_ld_r16_n16(cpu, CpuTableRp_DE, imm))             \
+    X(12, 1, Cpu_instr_ld_de_a(cpu, mem))                               \
+    X(13, 1, Cpu_instr_inc_r16(cpu, CpuTableRp_DE))                     \
+    X(14, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_D))                   \
+    X(15, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_D))                   \
+    X(16, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_D, imm))             \
+    X(17, 1, Cpu_instr_rla(cpu))                                        \
+    X(18, 2, Cpu_instr_jr_e8(cpu, imm))                                 \
+    X(19, 1, Cpu_instr_add_hl_r16(cpu, CpuTableRp_DE))                  \
+    X(1A, 1, Cpu_instr_ld_a_de(cpu, mem))                               \
+    X(1B, 1, Cpu_instr_dec_r16(cpu, CpuTableRp_DE))                     \
+    X(1C, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_E))                   \
+    X(1D, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_E))                   \
+    X(1E, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_E, imm))             \
+    X(1F, 1, Cpu_instr_rra(cpu))                                        \
+    X(20, 2, Cpu_instr_jr_cc_e8(cpu, CpuTableCc_NZ, imm))               \
+    X(21, 3, Cpu_instr_ld_r16_n16(cpu, CpuTableRp_HL, imm))             \
+    X(22, 1, Cpu_instr_ld_hli_a(cpu, mem))                              \
+    X(23, 1, Cpu_instr_inc_r16(cpu, CpuTableRp_HL))                     \
+    X(24, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_H))                   \
+    X(25, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_H))                   \
+    X(26, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_H, imm))             \
+    X(27, 1, Cpu_instr_daa(cpu))                                        \
+    X(28, 2, Cpu_instr_jr_cc_e8(cpu, CpuTableCc_Z, imm))                \
+    X(29, 1, Cpu_instr_add_hl_r16(cpu, CpuTableRp_HL))                  \
+    X(2A, 1, Cpu_instr_ld_a_hli(cpu, mem))                              \
+    X(2B, 1, Cpu_instr_dec_r16(cpu, CpuTableRp_HL))                     \
+    X(2C, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_L))                   \
+    X(2D, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_L))                   \
+    X(2E, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_L, imm))             \
+    X(2F, 1, Cpu_instr_cpl(cpu))                                        \
+    X(30, 2, Cpu_instr_jr_cc_e8(cpu, CpuTableCc_NC, imm))               \
+    X(31, 3, Cpu_instr_ld_r16_n16(cpu, CpuTableRp_SP, imm))             \
+    X(32, 1, Cpu_instr_ld_hld_a(cpu, mem))                              \
+    X(33, 1, Cpu_instr_inc_r16(cpu, CpuTableRp_SP))                     \
+    X(34, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_HL))                  \
+    X(35, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_HL))                  \
+    X(36, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_HL, imm))            \
+    X(37, 1, Cpu_instr_scf(cpu))                                        \
+    X(38, 2, Cpu_instr_jr_cc_e8(cpu, CpuTableCc_C, imm))                \
+    X(39, 1, Cpu_instr_add_hl_r16(cpu, CpuTableRp_SP))                  \
+    X(3A, 1, Cpu_instr_ld_a_hld(cpu, mem))                              \
+    X(3B, 1, Cpu_instr_dec_r16(cpu, CpuTableRp_SP))                     \
+    X(3C, 1, Cpu_instr_inc_r8(cpu, mem, CpuTableR_A))                   \
+    X(3D, 1, Cpu_instr_dec_r8(cpu, mem, CpuTableR_A))                   \
+    X(3E, 2, Cpu_instr_ld_r8_n(cpu, mem, CpuTableR_A, imm))             \
+    X(3F, 1, Cpu_instr_ccf(cpu))                                        \
+    X(40, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_B))    \
+    X(41, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_C))    \
+    X(42, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_D))    \
+    X(43, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_E))    \
+    X(44, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_H))    \
+    X(45, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_L))    \
+    X(46, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_HL))   \
+    X(47, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_B, CpuTableR_A))    \
+    X(48, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_B))    \
+    X(49, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_C))    \
+    X(4A, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_D))    \
+    X(4B, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_E))    \
+    X(4C, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_H))    \
+    X(4D, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_L))    \
+    X(4E, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_HL))   \
+    X(4F, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_C, CpuTableR_A))    \
+    X(50, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_B))    \
+    X(51, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_C))    \
+    X(52, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_D))    \
+    X(53, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_E))    \
+    X(54, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_H))    \
+    X(55, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_L))    \
+    X(56, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_HL))   \
+    X(57, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_D, CpuTableR_A))    \
+    X(58, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_B))    \
+    X(59, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_C))    \
+    X(5A, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_D))    \
+    X(5B, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_E))    \
+    X(5C, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_H))    \
+    X(5D, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_L))    \
+    X(5E, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_HL))   \
+    X(5F, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_E, CpuTableR_A))    \
+    X(60, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_B))    \
+    X(61, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_C))    \
+    X(62, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_D))    \
+    X(63, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_E))    \
+    X(64, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_H))    \
+    X(65, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_L))    \
+    X(66, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_HL))   \
+    X(67, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_H, CpuTableR_A))    \
+    X(68, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_B))    \
+    X(69, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_C))    \
+    X(6A, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_D))    \
+    X(6B, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_E))    \
+    X(6C, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_H))    \
+    X(6D, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_L))    \
+    X(6E, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_HL))   \
+    X(6F, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_L, CpuTableR_A))    \
+    X(70, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_B))   \
+    X(71, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_C))   \
+    X(72, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_D))   \
+    X(73, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_E))   \
+    X(74, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_H))   \
+    X(75, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_L))   \
+    X(76, 1, Cpu_instr_halt(cpu))                                       \
+    X(77, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_HL, CpuTableR_A))   \
+    X(78, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_B))    \
+    X(79, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_C))    \
+    X(7A, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_D))    \
+    X(7B, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_E))    \
+    X(7C, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_H))    \
+    X(7D, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_L))    \
+    X(7E, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_HL))   \
+    X(7F, 1, Cpu_instr_ld_r8_r8(cpu, mem, CpuTableR_A, CpuTableR_A))    \
+    X(80, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_B))  \
+    X(81, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_C))  \
+    X(82, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_D))  \
+    X(83, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_E))  \
+    X(84, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_H))  \
+    X(85, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_L))  \
+    X(86, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_HL)) \
+    X(87, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Add, CpuTableR_A))  \
+    X(88, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_B))  \
+    X(89, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_C))  \
+    X(8A, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_D))  \
+    X(8B, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_E))  \
+    X(8C, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_H))  \
+    X(8D, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_L))  \
+    X(8E, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_HL)) \
+    X(8F, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Adc, CpuTableR_A))  \
+    X(90, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_B))  \
+    X(91, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_C))  \
+    X(92, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_D))  \
+    X(93, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_E))  \
+    X(94, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_H))  \
+    X(95, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_L))  \
+    X(96, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_HL)) \
+    X(97, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sub, CpuTableR_A))  \
+    X(98, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_B))  \
+    X(99, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_C))  \
+    X(9A, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_D))  \
+    X(9B, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_E))  \
+    X(9C, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_H))  \
+    X(9D, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_L))  \
+    X(9E, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_HL)) \
+    X(9F, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Sbc, CpuTableR_A))  \
+    X(A0, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_B))  \
+    X(A1, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_C))  \
+    X(A2, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_D))  \
+    X(A3, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_E))  \
+    X(A4, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_H))  \
+    X(A5, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_L))  \
+    X(A6, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_HL)) \
+    X(A7, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_And, CpuTableR_A))  \
+    X(A8, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_B))  \
+    X(A9, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_C))  \
+    X(AA, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_D))  \
+    X(AB, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_E))  \
+    X(AC, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_H))  \
+    X(AD, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_L))  \
+    X(AE, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_HL)) \
+    X(AF, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Xor, CpuTableR_A))  \
+    X(B0, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_B))   \
+    X(B1, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_C))   \
+    X(B2, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_D))   \
+    X(B3, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_E))   \
+    X(B4, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_H))   \
+    X(B5, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_L))   \
+    X(B6, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_HL))  \
+    X(B7, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Or, CpuTableR_A))   \
+    X(B8, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_B))   \
+    X(B9, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_C))   \
+    X(BA, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_D))   \
+    X(BB, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_E))   \
+    X(BC, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_H))   \
+    X(BD, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_L))   \
+    X(BE, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_HL))  \
+    X(BF, 1, Cpu_instr_alu_r8(cpu, mem, CpuTableAlu_Cp, CpuTableR_A))   \
+    X(C0, 1, Cpu_instr_ret_cc(cpu, mem, CpuTableCc_NZ))                 \
+    X(C1, 1, Cpu_instr_pop_r16(cpu, mem, CpuTableRp2_BC))               \
+    X(C2, 3, Cpu_instr_jp_cc_a16(cpu, CpuTableCc_NZ, imm))              \
+    X(C3, 3, Cpu_instr_jp_a16(cpu, imm))                                \
+    X(C4, 3, Cpu_instr_call_cc_n16(cpu, mem, CpuTableCc_NZ, imm))       \
+    X(C5, 1, Cpu_instr_push_r16(cpu, mem, CpuTableRp2_BC))              \
+    X(C6, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Add, imm))             \
+    X(C7, 1, Cpu_instr_rst_vec(cpu, mem, 0x00))                         \
+    X(C8, 1, Cpu_instr_ret_cc(cpu, mem, CpuTableCc_Z))                  \
+    X(C9, 1, Cpu_instr_ret(cpu, mem))                                   \
+    X(CA, 3, Cpu_instr_jp_cc_a16(cpu, CpuTableCc_Z, imm))               \
+    X(CB, 2, Cpu_instr_prefix(cpu, mem, imm))                           \
+    X(CC, 3, Cpu_instr_call_cc_n16(cpu, mem, CpuTableCc_Z, imm))        \
+    X(CD, 3, Cpu_instr_call_n16(cpu, mem, imm))                         \
+    X(CE, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Adc, imm))             \
+    X(CF, 1, Cpu_instr_rst_vec(cpu, mem, 0x08))                         \
+    X(D0, 1, Cpu_instr_ret_cc(cpu, mem, CpuTableCc_NC))                 \
+    X(D1, 1, Cpu_instr_pop_r16(cpu, mem, CpuTableRp2_DE))               \
+    X(D2, 3, Cpu_instr_jp_cc_a16(cpu, CpuTableCc_NC, imm))              \
+    X(D3, 0, Cpu_instr_removed(0xD3))                                   \
+    X(D4, 3, Cpu_instr_call_cc_n16(cpu, mem, CpuTableCc_NC, imm))       \
+    X(D5, 1, Cpu_instr_push_r16(cpu, mem, CpuTableRp2_DE))              \
+    X(D6, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Sub, imm))             \
+    X(D7, 1, Cpu_instr_rst_vec(cpu, mem, 0x10))                         \
+    X(D8, 1, Cpu_instr_ret_cc(cpu, mem, CpuTableCc_C))                  \
+    X(D9, 1, Cpu_instr_reti(cpu, mem))                                  \
+    X(DA, 3, Cpu_instr_jp_cc_a16(cpu, CpuTableCc_C, imm))               \
+    X(DB, 0, Cpu_instr_removed(0xDB))                                   \
+    X(DC, 3, Cpu_instr_call_cc_n16(cpu, mem, CpuTableCc_C, imm))        \
+    X(DD, 0, Cpu_instr_removed(0xDD))                                   \
+    X(DE, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Sbc, imm))             \
+    X(DF, 1, Cpu_instr_rst_vec(cpu, mem, 0x18))                         \
+    X(E0, 2, Cpu_instr_ldh_n16_a(cpu, mem, imm))                        \
+    X(E1, 1, Cpu_instr_pop_r16(cpu, mem, CpuTableRp2_HL))               \
+    X(E2, 1, Cpu_instr_ldh_c_a(cpu, mem))                               \
+    X(E3, 0, Cpu_instr_removed(0xE3))                                   \
+    X(E4, 0, Cpu_instr_removed(0xE4))                                   \
+    X(E5, 1, Cpu_instr_push_r16(cpu, mem, CpuTableRp2_HL))              \
+    X(E6, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_And, imm))             \
+    X(E7, 1, Cpu_instr_rst_vec(cpu, mem, 0x20))                         \
+    X(E8, 2, Cpu_instr_add_sp_e8(cpu, imm))                             \
+    X(E9, 1, Cpu_instr_jp_hl(cpu))                                      \
+    X(EA, 3, Cpu_instr_ld_a16_a(cpu, mem, imm))                         \
+    X(EB, 0, Cpu_instr_removed(0xEB))                                   \
+    X(EC, 0, Cpu_instr_removed(0xEC))                                   \
+    X(ED, 0, Cpu_instr_removed(0xED))                                   \
+    X(EE, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Xor, imm))             \
+    X(EF, 1, Cpu_instr_rst_vec(cpu, mem, 0x28))                         \
+    X(F0, 2, Cpu_instr_ldh_a_n16(cpu, mem, imm))                        \
+    X(F1, 1, Cpu_instr_pop_r16(cpu, mem, CpuTableRp2_AF))               \
+    X(F2, 1, Cpu_instr_ldh_a_c(cpu, mem))                               \
+    X(F3, 1, Cpu_instr_di(cpu))                                         \
+    X(F4, 0, Cpu_instr_removed(0xF4))                                   \
+    X(F5, 1, Cpu_instr_push_r16(cpu, mem, CpuTableRp2_AF))              \
+    X(F6, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Or, imm))              \
+    X(F7, 1, Cpu_instr_rst_vec(cpu, mem, 0x30))                         \
+    X(F8, 2, Cpu_instr_ld_hl_sp_plus_e8(cpu, imm))                      \
+    X(F9, 1, Cpu_instr_ld_sp_hl(cpu))                                   \
+    X(FA, 3, Cpu_instr_ld_a_a16(cpu, mem, imm))                         \
+    X(FB, 1, Cpu_instr_ei(cpu))                                         \
+    X(FC, 0, Cpu_instr_removed(0xFC))                                   \
+    X(FD, 0, Cpu_instr_removed(0xFD))                                   \
+    X(FE, 2, Cpu_instr_alu_a_a8(cpu, CpuTableAlu_Cp, imm))              \
+    X(FF, 1, Cpu_instr_rst_vec(cpu, mem, 0x38))
+
+#define CPU_PREFIX_OPCODES(X)                             \
+    X(00, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_B))        \
+    X(01, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_C))        \
+    X(02, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_D))        \
+    X(03, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_E))        \
+    X(04, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_H))        \
+    X(05, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_L))        \
+    X(06, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_HL))       \
+    X(07, Cpu_instr_rlc_r8(cpu, mem, CpuTableR_A))        \
+    X(08, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_B))        \
+    X(09, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_C))        \
+    X(0A, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_D))        \
+    X(0B, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_E))        \
+    X(0C, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_H))        \
+    X(0D, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_L))        \
+    X(0E, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_HL))       \
+    X(0F, Cpu_instr_rrc_r8(cpu, mem, CpuTableR_A))        \
+    X(10, Cpu_instr_rl_r8(cpu, mem, CpuTableR_B))         \
+    X(11, Cpu_instr_rl_r8(cpu, mem, CpuTableR_C))         \
+    X(12, Cpu_instr_rl_r8(cpu, mem, CpuTableR_D))         \
+    X(13, Cpu_instr_rl_r8(cpu, mem, CpuTableR_E))         \
+    X(14, Cpu_instr_rl_r8(cpu, mem, CpuTableR_H))         \
+    X(15, Cpu_instr_rl_r8(cpu, mem, CpuTableR_L))         \
+    X(16, Cpu_instr_rl_r8(cpu, mem, CpuTableR_HL))        \
+    X(17, Cpu_instr_rl_r8(cpu, mem, CpuTableR_A))         \
+    X(18, Cpu_instr_rr_r8(cpu, mem, CpuTableR_B))         \
+    X(19, Cpu_instr_rr_r8(cpu, mem, CpuTableR_C))         \
+    X(1A, Cpu_instr_rr_r8(cpu, mem, CpuTableR_D))         \
+    X(1B, Cpu_instr_rr_r8(cpu, mem, CpuTableR_E))         \
+    X(1C, Cpu_instr_rr_r8(cpu, mem, CpuTableR_H))         \
+    X(1D, Cpu_instr_rr_r8(cpu, mem, CpuTableR_L))         \
+    X(1E, Cpu_instr_rr_r8(cpu, mem, CpuTableR_HL))        \
+    X(1F, Cpu_instr_rr_r8(cpu, mem, CpuTableR_A))         \
+    X(20, Cpu_instr_sla_r8(cpu, mem, CpuTableR_B))        \
+    X(21, Cpu_instr_sla_r8(cpu, mem, CpuTableR_C))        \
+    X(22, Cpu_instr_sla_r8(cpu, mem, CpuTableR_D))        \
+    X(23, Cpu_instr_sla_r8(cpu, mem, CpuTableR_E))        \
+    X(24, Cpu_instr_sla_r8(cpu, mem, CpuTableR_H))        \
+    X(25, Cpu_instr_sla_r8(cpu, mem, CpuTableR_L))        \
+    X(26, Cpu_instr_sla_r8(cpu, mem, CpuTableR_HL))       \
+    X(27, Cpu_instr_sla_r8(cpu, mem, CpuTableR_A))        \
+    X(28, Cpu_instr_sra_r8(cpu, mem, CpuTableR_B))        \
+    X(29, Cpu_instr_sra_r8(cpu, mem, CpuTableR_C))        \
+    X(2A, Cpu_instr_sra_r8(cpu, mem, CpuTableR_D))        \
+    X(2B, Cpu_instr_sra_r8(cpu, mem, CpuTableR_E))        \
+    X(2C, Cpu_instr_sra_r8(cpu, mem, CpuTableR_H))        \
+    X(2D, Cpu_instr_sra_r8(cpu, mem, CpuTableR_L))        \
+    X(2E, Cpu_instr_sra_r8(cpu, mem, CpuTableR_HL))       \
+    X(2F, Cpu_instr_sra_r8(cpu, mem, CpuTableR_A))        \
+    X(30, Cpu_instr_swap_r8(cpu, mem, CpuTableR_B))       \
+    X(31, Cpu_instr_swap_r8(cpu, mem, CpuTableR_C))       \
+    X(32, Cpu_instr_swap_r8(cpu, mem, CpuTableR_D))       \
+    X(33, Cpu_instr_swap_r8(cpu, mem, CpuTableR_E))       \
+    X(34, Cpu_instr_swap_r8(cpu, mem, CpuTableR_H))       \
+    X(35, Cpu_instr_swap_r8(cpu, mem, CpuTableR_L))       \
+    X(36, Cpu_instr_swap_r8(cpu, mem, CpuTableR_HL))      \
+    X(37, Cpu_instr_swap_r8(cpu, mem, CpuTableR_A))       \
+    X(38, Cpu_instr_srl_r8(cpu, mem, CpuTableR_B))        \
+    X(39, Cpu_instr_srl_r8(cpu, mem, CpuTableR_C))        \
+    X(3A, Cpu_instr_srl_r8(cpu, mem, CpuTableR_D))        \
+    X(3B, Cpu_instr_srl_r8(cpu, mem, CpuTableR_E))        \
+    X(3C, Cpu_instr_srl_r8(cpu, mem, CpuTableR_H))        \
+    X(3D, Cpu_instr_srl_r8(cpu, mem, CpuTableR_L))        \
+    X(3E, Cpu_instr_srl_r8(cpu, mem, CpuTableR_HL))       \
+    X(3F, Cpu_instr_srl_r8(cpu, mem, CpuTableR_A))        \
+    X(40, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_B))  \
+    X(41, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_C))  \
+    X(42, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_D))  \
+    X(43, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_E))  \
+    X(44, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_H))  \
+    X(45, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_L))  \
+    X(46, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_HL)) \
+    X(47, Cpu_instr_bit_u3_r8(cpu, mem, 0, CpuTableR_A))  \
+    X(48, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_B))  \
+    X(49, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_C))  \
+    X(4A, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_D))  \
+    X(4B, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_E))  \
+    X(4C, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_H))  \
+    X(4D, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_L))  \
+    X(4E, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_HL)) \
+    X(4F, Cpu_instr_bit_u3_r8(cpu, mem, 1, CpuTableR_A))  \
+    X(50, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_B))  \
+    X(51, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_C))  \
+    X(52, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_D))  \
+    X(53, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_E))  \
+    X(54, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_H))  \
+    X(55, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_L))  \
+    X(56, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_HL)) \
+    X(57, Cpu_instr_bit_u3_r8(cpu, mem, 2, CpuTableR_A))  \
+    X(58, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_B))  \
+    X(59, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_C))  \
+    X(5A, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_D))  \
+    X(5B, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_E))  \
+    X(5C, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_H))  \
+    X(5D, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_L))  \
+    X(5E, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_HL)) \
+    X(5F, Cpu_instr_bit_u3_r8(cpu, mem, 3, CpuTableR_A))  \
+    X(60, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_B))  \
+    X(61, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_C))  \
+    X(62, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_D))  \
+    X(63, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_E))  \
+    X(64, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_H))  \
+    X(65, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_L))  \
+    X(66, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_HL)) \
+    X(67, Cpu_instr_bit_u3_r8(cpu, mem, 4, CpuTableR_A))  \
+    X(68, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_B))  \
+    X(69, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_C))  \
+    X(6A, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_D))  \
+    X(6B, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_E))  \
+    X(6C, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_H))  \
+    X(6D, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_L))  \
+    X(6E, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_HL)) \
+    X(6F, Cpu_instr_bit_u3_r8(cpu, mem, 5, CpuTableR_A))  \
+    X(70, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_B))  \
+    X(71, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_C))  \
+    X(72, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_D))  \
+    X(73, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_E))  \
+    X(74, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_H))  \
+    X(75, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_L))  \
+    X(76, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_HL)) \
+    X(77, Cpu_instr_bit_u3_r8(cpu, mem, 6, CpuTableR_A))  \
+    X(78, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_B))  \
+    X(79, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_C))  \
+    X(7A, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_D))  \
+    X(7B, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_E))  \
+    X(7C, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_H))  \
+    X(7D, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_L))  \
+    X(7E, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_HL)) \
+    X(7F, Cpu_instr_bit_u3_r8(cpu, mem, 7, CpuTableR_A))  \
+    X(80, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_B))  \
+    X(81, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_C))  \
+    X(82, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_D))  \
+    X(83, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_E))  \
+    X(84, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_H))  \
+    X(85, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_L))  \
+    X(86, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_HL)) \
+    X(87, Cpu_instr_res_u3_r8(cpu, mem, 0, CpuTableR_A))  \
+    X(88, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_B))  \
+    X(89, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_C))  \
+    X(8A, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_D))  \
+    X(8B, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_E))  \
+    X(8C, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_H))  \
+    X(8D, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_L))  \
+    X(8E, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_HL)) \
+    X(8F, Cpu_instr_res_u3_r8(cpu, mem, 1, CpuTableR_A))  \
+    X(90, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_B))  \
+    X(91, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_C))  \
+    X(92, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_D))  \
+    X(93, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_E))  \
+    X(94, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_H))  \
+    X(95, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_L))  \
+    X(96, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_HL)) \
+    X(97, Cpu_instr_res_u3_r8(cpu, mem, 2, CpuTableR_A))  \
+    X(98, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_B))  \
+    X(99, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_C))  \
+    X(9A, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_D))  \
+    X(9B, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_E))  \
+    X(9C, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_H))  \
+    X(9D, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_L))  \
+    X(9E, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_HL)) \
+    X(9F, Cpu_instr_res_u3_r8(cpu, mem, 3, CpuTableR_A))  \
+    X(A0, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_B))  \
+    X(A1, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_C))  \
+    X(A2, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_D))  \
+    X(A3, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_E))  \
+    X(A4, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_H))  \
+    X(A5, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_L))  \
+    X(A6, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_HL)) \
+    X(A7, Cpu_instr_res_u3_r8(cpu, mem, 4, CpuTableR_A))  \
+    X(A8, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_B))  \
+    X(A9, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_C))  \
+    X(AA, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_D))  \
+    X(AB, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_E))  \
+    X(AC, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_H))  \
+    X(AD, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_L))  \
+    X(AE, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_HL)) \
+    X(AF, Cpu_instr_res_u3_r8(cpu, mem, 5, CpuTableR_A))  \
+    X(B0, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_B))  \
+    X(B1, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_C))  \
+    X(B2, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_D))  \
+    X(B3, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_E))  \
+    X(B4, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_H))  \
+    X(B5, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_L))  \
+    X(B6, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_HL)) \
+    X(B7, Cpu_instr_res_u3_r8(cpu, mem, 6, CpuTableR_A))  \
+    X(B8, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_B))  \
+    X(B9, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_C))  \
+    X(BA, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_D))  \
+    X(BB, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_E))  \
+    X(BC, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_H))  \
+    X(BD, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_L))  \
+    X(BE, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_HL)) \
+    X(BF, Cpu_instr_res_u3_r8(cpu, mem, 7, CpuTableR_A))  \
+    X(C0, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_B))  \
+    X(C1, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_C))  \
+    X(C2, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_D))  \
+    X(C3, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_E))  \
+    X(C4, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_H))  \
+    X(C5, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_L))  \
+    X(C6, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_HL)) \
+    X(C7, Cpu_instr_set_u3_r8(cpu, mem, 0, CpuTableR_A))  \
+    X(C8, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_B))  \
+    X(C9, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_C))  \
+    X(CA, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_D))  \
+    X(CB, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_E))  \
+    X(CC, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_H))  \
+    X(CD, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_L))  \
+    X(CE, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_HL)) \
+    X(CF, Cpu_instr_set_u3_r8(cpu, mem, 1, CpuTableR_A))  \
+    X(D0, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_B))  \
+    X(D1, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_C))  \
+    X(D2, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_D))  \
+    X(D3, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_E))  \
+    X(D4, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_H))  \
+    X(D5, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_L))  \
+    X(D6, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_HL)) \
+    X(D7, Cpu_instr_set_u3_r8(cpu, mem, 2, CpuTableR_A))  \
+    X(D8, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_B))  \
+    X(D9, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_C))  \
+    X(DA, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_D))  \
+    X(DB, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_E))  \
+    X(DC, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_H))  \
+    X(DD, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_L))  \
+    X(DE, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_HL)) \
+    X(DF, Cpu_instr_set_u3_r8(cpu, mem, 3, CpuTableR_A))  \
+    X(E0, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_B))  \
+    X(E1, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_C))  \
+    X(E2, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_D))  \
+    X(E3, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_E))  \
+    X(E4, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_H))  \
+    X(E5, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_L))  \
+    X(E6, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_HL)) \
+    X(E7, Cpu_instr_set_u3_r8(cpu, mem, 4, CpuTableR_A))  \
+    X(E8, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_B))  \
+    X(E9, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_C))  \
+    X(EA, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_D))  \
+    X(EB, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_E))  \
+    X(EC, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_H))  \
+    X(ED, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_L))  \
+    X(EE, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_HL)) \
+    X(EF, Cpu_instr_set_u3_r8(cpu, mem, 5, CpuTableR_A))  \
+    X(F0, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_B))  \
+    X(F1, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_C))  \
+    X(F2, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_D))  \
+    X(F3, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_E))  \
+    X(F4, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_H))  \
+    X(F5, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_L))  \
+    X(F6, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_HL)) \
+    X(F7, Cpu_instr_set_u3_r8(cpu, mem, 6, CpuTableR_A))  \
+    X(F8, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_B))  \
+    X(F9, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_C))  \
+    X(FA, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_D))  \
+    X(FB, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_E))  \
+    X(FC, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_H))  \
+    X(FD, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_L))  \
+    X(FE, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_HL)) \
+    X(FF, Cpu_instr_set_u3_r8(cpu, mem, 7, CpuTableR_A))
+
+// clang-format on
+
+#endif
@@ -0,0 +1,382 @@
+#include "ppu.h"
+#include "game_boy.h"
+#include "idle_loop.h"
+#include "stdinc.h"
+#include "tile_cache.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Maximum number of objects drawn on a single line
+ */
+static constexpr size_t LINE_MAX_OBJECTS = 10;
+
+static PpuMode mode_at(const double line_pos)
+{
+    const int line = (int)line_pos;
+    const double dot = (line_pos - line) * PPU_LINE_DOTS;
+
+    if (line >= GB_LCD_HEIGHT)
+        return PpuMode_VBlank;
+
+    if (dot < PPU_OAM_SCAN_DOTS)
+        return PpuMode_OamScan;
+
+    if (dot < PPU_OAM_SCAN_DOTS + PPU_DRAWING_DOTS)
+        return PpuMode_Drawing;
+
+    return PpuMode_HBlank;
+}
+
+double Ppu_next_mode_change(const double line_pos)
+{
+    const int line = (int)line_pos;
+    const double dot = (line_pos - line) * PPU_LINE_DOTS;
+
+    if (line < GB_LCD_HEIGHT) {
+        if (dot < PPU_OAM_SCAN_DOTS)
+            return line + ((double)PPU_OAM_SCAN_DOTS / PPU_LINE_DOTS);
+
+        if (dot < PPU_OAM_SCAN_DOTS + PPU_DRAWING_DOTS) {
+            return line + ((double)(PPU_OAM_SCAN_DOTS + PPU_DRAWING_DOTS) /
+                           PPU_LINE_DOTS);
+        }
+    }
+
+    return line + 1;
+}
+
+/**
+ * \brief Gets the tile a background or window tile index refers to.
+ */
+static size_t bgw_tile(const GameBoy *const gb, const u8 index)
+{
+    // The $8000 method indexes tiles unsigned, and the $8800 method signed
+    if ((gb->lcdc & LcdControl_BgwTileArea) != 0)
+        return index;
+
+    return 256 + (i8)index;
+}
+
+/**
+ * \brief Adds a tile to a set of tiles, a bit for each.
+ */
+static void add_tile(u64 *const tiles, const size_t tile)
+{
+    tiles[tile / 64] |= (u64)1 << (tile % 64);
+}
+
+/**
+ * \brief Draws a line of a tile map into ids, from a pixel of the line of the
+ * map to the right edge of the screen.
+ *
+ * \param gb the GameBoy.
+ * \param deps where to record the tile map row and tiles read.
+ * \param tile_map the tile map.
+ * \param map_x the pixel of the tile map to start at, which wraps around.
+ * \param map_y the line of the tile map.
+ * \param x the pixel of the screen to start at.
+ * \param ids where to write the color indices of the line of the screen.
+ */
+static void draw_tile_map(const GameBoy *const gb, PpuLine *const deps,
+                          const u8 *const tile_map, u8 map_x, const u8 map_y,
+                          size_t x, u8 *const ids)
+{
+    const u8 *const map_row = &tile_map[(map_y / 8) * 32];
+
+    // Rows of the maps at $9800 and $9C00 are numbered from 0 to 63 together
+    deps->map_rows |= (u64)1 << ((map_row - &gb->vram[0x1800]) / 32);
+
+    // A whole row of a tile at a time, except for the ones cut off by the
+    // edges of the screen
+    while (x < GB_LCD_WIDTH) {
+        const size_t tile = bgw_tile(gb, map_row[map_x / 8]);
+        const u8 *const row = TileCache_row(gb->tiles, tile, map_y % 8, false);
+        add_tile(deps->tiles, tile);
+
+        size_t len = 8 - (map_x % 8);
+        if (len > GB_LCD_WIDTH - x)
+            len = GB_LCD_WIDTH - x;
+
+        memcpy(&ids[x], &row[map_x % 8], len);
+
+        x += len;
+        map_x = (u8)(map_x + len);
+    }
+}
+
+static void draw_background(const GameBoy *const gb, PpuLine *const deps,
+                            const u8 ly, u8 *const ids)
+{
+    const u8 *const tile_map =
+        &gb->vram[(gb->lcdc & LcdControl_BgTileMap) != 0 ? 0x1C00 : 0x1800];
+
+    draw_tile_map(gb, deps, tile_map, gb->scx, (u8)(gb->scy + ly), 0, ids);
+}
+
+/**
+ * \brief Checks whether the window covers any of a line of the screen.
+ */
+static bool window_covers(const GameBoy *const gb, const u8 ly)
+{
+    return (gb->lcdc & LcdControl_WinEnable) != 0 && ly >= gb->wy &&
+           gb->wx < GB_LCD_WIDTH + 7;
+}
+
+/**
+ * \brief Draws a line of the window into ids.
+ *
+ * \param gb the GameBoy.
+ * \param deps where to record the tile map row and tiles read.
+ * \param y the line of the window, as counted by its own line counter.
+ * \param ids where to write the color indices of the line of the screen.
+ */
+static void draw_window(const GameBoy *const gb, PpuLine *const deps,
+                        const u8 y, u8 *const ids)
+{
+    const u8 *const tile_map =
+        &gb->vram[(gb->lcdc & LcdControl_WinTileMap) != 0 ? 0x1C00 : 0x1800];
+
+    // Windows starting left of the screen are cut off
+    if (gb->wx < 7)
+        draw_tile_map(gb, deps, tile_map, 7 - gb->wx, y, 0, ids);
+    else
+        draw_tile_map(gb, deps, tile_map, 0, y, gb->wx - 7, ids);
+}
+
+static void draw_objects(const GameBoy *const gb, PpuLine *const deps,
+                         const u8 ly, const u8 *const bg_ids, u8 *const line)
+{
+    const int height = (gb->lcdc & LcdControl_ObjSize) != 0 ? 16 : 8;
+
+    u8 objs[LINE_MAX_OBJECTS];
+    size_t objs_len = 0;
+
+    // The first objects in OAM that cover the line are the ones drawn
+    for (u8 obj = 0; obj < 40 && objs_len < LINE_MAX_OBJECTS; ++obj) {
+        const int top = gb->oam[obj * 4] - 16;
+
+        if (ly >= top && ly < top + height) {
+            objs[objs_len++] = obj;
+            deps->objects |= (u64)1 << obj;
+        }
+    }
+
+    // Objects further left take priority, and then those first in OAM
+    for (size_t i = 1; i < objs_len; ++i) {
+        const u8 obj = objs[i];
+        size_t j = i;
+
+        for (; j > 0 && gb->oam[objs[j - 1] * 4 + 1] > gb->oam[obj * 4 + 1];
+             --j)
+            objs[j] = objs[j - 1];
+
+        objs[j] = obj;
+    }
+
+    // Pixels already taken by an object, even if hidden behind the background
+    bool taken[GB_LCD_WIDTH] = {};
+
+    for (size_t i = 0; i < objs_len; ++i) {
+        const u8 *const obj_data = &gb->oam[objs[i] * 4];
+        const int left = obj_data[1] - 8;
+        const u8 attrs = obj_data[3];
+
+        int row = ly - (obj_data[0] - 16);
+        if ((attrs & ObjAttrs_FlipY) != 0)
+            row = height - 1 - row;
+
+        // Objects always use the $8000 method, and tall ones start on an even
+        // tile
+        const u8 tile =
+            (height == 16 ? obj_data[2] & 0xFE : obj_data[2]) + (row / 8);
+        const u8 *const ids = TileCache_row(gb->tiles, tile, row % 8,
+                                            (attrs & ObjAttrs_FlipX) != 0);
+        add_tile(deps->tiles, tile);
+        const u8 *const shades =
+            gb->obj_shades[(attrs & ObjAttrs_DmgPalette) != 0];
+
+        for (int col = 0; col < 8; ++col) {
+            const int x = left + col;
+
+            if (x < 0 || x >= GB_LCD_WIDTH || taken[x])
+                continue;
+
+            const u8 id = ids[col];
+
+            // Color 0 is transparent
+            if (id == 0)
+                continue;
+
+            taken[x] = true;
+
+            if ((attrs & ObjAttrs_Priority) != 0 && bg_ids[x] != 0)
+                continue;
+
+            line[x] = shades[id];
+        }
+    }
+}
+
+/**
+ * \brief Draws a line of the framebuffer, unless neither the registers it was
+ * last drawn with nor anything it read from VRAM and OAM have changed since.
+ */
+static void draw_line(GameBoy *const gb, const u8 ly)
+{
+    const bool bgw_enable = (gb->lcdc & LcdControl_ObjBgwEnable) != 0;
+    const bool window = bgw_enable && window_covers(gb, ly);
+
+    // The window has its own line counter, which only advances on lines it is
+    // drawn on
+    const u8 window_line = gb->window_line;
+    if (window)
+        ++gb->window_line;
+
+    const u8 regs[] = {gb->lcdc, gb->scy,  gb->scx,  gb->wy,     gb->wx,
+                       gb->bgp,  gb->obp0, gb->obp1, window_line};
+    static_assert(sizeof(regs) == sizeof(gb->lines[ly].regs));
+
+    PpuLine *const deps = &gb->lines[ly];
+    if (deps->drawn && memcmp(deps->regs, regs, sizeof(regs)) == 0)
+        return;
+
+    *deps = (PpuLine){.drawn = true};
+    memcpy(deps->regs, regs, sizeof(regs));
+    gb->framebuffer_dirty = true;
+
+    u8 *const line = &gb->framebuffer[ly * GB_LCD_WIDTH];
+    u8 bg_ids[GB_LCD_WIDTH] = {};
+
+    // Without the background and window, the line is left blank
+    if (bgw_enable) {
+        draw_background(gb, deps, ly, bg_ids);
+
+        if (window)
+            draw_window(gb, deps, window_line, bg_ids);
+
+        for (size_t x = 0; x < GB_LCD_WIDTH; ++x)
+            line[x] = gb->bg_shades[bg_ids[x]];
+    } else {
+        memset(line, 0, GB_LCD_WIDTH);
+    }
+
+    if ((gb->lcdc & LcdControl_ObjEnable) != 0)
+        draw_objects(gb, deps, ly, bg_ids, line);
+}
+
+void Ppu_invalidate_vram(GameBoy *const gb, const size_t start,
+                         const size_t end)
+{
+    u64 tiles[TILE_CACHE_TILES / 64] = {};
+    for (size_t tile = start / 16; tile <= end / 16 && tile < TILE_CACHE_TILES;
+         ++tile)
+        add_tile(tiles, tile);
+
+    // The tile maps follow the tiles, a row every 32 bytes
+    u64 map_rows = 0;
+    if (end >= 0x1800) {
+        const size_t first = start > 0x1800 ? start - 0x1800 : 0;
+
+        for (size_t row = first / 32; row <= (end - 0x1800) / 32; ++row)
+            map_rows |= (u64)1 << row;
+    }
+
+    for (size_t ly = 0; ly < GB_LCD_HEIGHT; ++ly) {
+        PpuLine *const line = &gb->lines[ly];
+        bool read = (line->map_rows & map_rows) != 0;
+
+        for (size_t i = 0; i < TILE_CACHE_TILES / 64 && !read; ++i)
+            read = (line->tiles[i] & tiles[i]) != 0;
+
+        if (read)
+            line->drawn = false;
+    }
+}
+
+void Ppu_invalidate_object(GameBoy *const gb, const u8 obj)
+{
+    const int top = gb->oam[obj * 4] - 16;
+
+    // Where the object was drawn, and where it may be drawn now at either size
+    for (int ly = 0; ly < GB_LCD_HEIGHT; ++ly) {
+        PpuLine *const line = &gb->lines[ly];
+
+        if ((line->objects & ((u64)1 << obj)) != 0 ||
+            (ly >= top && ly < top + 16))
+            line->drawn = false;
+    }
+}
+
+void Ppu_invalidate_lines(GameBoy *const gb)
+{
+    for (size_t ly = 0; ly < GB_LCD_HEIGHT; ++ly)
+        gb->lines[ly].drawn = false;
+}
+
+/**
+ * \brief Sets the mode and coincidence bits of STAT.
+ */
+static void set_stat(GameBoy *const gb, const PpuMode mode)
+{
+    gb->stat = (gb->stat & ~0b111) | ((gb->ly == gb->lcy) << 2) | mode;
+}
+
+void Ppu_update(GameBoy *const gb, const double progress)
+{
+    if ((gb->lcdc & LcdControl_Enable) == 0) {
+        gb->ly = 0;
+        gb->lines_drawn = 0;
+        gb->window_line = 0;
+        set_stat(gb, PpuMode_HBlank);
+        return;
+    }
+
+    const double line_pos = progress * GB_LCD_MAX_LY;
+    const u8 prev_ly = gb->ly;
+    const PpuMode prev_mode = gb->stat & 0b11;
+    const u8 ly = (u8)line_pos;
+    const PpuMode mode = mode_at(line_pos);
+
+    // A new frame
+    if (ly < prev_ly) {
+        gb->lines_drawn = 0;
+        gb->window_line = 0;
+    }
+
+    // Several lines may have gone by since the last update, all of which are
+    // drawn now
+    const u8 lines_done = ly >= GB_LCD_HEIGHT    ? GB_LCD_HEIGHT
+                          : mode == PpuMode_HBlank ? ly + 1
+                                                   : ly;
+
+    while (gb->lines_drawn < lines_done)
+        draw_line(gb, gb->lines_drawn++);
+
+    gb->ly = ly;
+    set_stat(gb, mode);
+
+    if (ly != prev_ly) {
+        IdleLoopDetector_event(gb->idle_loops);
+
+        // VBlank interrupt, which RAM freezes are applied along with
+        if (ly == GB_LCD_HEIGHT) {
+            gb->if_ |= InterruptFlag_VBlank;
+            GameBoy_apply_freezes(gb);
+
+            if ((gb->stat & StatSelect_Mode1) != 0)
+                gb->if_ |= InterruptFlag_Lcd;
+        }
+
+        // STAT lcy == ly interrupt
+        if ((gb->stat & StatSelect_Lyc) != 0 && ly == gb->lcy)
+            gb->if_ |= InterruptFlag_Lcd;
+    }
+
+    // STAT HBlank and OAM scan interrupts
+    if (mode != prev_mode && ((mode == PpuMode_HBlank &&
+                               (gb->stat & StatSelect_Mode0) != 0) ||
+                              (mode == PpuMode_OamScan &&
+                               (gb->stat & StatSelect_Mode2) != 0)))
+        gb->if_ |= InterruptFlag_Lcd;
+}
@@ -0,0 +1,83 @@
+#ifndef GEMU_PPU_H
+#define GEMU_PPU_H
+
+#include "game_boy.h"
+#include "stdinc.h"
+
+/**
+ * Number of dots the PPU spends on each line, 4 for every Cpu cycle
+ */
+constexpr int PPU_LINE_DOTS = 456;
+
+/**
+ * Number of dots at the start of a visible line spent scanning OAM (mode 2)
+ */
+constexpr int PPU_OAM_SCAN_DOTS = 80;
+
+/**
+ * Number of dots after OAM scan spent drawing pixels (mode 3), at the least
+ */
+constexpr int PPU_DRAWING_DOTS = 172;
+
+/**
+ * \brief What the PPU is doing, as reported in the low bits of STAT.
+ */
+typedef enum : u8 {
+    PpuMode_HBlank = 0,
+    PpuMode_VBlank = 1,
+    PpuMode_OamScan = 2,
+    PpuMode_Drawing = 3,
+} PpuMode;
+
+/**
+ * \brief Brings the PPU of a GameBoy up to date with how far into the current
+ * video frame it is.
+ *
+ * Updates LY and the mode and coincidence bits of STAT, requesting the VBlank
+ * and STAT interrupts along the way. Every visible line whose mode 3 ended
+ * since the last call is drawn into the framebuffer of the GameBoy, with the
+ * registers as they are now.
+ *
+ * While the LCD is off, LY is held at 0 and nothing is drawn.
+ *
+ * \param gb the GameBoy.
+ * \param progress how far into the current video frame the GameBoy is, from 0
+ * to 1.
+ */
+void Ppu_update(GameBoy *gb, double progress);
+
+/**
+ * \brief Gets the position of the next change of PPU mode.
+ *
+ * \param line_pos the current position, in lines since the start of the frame.
+ *
+ * \return the position of the next mode change, in lines since the start of
+ * the frame. Lines in VBlank count as changing at their end, since LY does.
+ */
+[[nodiscard]] double Ppu_next_mode_change(double line_pos);
+
+/**
+ * \brief Has the lines drawn from a range of VRAM drawn again, after it has
+ * changed.
+ *
+ * \param gb the GameBoy.
+ * \param start the first byte that changed, as an offset into VRAM.
+ * \param end the last byte that changed, as an offset into VRAM.
+ */
+void Ppu_invalidate_vram(GameBoy *gb, size_t start, size_t end);
+
+/**
+ * \brief Has the lines an object was drawn on, along with those it now
+ * covers, drawn again after its slot of OAM has changed.
+ *
+ * \param gb the GameBoy.
+ * \param obj the slot of the object, from 0 to 39.
+ */
+void Ppu_invalidate_object(GameBoy *gb, u8 obj);
+
+/**
+ * \brief Has every line drawn again, as after the framebuffer was cleared.
+ */
+void Ppu_invalidate_lines(GameBoy *gb);
+
+#endif
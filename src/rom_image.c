@@ -0,0 +1,138 @@
+#include "rom_image.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROM_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define ROM_IMAGE_MMAP 0
+#endif
+
+static RomImage *RomImage_wrap(const u8 *const data, const size_t len,
+                               const bool mapped)
+{
+    RomImage *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate ROM image");
+
+    self->data = data;
+    self->len = len;
+    self->mapped = mapped;
+    atomic_init(&self->refs, 1);
+
+    return self;
+}
+
+#if ROM_IMAGE_MMAP
+static RomImage *RomImage_map(const char *const path)
+{
+    const int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    void *data = MAP_FAILED;
+
+    // Empty and special files cannot be mapped, but may still be readable
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping outlives the descriptor
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    return RomImage_wrap(data, st.st_size, true);
+}
+#endif
+
+static RomImage *RomImage_read(const char *const path)
+{
+    FILE *const file = fopen(path, "rb");
+
+    if (file == nullptr)
+        return nullptr;
+
+    size_t capacity = 0x8000;
+    size_t len = 0;
+    u8 *data = malloc(capacity);
+    BAIL_IF_NULL(data, "Could not allocate ROM data");
+
+    while (true) {
+        len += fread(&data[len], 1, capacity - len, file);
+
+        if (len < capacity)
+            break;
+
+        capacity *= 2;
+        data = realloc(data, capacity);
+        BAIL_IF_NULL(data, "Could not allocate ROM data");
+    }
+
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+
+    if (failed) {
+        free(data);
+        return nullptr;
+    }
+
+    return RomImage_wrap(data, len, false);
+}
+
+RomImage *RomImage_open(const char *const path)
+{
+#if ROM_IMAGE_MMAP
+    RomImage *const mapped = RomImage_map(path);
+
+    if (mapped != nullptr)
+        return mapped;
+#endif
+
+    return RomImage_read(path);
+}
+
+RomImage *RomImage_copy(const u8 *const data, const size_t len)
+{
+    u8 *const copy = malloc(len != 0 ? len : 1);
+    BAIL_IF_NULL(copy, "Could not allocate ROM data");
+
+    memcpy(copy, data, len);
+    return RomImage_wrap(copy, len, false);
+}
+
+RomImage *RomImage_retain(RomImage *const self)
+{
+    atomic_fetch_add_explicit(&self->refs, 1, memory_order_relaxed);
+    return self;
+}
+
+void RomImage_release(RomImage *const self)
+{
+    if (self == nullptr)
+        return;
+
+    if (atomic_fetch_sub_explicit(&self->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+#if ROM_IMAGE_MMAP
+    if (self->mapped) {
+        munmap((void *)self->data, self->len);
+        free(self);
+        return;
+    }
+#endif
+
+    free((void *)self->data);
+    free(self);
+}
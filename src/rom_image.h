@@ -0,0 +1,68 @@
+#ifndef GEMU_ROM_IMAGE_H
+#define GEMU_ROM_IMAGE_H
+
+#include "stdinc.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * The contents of a ROM file, shared by every GameBoy it is loaded into.
+ *
+ * Where the platform allows it, the file is mapped read-only into memory
+ * instead of being read, so that only the pages actually used are ever loaded,
+ * and they are shared with every other process running the same file.
+ *
+ * RomImages are reference-counted, and freed once their last reference is
+ * released. They are never written to, so they may be shared across threads.
+ */
+typedef struct RomImage {
+    const u8 *data;
+    size_t len;
+    bool mapped;
+    atomic_size_t refs;
+} RomImage;
+
+/**
+ * \brief Opens a ROM file, mapping it into memory if possible.
+ *
+ * \param path the path to the ROM file.
+ *
+ * \return a new RomImage holding a single reference, or nullptr if the file
+ * could not be read.
+ *
+ * \sa RomImage_release
+ */
+[[nodiscard]] RomImage *RomImage_open(const char *path);
+
+/**
+ * \brief Creates a RomImage from ROM data already in memory.
+ *
+ * The data is copied, so ownership of data is not taken.
+ *
+ * \param data the ROM data.
+ * \param len the length of data.
+ *
+ * \return a new RomImage holding a single reference.
+ *
+ * \sa RomImage_release
+ */
+[[nodiscard]] RomImage *RomImage_copy(const u8 *data, size_t len);
+
+/**
+ * \brief Takes another reference to a RomImage.
+ *
+ * \param self the RomImage.
+ *
+ * \return self, for convenience.
+ */
+RomImage *RomImage_retain(RomImage *self);
+
+/**
+ * \brief Releases a reference to a RomImage, freeing it if it was the last
+ * one.
+ *
+ * \param self the RomImage, which may be nullptr.
+ */
+void RomImage_release(RomImage *self);
+
+#endif
@@ -0,0 +1,290 @@
+// ftruncate and sysconf are only declared for POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include "save_ram.h"
+#include "log.h"
+#include "macros.h"
+#include "stdinc.h"
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SAVE_RAM_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define SAVE_RAM_MMAP 0
+#endif
+
+/**
+ * Length of the chunks dirtiness is tracked in, when data is not mapped
+ */
+static constexpr size_t CHUNK_LEN_UNMAPPED = 0x1000;
+
+/**
+ * The background thread flushing a SaveRam.
+ */
+struct SaveRamFlusher {
+    SDL_Thread *thread;
+    SDL_Mutex *mtx;
+    SDL_Condition *cond;
+    u32 interval_ms;
+    bool quit;
+};
+
+extern inline void SaveRam_mark_dirty(SaveRam *self, size_t offset);
+
+static u8 log2_size(size_t value)
+{
+    u8 shift = 0;
+
+    while (((size_t)1 << (shift + 1)) <= value)
+        shift++;
+
+    return shift;
+}
+
+#if SAVE_RAM_MMAP
+static bool SaveRam_map(SaveRam *const self)
+{
+    const int fd = open(self->path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+
+    if (ok && (size_t)st.st_size < self->len)
+        ok = ftruncate(fd, (off_t)self->len) == 0;
+
+    void *data = MAP_FAILED;
+
+    if (ok)
+        data = mmap(nullptr, self->len, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                    0);
+
+    // The mapping outlives the descriptor
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    // msync only takes whole pages
+    const long page_len = sysconf(_SC_PAGESIZE);
+
+    self->data = data;
+    self->mapped = true;
+    self->chunk_shift = log2_size(page_len > 0 ? (size_t)page_len : 0x1000);
+    return true;
+}
+#endif
+
+static bool SaveRam_read(SaveRam *const self)
+{
+    self->data = calloc(self->len, sizeof(self->data[0]));
+    BAIL_IF_NULL(self->data, "Could not allocate save RAM");
+
+    self->mapped = false;
+    self->chunk_shift = log2_size(CHUNK_LEN_UNMAPPED);
+
+    FILE *file = fopen(self->path, "rb");
+
+    if (file != nullptr) {
+        const size_t read_len = fread(self->data, 1, self->len, file);
+        const bool failed = ferror(file) != 0;
+        fclose(file);
+
+        if (failed)
+            return false;
+
+        // Whatever was missing gets written out in full
+        if (read_len == self->len)
+            return true;
+    }
+
+    file = fopen(self->path, "wb");
+
+    if (file == nullptr)
+        return false;
+
+    const bool ok = fwrite(self->data, 1, self->len, file) == self->len;
+    fclose(file);
+    return ok;
+}
+
+static void SaveRam_flush_chunk(const SaveRam *const self,
+                                FILE *const file, const size_t chunk)
+{
+    const size_t start = chunk << self->chunk_shift;
+    const size_t end = SDL_min(start + ((size_t)1 << self->chunk_shift),
+                               self->len);
+
+#if SAVE_RAM_MMAP
+    if (self->mapped) {
+        if (msync(&self->data[start], end - start, MS_SYNC) != 0)
+            log_warn("Could not flush save RAM to %s", self->path);
+
+        return;
+    }
+#endif
+
+    if (file == nullptr || fseek(file, (long)start, SEEK_SET) != 0 ||
+        fwrite(&self->data[start], 1, end - start, file) != end - start)
+        log_warn("Could not write save RAM to %s", self->path);
+}
+
+void SaveRam_flush(SaveRam *const self)
+{
+    FILE *file = nullptr;
+
+    for (size_t chunk = 0; chunk < self->chunk_count; ++chunk) {
+        // Cleared first, so that writes racing with the flush mark it again
+        if (!atomic_exchange_explicit(&self->dirty[chunk], false,
+                                      memory_order_acquire))
+            continue;
+
+        if (!self->mapped && file == nullptr)
+            file = fopen(self->path, "r+b");
+
+        SaveRam_flush_chunk(self, file, chunk);
+    }
+
+    if (file != nullptr)
+        fclose(file);
+}
+
+static int SaveRam_flusher_fn(void *const data)
+{
+    SaveRam *const self = data;
+    SaveRamFlusher *const flusher = self->flusher;
+
+    SDL_LockMutex(flusher->mtx);
+
+    while (!flusher->quit) {
+        SDL_WaitConditionTimeout(flusher->cond, flusher->mtx,
+                                 (Sint32)flusher->interval_ms);
+
+        if (flusher->quit)
+            break;
+
+        SDL_UnlockMutex(flusher->mtx);
+        SaveRam_flush(self);
+        SDL_LockMutex(flusher->mtx);
+    }
+
+    SDL_UnlockMutex(flusher->mtx);
+    return 0;
+}
+
+static void SaveRam_start_flusher(SaveRam *const self, const u32 interval_ms)
+{
+    SaveRamFlusher *const flusher = malloc(sizeof(*flusher));
+    BAIL_IF_NULL(flusher, "Could not allocate save RAM flusher");
+
+    *flusher = (SaveRamFlusher){
+        .thread = nullptr,
+        .mtx = SDL_CreateMutex(),
+        .cond = SDL_CreateCondition(),
+        .interval_ms = interval_ms,
+        .quit = false,
+    };
+
+    self->flusher = flusher;
+
+    // NOLINTNEXTLINE
+    flusher->thread = SDL_CreateThread(SaveRam_flusher_fn, "Save RAM", self);
+
+    if (flusher->thread == nullptr)
+        log_warn("Could not start flushing save RAM in the background: %s",
+                 SDL_GetError());
+}
+
+static void SaveRam_stop_flusher(SaveRam *const self)
+{
+    SaveRamFlusher *const flusher = self->flusher;
+
+    if (flusher == nullptr)
+        return;
+
+    SDL_LockMutex(flusher->mtx);
+    flusher->quit = true;
+
+    SDL_SignalCondition(flusher->cond);
+    SDL_UnlockMutex(flusher->mtx);
+
+    SDL_WaitThread(flusher->thread, nullptr);
+    SDL_DestroyMutex(flusher->mtx);
+    SDL_DestroyCondition(flusher->cond);
+
+    free(flusher);
+    self->flusher = nullptr;
+}
+
+SaveRam *SaveRam_open(const char *const path, const size_t len,
+                      const u32 flush_interval_ms)
+{
+    BAIL_IF(len == 0, "Save RAM cannot be empty");
+
+    SaveRam *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate save RAM");
+
+    self->len = len;
+    self->path = SDL_strdup(path);
+    self->flusher = nullptr;
+    BAIL_IF_NULL(self->path, "Could not allocate save RAM path");
+
+    bool opened = false;
+
+#if SAVE_RAM_MMAP
+    opened = SaveRam_map(self);
+#endif
+
+    if (!opened && !SaveRam_read(self)) {
+        free(self->data);
+        SDL_free(self->path);
+        free(self);
+        return nullptr;
+    }
+
+    const size_t chunk_len = (size_t)1 << self->chunk_shift;
+    self->chunk_count = (len + chunk_len - 1) / chunk_len;
+    self->dirty = malloc(self->chunk_count * sizeof(self->dirty[0]));
+    BAIL_IF_NULL(self->dirty, "Could not allocate save RAM dirty chunks");
+
+    for (size_t chunk = 0; chunk < self->chunk_count; ++chunk)
+        atomic_init(&self->dirty[chunk], false);
+
+    if (flush_interval_ms != 0)
+        SaveRam_start_flusher(self, flush_interval_ms);
+
+    return self;
+}
+
+void SaveRam_close(SaveRam *const self)
+{
+    if (self == nullptr)
+        return;
+
+    SaveRam_stop_flusher(self);
+    SaveRam_flush(self);
+
+#if SAVE_RAM_MMAP
+    if (self->mapped)
+        munmap(self->data, self->len);
+    else
+        free(self->data);
+#else
+    free(self->data);
+#endif
+
+    free(self->dirty);
+    SDL_free(self->path);
+    free(self);
+}
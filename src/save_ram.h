@@ -0,0 +1,85 @@
+#ifndef GEMU_SAVE_RAM_H
+#define GEMU_SAVE_RAM_H
+
+#include "stdinc.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * Default interval at which a SaveRam flushes its dirty chunks to disk
+ */
+constexpr u32 SAVE_RAM_DEFAULT_FLUSH_INTERVAL_MS = 1000;
+
+typedef struct SaveRamFlusher SaveRamFlusher;
+
+/**
+ * Battery-backed external RAM, persisted to a save file.
+ *
+ * Where the platform allows it, data is a shared mapping of the save file
+ * itself, so that writes land in the page cache right away and survive the
+ * process crashing. Otherwise, data is a copy of the file that is written back
+ * chunk by chunk.
+ *
+ * Writers must call SaveRam_mark_dirty after writing to data. Dirty chunks are
+ * flushed to disk by a background thread, so that writers never wait for the
+ * disk.
+ */
+typedef struct SaveRam {
+    u8 *data;
+    size_t len;
+    bool mapped;
+    u8 chunk_shift;
+    size_t chunk_count;
+    atomic_bool *dirty;
+    char *path;
+    SaveRamFlusher *flusher;
+} SaveRam;
+
+/**
+ * \brief Opens a save file, creating it if it does not exist yet.
+ *
+ * Files shorter than len are padded with zeros. Anything past len is left
+ * alone.
+ *
+ * \param path the path to the save file.
+ * \param len the length of the external RAM.
+ * \param flush_interval_ms how often dirty chunks are flushed to disk, or 0 to
+ * only flush them on SaveRam_flush and SaveRam_close.
+ *
+ * \return the opened SaveRam, or nullptr if the file could not be opened.
+ *
+ * \sa SaveRam_close
+ */
+[[nodiscard]] SaveRam *SaveRam_open(const char *path, size_t len,
+                                    u32 flush_interval_ms);
+
+/**
+ * \brief Flushes any remaining dirty chunks, and frees a SaveRam.
+ *
+ * \param self the SaveRam to close, which may be nullptr.
+ *
+ * \sa SaveRam_open
+ */
+void SaveRam_close(SaveRam *self);
+
+/**
+ * \brief Writes every dirty chunk of a SaveRam to disk, waiting for it to
+ * finish.
+ *
+ * \param self the SaveRam to flush.
+ */
+void SaveRam_flush(SaveRam *self);
+
+/**
+ * \brief Marks the chunk holding a byte as needing to be flushed.
+ *
+ * \param self the SaveRam.
+ * \param offset the offset of the byte that was written into data.
+ */
+inline void SaveRam_mark_dirty(SaveRam *const self, const size_t offset)
+{
+    atomic_store_explicit(&self->dirty[offset >> self->chunk_shift], true,
+                          memory_order_relaxed);
+}
+
+#endif
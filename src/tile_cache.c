@@ -0,0 +1,49 @@
+#include "tile_cache.h"
+#include "macros.h"
+#include "stdinc.h"
+#include "tile_decode.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern inline void TileCache_invalidate(TileCache *self, size_t offset);
+
+TileCache *TileCache_new(const u8 *const vram)
+{
+    TileCache *const self = malloc(sizeof(*self));
+    BAIL_IF_NULL(self, "Could not allocate tile cache");
+
+    self->vram = vram;
+    memset(self->dirty, 0xFF, sizeof(self->dirty));
+
+    return self;
+}
+
+void TileCache_destroy(TileCache *const self)
+{
+    free(self);
+}
+
+/**
+ * Maps each color index to itself, as the cache holds color indices
+ */
+static const u8 COLOR_IDS[4] = {0, 1, 2, 3};
+
+static void TileCache_decode(TileCache *const self, const size_t tile)
+{
+    const u8 *const data = &self->vram[tile * 16];
+
+    decode_2bpp(data, 8, COLOR_IDS, false, &self->pixels[tile][0][0]);
+    decode_2bpp(data, 8, COLOR_IDS, true, &self->flipped[tile][0][0]);
+
+    self->dirty[tile / 64] &= ~((u64)1 << (tile % 64));
+}
+
+const u8 *TileCache_row(TileCache *const self, const size_t tile,
+                        const size_t row, const bool flip)
+{
+    if ((self->dirty[tile / 64] >> (tile % 64)) & 1)
+        TileCache_decode(self, tile);
+
+    return flip ? self->flipped[tile][row] : self->pixels[tile][row];
+}
@@ -0,0 +1,82 @@
+#ifndef GEMU_TILE_CACHE_H
+#define GEMU_TILE_CACHE_H
+
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * Number of tiles in VRAM
+ */
+constexpr size_t TILE_CACHE_TILES = 384;
+
+/**
+ * Length of the tile data at the start of VRAM, which the tile maps follow
+ */
+constexpr size_t TILE_CACHE_DATA_LEN = TILE_CACHE_TILES * 16;
+
+/**
+ * The tiles in VRAM, decoded from 2bpp into a color index per pixel.
+ *
+ * Each tile is decoded both as is and flipped horizontally, the latter for
+ * objects. Tiles are only decoded when they are first drawn after having
+ * changed. The owner of the cache is responsible for calling
+ * TileCache_invalidate whenever tile data in VRAM is written to.
+ */
+typedef struct TileCache {
+    const u8 *vram;
+    u8 pixels[TILE_CACHE_TILES][8][8];
+    u8 flipped[TILE_CACHE_TILES][8][8];
+    u64 dirty[TILE_CACHE_TILES / 64];
+} TileCache;
+
+/**
+ * \brief Allocates a TileCache for the tiles in a VRAM, none of which have
+ * been decoded yet.
+ *
+ * The created TileCache must eventually be freed with TileCache_destroy.
+ *
+ * \param vram the VRAM to decode tiles from, which must outlive the cache.
+ *
+ * \return the allocated TileCache.
+ *
+ * \sa TileCache_destroy
+ */
+[[nodiscard]] TileCache *TileCache_new(const u8 *vram);
+
+/**
+ * \brief Frees a previously-allocated TileCache.
+ *
+ * \param self the TileCache to free. May be NULL.
+ *
+ * \sa TileCache_new
+ */
+void TileCache_destroy(TileCache *self);
+
+/**
+ * \brief Gets a row of a tile as a color index for each of its 8 pixels,
+ * decoding the tile first if it has changed.
+ *
+ * \param self the TileCache.
+ * \param tile the tile, counting from the start of VRAM.
+ * \param row the row, counting from the top.
+ * \param flip whether to get the row flipped horizontally.
+ *
+ * \return the color indices of the row, from left to right.
+ */
+[[nodiscard]] const u8 *TileCache_row(TileCache *self, size_t tile, size_t row,
+                                      bool flip);
+
+/**
+ * \brief Marks the tile holding a byte of VRAM as needing to be decoded again.
+ *
+ * \param self the TileCache.
+ * \param offset the offset into VRAM of the byte that was written. Offsets
+ * past the tile data are ignored.
+ */
+inline void TileCache_invalidate(TileCache *const self, const size_t offset)
+{
+    if (offset < TILE_CACHE_DATA_LEN)
+        self->dirty[offset >> 10] |= (u64)1 << ((offset >> 4) & 63);
+}
+
+#endif
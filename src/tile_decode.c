@@ -0,0 +1,172 @@
+#include "tile_decode.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+void decode_2bpp_scalar(const u8 *const data, const size_t rows,
+                        const u8 palette[4], const bool flip, u8 *const dst)
+{
+    for (size_t row = 0; row < rows; ++row) {
+        const u8 lo = data[row * 2];
+        const u8 hi = data[(row * 2) + 1];
+
+        for (size_t x = 0; x < 8; ++x) {
+            const size_t bit = flip ? x : 7 - x;
+            const u8 id = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+
+            dst[(row * 8) + x] = palette[id];
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+/**
+ * \brief Gets the bit of each pixel within its bitplane byte, for 2 rows.
+ */
+static __m128i pixel_bits(const bool flip)
+{
+    return flip ? _mm_set1_epi64x((long long)0x8040201008040201)
+                : _mm_set1_epi64x((long long)0x0102040810204080);
+}
+
+/**
+ * \brief Decodes 2 rows at a time. SSE2 is part of x86-64, so this is always
+ * available.
+ */
+static void decode_2bpp_sse2(const u8 *const data, const size_t rows,
+                             const u8 palette[4], const bool flip,
+                             u8 *const dst)
+{
+    const __m128i bits = pixel_bits(flip);
+    const __m128i colors[4] = {
+        _mm_set1_epi8((char)palette[0]),
+        _mm_set1_epi8((char)palette[1]),
+        _mm_set1_epi8((char)palette[2]),
+        _mm_set1_epi8((char)palette[3]),
+    };
+
+    size_t row = 0;
+
+    for (; row + 2 <= rows; row += 2) {
+        u32 pair;
+        memcpy(&pair, &data[row * 2], sizeof(pair));
+
+        // Spreads each byte over 8 pixels, giving the low bitplanes of both
+        // rows in one vector and their high bitplanes in another
+        const __m128i bytes = _mm_cvtsi32_si128((int)pair);
+        const __m128i x2 = _mm_unpacklo_epi8(bytes, bytes);
+        const __m128i x4 = _mm_unpacklo_epi16(x2, x2);
+        const __m128i row0 = _mm_unpacklo_epi32(x4, x4);
+        const __m128i row1 = _mm_unpackhi_epi32(x4, x4);
+        const __m128i lo = _mm_unpacklo_epi64(row0, row1);
+        const __m128i hi = _mm_unpackhi_epi64(row0, row1);
+
+        const __m128i lo_set = _mm_cmpeq_epi8(_mm_and_si128(lo, bits), bits);
+        const __m128i hi_set = _mm_cmpeq_epi8(_mm_and_si128(hi, bits), bits);
+        const __m128i ids =
+            _mm_or_si128(_mm_and_si128(lo_set, _mm_set1_epi8(1)),
+                         _mm_and_si128(hi_set, _mm_set1_epi8(2)));
+
+        // Without a byte shuffle, each color is selected where it applies
+        __m128i out = _mm_setzero_si128();
+
+        for (int id = 0; id < 4; ++id) {
+            const __m128i is_id = _mm_cmpeq_epi8(ids, _mm_set1_epi8((char)id));
+            out = _mm_or_si128(out, _mm_and_si128(is_id, colors[id]));
+        }
+
+        _mm_storeu_si128((__m128i *)&dst[row * 8], out);
+    }
+
+    decode_2bpp_scalar(&data[row * 2], rows - row, palette, flip,
+                       &dst[row * 8]);
+}
+
+/**
+ * \brief Decodes 4 rows at a time, 2 in each 128-bit lane.
+ */
+__attribute__((target("avx2"))) static void
+decode_2bpp_avx2(const u8 *const data, const size_t rows, const u8 palette[4],
+                 const bool flip, u8 *const dst)
+{
+    // Which byte of the 4 rows each pixel takes its bitplanes from
+    const __m256i lo_bytes = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+        6, 6, 6, 6, 6, 6, 6, 6);
+    const __m256i hi_bytes = _mm256_add_epi8(lo_bytes, _mm256_set1_epi8(1));
+
+    const __m256i bits = _mm256_broadcastsi128_si256(pixel_bits(flip));
+
+    u32 palette_bytes;
+    memcpy(&palette_bytes, palette, sizeof(palette_bytes));
+    const __m256i colors = _mm256_set1_epi32((int)palette_bytes);
+
+    size_t row = 0;
+
+    for (; row + 4 <= rows; row += 4) {
+        u64 quad;
+        memcpy(&quad, &data[row * 2], sizeof(quad));
+
+        const __m256i bytes = _mm256_set1_epi64x((long long)quad);
+        const __m256i lo = _mm256_shuffle_epi8(bytes, lo_bytes);
+        const __m256i hi = _mm256_shuffle_epi8(bytes, hi_bytes);
+
+        const __m256i lo_set =
+            _mm256_cmpeq_epi8(_mm256_and_si256(lo, bits), bits);
+        const __m256i hi_set =
+            _mm256_cmpeq_epi8(_mm256_and_si256(hi, bits), bits);
+        const __m256i ids =
+            _mm256_or_si256(_mm256_and_si256(lo_set, _mm256_set1_epi8(1)),
+                            _mm256_and_si256(hi_set, _mm256_set1_epi8(2)));
+
+        _mm256_storeu_si256((__m256i *)&dst[row * 8],
+                            _mm256_shuffle_epi8(colors, ids));
+    }
+
+    decode_2bpp_sse2(&data[row * 2], rows - row, palette, flip, &dst[row * 8]);
+}
+
+#endif
+
+static Decode2bppKernel *kernel = nullptr;
+static const char *kernel_name = nullptr;
+
+static void select_kernel()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        kernel = decode_2bpp_avx2;
+        kernel_name = "avx2";
+    } else {
+        kernel = decode_2bpp_sse2;
+        kernel_name = "sse2";
+    }
+#else
+    kernel = decode_2bpp_scalar;
+    kernel_name = "scalar";
+#endif
+}
+
+void decode_2bpp(const u8 *const data, const size_t rows, const u8 palette[4],
+                 const bool flip, u8 *const dst)
+{
+    if (kernel == nullptr)
+        select_kernel();
+
+    kernel(data, rows, palette, flip, dst);
+}
+
+const char *decode_2bpp_kernel_name()
+{
+    if (kernel == nullptr)
+        select_kernel();
+
+    return kernel_name;
+}
@@ -0,0 +1,54 @@
+#ifndef GEMU_TILE_DECODE_H
+#define GEMU_TILE_DECODE_H
+
+#include "stdinc.h"
+#include <stddef.h>
+
+/**
+ * A kernel decoding rows of 2bpp tile data, with the parameters of
+ * decode_2bpp
+ */
+typedef void Decode2bppKernel(const u8 *data, size_t rows, const u8 palette[4],
+                              bool flip, u8 *dst);
+
+/**
+ * \brief Decodes rows of 2bpp tile data into a color for each of their 8
+ * pixels.
+ *
+ * Each row is a pair of bytes, the first holding the low bit of the color
+ * index of every pixel and the second the high one, leftmost pixel first. The
+ * color indices are mapped through the palette as they are decoded.
+ *
+ * Uses the fastest kernel the host CPU supports, which is picked on the first
+ * call.
+ *
+ * \param data the rows to decode, 2 bytes each.
+ * \param rows the number of rows.
+ * \param palette the color of each color index. Pass {0, 1, 2, 3} to get the
+ * color indices themselves.
+ * \param flip whether to decode the rows flipped horizontally.
+ * \param dst where to write the colors, 8 per row.
+ *
+ * \sa decode_2bpp_kernel_name
+ */
+void decode_2bpp(const u8 *data, size_t rows, const u8 palette[4], bool flip,
+                 u8 *dst);
+
+/**
+ * \brief Decodes rows of 2bpp tile data like decode_2bpp, one pixel at a time.
+ *
+ * This is the kernel decode_2bpp falls back to on CPUs without a faster one.
+ *
+ * \sa decode_2bpp
+ */
+void decode_2bpp_scalar(const u8 *data, size_t rows, const u8 palette[4],
+                        bool flip, u8 *dst);
+
+/**
+ * \brief Gets the name of the kernel decode_2bpp uses on the host CPU.
+ *
+ * \return "avx2", "sse2" or "scalar".
+ */
+[[nodiscard]] const char *decode_2bpp_kernel_name();
+
+#endif
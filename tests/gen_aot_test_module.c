@@ -0,0 +1,30 @@
+#include "aot.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <stdio.h>
+
+/*
+ * Translates the ROM of load_aot_test_rom into the module test_aot.c runs,
+ * writing it to the path given as the only argument.
+ */
+int main(const int argc, const char *const argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output>\n", argv[0]);
+        return 1;
+    }
+
+    static u8 rom[TEST_ROM_LEN];
+    load_aot_test_rom(rom);
+
+    FILE *const out = fopen(argv[1], "w");
+
+    if (out == nullptr) {
+        fprintf(stderr, "Could not open output file %s\n", argv[1]);
+        return 1;
+    }
+
+    Aot_emit(out, rom, sizeof(rom), "the AOT test ROM");
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "aot.h"
+#include "cpu.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static u8 rom[TEST_ROM_LEN];
+static bool is_code[AOT_CODE_LEN];
+
+/*
+ * Translated from load_aot_test_rom at build time, and linked in instead of
+ * being loaded
+ */
+const AotModule *gemu_aot_module();
+
+static void load_program(const u16 addr, const u8 *const program,
+                         const size_t len)
+{
+    memset(rom, 0xC9, sizeof(rom)); // ret everywhere
+    memcpy(&rom[addr], program, len);
+}
+
+void test_aot_follows_control_flow()
+{
+    static const u8 program[] = {
+        0x00,             // $0100: nop
+        0xC3, 0x50, 0x01, // $0101: jp $0150
+    };
+
+    static const u8 body[] = {
+        0xCD, 0x00, 0x20, // $0150: call $2000
+        0x20, 0xFB,       // $0153: jr nz, $0150
+        0x18, 0x01,       // $0155: jr $0158
+        0x00,             // $0157: (skipped)
+        0xE9,             // $0158: jp hl
+    };
+
+    load_program(0x0100, program, sizeof(program));
+    memcpy(&rom[0x0150], body, sizeof(body));
+
+    Aot_find_code(rom, sizeof(rom), is_code);
+
+    TEST_ASSERT_TRUE(is_code[0x0100]);
+    TEST_ASSERT_TRUE(is_code[0x0101]);
+    TEST_ASSERT_FALSE(is_code[0x0102]);
+    TEST_ASSERT_FALSE(is_code[0x0104]);
+    TEST_ASSERT_TRUE(is_code[0x0150]);
+    TEST_ASSERT_TRUE(is_code[0x0153]);
+    TEST_ASSERT_TRUE(is_code[0x0155]);
+    TEST_ASSERT_FALSE(is_code[0x0157]);
+    TEST_ASSERT_TRUE(is_code[0x0158]);
+    TEST_ASSERT_FALSE(is_code[0x0159]);
+    TEST_ASSERT_TRUE(is_code[0x2000]);
+    TEST_ASSERT_FALSE(is_code[0x2001]);
+    TEST_ASSERT_TRUE(is_code[0x0038]);
+    TEST_ASSERT_TRUE(is_code[0x0040]);
+}
+
+void test_aot_stops_at_removed_opcodes()
+{
+    static const u8 program[] = {
+        0x00, // $0100: nop
+        0xD3, // $0101: (removed)
+        0x00, // $0102: nop
+    };
+
+    load_program(0x0100, program, sizeof(program));
+
+    Aot_find_code(rom, sizeof(rom), is_code);
+
+    TEST_ASSERT_TRUE(is_code[0x0100]);
+    TEST_ASSERT_FALSE(is_code[0x0101]);
+    TEST_ASSERT_FALSE(is_code[0x0102]);
+}
+
+void test_aot_emits_module()
+{
+    static const u8 program[] = {
+        0x3E, 0x2A, // $0100: ld a, $2A
+        0xCB, 0x37, // $0102: swap a
+        0x76,       // $0104: halt
+        0xC9,       // $0105: ret
+    };
+
+    load_program(0x0100, program, sizeof(program));
+
+    FILE *const out = tmpfile();
+    TEST_ASSERT_NOT_NULL(out);
+
+    Aot_emit(out, rom, sizeof(rom), "test.gb");
+
+    static char source[0x40000];
+    rewind(out);
+    source[fread(source, 1, sizeof(source) - 1, out)] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_NOT_NULL(strstr(source, "case 0x0100: // 3E 2A\n"
+                                        "        cpu->pc = 0x0102;\n"
+                                        "        cpu->cycle_count += 2;\n"));
+    TEST_ASSERT_NOT_NULL(strstr(source, "const u16 imm = 0x002A;"));
+    TEST_ASSERT_NOT_NULL(
+        strstr(source, "Cpu_instr_swap_r8(cpu, mem, CpuTableR_A);"));
+    TEST_ASSERT_NOT_NULL(strstr(source, "case 0x0104: // 76\n"));
+    TEST_ASSERT_NOT_NULL(strstr(source, "case 0x0105: // C9\n"));
+    TEST_ASSERT_NULL(strstr(source, "case 0x0106:"));
+
+    char hash[32];
+    snprintf(hash, sizeof(hash), ".rom_hash = 0x%08X,",
+             Aot_hash_rom(rom, sizeof(rom)));
+    TEST_ASSERT_NOT_NULL(strstr(source, hash));
+}
+
+void test_aot_module_matches_interpreter()
+{
+    const AotModule *const module = gemu_aot_module();
+
+    load_aot_test_rom(rom);
+    TEST_ASSERT_TRUE(AotModule_matches(module, rom, sizeof(rom)));
+
+    Memory mem = flat_memory(flat_ram);
+
+    memset(flat_ram, 0, sizeof(flat_ram));
+    memcpy(flat_ram, rom, sizeof(rom));
+
+    Cpu interpreted = Cpu_new();
+    interpreted.pc = 0x0100;
+
+    while (interpreted.mode == CpuMode_Running)
+        Cpu_tick(&interpreted, &mem);
+
+    u8 expected_ram[0x10];
+    memcpy(expected_ram, &flat_ram[0xC000], sizeof(expected_ram));
+    memset(&flat_ram[0xC000], 0, 0x2000);
+
+    Cpu translated = Cpu_new();
+    translated.pc = 0x0100;
+
+    while (translated.mode == CpuMode_Running)
+        module->step(&translated, &mem);
+
+    TEST_ASSERT_EQUAL_HEX8(interpreted.a, translated.a);
+    TEST_ASSERT_EQUAL_HEX8(Cpu_read_f(&interpreted), Cpu_read_f(&translated));
+    TEST_ASSERT_EQUAL_HEX16(Cpu_read_rp(&interpreted, CpuTableRp_BC),
+                            Cpu_read_rp(&translated, CpuTableRp_BC));
+    TEST_ASSERT_EQUAL_HEX16(Cpu_read_rp(&interpreted, CpuTableRp_DE),
+                            Cpu_read_rp(&translated, CpuTableRp_DE));
+    TEST_ASSERT_EQUAL_HEX16(Cpu_read_rp(&interpreted, CpuTableRp_HL),
+                            Cpu_read_rp(&translated, CpuTableRp_HL));
+    TEST_ASSERT_EQUAL_HEX16(interpreted.sp, translated.sp);
+    TEST_ASSERT_EQUAL_HEX16(interpreted.pc, translated.pc);
+    TEST_ASSERT_EQUAL(interpreted.cycle_count, translated.cycle_count);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_ram, &flat_ram[0xC000],
+                                 sizeof(expected_ram));
+}
+
+void test_aot_module_steps_aside_during_oam_dma()
+{
+    const AotModule *const module = gemu_aot_module();
+
+    load_aot_test_rom(rom);
+    GameBoy gb = new_game_boy(nullptr, rom);
+    GameBoy_write_mem(&gb, 0xFF50, 0x01);
+
+    TEST_ASSERT_TRUE(GameBoy_set_aot_module(&gb, module));
+    TEST_ASSERT_EQUAL_PTR(module, gb.cpu.aot);
+
+    // ROM reads as $FF until the transfer ends, which the module cannot know
+    GameBoy_write_mem(&gb, 0xFF46, 0xC0);
+    TEST_ASSERT_NULL(gb.cpu.aot);
+
+    GameBoy_step_dma(&gb, GB_OAM_DMA_CYCLES);
+    TEST_ASSERT_EQUAL_PTR(module, gb.cpu.aot);
+
+    GameBoy_destroy(&gb);
+}
@@ -0,0 +1,77 @@
+#include "cheats.h"
+#include "stdinc.h"
+#include <string.h>
+#include <unity.h>
+
+static u8 rom[0x10000];
+
+void test_cheats_parse_gameshark()
+{
+    Cheat cheat;
+
+    TEST_ASSERT_TRUE(Cheat_parse("0163D2C1", &cheat));
+    TEST_ASSERT_EQUAL(CheatKind_RamFreeze, cheat.kind);
+    TEST_ASSERT_EQUAL_HEX16(0xC1D2, cheat.addr);
+    TEST_ASSERT_EQUAL_HEX8(0x63, cheat.value);
+    TEST_ASSERT_FALSE(cheat.has_compare);
+
+    // High RAM, but not I/O registers or ROM
+    TEST_ASSERT_TRUE(Cheat_parse("01ff80ff", &cheat));
+    TEST_ASSERT_EQUAL_HEX16(0xFF80, cheat.addr);
+    TEST_ASSERT_FALSE(Cheat_parse("010140FF", &cheat));
+    TEST_ASSERT_FALSE(Cheat_parse("01000040", &cheat));
+}
+
+void test_cheats_parse_game_genie()
+{
+    Cheat cheat;
+
+    TEST_ASSERT_TRUE(Cheat_parse("3EA-17B", &cheat));
+    TEST_ASSERT_EQUAL(CheatKind_RomPatch, cheat.kind);
+    TEST_ASSERT_EQUAL_HEX16(0x4A17, cheat.addr);
+    TEST_ASSERT_EQUAL_HEX8(0x3E, cheat.value);
+    TEST_ASSERT_FALSE(cheat.has_compare);
+
+    // $12 ^ $BA = $A8, rotated left by 2 into G and I
+    TEST_ASSERT_TRUE(Cheat_parse("3EA-17B-A02", &cheat));
+    TEST_ASSERT_TRUE(cheat.has_compare);
+    TEST_ASSERT_EQUAL_HEX8(0x12, cheat.compare);
+
+    // Out of ROM, too short, and not hex at all
+    TEST_ASSERT_FALSE(Cheat_parse("3EA-170", &cheat));
+    TEST_ASSERT_FALSE(Cheat_parse("3EA-17", &cheat));
+    TEST_ASSERT_FALSE(Cheat_parse("3EA-17B-A0G", &cheat));
+    TEST_ASSERT_FALSE(Cheat_parse("", &cheat));
+}
+
+void test_cheats_patch_only_matching_banks()
+{
+    memset(rom, 0, sizeof(rom));
+    rom[0x0A17] = 0x12;
+    rom[2 * 0x4000 + 0x0A17] = 0x12;
+
+    Cheats *const cheats = Cheats_new();
+    Cheat cheat;
+
+    TEST_ASSERT_TRUE(Cheat_parse("3EA-17B-A02", &cheat));
+    Cheats_add(cheats, &cheat, rom, sizeof(rom));
+
+    // Bank 0 holds the compare value too, and some mappers map it at $4000
+    TEST_ASSERT_NOT_NULL(Cheats_rom_page(cheats, 0x4A, 0));
+    TEST_ASSERT_NULL(Cheats_rom_page(cheats, 0x4A, 1));
+    TEST_ASSERT_NULL(Cheats_rom_page(cheats, 0x4B, 2));
+    TEST_ASSERT_NULL(Cheats_rom_page(cheats, 0x0A, 0));
+
+    const u8 *const page = Cheats_rom_page(cheats, 0x4A, 2);
+    TEST_ASSERT_NOT_NULL(page);
+    TEST_ASSERT_EQUAL_HEX8(0x3E, page[0x17]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&rom[2 * 0x4000 + 0x0A00], page, 0x17);
+
+    // ROM itself is never touched
+    TEST_ASSERT_EQUAL_HEX8(0x12, rom[2 * 0x4000 + 0x0A17]);
+
+    Cheats_clear(cheats);
+    TEST_ASSERT_NULL(Cheats_rom_page(cheats, 0x4A, 2));
+
+    Cheats_destroy(cheats);
+}
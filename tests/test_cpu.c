@@ -17,9 +17,198 @@ void test_cpu_new()
     TEST_ASSERT_EQUAL(cpu.l, 0);
     TEST_ASSERT_EQUAL(cpu.a, 0);
     TEST_ASSERT_EQUAL(cpu.f, 0);
+    TEST_ASSERT_EQUAL(cpu.flags_op, CpuFlagsOp_None);
     TEST_ASSERT_EQUAL(cpu.sp, 0);
     TEST_ASSERT_EQUAL(cpu.pc, 0);
     TEST_ASSERT_EQUAL(cpu.mode, CpuMode_Running);
     TEST_ASSERT_EQUAL(cpu.ime, true);
     TEST_ASSERT_EQUAL(cpu.cycle_count, 0);
 }
+
+void test_cpu_lazy_flags()
+{
+    Cpu cpu = Cpu_new();
+
+    // $10 - $01, borrowing from bit 4 but not from bit 8
+    Cpu_set_flags_op(&cpu, CpuFlagsOp_Sub, 0x10, 0x01, 0x000F);
+    TEST_ASSERT_EQUAL_HEX8(CpuFlag_N | CpuFlag_H, Cpu_read_f(&cpu));
+    TEST_ASSERT_FALSE(Cpu_read_cc(&cpu, CpuTableCc_Z));
+
+    // $FF + $01, carrying out of both nibbles
+    Cpu_set_flags_op(&cpu, CpuFlagsOp_Add, 0xFF, 0x01, 0x0100);
+    TEST_ASSERT_EQUAL_HEX8(CpuFlag_Z | CpuFlag_H | CpuFlag_C, Cpu_read_f(&cpu));
+    TEST_ASSERT_TRUE(Cpu_read_cc(&cpu, CpuTableCc_C));
+
+    Cpu_set_flags_op(&cpu, CpuFlagsOp_Carry, 0, 0, 0x0100);
+    TEST_ASSERT_EQUAL_HEX8(CpuFlag_C, Cpu_read_f(&cpu));
+
+    // push af sees the same flags, and pop af replaces them all
+    TEST_ASSERT_EQUAL_HEX8(CpuFlag_C, Cpu_read_rp2(&cpu, CpuTableRp2_AF));
+
+    Cpu_write_rp2(&cpu, CpuTableRp2_AF, 0x12F7);
+    TEST_ASSERT_EQUAL_HEX8(0xF0, Cpu_read_f(&cpu));
+    TEST_ASSERT_EQUAL(CpuFlagsOp_None, cpu.flags_op);
+
+    Cpu_set_flags_op(&cpu, CpuFlagsOp_And, 0, 0, 0x0000);
+    Cpu_materialize_flags(&cpu);
+    TEST_ASSERT_EQUAL_HEX8(CpuFlag_Z | CpuFlag_H, cpu.f);
+}
+
+void test_cpu_register_file()
+{
+    Cpu cpu = Cpu_new();
+
+    Cpu_write_rp(&cpu, CpuTableRp_BC, 0x0102);
+    Cpu_write_rp(&cpu, CpuTableRp_DE, 0x0304);
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0x0506);
+    Cpu_write_rp(&cpu, CpuTableRp_SP, 0xFFFE);
+    cpu.a = 0x07;
+
+    TEST_ASSERT_EQUAL_HEX8(0x01, cpu.b);
+    TEST_ASSERT_EQUAL_HEX8(0x02, cpu.c);
+    TEST_ASSERT_EQUAL_HEX8(0x03, cpu.d);
+    TEST_ASSERT_EQUAL_HEX8(0x04, cpu.e);
+    TEST_ASSERT_EQUAL_HEX8(0x05, cpu.h);
+    TEST_ASSERT_EQUAL_HEX8(0x06, cpu.l);
+    TEST_ASSERT_EQUAL_HEX16(0xFFFE, cpu.sp);
+
+    // Every register but [hl] must be reachable without touching memory
+    static const CpuTableR regs[] = {
+        CpuTableR_B, CpuTableR_C, CpuTableR_D, CpuTableR_E,
+        CpuTableR_H, CpuTableR_L, CpuTableR_A,
+    };
+    static const u8 expected[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+
+    for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]); ++i) {
+        TEST_ASSERT_EQUAL_HEX8(expected[i],
+                               Cpu_read_r(&cpu, nullptr, regs[i]));
+
+        Cpu_write_r(&cpu, nullptr, regs[i], 0xA0 + i);
+        TEST_ASSERT_EQUAL_HEX8(0xA0 + i, Cpu_read_r(&cpu, nullptr, regs[i]));
+    }
+
+    TEST_ASSERT_EQUAL_HEX16(0xA0A1, Cpu_read_rp2(&cpu, CpuTableRp2_BC));
+    TEST_ASSERT_EQUAL_HEX16(0xA2A3, Cpu_read_rp2(&cpu, CpuTableRp2_DE));
+    TEST_ASSERT_EQUAL_HEX16(0xA4A5, Cpu_read_rp2(&cpu, CpuTableRp2_HL));
+    TEST_ASSERT_EQUAL_HEX16(0xA600, Cpu_read_rp2(&cpu, CpuTableRp2_AF));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFE, Cpu_read_rp(&cpu, CpuTableRp_SP));
+    TEST_ASSERT_EQUAL(0, cpu.cycle_count);
+}
+
+typedef struct {
+    u8 data[0x10000];
+    int cycles;
+    int write_cycle;
+} CycleRam;
+
+static u8 read_cycle_ram(const void *const ctx, const u16 addr)
+{
+    const CycleRam *const ram = ctx;
+    return ram->data[addr];
+}
+
+static void write_cycle_ram(void *const ctx, const u16 addr, const u8 value)
+{
+    CycleRam *const ram = ctx;
+    ram->data[addr] = value;
+    ram->write_cycle = ram->cycles;
+}
+
+static void count_cycle(void *const ctx)
+{
+    CycleRam *const ram = ctx;
+    ++ram->cycles;
+}
+
+void test_cpu_accurate_tier()
+{
+    static CycleRam ram = {};
+
+    // ld [$C000], a
+    ram.data[0x0150] = 0xEA;
+    ram.data[0x0151] = 0x00;
+    ram.data[0x0152] = 0xC0;
+
+    Memory mem = (Memory){
+        .ctx = &ram,
+        .read = read_cycle_ram,
+        .write = write_cycle_ram,
+    };
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+    cpu.a = 0x42;
+    cpu.on_cycle = count_cycle;
+    cpu.on_cycle_ctx = &ram;
+
+    Cpu_tick_accurate(&cpu, &mem);
+
+    // The write happens on the last of 4 cycles, after the 3 fetches
+    TEST_ASSERT_EQUAL_HEX8(0x42, ram.data[0xC000]);
+    TEST_ASSERT_EQUAL(3, ram.write_cycle);
+    TEST_ASSERT_EQUAL(4, ram.cycles);
+    TEST_ASSERT_EQUAL(4, cpu.cycle_count);
+
+    // A halted Cpu still spends a cycle at a time
+    cpu.mode = CpuMode_Halted;
+    Cpu_tick_accurate(&cpu, &mem);
+    TEST_ASSERT_EQUAL(5, ram.cycles);
+}
+
+void test_cpu_accurate_interrupt()
+{
+    static CycleRam ram = {};
+
+    Memory mem = (Memory){
+        .ctx = &ram,
+        .read = read_cycle_ram,
+        .write = write_cycle_ram,
+    };
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+    cpu.sp = 0xFFFE;
+    cpu.on_cycle = count_cycle;
+    cpu.on_cycle_ctx = &ram;
+
+    Cpu_interrupt_accurate(&cpu, &mem, 0x48);
+
+    // pc is pushed after 2 wait states, and the jump takes one more cycle
+    TEST_ASSERT_EQUAL_HEX8(0x50, ram.data[0xFFFC]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, ram.data[0xFFFD]);
+    TEST_ASSERT_EQUAL(3, ram.write_cycle);
+    TEST_ASSERT_EQUAL(5, ram.cycles);
+    TEST_ASSERT_EQUAL(5, cpu.cycle_count);
+
+    TEST_ASSERT_EQUAL_HEX16(0x0048, cpu.pc);
+    TEST_ASSERT_EQUAL_HEX16(0xFFFC, cpu.sp);
+    TEST_ASSERT_FALSE(cpu.ime);
+}
+
+void test_cpu_flat_memory()
+{
+    static u8 ram[CPU_FLAT_MEMORY_LEN] = {};
+
+    // ld [$C000], a
+    ram[0x0150] = 0xEA;
+    ram[0x0151] = 0x00;
+    ram[0x0152] = 0xC0;
+    // ld hl, $C000
+    ram[0x0153] = 0x21;
+    ram[0x0154] = 0x00;
+    ram[0x0155] = 0xC0;
+    // inc [hl]
+    ram[0x0156] = 0x34;
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+    cpu.a = 0x42;
+
+    Cpu_tick_flat(&cpu, ram);
+    Cpu_tick_flat(&cpu, ram);
+    Cpu_tick_flat(&cpu, ram);
+
+    TEST_ASSERT_EQUAL_HEX8(0x43, ram[0xC000]);
+    TEST_ASSERT_EQUAL_HEX16(0x0157, cpu.pc);
+    TEST_ASSERT_EQUAL(4 + 3 + 3, cpu.cycle_count);
+}
@@ -1,4 +1,5 @@
 #include "cpu.h"
+#include "jit.h"
 #include "stdinc.h"
 #include <cjson/cJSON.h>
 #include <dirent.h>
@@ -103,11 +104,22 @@ static void CpuState_destroy(CpuState *const state)
     state->ram_len = 0;
 }
 
+static void count_cycle(void *const ctx)
+{
+    int *const cycles = ctx;
+    ++*cycles;
+}
+
 static void run_cpu_tick_test(const CpuState *const initial_state,
                               const CpuState *const final_state,
-                              const char *const test_name)
+                              const char *const test_name, Jit *const jit,
+                              const CpuTier tier, const bool flat)
 {
     Cpu cpu = Cpu_new();
+    cpu.jit = jit;
+
+    if (jit != nullptr)
+        Jit_flush(jit);
 
     DumbRam dumb_ram = {};
 
@@ -136,10 +148,25 @@ static void run_cpu_tick_test(const CpuState *const initial_state,
         dumb_ram.active[entry->address] = true;
     }
 
-    Cpu_tick(&cpu, &mock_memory);
+    int reported_cycles = 0;
+    cpu.on_cycle = count_cycle;
+    cpu.on_cycle_ctx = &reported_cycles;
+
+    if (flat)
+        Cpu_tick_flat(&cpu, dumb_ram.data);
+    else if (tier == CpuTier_Accurate)
+        Cpu_tick_accurate(&cpu, &mock_memory);
+    else
+        Cpu_tick(&cpu, &mock_memory);
 
     char msg_buffer[32];
 
+    if (tier == CpuTier_Accurate) {
+        snprintf(msg_buffer, sizeof(msg_buffer), "(%s, cycles)", test_name);
+        TEST_ASSERT_EQUAL_MESSAGE(cpu.cycle_count, reported_cycles,
+                                  msg_buffer);
+    }
+
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, pc)", test_name);
     TEST_ASSERT_EQUAL_HEX16_MESSAGE(final_state->pc, cpu.pc, msg_buffer);
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, sp)", test_name);
@@ -155,7 +182,8 @@ static void run_cpu_tick_test(const CpuState *const initial_state,
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, e)", test_name);
     TEST_ASSERT_EQUAL_HEX8_MESSAGE(final_state->e, cpu.e, msg_buffer);
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, f)", test_name);
-    TEST_ASSERT_EQUAL_HEX8_MESSAGE(final_state->f, cpu.f, msg_buffer);
+    TEST_ASSERT_EQUAL_HEX8_MESSAGE(final_state->f, Cpu_read_f(&cpu),
+                                   msg_buffer);
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, h)", test_name);
     TEST_ASSERT_EQUAL_HEX8_MESSAGE(final_state->h, cpu.h, msg_buffer);
     snprintf(msg_buffer, sizeof(msg_buffer), "(%s, l)", test_name);
@@ -173,7 +201,8 @@ static void run_cpu_tick_test(const CpuState *const initial_state,
     }
 }
 
-static void run_opcode_test_file(const char *const filepath)
+static void run_opcode_test_file(const char *const filepath, Jit *const jit,
+                                 const CpuTier tier, const bool flat)
 {
     FILE *const file = fopen(filepath, "r");
     TEST_ASSERT_NOT_NULL_MESSAGE(file, "could not open JSON file");
@@ -206,7 +235,8 @@ static void run_opcode_test_file(const char *const filepath)
         CpuState final_state = CpuState_from_cjson(final);
         TEST_ASSERT_EQUAL(initial_state.ram_len, final_state.ram_len);
 
-        run_cpu_tick_test(&initial_state, &final_state, name->valuestring);
+        run_cpu_tick_test(&initial_state, &final_state, name->valuestring,
+                          jit, tier, flat);
 
         CpuState_destroy(&initial_state);
         CpuState_destroy(&final_state);
@@ -222,7 +252,8 @@ static int dirent_filter(const struct dirent *const entry)
     return entry->d_type == DT_REG && entry->d_name[0] != '.';
 }
 
-void test_cpu_opcodes()
+static void run_opcode_test_files(Jit *const jit, const CpuTier tier,
+                                  const bool flat)
 {
     struct dirent **entries = nullptr;
     const int entries_len =
@@ -238,8 +269,43 @@ void test_cpu_opcodes()
                  entry->d_name);
         free(entry);
 
-        run_opcode_test_file(full_path);
+        run_opcode_test_file(full_path, jit, tier, flat);
     }
 
     free((void *)entries);
 }
+
+void test_cpu_opcodes()
+{
+    run_opcode_test_files(nullptr, CpuTier_Fast, false);
+}
+
+void test_cpu_opcodes_accurate()
+{
+    run_opcode_test_files(nullptr, CpuTier_Accurate, false);
+}
+
+void test_cpu_opcodes_flat()
+{
+    // Accesses to inactive memory go unnoticed, since mem is bypassed
+    run_opcode_test_files(nullptr, CpuTier_Fast, true);
+}
+
+void test_cpu_opcodes_jit()
+{
+    Jit *const jit = Jit_new();
+
+    if (jit == nullptr)
+        TEST_IGNORE_MESSAGE("JIT not supported on this host");
+
+    // Compile every instruction on its own, as soon as it is reached, and
+    // never run past it, since nothing else is mapped in
+    Jit_set_cacheable(jit, 0x0000, 0xFFFF);
+    jit->hot_threshold = 0;
+    jit->max_block_len = 1;
+    jit->cycle_budget = 1;
+
+    run_opcode_test_files(jit, CpuTier_Fast, false);
+
+    Jit_destroy(jit);
+}
@@ -0,0 +1,123 @@
+#include "cpu.h"
+#include "decode_cache.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <unity.h>
+
+void test_decode_cache_uncacheable_page()
+{
+    DecodeCache *const cache = DecodeCache_new();
+    DecodeCache_set_cacheable(cache, 0xC000, 0xDFFF);
+    const Memory mem = flat_memory(flat_ram);
+
+    TEST_ASSERT_NULL(DecodeCache_fetch(cache, &mem, 0x0100));
+    TEST_ASSERT_NOT_NULL(DecodeCache_fetch(cache, &mem, 0xC000));
+
+    DecodeCache_destroy(cache);
+}
+
+void test_decode_cache_block()
+{
+    DecodeCache *const cache = DecodeCache_new();
+    DecodeCache_set_cacheable(cache, 0xC000, 0xDFFF);
+    const Memory mem = flat_memory(flat_ram);
+
+    flat_ram[0xC000] = 0x3E; // ld a, $42
+    flat_ram[0xC001] = 0x42;
+    flat_ram[0xC002] = 0x21; // ld hl, $1234
+    flat_ram[0xC003] = 0x34;
+    flat_ram[0xC004] = 0x12;
+    flat_ram[0xC005] = 0x18; // jr -7
+    flat_ram[0xC006] = 0xF9;
+
+    const DecodedInstr *const ld_a = DecodeCache_fetch(cache, &mem, 0xC000);
+    TEST_ASSERT_NOT_NULL(ld_a);
+    TEST_ASSERT_EQUAL(2, ld_a->len);
+    TEST_ASSERT_EQUAL_HEX(0x42, ld_a->imm);
+    TEST_ASSERT_FALSE(ld_a->ends_block);
+
+    const DecodedInstr *const ld_hl = DecodeCache_fetch(cache, &mem, 0xC002);
+    TEST_ASSERT_EQUAL_PTR(ld_a + 1, ld_hl);
+    TEST_ASSERT_EQUAL(3, ld_hl->len);
+    TEST_ASSERT_EQUAL_HEX(0x1234, ld_hl->imm);
+
+    const DecodedInstr *const jr = DecodeCache_fetch(cache, &mem, 0xC005);
+    TEST_ASSERT_EQUAL_PTR(ld_a + 2, jr);
+    TEST_ASSERT_TRUE(jr->ends_block);
+
+    DecodeCache_destroy(cache);
+}
+
+void test_decode_cache_block_stops_at_page_end()
+{
+    DecodeCache *const cache = DecodeCache_new();
+    DecodeCache_set_cacheable(cache, 0xC000, 0xDFFF);
+    const Memory mem = flat_memory(flat_ram);
+
+    flat_ram[0xC0FE] = 0x00; // nop
+    flat_ram[0xC0FF] = 0x3E; // ld a, $42 (spills into the next page)
+    flat_ram[0xC100] = 0x42;
+
+    const DecodedInstr *const nop = DecodeCache_fetch(cache, &mem, 0xC0FE);
+    TEST_ASSERT_NOT_NULL(nop);
+    TEST_ASSERT_TRUE(nop->ends_block);
+
+    TEST_ASSERT_NULL(DecodeCache_fetch(cache, &mem, 0xC0FF));
+
+    DecodeCache_destroy(cache);
+}
+
+void test_decode_cache_self_modifying_code()
+{
+    DecodeCache *const cache = DecodeCache_new();
+    DecodeCache_set_cacheable(cache, 0xC000, 0xDFFF);
+    Memory mem = flat_memory(flat_ram);
+
+    Cpu cpu = Cpu_new();
+    cpu.decode_cache = cache;
+    cpu.pc = 0xC000;
+    cpu.h = 0xC0;
+    cpu.l = 0x02;
+
+    flat_ram[0xC000] = 0x36; // ld [hl], $3C
+    flat_ram[0xC001] = 0x3C;
+    flat_ram[0xC002] = 0x04; // inc b
+
+    Cpu_tick(&cpu, &mem);
+    DecodeCache_invalidate(cache, 0xC002);
+
+    // The patched opcode ($3C, inc a) must run instead of the decoded inc b
+    Cpu_tick(&cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX(0x01, cpu.a);
+    TEST_ASSERT_EQUAL_HEX(0x00, cpu.b);
+    TEST_ASSERT_EQUAL_HEX(0xC003, cpu.pc);
+
+    DecodeCache_destroy(cache);
+}
+
+void test_decode_cache_cycles()
+{
+    DecodeCache *const cache = DecodeCache_new();
+    DecodeCache_set_cacheable(cache, 0xC000, 0xDFFF);
+    Memory mem = flat_memory(flat_ram);
+
+    flat_ram[0xC000] = 0xCD; // call $C010
+    flat_ram[0xC001] = 0x10;
+    flat_ram[0xC002] = 0xC0;
+
+    Cpu cached = Cpu_new();
+    cached.decode_cache = cache;
+    cached.pc = 0xC000;
+    cached.sp = 0xD000;
+    Cpu_tick(&cached, &mem);
+
+    Cpu uncached = Cpu_new();
+    uncached.pc = 0xC000;
+    uncached.sp = 0xD000;
+    Cpu_tick(&uncached, &mem);
+
+    TEST_ASSERT_EQUAL(uncached.cycle_count, cached.cycle_count);
+    TEST_ASSERT_EQUAL_HEX(uncached.pc, cached.pc);
+
+    DecodeCache_destroy(cache);
+}
@@ -0,0 +1,504 @@
+#include "data.h"
+#include "decode_cache.h"
+#include "game_boy.h"
+#include "rom_image.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static u8 boot_rom[GB_BOOT_ROM_LEN];
+
+static u8 rom[TEST_ROM_LEN];
+
+/**
+ * \brief Creates a GameBoy whose boot ROM and ROM are filled with patterns
+ * that tell every byte apart from its neighbours.
+ */
+static GameBoy new_patterned_game_boy()
+{
+    for (size_t i = 0; i < sizeof(boot_rom); ++i)
+        boot_rom[i] = (u8)(0xFF - i);
+
+    for (size_t i = 0; i < sizeof(rom); ++i)
+        rom[i] = (u8)(i * 7 + 3);
+
+    return new_game_boy(boot_rom, rom);
+}
+
+void test_game_boy_boot_rom_unmapped_at_ff50()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    TEST_ASSERT_EQUAL_HEX8(boot_rom[0x00], GameBoy_read_mem(&gb, 0x0000));
+    TEST_ASSERT_EQUAL_HEX8(boot_rom[0xFF], GameBoy_read_mem(&gb, 0x00FF));
+    TEST_ASSERT_EQUAL_HEX8(rom[0x0100], GameBoy_read_mem(&gb, 0x0100));
+
+    GameBoy_write_mem(&gb, 0xFF50, 0x01);
+
+    TEST_ASSERT_EQUAL_HEX8(rom[0x0000], GameBoy_read_mem(&gb, 0x0000));
+    TEST_ASSERT_EQUAL_HEX8(rom[0x00FF], GameBoy_read_mem(&gb, 0x00FF));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_rom_is_read_only()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    GameBoy_write_mem(&gb, 0x4000, 0x12);
+    TEST_ASSERT_EQUAL_HEX8(rom[0x4000], GameBoy_read_mem(&gb, 0x4000));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_echo_ram_mirrors_wram()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    GameBoy_write_mem(&gb, 0xC123, 0x5A);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, GameBoy_read_mem(&gb, 0xE123));
+
+    GameBoy_write_mem(&gb, 0xFDFF, 0xA5);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, GameBoy_read_mem(&gb, 0xDDFF));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_mixed_pages()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    GameBoy_write_mem(&gb, 0xFE9F, 0x11);
+    GameBoy_write_mem(&gb, 0xFF80, 0x22);
+    GameBoy_write_mem(&gb, 0xFFFF, 0x1F);
+    GameBoy_write_mem(&gb, 0xFF42, 0x33);
+
+    TEST_ASSERT_EQUAL_HEX8(0x11, gb.oam[0x9F]);
+    TEST_ASSERT_EQUAL_HEX8(0x22, GameBoy_read_mem(&gb, 0xFF80));
+    TEST_ASSERT_EQUAL_HEX8(0x1F, GameBoy_read_mem(&gb, 0xFFFF));
+    TEST_ASSERT_EQUAL_HEX8(0x33, GameBoy_read_mem(&gb, 0xFF42));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_pages_survive_copies()
+{
+    const GameBoy original = new_patterned_game_boy();
+    GameBoy gb = original;
+
+    GameBoy_write_mem(&gb, 0x8000, 0x42);
+    GameBoy_write_mem(&gb, 0xC000, 0x24);
+
+    TEST_ASSERT_EQUAL_HEX8(0x42, gb.vram[0x0000]);
+    TEST_ASSERT_EQUAL_HEX8(0x24, gb.ram[0x0000]);
+    TEST_ASSERT_EQUAL_HEX8(0x24, GameBoy_read_mem(&gb, 0xC000));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_io_write_masks()
+{
+    GameBoy gb = new_patterned_game_boy();
+    gb.stat = 0b00000010;
+    gb.ly = 0x42;
+
+    // The mode bits of STAT and the whole of LY are read-only
+    GameBoy_write_mem(&gb, 0xFF41, 0xFF);
+    GameBoy_write_mem(&gb, 0xFF44, 0x00);
+
+    TEST_ASSERT_EQUAL_HEX8(0b11111010, GameBoy_read_mem(&gb, 0xFF41));
+    TEST_ASSERT_EQUAL_HEX8(0x42, GameBoy_read_mem(&gb, 0xFF44));
+
+    GameBoy_write_mem(&gb, 0xFF04, 0x12);
+    TEST_ASSERT_EQUAL_HEX8(0x00, GameBoy_read_mem(&gb, 0xFF04));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_io_open_bus()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    // Unmapped, audio and CGB-only registers
+    GameBoy_write_mem(&gb, 0xFF03, 0x12);
+    GameBoy_write_mem(&gb, 0xFF26, 0x34);
+    GameBoy_write_mem(&gb, 0xFF4F, 0x01);
+
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xFF03));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xFF26));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xFF4F));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xFF7F));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_spans()
+{
+    GameBoy gb = new_patterned_game_boy();
+    size_t len = 0;
+
+    // The boot ROM covers the first page only
+    TEST_ASSERT_EQUAL_PTR(&gb.boot_rom[0x10],
+                          GameBoy_get_span(&gb, 0x0010, &len));
+    TEST_ASSERT_EQUAL(0xF0, len);
+
+    TEST_ASSERT_EQUAL_PTR(&gb.rom[0x0123], GameBoy_get_span(&gb, 0x0123, &len));
+    TEST_ASSERT_EQUAL(0x8000 - 0x0123, len);
+
+    TEST_ASSERT_EQUAL_PTR(&gb.ram[0x1000], GameBoy_get_span(&gb, 0xD000, &len));
+    TEST_ASSERT_EQUAL(0x1000, len);
+
+    TEST_ASSERT_NULL(GameBoy_get_span(&gb, 0xFE00, &len));
+    TEST_ASSERT_NULL(GameBoy_get_span(&gb, 0xFF80, &len));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_blocks()
+{
+    GameBoy gb = new_patterned_game_boy();
+    Memory mem = GameBoy_memory(&gb);
+    u8 block[0x300];
+
+    for (size_t i = 0; i < sizeof(block); ++i)
+        block[i] = (u8)(i * 3);
+
+    // Across the end of WRAM, echo RAM and back
+    Memory_write_block(&mem, 0xDF00, block, sizeof(block));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(block, &gb.ram[0x1F00], 0x100);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&block[0x100], gb.ram, 0x200);
+
+    // Across OAM, I/O registers and HRAM, wrapping around
+    Memory_write_block(&mem, 0xFE00, block, 0xA0);
+    Memory_write_block(&mem, 0xFF80, block, 0x7F);
+    Memory_write_block(&mem, 0xFF47, &block[0x20], 1);
+    TEST_ASSERT_EQUAL_HEX8(block[0x20], gb.bgp);
+
+    u8 read[0xE0];
+    Memory_read_block(&mem, 0xFE00, read, 0xA0);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(block, read, 0xA0);
+
+    // FF47-FFFF, then 0000-0026
+    Memory_read_block(&mem, 0xFF47, read, sizeof(read));
+    TEST_ASSERT_EQUAL_HEX8(block[0x20], read[0x00]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(block, &read[0x39], 0x7F);
+    TEST_ASSERT_EQUAL_HEX8(gb.ie, read[0xB8]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(boot_rom, &read[0xB9], 0x27);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_write_block_invalidates_code()
+{
+    GameBoy gb = new_patterned_game_boy();
+    Memory mem = GameBoy_memory(&gb);
+
+    // ld a, $12; ld a, $34
+    const u8 code[] = {0x3E, 0x12, 0x3E, 0x34};
+    Memory_write_block(&mem, 0xC000, code, sizeof(code));
+
+    gb.cpu.pc = 0xC000;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x12, gb.cpu.a);
+
+    const u8 patch[] = {0x3E, 0x56};
+    Memory_write_block(&mem, 0xC002, patch, sizeof(patch));
+
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x56, gb.cpu.a);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_oam_dma()
+{
+    GameBoy gb = new_patterned_game_boy();
+
+    for (u16 i = 0; i < 0xA0; ++i)
+        GameBoy_write_mem(&gb, 0xC100 + i, (u8)(0xA0 - i));
+
+    GameBoy_write_mem(&gb, 0xFF80, 0x12);
+    GameBoy_write_mem(&gb, 0xFF46, 0xC1);
+
+    // Copied all at once in the fast tier
+    TEST_ASSERT_EQUAL_HEX8(0xC1, GameBoy_read_mem(&gb, 0xFF46));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&gb.ram[0x100], gb.oam, 0xA0);
+
+    // Only HRAM and I/O registers are reachable until the transfer ends
+    GameBoy_write_mem(&gb, 0xC000, 0x34);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xC100));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0x0100));
+    TEST_ASSERT_EQUAL_HEX8(0x12, GameBoy_read_mem(&gb, 0xFF80));
+    TEST_ASSERT_EQUAL_HEX8(0xC1, GameBoy_read_mem(&gb, 0xFF46));
+
+    TEST_ASSERT_FALSE(GameBoy_step_dma(&gb, 0x9F));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xC100));
+
+    TEST_ASSERT_TRUE(GameBoy_step_dma(&gb, 4));
+    TEST_ASSERT_EQUAL_HEX8(0xA0, GameBoy_read_mem(&gb, 0xC100));
+    TEST_ASSERT_EQUAL_HEX8(0x00, GameBoy_read_mem(&gb, 0xC000));
+    TEST_ASSERT_EQUAL_HEX8(boot_rom[0x00], GameBoy_read_mem(&gb, 0x0000));
+    TEST_ASSERT_FALSE(GameBoy_step_dma(&gb, 1));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_oam_dma_keeps_code_apart()
+{
+    GameBoy gb = new_patterned_game_boy();
+    Memory mem = GameBoy_memory(&gb);
+
+    // inc a; inc a
+    GameBoy_write_mem(&gb, 0xC000, 0x3C);
+    GameBoy_write_mem(&gb, 0xC001, 0x3C);
+
+    gb.cpu.pc = 0xC000;
+    gb.cpu.sp = 0xFFFE;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(1, gb.cpu.a);
+
+    // Blocked memory reads as rst $38, even right after decoded code
+    GameBoy_write_mem(&gb, 0xFF46, 0xC1);
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX16(0x0038, gb.cpu.pc);
+    TEST_ASSERT_EQUAL_HEX8(1, gb.cpu.a);
+
+    gb.cpu.pc = 0xC000;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX16(0x0038, gb.cpu.pc);
+
+    // What was decoded while blocked is not run once the transfer ends
+    TEST_ASSERT_TRUE(GameBoy_step_dma(&gb, GB_OAM_DMA_CYCLES));
+    gb.cpu.pc = 0xC000;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(2, gb.cpu.a);
+    TEST_ASSERT_EQUAL_HEX16(0xC001, gb.cpu.pc);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_oam_dma_accurate()
+{
+    GameBoy gb = new_patterned_game_boy();
+    gb.tier = CpuTier_Accurate;
+
+    // Sources past DFFF read from WRAM, like echo RAM
+    for (u16 i = 0; i < 0xA0; ++i)
+        GameBoy_write_mem(&gb, 0xDE00 + i, (u8)(i + 1));
+
+    GameBoy_write_mem(&gb, 0xFF46, 0xFE);
+    TEST_ASSERT_EQUAL_HEX8(0x00, gb.oam[0x00]);
+
+    // A byte per cycle
+    GameBoy_step_dma(&gb, 2);
+    TEST_ASSERT_EQUAL_HEX8(0x01, gb.oam[0x00]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, gb.oam[0x01]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, gb.oam[0x02]);
+
+    TEST_ASSERT_TRUE(GameBoy_step_dma(&gb, 0x9E));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&gb.ram[0x1E00], gb.oam, 0xA0);
+    TEST_ASSERT_EQUAL_HEX8(0x01, GameBoy_read_mem(&gb, 0xFE00));
+
+    GameBoy_destroy(&gb);
+}
+
+static u8 banked_rom[0x20000];
+
+static RomImage *new_banked_rom()
+{
+    // MBC1 with 32 KiB of RAM and 128 KiB of ROM, where every bank starts
+    // with `ld a, <bank>` / `jr -4`
+    memset(banked_rom, 0, sizeof(banked_rom));
+
+    for (size_t bank = 0; bank < sizeof(banked_rom) / 0x4000; ++bank) {
+        u8 *const start = &banked_rom[bank * 0x4000];
+        start[0] = 0x3E;
+        start[1] = (u8)bank;
+        start[2] = 0x18;
+        start[3] = 0xFC;
+    }
+
+    banked_rom[RomHeader_CartridgeType] = CartridgeType_Mbc1RamBattery;
+    banked_rom[RomHeader_RomSize] = 0x02;
+    banked_rom[RomHeader_RamSize] = RamSize_32KiB;
+
+    return RomImage_copy(banked_rom, sizeof(banked_rom));
+}
+
+static GameBoy new_banked_game_boy()
+{
+    RomImage *const image = new_banked_rom();
+    GameBoy gb = GameBoy_new(boot_rom);
+    GameBoy_load_rom(&gb, image);
+    RomImage_release(image);
+    GameBoy_write_mem(&gb, 0xFF50, 0x01);
+    return gb;
+}
+
+void test_game_boy_rom_banking()
+{
+    GameBoy gb = new_banked_game_boy();
+
+    TEST_ASSERT_EQUAL_HEX8(0, GameBoy_read_mem(&gb, 0x0001));
+    TEST_ASSERT_EQUAL_HEX8(1, GameBoy_read_mem(&gb, 0x4001));
+
+    GameBoy_write_mem(&gb, 0x2000, 0x05);
+    TEST_ASSERT_EQUAL_HEX8(5, GameBoy_read_mem(&gb, 0x4001));
+
+    GameBoy_write_mem(&gb, 0x2000, 0x00);
+    TEST_ASSERT_EQUAL_HEX8(1, GameBoy_read_mem(&gb, 0x4001));
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_ext_ram_banking()
+{
+    GameBoy gb = new_banked_game_boy();
+
+    // Disabled RAM reads as open bus, and ignores writes
+    GameBoy_write_mem(&gb, 0xA000, 0x12);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, GameBoy_read_mem(&gb, 0xA000));
+
+    GameBoy_write_mem(&gb, 0x0000, 0x0A);
+    GameBoy_write_mem(&gb, 0x6000, 0x01);
+    GameBoy_write_mem(&gb, 0xA000, 0x34);
+
+    GameBoy_write_mem(&gb, 0x4000, 0x03);
+    GameBoy_write_mem(&gb, 0xBFFF, 0x56);
+    TEST_ASSERT_EQUAL_HEX8(0x00, GameBoy_read_mem(&gb, 0xA000));
+
+    GameBoy_write_mem(&gb, 0x4000, 0x00);
+    TEST_ASSERT_EQUAL_HEX8(0x34, GameBoy_read_mem(&gb, 0xA000));
+    TEST_ASSERT_EQUAL_HEX8(0x56, gb.ext_ram[3 * 0x2000 + 0x1FFF]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_bank_switch_maps_code()
+{
+    GameBoy gb = new_banked_game_boy();
+    Memory mem = GameBoy_memory(&gb);
+
+    gb.cpu.pc = 0x4000;
+    Cpu_tick(&gb.cpu, &mem);
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(1, gb.cpu.a);
+
+    GameBoy_write_mem(&gb, 0x2000, 0x06);
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(6, gb.cpu.a);
+
+    // Code decoded from bank 1 is still around once it is switched back in
+    GameBoy_write_mem(&gb, 0x2000, 0x01);
+    TEST_ASSERT_TRUE(gb.cpu.decode_cache->pages[0x40]->has_code);
+
+    Cpu_tick(&gb.cpu, &mem);
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(1, gb.cpu.a);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_game_boy_shares_rom_image()
+{
+    RomImage *const image = new_banked_rom();
+    GameBoy first = GameBoy_new(boot_rom);
+    GameBoy second = GameBoy_new(boot_rom);
+
+    GameBoy_load_rom(&first, image);
+    GameBoy_load_rom(&second, image);
+    RomImage_release(image);
+
+    TEST_ASSERT_EQUAL_PTR(first.rom, second.rom);
+    TEST_ASSERT_EQUAL(2, atomic_load(&image->refs));
+
+    GameBoy_destroy(&first);
+    TEST_ASSERT_EQUAL(1, atomic_load(&image->refs));
+
+    GameBoy_destroy(&second);
+}
+
+void test_game_boy_save_tracks_ext_ram_writes()
+{
+    GameBoy gb = new_banked_game_boy();
+
+    TEST_ASSERT_TRUE(GameBoy_load_save(&gb, "test_game_boy.sav", 0));
+    TEST_ASSERT_NOT_NULL(gb.save);
+    TEST_ASSERT_EQUAL_PTR(gb.save->data, gb.ext_ram);
+
+    GameBoy_write_mem(&gb, 0x0000, 0x0A);
+    GameBoy_write_mem(&gb, 0x6000, 0x01);
+    GameBoy_write_mem(&gb, 0x4000, 0x02);
+    GameBoy_write_mem(&gb, 0xA123, 0x42);
+
+    const size_t offset = 2 * 0x2000 + 0x0123;
+    TEST_ASSERT_EQUAL_HEX8(0x42, gb.save->data[offset]);
+    TEST_ASSERT_TRUE(
+        atomic_load(&gb.save->dirty[offset >> gb.save->chunk_shift]));
+
+    GameBoy_destroy(&gb);
+
+    // Closed along with the GameBoy
+    gb = new_banked_game_boy();
+    TEST_ASSERT_TRUE(GameBoy_load_save(&gb, "test_game_boy.sav", 0));
+    TEST_ASSERT_EQUAL_HEX8(0x42, gb.ext_ram[offset]);
+    GameBoy_destroy(&gb);
+
+    remove("test_game_boy.sav");
+}
+
+void test_game_boy_cheats()
+{
+    GameBoy gb = new_banked_game_boy();
+    Memory mem = GameBoy_memory(&gb);
+
+    gb.cpu.pc = 0x4000;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(1, gb.cpu.a);
+
+    // ld a, $42 in every bank that has ld a, 5 there
+    Cheat patch;
+    TEST_ASSERT_TRUE(Cheat_parse("420-01B-F0E", &patch));
+    TEST_ASSERT_EQUAL_HEX16(0x4001, patch.addr);
+    TEST_ASSERT_EQUAL_HEX8(0x05, patch.compare);
+    GameBoy_add_cheat(&gb, &patch);
+
+    // Only the patched page is covered
+    TEST_ASSERT_EQUAL_HEX8(1, GameBoy_read_mem(&gb, 0x4001));
+    TEST_ASSERT_EQUAL_PTR(&gb.rom[0x4000], gb.pages[0x40].read);
+
+    GameBoy_write_mem(&gb, 0x2000, 0x05);
+    TEST_ASSERT_EQUAL_HEX8(0x42, GameBoy_read_mem(&gb, 0x4001));
+    TEST_ASSERT_EQUAL_HEX8(5, gb.rom[5 * 0x4000 + 1]);
+    TEST_ASSERT_EQUAL_PTR(&gb.rom[5 * 0x4000 + 0x100], gb.pages[0x41].read);
+
+    gb.cpu.pc = 0x4000;
+    Cpu_tick(&gb.cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x42, gb.cpu.a);
+
+    size_t len = 0;
+    TEST_ASSERT_NOT_NULL(GameBoy_get_span(&gb, 0x4000, &len));
+    TEST_ASSERT_EQUAL(0x100, len);
+
+    // Freezes only apply once asked to
+    Cheat freeze;
+    TEST_ASSERT_TRUE(Cheat_parse("019923C0", &freeze));
+    GameBoy_add_cheat(&gb, &freeze);
+
+    GameBoy_write_mem(&gb, 0xC023, 0x11);
+    TEST_ASSERT_EQUAL_HEX8(0x11, GameBoy_read_mem(&gb, 0xC023));
+    GameBoy_apply_freezes(&gb);
+    TEST_ASSERT_EQUAL_HEX8(0x99, GameBoy_read_mem(&gb, 0xC023));
+
+    // Dropped along with the ROM
+    RomImage *const image = new_banked_rom();
+    GameBoy_load_rom(&gb, image);
+    RomImage_release(image);
+    GameBoy_write_mem(&gb, 0xFF50, 0x01);
+    GameBoy_write_mem(&gb, 0x2000, 0x05);
+    TEST_ASSERT_EQUAL_HEX8(5, GameBoy_read_mem(&gb, 0x4001));
+
+    GameBoy_destroy(&gb);
+}
@@ -0,0 +1,203 @@
+#include "game_boy.h"
+#include "gdb_stub.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <string.h>
+#include <unity.h>
+
+static u8 boot_rom[GB_BOOT_ROM_LEN];
+static u8 rom[TEST_ROM_LEN];
+static char reply[GDB_STUB_PACKET_MAX + 1];
+
+/**
+ * \brief Creates a GameBoy about to run ld [$C000], a / ld a, [$C001] at
+ * $0150, past the boot ROM.
+ */
+static GameBoy new_debugged_game_boy()
+{
+    memset(rom, 0, sizeof(rom));
+    rom[0x0150] = 0xEA;
+    rom[0x0151] = 0x00;
+    rom[0x0152] = 0xC0;
+    rom[0x0153] = 0xFA;
+    rom[0x0154] = 0x01;
+    rom[0x0155] = 0xC0;
+
+    GameBoy gb = new_game_boy(boot_rom, rom);
+    GameBoy_write_mem(&gb, 0xFF50, 0x01);
+    gb.cpu.pc = 0x0150;
+    return gb;
+}
+
+void test_gdb_stub_registers()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(
+        gdb, &gb, "G30f0020104034060feff5001", reply));
+    TEST_ASSERT_EQUAL_STRING("OK", reply);
+
+    TEST_ASSERT_EQUAL_HEX8(0xF0, gb.cpu.a);
+    TEST_ASSERT_EQUAL_HEX8(0x30, Cpu_read_f(&gb.cpu));
+    TEST_ASSERT_EQUAL_HEX16(0x0102, Cpu_read_rp(&gb.cpu, CpuTableRp_BC));
+    TEST_ASSERT_EQUAL_HEX16(0x0304, Cpu_read_rp(&gb.cpu, CpuTableRp_DE));
+    TEST_ASSERT_EQUAL_HEX16(0x6040, Cpu_read_rp(&gb.cpu, CpuTableRp_HL));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFE, gb.cpu.sp);
+    TEST_ASSERT_EQUAL_HEX16(0x0150, gb.cpu.pc);
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "g", reply));
+    TEST_ASSERT_EQUAL_STRING("30f0020104034060feff5001", reply);
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "P5=5301", reply));
+    TEST_ASSERT_EQUAL_HEX16(0x0153, gb.cpu.pc);
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "p4", reply));
+    TEST_ASSERT_EQUAL_STRING("feff", reply);
+
+    // Registers of the z80 that the Game Boy does not have
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "p6", reply));
+    TEST_ASSERT_EQUAL_STRING("E01", reply);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
+
+void test_gdb_stub_memory()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "MC000,3:a1b2c3", reply));
+    TEST_ASSERT_EQUAL_STRING("OK", reply);
+    TEST_ASSERT_EQUAL_HEX8(0xB2, GameBoy_read_mem(&gb, 0xC001));
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "mc000,4", reply));
+    TEST_ASSERT_EQUAL_STRING("a1b2c300", reply);
+
+    // Unusable memory reads as open bus, instead of stopping the emulator
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "mfe9f,2", reply));
+    TEST_ASSERT_EQUAL_STRING("00ff", reply);
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "MC000,2:a1", reply));
+    TEST_ASSERT_EQUAL_STRING("E01", reply);
+
+    // Lengths whose hex digits would overflow a u32 are still too long
+    TEST_ASSERT_TRUE(
+        GdbStub_handle_packet(gdb, &gb, "MC000,80000000:", reply));
+    TEST_ASSERT_EQUAL_STRING("E01", reply);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
+
+void test_gdb_stub_breakpoints()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "Z0,153,1", reply));
+    TEST_ASSERT_EQUAL_STRING("OK", reply);
+
+    TEST_ASSERT_FALSE(GdbStub_check_break(gdb, 0x0150));
+    TEST_ASSERT_TRUE(GdbStub_check_break(gdb, 0x0153));
+    TEST_ASSERT_TRUE(gdb->halted);
+
+    // Continuing runs the instruction the breakpoint is on first
+    TEST_ASSERT_FALSE(GdbStub_handle_packet(gdb, &gb, "c", reply));
+    TEST_ASSERT_FALSE(gdb->halted);
+    TEST_ASSERT_FALSE(GdbStub_check_break(gdb, 0x0153));
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_TRUE(GdbStub_check_break(gdb, 0x0153));
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "z0,153,1", reply));
+    TEST_ASSERT_FALSE(GdbStub_handle_packet(gdb, &gb, "c", reply));
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_FALSE(GdbStub_check_break(gdb, 0x0153));
+    TEST_ASSERT_FALSE(gdb->halted);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
+
+void test_gdb_stub_step_and_watch()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+    Memory memory = GameBoy_memory(&gb);
+    Memory watched_memory = GdbStub_memory(gdb, &memory);
+
+    // Single-stepping
+    TEST_ASSERT_FALSE(GdbStub_handle_packet(gdb, &gb, "s", reply));
+    TEST_ASSERT_FALSE(GdbStub_check_break(gdb, gb.cpu.pc));
+    Cpu_tick(&gb.cpu, &watched_memory);
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_TRUE(gdb->halted);
+    TEST_ASSERT_EQUAL_HEX16(0x0153, gb.cpu.pc);
+
+    // Reading $C001 hits the read watchpoint, but writing $C000 does not
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "Z3,c001,1", reply));
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "Z2,c002,1", reply));
+    TEST_ASSERT_FALSE(GdbStub_handle_packet(gdb, &gb, "c150", reply));
+
+    Cpu_tick(&gb.cpu, &watched_memory);
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_FALSE(gdb->halted);
+
+    Cpu_tick(&gb.cpu, &watched_memory);
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_TRUE(gdb->halted);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
+
+void test_gdb_stub_watches_reads_as_they_run()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+    Memory memory = GameBoy_memory(&gb);
+    Memory watched_memory = GdbStub_memory(gdb, &memory);
+
+    GameBoy_set_debugging(&gb, true);
+
+    // The operand of ld a, [$C001] is only read once that instruction runs,
+    // not when the one before it does
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "Z3,154,1", reply));
+    TEST_ASSERT_FALSE(GdbStub_handle_packet(gdb, &gb, "c", reply));
+
+    Cpu_tick(&gb.cpu, &watched_memory);
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_FALSE(gdb->halted);
+    TEST_ASSERT_EQUAL_HEX16(0x0153, gb.cpu.pc);
+
+    Cpu_tick(&gb.cpu, &watched_memory);
+    GdbStub_instruction_done(gdb);
+    TEST_ASSERT_TRUE(gdb->halted);
+
+    GameBoy_set_debugging(&gb, false);
+    TEST_ASSERT_NOT_NULL(gb.cpu.decode_cache);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
+
+void test_gdb_stub_queries()
+{
+    GameBoy gb = new_debugged_game_boy();
+    GdbStub *const gdb = GdbStub_new();
+
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "?", reply));
+    TEST_ASSERT_EQUAL_STRING("S05", reply);
+
+    TEST_ASSERT_TRUE(
+        GdbStub_handle_packet(gdb, &gb, "qSupported:swbreak+", reply));
+    TEST_ASSERT_EQUAL_STRING("PacketSize=1000", reply);
+
+    // Unsupported packets get an empty reply
+    TEST_ASSERT_TRUE(GdbStub_handle_packet(gdb, &gb, "vMustReplyEmpty", reply));
+    TEST_ASSERT_EQUAL_STRING("", reply);
+
+    GdbStub_destroy(gdb);
+    GameBoy_destroy(&gb);
+}
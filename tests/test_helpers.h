@@ -0,0 +1,149 @@
+#ifndef GEMU_TEST_HELPERS_H
+#define GEMU_TEST_HELPERS_H
+
+#include "cpu.h"
+#include "data.h"
+#include "game_boy.h"
+#include "rom_image.h"
+#include "stdinc.h"
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Fixtures shared by the tests. Everything is static, and not every test uses
+ * all of it.
+ */
+
+/**
+ * Length of the ROMs new_game_boy runs, the most that fits without a mapper
+ */
+static constexpr size_t TEST_ROM_LEN = 0x8000;
+
+/**
+ * A whole address space of plain RAM, which flat_memory may be backed by
+ */
+[[maybe_unused]] static u8 flat_ram[0x10000];
+
+/**
+ * Cpu whose compiled code gets invalidated on every write to flat memory, if
+ * any
+ */
+[[maybe_unused]] static Cpu *ram_owner = nullptr;
+
+[[maybe_unused]] static u8 read_flat_ram(const void *const ctx, const u16 addr)
+{
+    const u8 *const ram = ctx;
+    return ram[addr];
+}
+
+[[maybe_unused]] static void write_flat_ram(void *const ctx, const u16 addr,
+                                            const u8 value)
+{
+    u8 *const ram = ctx;
+    ram[addr] = value;
+
+    if (ram_owner != nullptr)
+        Cpu_invalidate_code(ram_owner, addr);
+}
+
+[[maybe_unused]] static const u8 *
+get_flat_ram_span(const void *const ctx, const u16 addr, size_t *const len)
+{
+    const u8 *const ram = ctx;
+    *len = 0x10000 - addr;
+    return &ram[addr];
+}
+
+/**
+ * \brief Gets Memory backed by a whole address space of plain RAM.
+ *
+ * \param ram the RAM, 0x10000 bytes long. Usually flat_ram.
+ */
+[[maybe_unused]] static Memory flat_memory(u8 *const ram)
+{
+    // Bulk copies read through spans, and write through write
+    return (Memory){
+        .ctx = ram,
+        .read = read_flat_ram,
+        .write = write_flat_ram,
+        .get_span = get_flat_ram_span,
+    };
+}
+
+/**
+ * \brief Fills in the header of a ROM with no mapper and no cartridge RAM,
+ * along with its checksum.
+ *
+ * \param rom the ROM, TEST_ROM_LEN bytes long.
+ */
+[[maybe_unused]] static void fill_rom_header(u8 *const rom)
+{
+    rom[RomHeader_CartridgeType] = 0x00;
+    rom[RomHeader_RomSize] = 0x00;
+    rom[RomHeader_RamSize] = 0x00;
+
+    u8 checksum = 0;
+    for (size_t addr = 0x0134; addr <= 0x014C; ++addr)
+        checksum = checksum - rom[addr] - 1;
+
+    rom[RomHeader_HeaderChecksum] = checksum;
+}
+
+/**
+ * \brief Creates a GameBoy running a ROM with no mapper and no cartridge RAM.
+ *
+ * \param boot_rom the boot ROM, which may be nullptr.
+ * \param rom the ROM, TEST_ROM_LEN bytes long, whose header gets filled in by
+ * fill_rom_header. May be nullptr to leave the cartridge slot empty.
+ */
+[[maybe_unused]] static GameBoy new_game_boy(const u8 *const boot_rom,
+                                             u8 *const rom)
+{
+    GameBoy gb = GameBoy_new(boot_rom);
+
+    if (rom == nullptr)
+        return gb;
+
+    fill_rom_header(rom);
+
+    RomImage *const image = RomImage_copy(rom, TEST_ROM_LEN);
+    GameBoy_load_rom(&gb, image);
+    RomImage_release(image);
+    return gb;
+}
+
+/**
+ * Program the AOT test module is generated from at build time, at $0100
+ */
+[[maybe_unused]] static const u8 AOT_TEST_PROGRAM[] = {
+    0x31, 0xFE, 0xDF, // $0100: ld sp, $DFFE
+    0x21, 0x00, 0xC0, // $0103: ld hl, $C000
+    0x06, 0x0A,       // $0106: ld b, 10
+    0x78,             // $0108: ld a, b
+    0xCD, 0x15, 0x01, // $0109: call $0115
+    0x22,             // $010C: ld [hl+], a
+    0x05,             // $010D: dec b
+    0x20, 0xF8,       // $010E: jr nz, $0108
+    0xCB, 0x37,       // $0110: swap a
+    0xF5,             // $0112: push af
+    0xC1,             // $0113: pop bc
+    0x76,             // $0114: halt
+    0x87,             // $0115: add a, a
+    0xCB, 0x17,       // $0116: rl a
+    0xC9,             // $0118: ret
+};
+
+/**
+ * \brief Fills a ROM with AOT_TEST_PROGRAM, and ret everywhere else but its
+ * header.
+ *
+ * \param rom the ROM, TEST_ROM_LEN bytes long.
+ */
+[[maybe_unused]] static void load_aot_test_rom(u8 *const rom)
+{
+    memset(rom, 0xC9, TEST_ROM_LEN);
+    memcpy(&rom[0x0100], AOT_TEST_PROGRAM, sizeof(AOT_TEST_PROGRAM));
+    fill_rom_header(rom);
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "cpu.h"
+#include "idiom.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <string.h>
+#include <unity.h>
+
+static constexpr u16 PROGRAM_START = 0x0150;
+
+static u8 reference_ram[0x10000];
+
+static void load_program(const u8 *const program, const size_t len)
+{
+    for (size_t i = 0; i < sizeof(flat_ram); ++i)
+        flat_ram[i] = (u8)(i * 7 + 3);
+
+    memcpy(&flat_ram[PROGRAM_START], program, len);
+    memcpy(reference_ram, flat_ram, sizeof(flat_ram));
+}
+
+static IdiomCache *new_cache()
+{
+    IdiomCache *const cache = IdiomCache_new();
+    IdiomCache_set_readable(cache, 0x0000, 0x7FFF);
+    IdiomCache_set_readable(cache, 0xC000, 0xDFFF);
+    IdiomCache_set_writable(cache, 0xC000, 0xDFFF);
+    return cache;
+}
+
+/**
+ * \brief Runs a Cpu until it leaves the loop at PROGRAM_START, running idioms
+ * in bulk when a cache is given.
+ */
+static void run_loop(Cpu *const cpu, u8 *const ram, IdiomCache *const cache,
+                     const u16 end)
+{
+    Memory mem = flat_memory(ram);
+
+    while (cpu->pc != end) {
+        Idiom idiom;
+
+        if (cache != nullptr && IdiomCache_lookup(cache, &mem, cpu->pc, &idiom) &&
+            IdiomCache_run(cache, &idiom, cpu, &mem, 0x100000))
+            continue;
+
+        Cpu_tick(cpu, &mem);
+    }
+}
+
+/**
+ * \brief Checks that running a loop with idioms leaves everything exactly as
+ * running it one instruction at a time does.
+ */
+static void assert_same_as_interpreter(const Cpu *const initial,
+                                       const size_t program_len)
+{
+    IdiomCache *const cache = new_cache();
+    const u16 end = PROGRAM_START + program_len;
+
+    Cpu expected = *initial;
+    run_loop(&expected, reference_ram, nullptr, end);
+
+    Cpu actual = *initial;
+    run_loop(&actual, flat_ram, cache, end);
+
+    TEST_ASSERT_EQUAL_HEX16(expected.pc, actual.pc);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.r8, actual.r8, 6);
+    TEST_ASSERT_EQUAL_HEX8(expected.a, actual.a);
+    TEST_ASSERT_EQUAL_HEX8(Cpu_read_f(&expected), Cpu_read_f(&actual));
+    TEST_ASSERT_EQUAL(expected.cycle_count, actual.cycle_count);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(reference_ram, flat_ram, sizeof(flat_ram));
+
+    IdiomCache_destroy(cache);
+}
+
+void test_idiom_fill_a()
+{
+    static const u8 program[] = {
+        0x22,       // $0150: ld [hl+], a
+        0x05,       // $0151: dec b
+        0x20, 0xFC, // $0152: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    cpu.a = 0x5A;
+    cpu.b = 0x40;
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xC000);
+    Cpu_write_f(&cpu, CpuFlag_C);
+
+    assert_same_as_interpreter(&cpu, sizeof(program));
+}
+
+void test_idiom_fill_r_wide_counter()
+{
+    static const u8 program[] = {
+        0x7B,       // $0150: ld a, e
+        0x32,       // $0151: ld [hl-], a
+        0x0B,       // $0152: dec bc
+        0x78,       // $0153: ld a, b
+        0xB1,       // $0154: or c
+        0x20, 0xF9, // $0155: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    cpu.e = 0xA5;
+    Cpu_write_rp(&cpu, CpuTableRp_BC, 0x0300);
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xDFFF);
+
+    assert_same_as_interpreter(&cpu, sizeof(program));
+}
+
+void test_idiom_copy_hl_to_de()
+{
+    static const u8 program[] = {
+        0x2A,       // $0150: ld a, [hl+]
+        0x12,       // $0151: ld [de], a
+        0x13,       // $0152: inc de
+        0x0D,       // $0153: dec c
+        0x20, 0xFA, // $0154: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    // A counter of 0 runs 256 iterations. Memory repeats every 256 bytes, so
+    // the destination is offset for the copy to change anything.
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    cpu.c = 0;
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0x4000);
+    Cpu_write_rp(&cpu, CpuTableRp_DE, 0xC801);
+
+    assert_same_as_interpreter(&cpu, sizeof(program));
+}
+
+void test_idiom_copy_de_to_hl_overlapping()
+{
+    static const u8 program[] = {
+        0x1A,       // $0150: ld a, [de]
+        0x13,       // $0151: inc de
+        0x22,       // $0152: ld [hl+], a
+        0x0B,       // $0153: dec bc
+        0x78,       // $0154: ld a, b
+        0xB1,       // $0155: or c
+        0x20, 0xF8, // $0156: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    // Copying forwards onto itself repeats the first few bytes
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    Cpu_write_rp(&cpu, CpuTableRp_BC, 0x0123);
+    Cpu_write_rp(&cpu, CpuTableRp_DE, 0xC000);
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xC003);
+
+    assert_same_as_interpreter(&cpu, sizeof(program));
+}
+
+void test_idiom_rejects_counter_used_by_body()
+{
+    static const u8 program[] = {
+        0x78,       // $0150: ld a, b
+        0x22,       // $0151: ld [hl+], a
+        0x05,       // $0152: dec b
+        0x20, 0xFB, // $0153: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    IdiomCache *const cache = new_cache();
+    Memory mem = flat_memory(flat_ram);
+    Idiom idiom;
+
+    TEST_ASSERT_FALSE(IdiomCache_lookup(cache, &mem, PROGRAM_START, &idiom));
+
+    IdiomCache_destroy(cache);
+}
+
+void test_idiom_bails_outside_writable_memory()
+{
+    static const u8 program[] = {
+        0x22,       // $0150: ld [hl+], a
+        0x05,       // $0151: dec b
+        0x20, 0xFC, // $0152: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    IdiomCache *const cache = new_cache();
+    Memory mem = flat_memory(flat_ram);
+    Idiom idiom;
+
+    TEST_ASSERT_TRUE(IdiomCache_lookup(cache, &mem, PROGRAM_START, &idiom));
+
+    // Filling from the end of WRAM into echo RAM
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    cpu.b = 0x10;
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xDFF8);
+
+    TEST_ASSERT_FALSE(IdiomCache_run(cache, &idiom, &cpu, &mem, 0x100000));
+    TEST_ASSERT_EQUAL(0, cpu.cycle_count);
+    TEST_ASSERT_EQUAL_HEX8(0x10, cpu.b);
+
+    IdiomCache_destroy(cache);
+}
+
+void test_idiom_bounded_by_cycles()
+{
+    static const u8 program[] = {
+        0x22,       // $0150: ld [hl+], a
+        0x05,       // $0151: dec b
+        0x20, 0xFC, // $0152: jr nz, $0150
+    };
+
+    load_program(program, sizeof(program));
+
+    IdiomCache *const cache = new_cache();
+    Memory mem = flat_memory(flat_ram);
+    Idiom idiom;
+
+    TEST_ASSERT_TRUE(IdiomCache_lookup(cache, &mem, PROGRAM_START, &idiom));
+    TEST_ASSERT_EQUAL(6, idiom.iteration_cycles);
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = PROGRAM_START;
+    cpu.b = 0x10;
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xC000);
+
+    TEST_ASSERT_FALSE(IdiomCache_run(cache, &idiom, &cpu, &mem, 5));
+
+    TEST_ASSERT_TRUE(IdiomCache_run(cache, &idiom, &cpu, &mem, 4 * 6 + 5));
+    TEST_ASSERT_EQUAL(4 * 6, cpu.cycle_count);
+    TEST_ASSERT_EQUAL_HEX8(0x0C, cpu.b);
+    TEST_ASSERT_EQUAL_HEX16(0xC004, Cpu_read_rp(&cpu, CpuTableRp_HL));
+    TEST_ASSERT_EQUAL_HEX16(PROGRAM_START, cpu.pc);
+
+    IdiomCache_destroy(cache);
+}
@@ -0,0 +1,177 @@
+#include "cpu.h"
+#include "idle_loop.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static void load_program(const u16 addr, const u8 *const program,
+                         const size_t len)
+{
+    memset(flat_ram, 0, sizeof(flat_ram));
+    memcpy(&flat_ram[addr], program, len);
+}
+
+/**
+ * \brief Runs the Cpu the way the frontend does, until the detector finds a
+ * loop that may be skipped.
+ *
+ * \return the length of an iteration of the loop, or 0 if none was found.
+ */
+static int run_until_skippable(IdleLoopDetector *const detector, Cpu *const cpu,
+                               const size_t max_ticks, bool *const line_bound)
+{
+    Memory mem = flat_memory(flat_ram);
+    Memory watched_mem = IdleLoopDetector_memory(detector, &mem);
+
+    for (size_t i = 0; i < max_ticks; ++i) {
+        const u16 prev_pc = cpu->pc;
+        cpu->cycle_count = 0;
+        Cpu_tick(cpu, detector->watching ? &watched_mem : &mem);
+
+        const int cycles =
+            IdleLoopDetector_observe(detector, cpu, prev_pc, line_bound);
+
+        if (cycles != 0)
+            return cycles;
+    }
+
+    return 0;
+}
+
+void test_idle_loop_polling_hram()
+{
+    static const u8 program[] = {
+        0xF0, 0x80, // $0150: ldh a, [$FF80]
+        0xA7,       // $0152: and a
+        0x28, 0xFB, // $0153: jr z, $0150
+    };
+
+    load_program(0x0150, program, sizeof(program));
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+
+    bool line_bound = true;
+    const int cycles = run_until_skippable(detector, &cpu, 100, &line_bound);
+
+    TEST_ASSERT_EQUAL(7, cycles);
+    TEST_ASSERT_FALSE(line_bound);
+    TEST_ASSERT_EQUAL_HEX16(0x0150, cpu.pc);
+    TEST_ASSERT_EQUAL(IdleLoopState_Idle, detector->states[0x0150]);
+
+    // Once confirmed, every iteration may be skipped
+    TEST_ASSERT_EQUAL(7, run_until_skippable(detector, &cpu, 3, &line_bound));
+
+    IdleLoopDetector_destroy(detector);
+}
+
+void test_idle_loop_polling_ly()
+{
+    static const u8 program[] = {
+        0xF0, 0x44, // $0150: ldh a, [$FF44]
+        0xFE, 0x90, // $0152: cp $90
+        0x20, 0xFA, // $0154: jr nz, $0150
+    };
+
+    load_program(0x0150, program, sizeof(program));
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+
+    bool line_bound = false;
+    TEST_ASSERT_EQUAL(8, run_until_skippable(detector, &cpu, 100, &line_bound));
+    TEST_ASSERT_TRUE(line_bound);
+
+    IdleLoopDetector_destroy(detector);
+}
+
+void test_idle_loop_rejects_delay_loop()
+{
+    static const u8 program[] = {
+        0x05,       // $0150: dec b
+        0x20, 0xFD, // $0151: jr nz, $0150
+    };
+
+    load_program(0x0150, program, sizeof(program));
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+    cpu.b = 0xFF;
+
+    bool line_bound = false;
+    TEST_ASSERT_EQUAL(0, run_until_skippable(detector, &cpu, 100, &line_bound));
+    TEST_ASSERT_EQUAL(IdleLoopState_Rejected, detector->states[0x0150]);
+
+    IdleLoopDetector_destroy(detector);
+}
+
+void test_idle_loop_rejects_writes()
+{
+    static const u8 program[] = {
+        0x77,       // $0150: ld [hl], a
+        0x18, 0xFD, // $0151: jr $0150
+    };
+
+    load_program(0x0150, program, sizeof(program));
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+    Cpu_write_rp(&cpu, CpuTableRp_HL, 0xC000);
+
+    bool line_bound = false;
+    TEST_ASSERT_EQUAL(0, run_until_skippable(detector, &cpu, 100, &line_bound));
+    TEST_ASSERT_EQUAL(IdleLoopState_Rejected, detector->states[0x0150]);
+
+    IdleLoopDetector_destroy(detector);
+}
+
+void test_idle_loop_rejects_volatile_reads()
+{
+    static const u8 program[] = {
+        0xF0, 0x04, // $0150: ldh a, [$FF04]
+        0xA7,       // $0152: and a
+        0x20, 0xFB, // $0153: jr nz, $0150
+    };
+
+    load_program(0x0150, program, sizeof(program));
+    flat_ram[0xFF04] = 0x12;
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0x0150;
+
+    bool line_bound = false;
+    TEST_ASSERT_EQUAL(0, run_until_skippable(detector, &cpu, 100, &line_bound));
+    TEST_ASSERT_EQUAL(IdleLoopState_Rejected, detector->states[0x0150]);
+
+    IdleLoopDetector_destroy(detector);
+}
+
+void test_idle_loop_save_load()
+{
+    static const char *const path = "test_idle_loop_cache.txt";
+
+    IdleLoopDetector *const detector = IdleLoopDetector_new();
+    detector->states[0x0150] = IdleLoopState_Idle;
+    detector->states[0xFF90] = IdleLoopState_Idle;
+    detector->states[0x0200] = IdleLoopState_Rejected;
+    detector->modified = true;
+
+    TEST_ASSERT_TRUE(IdleLoopDetector_save(detector, path));
+
+    IdleLoopDetector_clear(detector);
+    TEST_ASSERT_TRUE(IdleLoopDetector_load(detector, path));
+    remove(path);
+
+    TEST_ASSERT_EQUAL(IdleLoopState_Idle, detector->states[0x0150]);
+    TEST_ASSERT_EQUAL(IdleLoopState_Idle, detector->states[0xFF90]);
+    TEST_ASSERT_EQUAL(IdleLoopState_Unknown, detector->states[0x0200]);
+
+    IdleLoopDetector_destroy(detector);
+}
@@ -0,0 +1,293 @@
+#include "cpu.h"
+#include "jit.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <string.h>
+#include <unity.h>
+
+// Ends the run on writes to FF00-FFFF, like GameBoy does for I/O registers
+static void write_flat_io(void *const ctx, const u16 addr, const u8 value)
+{
+    write_flat_ram(ctx, addr, value);
+
+    if (addr >= 0xFF00 && ram_owner != nullptr)
+        Jit_end_run(ram_owner->jit);
+}
+
+static Jit *new_jit()
+{
+    Jit *const jit = Jit_new();
+
+    if (jit == nullptr)
+        TEST_IGNORE_MESSAGE("JIT not supported on this host");
+
+    Jit_set_cacheable(jit, 0xC000, 0xDFFF);
+    return jit;
+}
+
+static void run_until_halt(Cpu *const cpu, Memory *const mem)
+{
+    ram_owner = cpu;
+
+    while (cpu->mode == CpuMode_Running)
+        Cpu_tick(cpu, mem);
+
+    ram_owner = nullptr;
+}
+
+void test_jit_matches_interpreter()
+{
+    static const u8 program[] = {
+        0x3E, 0x00,       // ld a, 0
+        0x06, 0x0A,       // ld b, 10
+        0x21, 0x00, 0xD0, // ld hl, $D000
+        0x80,             // loop: add a, b
+        0x22,             // ld [hl+], a
+        0x05,             // dec b
+        0x20, 0xFB,       // jr nz, loop
+        0x76,             // halt
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 1;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], program, sizeof(program));
+
+    Cpu interpreted = Cpu_new();
+    interpreted.pc = 0xC000;
+    run_until_halt(&interpreted, &mem);
+
+    u8 expected_ram[0x10] = {};
+    memcpy(expected_ram, &flat_ram[0xD000], sizeof(expected_ram));
+    memset(&flat_ram[0xD000], 0, sizeof(expected_ram));
+
+    Cpu compiled = Cpu_new();
+    compiled.pc = 0xC000;
+    compiled.jit = jit;
+    run_until_halt(&compiled, &mem);
+
+    TEST_ASSERT_EQUAL_HEX8(55, compiled.a);
+    TEST_ASSERT_EQUAL_HEX8(interpreted.a, compiled.a);
+    TEST_ASSERT_EQUAL_HEX8(interpreted.b, compiled.b);
+    TEST_ASSERT_EQUAL_HEX8(Cpu_read_f(&interpreted), Cpu_read_f(&compiled));
+    TEST_ASSERT_EQUAL_HEX8(interpreted.h, compiled.h);
+    TEST_ASSERT_EQUAL_HEX8(interpreted.l, compiled.l);
+    TEST_ASSERT_EQUAL_HEX16(interpreted.pc, compiled.pc);
+    TEST_ASSERT_EQUAL(interpreted.cycle_count, compiled.cycle_count);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_ram, &flat_ram[0xD000],
+                                 sizeof(expected_ram));
+
+    Jit_destroy(jit);
+}
+
+void test_jit_chains_blocks_within_budget()
+{
+    static const u8 program[] = {
+        0x05,       // loop: dec b
+        0x20, 0xFD, // jr nz, loop
+        0x76,       // halt
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.b = 200;
+    cpu.jit = jit;
+
+    // Each iteration takes 4 cycles, so the budget runs out mid-loop
+    Cpu_tick(&cpu, &mem);
+    TEST_ASSERT_EQUAL(jit->cycle_budget, cpu.cycle_count);
+    TEST_ASSERT_EQUAL_HEX16(0xC000, cpu.pc);
+    TEST_ASSERT_EQUAL(200 - cpu.cycle_count / 4, cpu.b);
+
+    run_until_halt(&cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0, cpu.b);
+    // The last jr is not taken, and halt takes one more cycle
+    TEST_ASSERT_EQUAL(199 * 4 + 3 + 1, cpu.cycle_count);
+
+    Jit_destroy(jit);
+}
+
+void test_jit_stays_within_max_tick_cycles()
+{
+    static const u8 program[] = {
+        0x05,       // loop: dec b
+        0x20, 0xFD, // jr nz, loop
+        0x76,       // halt
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.b = 200;
+    cpu.jit = jit;
+
+    // A third iteration could end past the limit
+    cpu.max_tick_cycles = 10;
+    Cpu_tick(&cpu, &mem);
+    TEST_ASSERT_EQUAL(8, cpu.cycle_count);
+    TEST_ASSERT_EQUAL_HEX16(0xC000, cpu.pc);
+    TEST_ASSERT_EQUAL(198, cpu.b);
+
+    // Not even one iteration fits, so a single instruction gets interpreted
+    cpu.max_tick_cycles = 3;
+    Cpu_tick(&cpu, &mem);
+    TEST_ASSERT_EQUAL(9, cpu.cycle_count);
+    TEST_ASSERT_EQUAL_HEX16(0xC001, cpu.pc);
+    TEST_ASSERT_EQUAL(197, cpu.b);
+
+    Jit_destroy(jit);
+}
+
+void test_jit_ends_run_when_asked()
+{
+    static const u8 program[] = {
+        0x04,       // loop: inc b
+        0xE0, 0x00, // ldh [$00], a
+        0x18, 0xFB, // jr loop
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+    mem.write = write_flat_io;
+
+    memcpy(&flat_ram[0xC000], program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.a = 0x42;
+    cpu.jit = jit;
+
+    ram_owner = &cpu;
+    Cpu_tick(&cpu, &mem);
+    ram_owner = nullptr;
+
+    // The rest of the block is left for after the caller has caught up
+    TEST_ASSERT_EQUAL_HEX8(0x42, flat_ram[0xFF00]);
+    TEST_ASSERT_EQUAL(1, cpu.b);
+    TEST_ASSERT_EQUAL_HEX16(0xC003, cpu.pc);
+
+    Jit_destroy(jit);
+}
+
+void test_jit_self_modifying_code()
+{
+    static const u8 program[] = {
+        0x06, 0x01,       // ld b, 1
+        0x3E, 0x02,       // ld a, 2
+        0xEA, 0x01, 0xC0, // ld [$C001], a
+        0x0D,             // dec c
+        0x20, 0xF6,       // jr nz, -10
+        0x76,             // halt
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], program, sizeof(program));
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.c = 2;
+    cpu.jit = jit;
+
+    run_until_halt(&cpu, &mem);
+
+    TEST_ASSERT_EQUAL_HEX8(0x02, flat_ram[0xC001]);
+    TEST_ASSERT_EQUAL_HEX8(2, cpu.b);
+
+    Jit_destroy(jit);
+}
+
+void test_jit_keeps_blocks_of_mapped_out_pages()
+{
+    static const u8 bank_a[] = {0x3E, 0x0A, 0x76}; // ld a, $0A; halt
+    static const u8 bank_b[] = {0x3E, 0x0B, 0x76}; // ld a, $0B; halt
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], bank_a, sizeof(bank_a));
+    Jit_map(jit, 0xC0, 0xC0, 0x1000);
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.jit = jit;
+    run_until_halt(&cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x0A, cpu.a);
+
+    memcpy(&flat_ram[0xC000], bank_b, sizeof(bank_b));
+    Jit_map(jit, 0xC0, 0xC0, 0x1001);
+
+    cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.jit = jit;
+    run_until_halt(&cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x0B, cpu.a);
+
+    // Mapping the first code page back in runs what was compiled from it,
+    // even though memory was never told to change back
+    Jit_map(jit, 0xC0, 0xC0, 0x1000);
+
+    cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.jit = jit;
+    run_until_halt(&cpu, &mem);
+    TEST_ASSERT_EQUAL_HEX8(0x0A, cpu.a);
+
+    Jit_destroy(jit);
+}
+
+void test_jit_chained_blocks_bail_out_of_mapped_out_pages()
+{
+    static const u8 bank_a[] = {0x14, 0xC3, 0x00, 0xC1}; // inc d; jp $C100
+    static const u8 bank_b[] = {0x1C, 0xC3, 0x00, 0xC1}; // inc e; jp $C100
+    static const u8 loop[] = {
+        0x0D,             // dec c
+        0xC2, 0x00, 0xC0, // jp nz, $C000
+        0x76,             // halt
+    };
+
+    Jit *const jit = new_jit();
+    jit->hot_threshold = 0;
+    Memory mem = flat_memory(flat_ram);
+
+    memcpy(&flat_ram[0xC000], bank_a, sizeof(bank_a));
+    memcpy(&flat_ram[0xC100], loop, sizeof(loop));
+    Jit_map(jit, 0xC0, 0xC0, 0x1000);
+
+    Cpu cpu = Cpu_new();
+    cpu.pc = 0xC000;
+    cpu.c = 100;
+    cpu.jit = jit;
+
+    for (int i = 0; i < 10; ++i)
+        Cpu_tick(&cpu, &mem);
+
+    const u8 d = cpu.d;
+    TEST_ASSERT_GREATER_THAN(0, d);
+
+    // The loop has been chained into the block at $C000 by now
+    memcpy(&flat_ram[0xC000], bank_b, sizeof(bank_b));
+    Jit_map(jit, 0xC0, 0xC0, 0x1001);
+    run_until_halt(&cpu, &mem);
+
+    TEST_ASSERT_EQUAL(d, cpu.d);
+    TEST_ASSERT_EQUAL(100 - d, cpu.e);
+
+    Jit_destroy(jit);
+}
@@ -0,0 +1,109 @@
+#include "data.h"
+#include "mapper.h"
+#include "stdinc.h"
+#include <unity.h>
+
+void test_mapper_mbc1_bank_zero_selects_one()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc1, 32, 0);
+
+    TEST_ASSERT_EQUAL(1, Mapper_rom_bank_hi(&mapper));
+
+    Mapper_write(&mapper, 0x2000, 0x00);
+    TEST_ASSERT_EQUAL(1, Mapper_rom_bank_hi(&mapper));
+
+    // Only the lower 5 bits are checked against 0
+    Mapper_write(&mapper, 0x3FFF, 0xE0);
+    TEST_ASSERT_EQUAL(1, Mapper_rom_bank_hi(&mapper));
+
+    Mapper_write(&mapper, 0x2000, 0x1F);
+    TEST_ASSERT_EQUAL(0x1F, Mapper_rom_bank_hi(&mapper));
+}
+
+void test_mapper_mbc1_upper_bits()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc1RamBattery, 128, 4);
+    size_t ram_bank;
+
+    Mapper_write(&mapper, 0x0000, 0x0A);
+    Mapper_write(&mapper, 0x2000, 0x00);
+    Mapper_write(&mapper, 0x4000, 0x02);
+
+    // Mode 0: upper bits only apply to 4000-7FFF
+    TEST_ASSERT_EQUAL(0x41, Mapper_rom_bank_hi(&mapper));
+    TEST_ASSERT_EQUAL(0, Mapper_rom_bank_lo(&mapper));
+    TEST_ASSERT_TRUE(Mapper_ram_bank(&mapper, &ram_bank));
+    TEST_ASSERT_EQUAL(0, ram_bank);
+
+    // Mode 1: they also apply to 0000-3FFF and external RAM
+    Mapper_write(&mapper, 0x6000, 0x01);
+
+    TEST_ASSERT_EQUAL(0x41, Mapper_rom_bank_hi(&mapper));
+    TEST_ASSERT_EQUAL(0x40, Mapper_rom_bank_lo(&mapper));
+    TEST_ASSERT_TRUE(Mapper_ram_bank(&mapper, &ram_bank));
+    TEST_ASSERT_EQUAL(2, ram_bank);
+}
+
+void test_mapper_banks_wrap_around_rom_size()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc1, 8, 0);
+
+    Mapper_write(&mapper, 0x2000, 0x0B);
+    TEST_ASSERT_EQUAL(3, Mapper_rom_bank_hi(&mapper));
+}
+
+void test_mapper_ram_enable()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc5Ram, 4, 1);
+    size_t ram_bank;
+
+    TEST_ASSERT_FALSE(Mapper_ram_bank(&mapper, &ram_bank));
+
+    Mapper_write(&mapper, 0x0000, 0x0A);
+    TEST_ASSERT_TRUE(Mapper_ram_bank(&mapper, &ram_bank));
+
+    Mapper_write(&mapper, 0x1FFF, 0x00);
+    TEST_ASSERT_FALSE(Mapper_ram_bank(&mapper, &ram_bank));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, Mapper_read_register(&mapper));
+}
+
+void test_mapper_mbc3_rtc_latch()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc3TimerRamBattery, 64, 4);
+    size_t ram_bank;
+
+    Mapper_write(&mapper, 0x0000, 0x0A);
+    Mapper_write(&mapper, 0x4000, 0x08);
+
+    TEST_ASSERT_FALSE(Mapper_ram_bank(&mapper, &ram_bank));
+
+    Mapper_write_register(&mapper, 0x2A);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Mapper_read_register(&mapper));
+
+    // Latched on writing $00 then $01
+    Mapper_write(&mapper, 0x6000, 0x01);
+    TEST_ASSERT_EQUAL_HEX8(0x00, Mapper_read_register(&mapper));
+
+    Mapper_write(&mapper, 0x6000, 0x00);
+    Mapper_write(&mapper, 0x6000, 0x01);
+    TEST_ASSERT_EQUAL_HEX8(0x2A, Mapper_read_register(&mapper));
+
+    Mapper_write(&mapper, 0x4000, 0x03);
+    TEST_ASSERT_TRUE(Mapper_ram_bank(&mapper, &ram_bank));
+    TEST_ASSERT_EQUAL(3, ram_bank);
+}
+
+void test_mapper_mbc5_9_bit_banks()
+{
+    Mapper mapper = Mapper_new(CartridgeType_Mbc5, 512, 0);
+
+    // Unlike on MBC1 and MBC3, bank 0 may be mapped at 4000-7FFF
+    Mapper_write(&mapper, 0x2000, 0x00);
+    TEST_ASSERT_EQUAL(0, Mapper_rom_bank_hi(&mapper));
+
+    Mapper_write(&mapper, 0x3000, 0x01);
+    TEST_ASSERT_EQUAL(0x100, Mapper_rom_bank_hi(&mapper));
+
+    Mapper_write(&mapper, 0x2000, 0x42);
+    TEST_ASSERT_EQUAL(0x142, Mapper_rom_bank_hi(&mapper));
+}
@@ -0,0 +1,302 @@
+#include "game_boy.h"
+#include "ppu.h"
+#include "stdinc.h"
+#include "test_helpers.h"
+#include <string.h>
+#include <unity.h>
+
+/**
+ * \brief Gets how far into a video frame a dot of a line is.
+ */
+static double progress_at(const int line, const int dot)
+{
+    return (line + ((double)dot / PPU_LINE_DOTS)) / GB_LCD_MAX_LY;
+}
+
+/**
+ * \brief Creates a GameBoy with no cartridge, a few solid tiles and palettes
+ * that map every color to its own shade.
+ */
+static GameBoy new_tiled_game_boy()
+{
+    GameBoy gb = new_game_boy(nullptr, nullptr);
+
+    // Tile 1 is solid color 3, tile 2 solid color 1, and tile 0 is blank
+    memset(&gb.vram[0x10], 0xFF, 0x10);
+    for (size_t i = 0; i < 8; ++i)
+        gb.vram[0x20 + (i * 2)] = 0xFF;
+
+    gb.lcdc = LcdControl_Enable | LcdControl_BgwTileArea |
+              LcdControl_ObjBgwEnable;
+    GameBoy_write_mem(&gb, 0xFF47, 0b11100100);
+    GameBoy_write_mem(&gb, 0xFF48, 0b11100100);
+    return gb;
+}
+
+static const u8 *line(const GameBoy *const gb, const size_t ly)
+{
+    return &gb->framebuffer[ly * GB_LCD_WIDTH];
+}
+
+/**
+ * \brief Draws every line of a video frame, starting a new one if need be.
+ */
+static void draw_frame(GameBoy *const gb)
+{
+    Ppu_update(gb, progress_at(0, 0));
+    Ppu_update(gb, progress_at(GB_LCD_HEIGHT, 0));
+}
+
+/**
+ * \brief Marks a line with a shade it is never drawn with, to tell whether it
+ * gets drawn over.
+ */
+static void mark_line(GameBoy *const gb, const size_t ly)
+{
+    gb->framebuffer[(ly * GB_LCD_WIDTH) + 100] = 2;
+}
+
+void test_ppu_draws_lines_at_end_of_mode_3()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.vram[0x1800 + 1] = 1;
+
+    Ppu_update(&gb, progress_at(0, 100));
+    TEST_ASSERT_EQUAL_HEX8(PpuMode_Drawing, gb.stat & 0b11);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 0)[8]);
+
+    Ppu_update(&gb, progress_at(0, 300));
+    TEST_ASSERT_EQUAL_HEX8(PpuMode_HBlank, gb.stat & 0b11);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 0)[7]);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 0)[8]);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 0)[15]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 0)[16]);
+
+    // Changes partway through the frame only apply to the lines after them
+    gb.scx = 4;
+    GameBoy_write_mem(&gb, 0xFF47, 0b01100100);
+
+    Ppu_update(&gb, progress_at(2, 300));
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 0)[8]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 1)[3]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 1)[4]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 2)[11]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 2)[12]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_stat_and_interrupts()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.lcy = 2;
+    gb.stat = StatSelect_Lyc | StatSelect_Mode0;
+
+    Ppu_update(&gb, progress_at(1, 0));
+    TEST_ASSERT_EQUAL_HEX8(1, gb.ly);
+    TEST_ASSERT_EQUAL_HEX8(PpuMode_OamScan, gb.stat & 0b111);
+    TEST_ASSERT_EQUAL_HEX8(0, gb.if_);
+
+    Ppu_update(&gb, progress_at(1, 300));
+    TEST_ASSERT_EQUAL_HEX8(InterruptFlag_Lcd, gb.if_);
+    gb.if_ = 0;
+
+    Ppu_update(&gb, progress_at(2, 0));
+    TEST_ASSERT_EQUAL_HEX8(0b100 | PpuMode_OamScan, gb.stat & 0b111);
+    TEST_ASSERT_EQUAL_HEX8(InterruptFlag_Lcd, gb.if_);
+    gb.if_ = 0;
+
+    Ppu_update(&gb, progress_at(GB_LCD_HEIGHT, 0));
+    TEST_ASSERT_EQUAL_HEX8(PpuMode_VBlank, gb.stat & 0b111);
+    TEST_ASSERT_EQUAL_HEX8(InterruptFlag_VBlank, gb.if_);
+
+    // LY is held at 0 while the LCD is off, which also blanks it
+    memset(gb.framebuffer, 3, (size_t)GB_LCD_WIDTH * GB_LCD_HEIGHT);
+    GameBoy_write_mem(&gb, 0xFF40, 0x00);
+    Ppu_update(&gb, progress_at(50, 300));
+
+    TEST_ASSERT_EQUAL_HEX8(0, gb.ly);
+    TEST_ASSERT_EQUAL_HEX8(PpuMode_HBlank, gb.stat & 0b11);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 143)[159]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_window()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.lcdc |= LcdControl_WinEnable | LcdControl_WinTileMap;
+    gb.wx = 7 + 100;
+    gb.wy = 1;
+    gb.vram[0x1C00] = 1;
+    gb.vram[0x1C00 + 32] = 2;
+
+    Ppu_update(&gb, progress_at(9, 300));
+
+    // Above wy, and then left of wx
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 0)[100]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 1)[99]);
+
+    // The window starts from its own first line, on whichever line wy is
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 1)[100]);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 8)[107]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 8)[108]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 9)[100]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_objects()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.lcdc |= LcdControl_ObjEnable;
+    GameBoy_write_mem(&gb, 0xFF49, 0b10100100);
+
+    // Object 0 on top of object 1, which is further left and so wins
+    const u8 oam[][4] = {
+        {16, 8 + 4, 2, 0},
+        {16, 8 + 0, 1, ObjAttrs_DmgPalette},
+        {16, 8 + 20, 1, ObjAttrs_Priority},
+    };
+    memcpy(gb.oam, oam, sizeof(oam));
+
+    // Background color 1 under the low-priority object
+    gb.vram[0x1800 + 3] = 2;
+
+    Ppu_update(&gb, progress_at(0, 300));
+
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 0)[0]);
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 0)[7]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 0)[8]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 0)[11]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 0)[12]);
+
+    // Behind background colors other than 0
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 0)[20]);
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 0)[24]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_redraws_only_changed_lines()
+{
+    GameBoy gb = new_tiled_game_boy();
+
+    Ppu_update(&gb, progress_at(GB_LCD_HEIGHT, 0));
+    gb.framebuffer_dirty = false;
+
+    // Marks lines, to tell whether they get drawn over
+    gb.framebuffer[0] = 2;
+    gb.framebuffer[GB_LCD_WIDTH] = 2;
+
+    Ppu_update(&gb, progress_at(0, 300));
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 0)[0]);
+    TEST_ASSERT_FALSE(gb.framebuffer_dirty);
+
+    // Rewriting what a register, VRAM or OAM already holds changes nothing
+    GameBoy_write_mem(&gb, 0xFF42, gb.scy);
+    GameBoy_write_mem(&gb, 0x9800, gb.vram[0x1800]);
+    GameBoy_write_mem(&gb, 0xFE00, gb.oam[0]);
+
+    Ppu_update(&gb, progress_at(1, 300));
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 1)[0]);
+    TEST_ASSERT_FALSE(gb.framebuffer_dirty);
+
+    mark_line(&gb, 2);
+    GameBoy_write_mem(&gb, 0xFF43, gb.scx + 1);
+
+    Ppu_update(&gb, progress_at(2, 300));
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 2)[100]);
+    TEST_ASSERT_TRUE(gb.framebuffer_dirty);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_redraws_lines_the_window_moved_on()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.wx = 7;
+
+    // Tile 3 has color 1 on its first row and color 2 on its third
+    gb.vram[0x30] = 0xFF;
+    gb.vram[0x30 + 5] = 0xFF;
+    gb.vram[0x1800] = 3;
+
+    // The window is turned on after line 1, so line 2 shows its first line
+    Ppu_update(&gb, progress_at(1, 300));
+    GameBoy_write_mem(&gb, 0xFF40, gb.lcdc | LcdControl_WinEnable);
+    Ppu_update(&gb, progress_at(GB_LCD_HEIGHT, 0));
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 2)[0]);
+
+    // Without any writes, but with the window on from the top, line 2 shows
+    // its third line
+    Ppu_update(&gb, progress_at(0, 0));
+    Ppu_update(&gb, progress_at(2, 300));
+    TEST_ASSERT_EQUAL_HEX8(1, line(&gb, 0)[0]);
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 2)[0]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_redraws_only_lines_reading_changed_vram()
+{
+    GameBoy gb = new_tiled_game_boy();
+
+    // Lines 0-7 show tile 1, lines 8-15 tile 2, and every line tile 0
+    gb.vram[0x1800] = 1;
+    gb.vram[0x1800 + 32] = 2;
+    draw_frame(&gb);
+
+    for (size_t ly = 0; ly < 32; ly += 8)
+        mark_line(&gb, ly);
+
+    // Tile 2, which only lines 8-15 read, and the third row of the map
+    GameBoy_write_mem(&gb, 0x8020, 0x00);
+    GameBoy_write_mem(&gb, 0x9800 + 64, 1);
+    draw_frame(&gb);
+
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 0)[100]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 8)[100]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 16)[100]);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 16)[0]);
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 24)[100]);
+
+    GameBoy_destroy(&gb);
+}
+
+void test_ppu_redraws_only_lines_of_changed_objects()
+{
+    GameBoy gb = new_tiled_game_boy();
+    gb.lcdc |= LcdControl_ObjEnable;
+
+    // Object 0 shows tile 1 at the left of lines 40-47, and the others are
+    // off screen
+    gb.oam[0] = 16 + 40;
+    gb.oam[1] = 8;
+    gb.oam[2] = 1;
+    draw_frame(&gb);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 40)[0]);
+
+    mark_line(&gb, 0);
+    mark_line(&gb, 40);
+    mark_line(&gb, 60);
+
+    // Transferring the same objects again changes nothing
+    memcpy(gb.ram, gb.oam, GB_OAM_DMA_CYCLES);
+    GameBoy_write_mem(&gb, 0xFF46, 0xC0);
+    GameBoy_step_dma(&gb, GB_OAM_DMA_CYCLES);
+    draw_frame(&gb);
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 40)[100]);
+
+    // Moving it redraws where it was and where it is now
+    GameBoy_write_mem(&gb, 0xFE00, 16 + 60);
+    draw_frame(&gb);
+
+    TEST_ASSERT_EQUAL_HEX8(2, line(&gb, 0)[100]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 40)[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 40)[100]);
+    TEST_ASSERT_EQUAL_HEX8(3, line(&gb, 60)[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, line(&gb, 60)[100]);
+
+    GameBoy_destroy(&gb);
+}
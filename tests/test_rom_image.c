@@ -0,0 +1,71 @@
+#include "rom_image.h"
+#include "stdinc.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static constexpr char ROM_PATH[] = "test_rom_image.gb";
+
+static u8 rom[0x8000];
+
+static void write_rom_file(const size_t len)
+{
+    for (size_t i = 0; i < sizeof(rom); ++i)
+        rom[i] = (u8)(i * 7 + 3);
+
+    FILE *const file = fopen(ROM_PATH, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(len, fwrite(rom, 1, len, file));
+    fclose(file);
+}
+
+void tearDown()
+{
+    remove(ROM_PATH);
+}
+
+void test_rom_image_open()
+{
+    write_rom_file(sizeof(rom));
+
+    RomImage *const image = RomImage_open(ROM_PATH);
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ASSERT_EQUAL(sizeof(rom), image->len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rom, image->data, sizeof(rom));
+
+    RomImage_release(image);
+}
+
+void test_rom_image_open_empty_file()
+{
+    write_rom_file(0);
+
+    RomImage *const image = RomImage_open(ROM_PATH);
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ASSERT_EQUAL(0, image->len);
+
+    RomImage_release(image);
+}
+
+void test_rom_image_open_missing_file()
+{
+    TEST_ASSERT_NULL(RomImage_open("does-not-exist.gb"));
+}
+
+void test_rom_image_refs()
+{
+    write_rom_file(0x100);
+
+    RomImage *const image = RomImage_copy(rom, 0x100);
+    TEST_ASSERT_EQUAL(1, atomic_load(&image->refs));
+
+    TEST_ASSERT_EQUAL_PTR(image, RomImage_retain(image));
+    TEST_ASSERT_EQUAL(2, atomic_load(&image->refs));
+
+    RomImage_release(image);
+    TEST_ASSERT_EQUAL(1, atomic_load(&image->refs));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rom, image->data, 0x100);
+
+    RomImage_release(image);
+}
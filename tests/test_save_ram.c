@@ -0,0 +1,112 @@
+#include "save_ram.h"
+#include "stdinc.h"
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static constexpr char SAVE_PATH[] = "test_save_ram.sav";
+
+static u8 contents[0x2000];
+
+static void read_save_file(const size_t len)
+{
+    memset(contents, 0xAA, sizeof(contents));
+
+    FILE *const file = fopen(SAVE_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(len, fread(contents, 1, sizeof(contents), file));
+    fclose(file);
+}
+
+void tearDown()
+{
+    remove(SAVE_PATH);
+}
+
+void test_save_ram_open_creates_file()
+{
+    SaveRam *const save = SaveRam_open(SAVE_PATH, 0x2000, 0);
+    TEST_ASSERT_NOT_NULL(save);
+    TEST_ASSERT_EQUAL(0x2000, save->len);
+    TEST_ASSERT_EQUAL_HEX8(0x00, save->data[0x1FFF]);
+    SaveRam_close(save);
+
+    read_save_file(0x2000);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x00, contents, 0x2000);
+}
+
+void test_save_ram_persists()
+{
+    SaveRam *save = SaveRam_open(SAVE_PATH, 0x2000, 0);
+    TEST_ASSERT_NOT_NULL(save);
+
+    save->data[0x0123] = 0x42;
+    SaveRam_mark_dirty(save, 0x0123);
+    save->data[0x1FFF] = 0x99;
+    SaveRam_mark_dirty(save, 0x1FFF);
+    SaveRam_close(save);
+
+    save = SaveRam_open(SAVE_PATH, 0x2000, 0);
+    TEST_ASSERT_NOT_NULL(save);
+    TEST_ASSERT_EQUAL_HEX8(0x42, save->data[0x0123]);
+    TEST_ASSERT_EQUAL_HEX8(0x99, save->data[0x1FFF]);
+    SaveRam_close(save);
+}
+
+void test_save_ram_flush_clears_dirty()
+{
+    SaveRam *const save = SaveRam_open(SAVE_PATH, 0x2000, 0);
+    TEST_ASSERT_NOT_NULL(save);
+
+    const size_t chunk = 0x1800 >> save->chunk_shift;
+
+    save->data[0x1800] = 0x5A;
+    SaveRam_mark_dirty(save, 0x1800);
+    TEST_ASSERT_TRUE(atomic_load(&save->dirty[chunk]));
+
+    SaveRam_flush(save);
+    TEST_ASSERT_FALSE(atomic_load(&save->dirty[chunk]));
+
+    // Readable from the file before the save RAM is closed
+    read_save_file(0x2000);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, contents[0x1800]);
+
+    SaveRam_close(save);
+}
+
+void test_save_ram_pads_short_file()
+{
+    FILE *const file = fopen(SAVE_PATH, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(3, fwrite("\x01\x02\x03", 1, 3, file));
+    fclose(file);
+
+    SaveRam *const save = SaveRam_open(SAVE_PATH, 0x2000, 0);
+    TEST_ASSERT_NOT_NULL(save);
+    TEST_ASSERT_EQUAL_HEX8(0x03, save->data[0x0002]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, save->data[0x0003]);
+    SaveRam_close(save);
+
+    read_save_file(0x2000);
+}
+
+void test_save_ram_background_flush()
+{
+    SaveRam *const save = SaveRam_open(SAVE_PATH, 0x2000, 1);
+    TEST_ASSERT_NOT_NULL(save);
+
+    save->data[0x0000] = 0x77;
+    SaveRam_mark_dirty(save, 0x0000);
+
+    // The flusher clears the flag once it picks the chunk up
+    for (int i = 0; i < 1000 && atomic_load(&save->dirty[0]); ++i)
+        SDL_Delay(1);
+
+    TEST_ASSERT_FALSE(atomic_load(&save->dirty[0]));
+    SaveRam_close(save);
+
+    read_save_file(0x2000);
+    TEST_ASSERT_EQUAL_HEX8(0x77, contents[0x0000]);
+}
@@ -0,0 +1,69 @@
+#include "game_boy.h"
+#include "stdinc.h"
+#include "tile_cache.h"
+#include <string.h>
+#include <unity.h>
+
+static u8 vram[0x2000];
+
+void test_tile_cache_decodes_rows()
+{
+    memset(vram, 0, sizeof(vram));
+
+    // Colors 0, 1, 2 and 3, then 3 to the right edge
+    vram[0x10 + 2] = 0b01011111;
+    vram[0x10 + 3] = 0b00111111;
+
+    TileCache *const tiles = TileCache_new(vram);
+
+    const u8 expected[8] = {0, 1, 2, 3, 3, 3, 3, 3};
+    const u8 expected_flipped[8] = {3, 3, 3, 3, 3, 2, 1, 0};
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, TileCache_row(tiles, 1, 1, false),
+                                 8);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_flipped,
+                                 TileCache_row(tiles, 1, 1, true), 8);
+
+    // Until invalidated, the tile stays as it was decoded
+    vram[0x10 + 2] = 0x00;
+    TEST_ASSERT_EQUAL_HEX8(1, TileCache_row(tiles, 1, 1, false)[1]);
+
+    TileCache_invalidate(tiles, 0x10 + 2);
+    TEST_ASSERT_EQUAL_HEX8(0, TileCache_row(tiles, 1, 1, false)[1]);
+    TEST_ASSERT_EQUAL_HEX8(2, TileCache_row(tiles, 1, 1, false)[3]);
+
+    TileCache_destroy(tiles);
+}
+
+void test_tile_cache_invalidated_by_vram_writes()
+{
+    GameBoy gb = GameBoy_new(nullptr);
+
+    TEST_ASSERT_EQUAL_HEX8(0, TileCache_row(gb.tiles, 0, 0, false)[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, TileCache_row(gb.tiles, 383, 7, false)[7]);
+    TEST_ASSERT_EQUAL_HEX8(0, TileCache_row(gb.tiles, 2, 0, false)[0]);
+
+    GameBoy_write_mem(&gb, 0x8000, 0x80);
+    TEST_ASSERT_EQUAL_HEX8(1, TileCache_row(gb.tiles, 0, 0, false)[0]);
+
+    GameBoy_write_mem(&gb, 0x97FF, 0x01);
+    TEST_ASSERT_EQUAL_HEX8(2, TileCache_row(gb.tiles, 383, 7, false)[7]);
+
+    // Blocks spanning several tiles invalidate all of them
+    u8 block[0x22];
+    memset(block, 0xFF, sizeof(block));
+    GameBoy_write_block(&gb, 0x800F, block, sizeof(block));
+
+    TEST_ASSERT_EQUAL_HEX8(2, TileCache_row(gb.tiles, 0, 7, false)[0]);
+    TEST_ASSERT_EQUAL_HEX8(3, TileCache_row(gb.tiles, 1, 0, false)[0]);
+    TEST_ASSERT_EQUAL_HEX8(3, TileCache_row(gb.tiles, 2, 0, false)[0]);
+
+    // Tile maps are not tile data
+    u64 dirty[sizeof(gb.tiles->dirty) / sizeof(u64)];
+    memcpy(dirty, gb.tiles->dirty, sizeof(dirty));
+
+    GameBoy_write_mem(&gb, 0x9800, 0x01);
+    TEST_ASSERT_EQUAL_MEMORY(dirty, gb.tiles->dirty, sizeof(dirty));
+
+    GameBoy_destroy(&gb);
+}
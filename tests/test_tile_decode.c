@@ -0,0 +1,54 @@
+#include "stdinc.h"
+#include "tile_decode.h"
+#include <string.h>
+#include <unity.h>
+
+static const u8 COLOR_IDS[4] = {0, 1, 2, 3};
+
+void test_decode_2bpp_scalar()
+{
+    // Colors 0, 1, 2 and 3, then 3 to the right edge
+    const u8 data[2] = {0b01011111, 0b00111111};
+    const u8 palette[4] = {0x10, 0x11, 0x12, 0x13};
+    u8 row[8];
+
+    decode_2bpp_scalar(data, 1, COLOR_IDS, false, row);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((u8[]){0, 1, 2, 3, 3, 3, 3, 3}), row, 8);
+
+    decode_2bpp_scalar(data, 1, COLOR_IDS, true, row);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(((u8[]){3, 3, 3, 3, 3, 2, 1, 0}), row, 8);
+
+    decode_2bpp_scalar(data, 1, palette, false, row);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(
+        ((u8[]){0x10, 0x11, 0x12, 0x13, 0x13, 0x13, 0x13, 0x13}), row, 8);
+}
+
+void test_decode_2bpp_matches_scalar()
+{
+    const char *const name = decode_2bpp_kernel_name();
+    TEST_ASSERT_TRUE(strcmp(name, "avx2") == 0 || strcmp(name, "sse2") == 0 ||
+                     strcmp(name, "scalar") == 0);
+
+    u8 data[2 * 13];
+    u32 seed = 0x2BB;
+
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        seed = (seed * 1103515245) + 12345;
+        data[i] = (u8)(seed >> 16);
+    }
+
+    const u8 palette[4] = {3, 0, 2, 1};
+
+    // Row counts the wider kernels have to finish off a row at a time
+    for (size_t rows = 0; rows <= 13; ++rows) {
+        for (int flip = 0; flip < 2; ++flip) {
+            u8 expected[8 * 13] = {};
+            u8 actual[8 * 13] = {};
+
+            decode_2bpp_scalar(data, rows, palette, flip, expected);
+            decode_2bpp(data, rows, palette, flip, actual);
+
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, actual, sizeof(expected));
+        }
+    }
+}